@@ -0,0 +1,204 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: castd
+// File: allocation_counter.h
+//---------------------------------------------------------------------------//
+// Brief: Counts the heap allocations of each thread.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_CASTD_ALLOCATION_COUNTER_H
+#define HEADER_GUARD_CAOCO_CASTD_ALLOCATION_COUNTER_H
+// Includes:
+#include "import_stl.h"
+
+#include <cstdlib>
+#include <new>
+
+// Opt-in: replaces the global operator new and delete to count, for test
+// builds only, e.g. caoco.cc built with -DCAOCO_COUNT_ALLOCATIONS=1. Off,
+// the counts stay 0 and nothing is replaced. A program defining it to 1 must
+// include this header in one translation unit only.
+#ifndef CAOCO_COUNT_ALLOCATIONS
+#define CAOCO_COUNT_ALLOCATIONS 0
+#endif
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+struct AllocationCount {
+  std::uint64_t count = 0;
+  std::uint64_t bytes = 0;
+
+  AllocationCount operator-(const AllocationCount& before) const {
+    return {count - before.count, bytes - before.bytes};
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// AllocationCounter
+//---------------------------------------------------------------------------//
+// The allocations of the calling thread since it started. Take the
+// difference of two counts around the code to measure. Freeing is not
+// counted, the sizes are those requested.
+class AllocationCounter {
+  static AllocationCount& ThreadCount() {
+    static thread_local AllocationCount count;
+    return count;
+  }
+
+ public:
+  static constexpr bool kEnabled = CAOCO_COUNT_ALLOCATIONS;
+
+  static AllocationCount Count() { return ThreadCount(); }
+
+  static void Record(std::size_t size) {
+    auto& count = ThreadCount();
+    count.count++;
+    count.bytes += size;
+  }
+};
+
+// The allocations of the calling thread since the scope was constructed.
+// Threads the measured code starts are not counted.
+class AllocationScope {
+  AllocationCount start_;
+
+ public:
+  AllocationScope() : start_(AllocationCounter::Count()) {}
+  AllocationCount Count() const { return AllocationCounter::Count() - start_; }
+  void Reset() { start_ = AllocationCounter::Count(); }
+};
+
+#if CAOCO_COUNT_ALLOCATIONS
+// Every replaced operator allocates with AllocateCounted and frees with
+// FreeCounted, so memory is freed as it was allocated whichever overload
+// the standard library picks. GCC cannot see that free matches the new it
+// inlined at each call site, hence the pragma.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+inline void* AllocateCounted(std::size_t size, std::size_t alignment,
+                             bool nothrow) {
+  AllocationCounter::Record(size);
+  size = size != 0 ? size : 1;
+  void* memory = nullptr;
+  if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    memory = std::malloc(size);
+  } else {
+#if defined(_MSC_VER)
+    memory = ::_aligned_malloc(size, alignment);
+#else
+    // aligned_alloc needs the size to be a multiple of the alignment.
+    memory = std::aligned_alloc(alignment,
+                                (size + alignment - 1) / alignment * alignment);
+#endif
+  }
+  if (memory == nullptr && !nothrow) throw std::bad_alloc();
+  return memory;
+}
+
+inline void FreeCounted(void* memory, std::size_t alignment) noexcept {
+#if defined(_MSC_VER)
+  if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    ::_aligned_free(memory);
+    return;
+  }
+#endif
+  static_cast<void>(alignment);
+  std::free(memory);
+}
+
+constexpr std::size_t kAllocationDefaultAlignment =
+    __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+void* operator new(std::size_t size) {
+  return AllocateCounted(size, kAllocationDefaultAlignment, false);
+}
+void* operator new[](std::size_t size) {
+  return AllocateCounted(size, kAllocationDefaultAlignment, false);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return AllocateCounted(size, kAllocationDefaultAlignment, true);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return AllocateCounted(size, kAllocationDefaultAlignment, true);
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return AllocateCounted(size, static_cast<std::size_t>(alignment), false);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return AllocateCounted(size, static_cast<std::size_t>(alignment), false);
+}
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return AllocateCounted(size, static_cast<std::size_t>(alignment), true);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  return AllocateCounted(size, static_cast<std::size_t>(alignment), true);
+}
+
+void operator delete(void* memory) noexcept {
+  FreeCounted(memory, kAllocationDefaultAlignment);
+}
+void operator delete[](void* memory) noexcept {
+  FreeCounted(memory, kAllocationDefaultAlignment);
+}
+void operator delete(void* memory, std::size_t) noexcept {
+  FreeCounted(memory, kAllocationDefaultAlignment);
+}
+void operator delete[](void* memory, std::size_t) noexcept {
+  FreeCounted(memory, kAllocationDefaultAlignment);
+}
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+  FreeCounted(memory, kAllocationDefaultAlignment);
+}
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+  FreeCounted(memory, kAllocationDefaultAlignment);
+}
+void operator delete(void* memory, std::align_val_t alignment) noexcept {
+  FreeCounted(memory, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void* memory, std::align_val_t alignment) noexcept {
+  FreeCounted(memory, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* memory, std::size_t,
+                     std::align_val_t alignment) noexcept {
+  FreeCounted(memory, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void* memory, std::size_t,
+                       std::align_val_t alignment) noexcept {
+  FreeCounted(memory, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* memory, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  FreeCounted(memory, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void* memory, std::align_val_t alignment,
+                       const std::nothrow_t&) noexcept {
+  FreeCounted(memory, static_cast<std::size_t>(alignment));
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: castd
+// File: allocation_counter.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_CASTD_ALLOCATION_COUNTER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,392 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: cand_lang
+// File: aot_runtime.h
+//---------------------------------------------------------------------------//
+// Brief: Runtime library of C& programs compiled ahead of time.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_CAND_LANG_AOT_RUNTIME_H
+#define HEADER_GUARD_CAOCO_CAND_LANG_AOT_RUNTIME_H
+// Includes:
+#include "cand_lang.h"
+#include "import_stl.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+// Source generated by IrTranspiler (ir_transpiler.h) includes this header
+// and nothing else. Each operation has the semantics and the error messages
+// of the Evaluator, so a program prints the same text and fails with the
+// same message whether it is interpreted or compiled.
+
+// Text written by the cout builtin.
+inline std::string AotDisplayString(const RtVal& value) {
+  switch (value.Type()) {
+    case RtVal::kInt:
+      return std::to_string(value.GetInt());
+    case RtVal::kDouble: {
+      std::ostringstream os;
+      os << value.GetDouble();
+      return os.str();
+    }
+    case RtVal::kBool:
+      return value.GetBool() ? "true" : "false";
+    case RtVal::kString:
+      return value.GetString() == nullptr ? "" : *value.GetString();
+    case RtVal::kNone:
+      return "none";
+    case RtVal::kUndefined:
+      return "undefined";
+    case RtVal::kMethod:
+      return "<method>";
+    case RtVal::kObject:
+      return "<object>";
+    default:
+      return "<value>";
+  }
+}
+
+[[noreturn]] inline void AotThrow(const std::string& what) {
+  throw std::runtime_error(what);
+}
+
+// An expression which fails, for ops the Evaluator rejects at runtime.
+[[noreturn]] inline RtVal AotFail(const std::string& what) { AotThrow(what); }
+
+inline RtVal AotInt(RtVal::IntT value) {
+  return RtVal(RtVal::NativeVariant(std::in_place_type<RtVal::IntT>, value));
+}
+inline RtVal AotBool(RtVal::BoolT value) {
+  return RtVal(RtVal::NativeVariant(std::in_place_type<RtVal::BoolT>, value));
+}
+inline RtVal AotDouble(RtVal::DoubleT value) {
+  return RtVal(
+      RtVal::NativeVariant(std::in_place_type<RtVal::DoubleT>, value));
+}
+inline RtVal AotString(const std::string& value) {
+  return RtVal(RtVal::NativeVariant(std::in_place_type<RtVal::StringT>,
+                                    std::make_shared<std::string>(value)));
+}
+
+// Runs a RtVal operator, which reports errors by throwing a C string.
+template <class OpT>
+RtVal AotApply(OpT op) {
+  try {
+    return op();
+  } catch (const char* what) {
+    throw std::runtime_error(what);
+  } catch (const std::bad_variant_access&) {
+    throw std::runtime_error("Operand types do not match.");
+  }
+}
+
+// Left operand of a binary operator. Binding it first evaluates the
+// operands from left to right, like the Evaluator: AotLhs{a}.Add(b).
+// Ints take an inline path, every other type goes through RtVal.
+struct AotLhs {
+  const RtVal& lhs;
+
+  bool BothInt(const RtVal& rhs) const {
+    return lhs.Type() == RtVal::kInt && rhs.Type() == RtVal::kInt;
+  }
+  RtVal::IntT L() const { return lhs.GetAs<RtVal::IntT>(); }
+  static RtVal::IntT R(const RtVal& rhs) { return rhs.GetAs<RtVal::IntT>(); }
+  // Ints wrap on overflow.
+  static RtVal::IntT Wrap(unsigned value) {
+    return static_cast<RtVal::IntT>(value);
+  }
+
+  RtVal Add(const RtVal& rhs) const {
+    if (BothInt(rhs)) {
+      return AotInt(Wrap(static_cast<unsigned>(L()) +
+                         static_cast<unsigned>(R(rhs))));
+    }
+    return AotApply([&] { return lhs.AddOp(rhs); });
+  }
+  RtVal Sub(const RtVal& rhs) const {
+    if (BothInt(rhs)) {
+      return AotInt(Wrap(static_cast<unsigned>(L()) -
+                         static_cast<unsigned>(R(rhs))));
+    }
+    return AotApply([&] { return lhs.SubOp(rhs); });
+  }
+  RtVal Mul(const RtVal& rhs) const {
+    if (BothInt(rhs)) {
+      return AotInt(Wrap(static_cast<unsigned>(L()) *
+                         static_cast<unsigned>(R(rhs))));
+    }
+    return AotApply([&] { return lhs.MulOp(rhs); });
+  }
+  RtVal Div(const RtVal& rhs) const {
+    if (BothInt(rhs) && R(rhs) != 0 && R(rhs) != -1) {
+      return AotInt(L() / R(rhs));
+    }
+    return AotApply([&] { return lhs.DivOp(rhs); });
+  }
+  RtVal Mod(const RtVal& rhs) const {
+    if (BothInt(rhs) && R(rhs) != 0 && R(rhs) != -1) {
+      return AotInt(L() % R(rhs));
+    }
+    return AotApply([&] { return lhs.ModOp(rhs); });
+  }
+  RtVal Eq(const RtVal& rhs) const {
+    if (BothInt(rhs)) return AotBool(L() == R(rhs));
+    return AotApply([&] { return lhs.EqOp(rhs); });
+  }
+  RtVal Ne(const RtVal& rhs) const {
+    if (BothInt(rhs)) return AotBool(L() != R(rhs));
+    return AotApply([&] { return lhs.NeOp(rhs); });
+  }
+  RtVal Lt(const RtVal& rhs) const {
+    if (BothInt(rhs)) return AotBool(L() < R(rhs));
+    return AotApply([&] { return lhs.LtOp(rhs); });
+  }
+  RtVal Gt(const RtVal& rhs) const {
+    if (BothInt(rhs)) return AotBool(L() > R(rhs));
+    return AotApply([&] { return lhs.GtOp(rhs); });
+  }
+  RtVal Le(const RtVal& rhs) const {
+    if (BothInt(rhs)) return AotBool(L() <= R(rhs));
+    return AotApply([&] { return lhs.LeOp(rhs); });
+  }
+  RtVal Ge(const RtVal& rhs) const {
+    if (BothInt(rhs)) return AotBool(L() >= R(rhs));
+    return AotApply([&] { return lhs.GeOp(rhs); });
+  }
+};
+
+// Left operand of a short circuit operator, and the operand of UNARY_NOT.
+inline bool AotLogical(const RtVal& value) {
+  if (value.Type() != RtVal::kBool) {
+    AotThrow("Logical operand must be a bool.");
+  }
+  return value.GetAs<RtVal::BoolT>();
+}
+// Right operand of a short circuit operator.
+inline RtVal AotLogicalRhs(const RtVal& value) {
+  return AotApply([&] { return AotBool(value.GetBool()); });
+}
+inline RtVal AotNot(const RtVal& value) { return AotBool(!AotLogical(value)); }
+
+inline bool AotCondition(const RtVal& value) {
+  if (value.Type() != RtVal::kBool) AotThrow("Condition must be a bool.");
+  return value.GetAs<RtVal::BoolT>();
+}
+
+// DECLARE_VARIABLE with a type constraint.
+inline const RtVal& AotConstrain(const RtVal& value, int type_constraint,
+                                 const std::string& var_name) {
+  if (type_constraint != value.Type() && value.Type() != RtVal::kUndefined) {
+    AotThrow("Type constraint violated: " + var_name);
+  }
+  return value;
+}
+
+// A variable declared in the outermost scope of the program.
+struct AotGlobal {
+  std::string name;
+  RtVal value{kRuntimeUndefined};
+  bool declared{false};
+
+  RtVal& Get() {
+    if (!declared) AotThrow("Variable not found: " + name);
+    return value;
+  }
+  void Declare(RtVal init, bool temp) {
+    if (declared && !temp) AotThrow("Variable already exists: " + name);
+    value = std::move(init);
+    declared = true;
+  }
+};
+
+struct AotCall;
+using AotBody = RtVal (*)(const AotCall&);
+
+// Body of the method whose first IR line is entry. Defined by the generated
+// program.
+AotBody AotBodyAt(std::size_t entry);
+
+// Arguments and instance of a call. Frames live on the C++ stack.
+struct AotCall {
+  std::span<const RtVal> args;
+  std::shared_ptr<CandObject> self;  // Instance of a member call, or null.
+};
+
+inline RtVal AotInvoke(AotBody body, std::size_t param_count,
+                       std::span<const RtVal> args,
+                       std::shared_ptr<CandObject> self) {
+  if (param_count != args.size()) {
+    AotThrow("Wrong number of arguments in call.");
+  }
+  return body(AotCall{args, std::move(self)});
+}
+
+inline RtVal AotInvoke(const CandMethod& method, std::span<const RtVal> args,
+                       std::shared_ptr<CandObject> self) {
+  return AotInvoke(AotBodyAt(method.EntryLine()), method.Args().size(), args,
+                   std::move(self));
+}
+
+// A method declared outside of a class.
+struct AotFunction {
+  AotBody body{nullptr};
+  std::size_t param_count{0};
+};
+
+// A class. Each DECLARE_OBJECT creates a new static environment.
+struct AotType {
+  RuntimeEnv* class_env{nullptr};
+  AotBody constructor{nullptr};
+
+  void Declare(AotBody body) {
+    static std::list<RuntimeEnv> class_envs;
+    class_env = &class_envs.emplace_back();
+    constructor = body;
+  }
+  RtVal Instantiate(std::span<const RtVal> args) const {
+    auto instance = std::make_shared<CandObject>(*class_env, nullptr, nullptr);
+    AotInvoke(constructor, 0, args, instance);
+    return RtVal(RtVal::NativeVariant(std::in_place_type<RtVal::ObjectT>,
+                                      std::move(instance)));
+  }
+};
+
+inline const CandMethod* AotFindMethod(const std::shared_ptr<CandObject>& self,
+                                       const std::string& method_name) {
+  if (self == nullptr ||
+      !self->object_env.ContainsLocal(method_name, eNameCategory::kFunction)) {
+    return nullptr;
+  }
+  return self->object_env.RetrieveLocal(method_name, eNameCategory::kFunction)
+      .GetMethod()
+      .get();
+}
+
+// DECLARE_METHOD in the body of a class. Each instance runs the class body,
+// the method is only defined once.
+inline void AotDeclareMember(const std::shared_ptr<CandObject>& self,
+                             const std::string& method_name,
+                             std::vector<std::string> params,
+                             std::size_t entry) {
+  auto& object_env = self->object_env;
+  if (!object_env.ContainsLocal(method_name, eNameCategory::kFunction)) {
+    object_env.Define(method_name, eNameCategory::kFunction,
+                      RtVal(RtVal::NativeVariant(
+                          std::in_place_type<RtVal::MethodT>,
+                          std::make_shared<CandMethod>(params, entry))));
+  }
+}
+
+// Variable lookup in the methods of a class: members of self, then globals.
+// global is null if the program declares no global of that name.
+inline RtVal& AotLookup(const std::shared_ptr<CandObject>& self,
+                        const std::string& var_name, AotGlobal* global) {
+  if (self != nullptr &&
+      self->local_env.ContainsLocal(var_name, eNameCategory::kVar)) {
+    return self->local_env.RetrieveLocal(var_name, eNameCategory::kVar);
+  }
+  if (global == nullptr) AotThrow("Variable not found: " + var_name);
+  return global->Get();
+}
+
+enum class eAotBuiltin { kNone, kCout, kCin };
+
+// Everything a CALL of name may resolve to, in the order of the Evaluator:
+// a method of self, a function, a class, then a builtin.
+struct AotCallee {
+  const char* name;
+  AotFunction* function;  // Null if no function of that name is declared.
+  AotType* type;          // Null if no class of that name is declared.
+  eAotBuiltin builtin;
+};
+
+inline RtVal AotCallBuiltin(eAotBuiltin builtin, std::span<const RtVal> args) {
+  if (builtin == eAotBuiltin::kCout) {
+    for (const auto& arg : args) {
+      std::cout << AotDisplayString(arg);
+    }
+    std::cout << std::endl;
+    return kRuntimeUndefined;
+  }
+  std::string read;
+  std::getline(std::cin, read);
+  return AotString(read);
+}
+
+inline RtVal AotCallName(const AotCallee& callee,
+                         std::initializer_list<RtVal> arg_list,
+                         const std::shared_ptr<CandObject>& self) {
+  std::span<const RtVal> args(arg_list.begin(), arg_list.size());
+  if (self != nullptr) {
+    if (auto method = AotFindMethod(self, callee.name)) {
+      return AotInvoke(*method, args, self);
+    }
+  }
+  if (callee.function != nullptr && callee.function->body != nullptr) {
+    return AotInvoke(callee.function->body, callee.function->param_count, args,
+                     nullptr);
+  }
+  if (callee.type != nullptr && callee.type->class_env != nullptr) {
+    return callee.type->Instantiate(args);
+  }
+  if (callee.builtin != eAotBuiltin::kNone) {
+    return AotCallBuiltin(callee.builtin, args);
+  }
+  AotThrow(std::string("Method not found: ") + callee.name);
+}
+
+// Method of an object, resolved before the arguments are evaluated:
+// AotMember(object, name).Call({args...}).
+struct AotMember {
+  std::shared_ptr<CandObject> self;
+  const CandMethod* method;
+
+  RtVal Call(std::initializer_list<RtVal> arg_list) const {
+    return AotInvoke(*method,
+                     std::span<const RtVal>(arg_list.begin(), arg_list.size()),
+                     self);
+  }
+};
+
+inline AotMember AotResolveMember(const RtVal& object,
+                                  const std::string& method_name) {
+  if (object.Type() != RtVal::kObject) {
+    AotThrow("Member call on a non object: " + method_name);
+  }
+  auto self = object.GetObject();
+  auto method = AotFindMethod(self, method_name);
+  if (method == nullptr) AotThrow("Method not found: " + method_name);
+  return AotMember{std::move(self), method};
+}
+
+// Entry point of a compiled program. Errors are written to stderr.
+inline int AotMain(AotBody program) {
+  try {
+    program(AotCall{});
+  } catch (const std::runtime_error& e) {
+    std::cout.flush();
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: cand_lang
+// File: aot_runtime.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_CAND_LANG_AOT_RUNTIME_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
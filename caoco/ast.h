@@ -7,6 +7,7 @@ class Ast {
  private:
   eAst type_{eAst::kInvalid};
   std::string literal_{""};
+  std::size_t line_{0};  // Source line of the first token, 0 if unknown.
   Ast* parent_{nullptr};
   std::list<Ast> children_;
 
@@ -42,6 +43,7 @@ class Ast {
       ChildTs... children)
       : type_(type) {
     literal_ = u8"";
+    if (beg != end) line_ = beg->Line();
     for (std::vector<Tk>::iterator it = beg; it != end; it++) {
       literal_ += it->Literal();
     }
@@ -52,6 +54,8 @@ class Ast {
   // Properties
   constexpr eAst Type() const noexcept;
   constexpr const std::string& Literal() const noexcept;
+  // Source line of the node, else of its first descendant which has one.
+  std::size_t Line() const noexcept;
   bool Leaf() const noexcept;
   constexpr bool Root() const noexcept;
   bool Branch() const noexcept;
@@ -92,15 +96,27 @@ class Ast {
            type_ == eAst::kMultiplication || type_ == eAst::kDivision ||
            type_ == eAst::kRemainder;
   }
+  bool IsComparisonBinaryOp() const noexcept {
+    return type_ == eAst::kEqual || type_ == eAst::kNotEqual ||
+           type_ == eAst::kLessThan || type_ == eAst::kGreaterThan ||
+           type_ == eAst::kLessThanOrEqual ||
+           type_ == eAst::kGreaterThanOrEqual;
+  }
+  bool IsLogicalBinaryOp() const noexcept {
+    return type_ == eAst::kLogicalAnd || type_ == eAst::kLogicalOr;
+  }
 };
 
 Ast::Ast(const Tk& t)
-    : type_(tk_traits::kTkTypeToAstNodeType(t.Type())), literal_(t.Literal()) {}
+    : type_(tk_traits::kTkTypeToAstNodeType(t.Type())),
+      literal_(t.Literal()),
+      line_(t.Line()) {}
 
 Ast::Ast(eAst type, std::vector<Tk>::iterator beg,
          std::vector<Tk>::iterator end)
     : type_(type) {
   literal_ = "";
+  if (beg != end) line_ = beg->Line();
   for (std::vector<Tk>::iterator it = beg; it != end; it++) {
     literal_ += it->Literal();
   }
@@ -110,6 +126,14 @@ constexpr eAst Ast::Type() const noexcept { return type_; }
 
 constexpr const std::string& Ast::Literal() const noexcept { return literal_; }
 
+std::size_t Ast::Line() const noexcept {
+  if (line_ != 0) return line_;
+  for (const auto& child : children_) {
+    if (auto line = child.Line()) return line;
+  }
+  return 0;
+}
+
 bool Ast::Leaf() const noexcept { return children_.empty(); }
 
 constexpr bool Ast::Root() const noexcept { return parent_ == nullptr; }
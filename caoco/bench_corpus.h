@@ -0,0 +1,316 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: bench_corpus.h
+//---------------------------------------------------------------------------//
+// Brief: Corpus of C& benchmark programs, run by each execution engine and
+//        checked against their golden output.
+// Sample Use:
+//       caoco bench benchmarks --repeats 5 --json bench.json
+//
+// A benchmark is a program <name>.cand of the corpus directory, and its
+// golden output <name>.out. Each engine compiles the program once, then
+// runs it BenchCorpusOptions::repeats times, and passes if every run
+// printed the golden output. The engines are:
+//   interpreter  One IR line per dispatch, no superinstructions nor JIT.
+//   bytecode     Tiered to superinstructions, see tier_manager.h.
+//   optimized    The bytecode tier on IR optimized like -O.
+//   jit          The optimized IR with hot regions compiled, on x86-64
+//                Linux only, see jit_x86_64.h.
+//   aot          The optimized IR transpiled to C++ and built by the system
+//                compiler, see ir_transpiler.h. Only when asked for, its
+//                time includes starting the process.
+// The JSON of the runs names each one <program>.<engine> with its median
+// time in median_ns, as minibench.h does, so the results of two commits
+// compare like the benchmarks of the unit tests.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_BENCH_CORPUS_H
+#define HEADER_GUARD_CAOCO_COMPILER_BENCH_CORPUS_H
+// Includes:
+#include "compilation_session.h"
+#include "evaluator.h"
+#include "expected.h"
+#include "import_stl.h"
+#include "ir_transpiler.h"
+#include "jit_x86_64.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+static constexpr std::string_view kBenchErrorCannotReadCorpus =
+    "Cannot read the benchmark directory.";
+static constexpr std::string_view kBenchErrorNoGolden =
+    "Benchmark has no golden output file:";
+static constexpr std::string_view kBenchErrorUnknownEngine =
+    "Unknown engine, expected interpreter, bytecode, optimized, jit or aot.";
+static constexpr std::string_view kBenchErrorWrongOutput =
+    "Output differs from the golden file.";
+static constexpr std::string_view kBenchErrorAotBuild =
+    "The system compiler failed to build the program.";
+
+enum class eBenchEngine { kInterpreter, kBytecode, kOptimized, kJit, kAot };
+
+constexpr std::string_view ToStr(eBenchEngine engine) {
+  switch (engine) {
+    case eBenchEngine::kInterpreter:
+      return "interpreter";
+    case eBenchEngine::kBytecode:
+      return "bytecode";
+    case eBenchEngine::kOptimized:
+      return "optimized";
+    case eBenchEngine::kJit:
+      return "jit";
+    default:
+      return "aot";
+  }
+}
+
+struct BenchProgram {
+  std::string name;  // File name without the extension.
+  std::string source;
+  std::string golden;  // Expected standard output.
+};
+
+struct BenchCorpusOptions {
+  std::size_t repeats = 5;  // Timed runs of each program per engine.
+  // Directory of aot_runtime.h, for the aot engine.
+  std::filesystem::path aot_include = std::filesystem::current_path();
+};
+
+// Runs of one program by one engine.
+struct BenchRun {
+  std::string program;
+  eBenchEngine engine{eBenchEngine::kInterpreter};
+  std::string error;  // Empty if every run printed the golden output.
+  std::chrono::nanoseconds compile{0};  // Including the aot build.
+  std::vector<std::chrono::nanoseconds> times;  // Sorted.
+  std::size_t dispatches{0};  // Of the last run, 0 for aot.
+
+  bool Passed() const { return error.empty(); }
+  std::string Name() const {
+    return program + "." + std::string(ToStr(engine));
+  }
+  std::chrono::nanoseconds Median() const {
+    return times.empty() ? std::chrono::nanoseconds{0}
+                         : times[times.size() / 2];
+  }
+  std::chrono::nanoseconds Fastest() const {
+    return times.empty() ? std::chrono::nanoseconds{0} : times.front();
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// BenchCorpus
+//---------------------------------------------------------------------------//
+class BenchCorpus {
+  BenchCorpusOptions options_;
+  std::vector<BenchRun> runs_;
+
+  static std::chrono::nanoseconds Since(
+      std::chrono::steady_clock::time_point start) {
+    return std::chrono::steady_clock::now() - start;
+  }
+
+  static std::string ReadFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>()};
+  }
+
+  // Runs code in the evaluator configured as the engine, into run.
+  void Evaluate(const BenchProgram& program, const IrCode& code,
+                BenchRun& run) const {
+    bool bytecode = run.engine != eBenchEngine::kInterpreter;
+    for (std::size_t i = 0; i < options_.repeats && run.Passed(); i++) {
+      Environment env;
+      std::istringstream in;
+      std::ostringstream out;
+      Evaluator evaluator{env, in, out};
+      evaluator.EnableFusion(bytecode)
+          .EnableJit(run.engine == eBenchEngine::kJit)
+          .SetLimits({.dispatches = 0, .frames = kEvaluatorDefaultFrameLimit});
+      auto start = std::chrono::steady_clock::now();
+      try {
+        evaluator.Evaluate(code);
+      } catch (const std::runtime_error& e) {
+        run.error = e.what();
+        return;
+      }
+      run.times.push_back(Since(start));
+      run.dispatches = evaluator.Dispatches();
+      if (out.str() != program.golden) run.error = kBenchErrorWrongOutput;
+    }
+  }
+
+  // Builds code with the system compiler and runs the executable, into run.
+  void RunCompiled(const BenchProgram& program, const IrCode& code,
+                   BenchRun& run) const {
+    auto dir = std::filesystem::temp_directory_path() / "caoco_bench";
+    std::filesystem::create_directories(dir);
+    auto exe = dir / program.name;
+    auto start = std::chrono::steady_clock::now();
+    if (IrTranspiler::Build(code, exe, options_.aot_include.string(),
+                            "c++ -std=c++20 -O2 -w") != 0) {
+      run.error = kBenchErrorAotBuild;
+      return;
+    }
+    run.compile += Since(start);
+    auto output = std::filesystem::path(exe).replace_extension(".out");
+    auto command = "\"" + exe.string() + "\" > \"" + output.string() + "\"";
+    for (std::size_t i = 0; i < options_.repeats && run.Passed(); i++) {
+      start = std::chrono::steady_clock::now();
+      int status = std::system(command.c_str());
+      run.times.push_back(Since(start));
+      if (status != 0 || ReadFile(output) != program.golden) {
+        run.error = kBenchErrorWrongOutput;
+      }
+    }
+  }
+
+ public:
+  explicit BenchCorpus(BenchCorpusOptions options = {}) : options_(options) {}
+
+  // The engines of this build, the aot engine if asked for.
+  static std::vector<eBenchEngine> Engines(bool aot = false) {
+    std::vector<eBenchEngine> engines = {eBenchEngine::kInterpreter,
+                                         eBenchEngine::kBytecode,
+                                         eBenchEngine::kOptimized};
+    if (CAOCO_JIT_SUPPORTED) engines.push_back(eBenchEngine::kJit);
+    if (aot) engines.push_back(eBenchEngine::kAot);
+    return engines;
+  }
+
+  static Expected<eBenchEngine> FindEngine(std::string_view name) {
+    for (auto engine : Engines(true)) {
+      if (ToStr(engine) == name) {
+        return Expected<eBenchEngine>::Success(engine);
+      }
+    }
+    return Expected<eBenchEngine>::Failure(
+        std::string(kBenchErrorUnknownEngine));
+  }
+
+  // The programs of a directory sorted by name, each with its golden file.
+  static Expected<std::vector<BenchProgram>> Load(
+      const std::filesystem::path& dir) {
+    using Result = Expected<std::vector<BenchProgram>>;
+    std::error_code error;
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, error)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".cand") {
+        paths.push_back(entry.path());
+      }
+    }
+    if (error) return Result::Failure(std::string(kBenchErrorCannotReadCorpus));
+    std::sort(paths.begin(), paths.end());
+    std::vector<BenchProgram> programs;
+    for (const auto& path : paths) {
+      auto golden = std::filesystem::path(path).replace_extension(".out");
+      if (!std::filesystem::is_regular_file(golden)) {
+        return Result::Failure(std::string(kBenchErrorNoGolden) + " " +
+                               golden.string());
+      }
+      programs.push_back(
+          {path.stem().string(), ReadFile(path), ReadFile(golden)});
+    }
+    return Result::Success(std::move(programs));
+  }
+
+  // Compiles and runs a program with an engine, the run is kept for the
+  // report.
+  BenchRun Run(const BenchProgram& program, eBenchEngine engine) {
+    BenchRun& run = runs_.emplace_back();
+    run.program = program.name;
+    run.engine = engine;
+    auto start = std::chrono::steady_clock::now();
+    bool optimize = engine != eBenchEngine::kInterpreter &&
+                    engine != eBenchEngine::kBytecode;
+    auto code =
+        CompilationSession({.optimize = optimize}).Compile(program.source);
+    run.compile = Since(start);
+    if (!code) {
+      run.error = code.Error();
+      return run;
+    }
+    if (engine == eBenchEngine::kAot) {
+      RunCompiled(program, code.Value(), run);
+    } else {
+      Evaluate(program, code.Value(), run);
+    }
+    std::sort(run.times.begin(), run.times.end());
+    return run;
+  }
+
+  // Runs every program with every engine, in that order. Returns false if
+  // a run failed.
+  bool RunAll(const std::vector<BenchProgram>& programs,
+              const std::vector<eBenchEngine>& engines) {
+    bool passed = true;
+    for (const auto& program : programs) {
+      for (auto engine : engines) {
+        passed = Run(program, engine).Passed() && passed;
+      }
+    }
+    return passed;
+  }
+
+  const std::vector<BenchRun>& Runs() const { return runs_; }
+
+  // A line per run: its median and fastest time, or its error.
+  void PrintReport(std::ostream& out) const {
+    auto ms = [](std::chrono::nanoseconds time) {
+      return std::chrono::duration<double, std::milli>(time).count();
+    };
+    auto flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    for (const auto& run : runs_) {
+      out << "[Bench " << run.Name() << "] ";
+      if (!run.Passed()) {
+        out << "FAILED: " << run.error << std::endl;
+        continue;
+      }
+      out << "median: " << ms(run.Median())
+          << "ms, fastest: " << ms(run.Fastest())
+          << "ms, compile: " << ms(run.compile)
+          << "ms, dispatches: " << run.dispatches << std::endl;
+    }
+    out.flags(flags);
+  }
+
+  void WriteJson(std::ostream& os) const {
+    os << "{\"benchmarks\":[";
+    for (std::size_t i = 0; i < runs_.size(); i++) {
+      const auto& run = runs_[i];
+      os << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << run.Name()
+         << "\",\"program\":\"" << run.program << "\",\"engine\":\""
+         << ToStr(run.engine) << "\",\"passed\":"
+         << (run.Passed() ? "true" : "false")
+         << ",\"repeats\":" << run.times.size()
+         << ",\"compile_ns\":" << run.compile.count()
+         << ",\"median_ns\":" << run.Median().count()
+         << ",\"fastest_ns\":" << run.Fastest().count()
+         << ",\"dispatches\":" << run.dispatches << "}";
+    }
+    os << "\n]}\n";
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: bench_corpus.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_BENCH_CORPUS_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,438 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: cand_driver.h
+//---------------------------------------------------------------------------//
+// Brief: Command line driver of the compiler.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_CAND_DRIVER_H
+#define HEADER_GUARD_CAOCO_COMPILER_CAND_DRIVER_H
+// Includes:
+#include "bench_corpus.h"
+#include "candc_module.h"
+#include "compilation_session.h"
+#include "compiler_daemon.h"
+#include "evaluator.h"
+#include "expected.h"
+#include "fuzz_targets.h"
+#include "import_stl.h"
+#include "module_graph.h"
+#include "phase_timer.h"
+#include "system_io.h"
+
+// Usage:
+//   caoco compile <file.cand> [-o <file.candc>] [-O] [--report]
+//                 [--cache <dir>]
+//     Writes the IR of a program and the files it imports to a module,
+//     optimized with -O. Prints the time of each file with --report. Reuses
+//     the files compiled into the cache directory which did not change.
+//   caoco run <file.cand|file.candc> [-O]
+//     Runs a program from source, or from a module without recompiling it.
+//     Calls nest at most kEvaluatorDefaultFrameLimit deep.
+//   caoco check <file.cand>
+//     Resolves the names of a program and the files it imports, prints a
+//     diagnostic per line.
+//   Any of the three also takes --time-passes, which prints the time,
+//   memory and allocations of each phase, and --trace <file.json>, which
+//   writes the phases as Chrome trace events.
+//   caoco daemon <socket> [--cache <dir>]
+//     Serves the commands above to clients of a Unix domain socket, keeping
+//     the modules they compile in memory. Stops on `caoco client <socket>
+//     stop`. A program run by the daemon is interpreted without the JIT and
+//     fails after kCandDriverDaemonDispatchLimit dispatches, so that a
+//     program which never ends cannot keep the daemon from stopping.
+//   caoco client <socket> <command> [<args>...]
+//     Runs a command in the daemon, sending the standard input of run.
+//   caoco fuzz <lex|parse|irgen|evaluate> <corpus dir> [--runs <n>]
+//              [--seconds <n>] [--regressions <dir>]
+//     Fuzzes a phase with mutations of the corpus, see fuzz_targets.h.
+//     Prints the execs per second, and writes the inputs found superlinear
+//     to the regressions directory. Fails when it finds one.
+//   caoco bench <dir> [--engines <name,...>] [--repeats <n>]
+//               [--json <file>] [--aot <include dir>]
+//     Runs the benchmark programs of a directory with each engine, see
+//     bench_corpus.h, and writes their times as JSON. The aot engine runs
+//     only with --aot, given the directory of aot_runtime.h. Fails when an
+//     output differs from its golden file.
+// Limits of a program run from the command line, and by the daemon.
+static constexpr EvaluatorLimits kCandDriverRunLimits = {
+    .dispatches = 0, .frames = kEvaluatorDefaultFrameLimit};
+static constexpr std::size_t kCandDriverDaemonDispatchLimit = 100'000'000;
+static constexpr EvaluatorLimits kCandDriverDaemonRunLimits = {
+    .dispatches = kCandDriverDaemonDispatchLimit,
+    .frames = kEvaluatorDefaultFrameLimit};
+static constexpr std::string_view kCandDriverErrorTimerBusy =
+    "Another command is being timed, running untimed.";
+static constexpr std::string_view kCandDriverUsage =
+    "Usage:\n"
+    "  caoco compile <file.cand> [-o <file.candc>] [-O] [--report]\n"
+    "                [--cache <dir>]\n"
+    "  caoco run <file.cand|file.candc> [-O]\n"
+    "  caoco check <file.cand>\n"
+    "  compile, run and check take [--time-passes] [--trace <file.json>]\n"
+    "  caoco daemon <socket> [--cache <dir>]\n"
+    "  caoco client <socket> <command> [<args>...]\n"
+    "  caoco fuzz <lex|parse|irgen|evaluate> <corpus dir> [--runs <n>]\n"
+    "             [--seconds <n>] [--regressions <dir>]\n"
+    "  caoco bench <dir> [--engines <name,...>] [--repeats <n>]\n"
+    "              [--json <file>] [--aot <include dir>]\n";
+
+class CandDriver {
+ public:
+  // Lexes, parses and generates the IR of a program in a new session.
+  static Expected<IrCode> Compile(const std::string& source, bool optimize) {
+    return CompilationSession({.optimize = optimize}).Compile(source);
+  }
+
+  // Lexes, parses and resolves the names of a program, see sema.h.
+  static Expected<std::vector<SemaDiagnostic>> Check(
+      const std::string& source) {
+    using Result = Expected<std::vector<SemaDiagnostic>>;
+    CompilationSession session;
+    auto checked = session.Check(source);
+    if (!checked) return Result::Failure(checked.Error());
+    return Result::Success(session.Diagnostics());
+  }
+
+  // Compiles a file and the modules it imports, see module_graph.h. Prints
+  // the build report when given a stream, uses the cache when given one.
+  static Expected<IrCode> CompileFile(const std::filesystem::path& path,
+                                      bool optimize,
+                                      std::ostream* report = nullptr,
+                                      ModuleCache* cache = nullptr) {
+    ModuleGraph graph({.optimize = optimize}, 0, cache);
+    auto loaded = graph.Load(path);
+    if (!loaded) return Expected<IrCode>::Failure(loaded.Error());
+    auto built = graph.Build();
+    if (!built) return Expected<IrCode>::Failure(built.Error());
+    if (report != nullptr) graph.PrintReport(*report);
+    return graph.Link();
+  }
+
+  // Loads a .candc module, else compiles the source file.
+  static Expected<IrCode> LoadProgram(const std::filesystem::path& path,
+                                      bool optimize,
+                                      ModuleCache* cache = nullptr) {
+    if (path.extension() != ".candc") {
+      return CompileFile(path, optimize, nullptr, cache);
+    }
+    CAOCO_PHASE("load");
+    auto module = CandcModule::Load(path);
+    if (!module) return Expected<IrCode>::Failure(module.Error());
+    return Expected<IrCode>::Success(module.Value().ToIrCode());
+  }
+
+  // The paths of the commands a daemon serves, see
+  // CompilerDaemon::AbsoluteArgs.
+  static const std::vector<CompilerDaemon::CommandPaths>& CommandPaths() {
+    static const std::vector<CompilerDaemon::CommandPaths> paths = {
+        {"compile", {0}, {"-o", "--cache", "--trace"}, {}},
+        {"run", {0}, {"-o", "--cache", "--trace"}, {}},
+        {"check", {0}, {"-o", "--cache", "--trace"}, {}},
+        {"fuzz", {1}, {"--regressions"}, {"--runs", "--seconds"}},
+        {"bench", {0}, {"--json", "--aot"}, {"--engines", "--repeats"}}};
+    return paths;
+  }
+
+  // Serves commands until a client stops the daemon.
+  // Runs the command lines of the daemon's clients.
+  static CompilerDaemon::Handler DaemonHandler(
+      EvaluatorLimits limits = kCandDriverDaemonRunLimits) {
+    return [limits](const std::vector<std::string>& command,
+                    std::istream& in, std::ostream& out, std::ostream& err,
+                    ModuleCache& cache) {
+      return Main(command, in, out, err, &cache, limits);
+    };
+  }
+
+  static int Daemon(const std::vector<std::string>& args, std::ostream& err) {
+    std::filesystem::path cache_dir =
+        std::filesystem::temp_directory_path() / "caoco-daemon-cache";
+    if (args.size() == 4 && args[2] == "--cache") {
+      cache_dir = args[3];
+    } else if (args.size() != 2) {
+      err << kCandDriverUsage;
+      return 2;
+    }
+    CompilerDaemon daemon(args[1], cache_dir, DaemonHandler());
+    auto listening = daemon.Listen();
+    if (!listening) {
+      err << listening.Error() << std::endl;
+      return 1;
+    }
+    daemon.Serve();
+    return 0;
+  }
+
+  // Forwards a command line to a daemon, prints its reply.
+  static int Client(const std::vector<std::string>& args, std::istream& in,
+                    std::ostream& out, std::ostream& err) {
+    if (args.size() < 3) {
+      err << kCandDriverUsage;
+      return 2;
+    }
+    std::vector<std::string> command = CompilerDaemon::AbsoluteArgs(
+        {args.begin() + 2, args.end()}, CommandPaths());
+    std::string input;
+    if (command[0] == "run") {
+      input.assign(std::istreambuf_iterator<char>(in),
+                   std::istreambuf_iterator<char>());
+    }
+    auto reply = CompilerDaemon::Request(args[1], command, input);
+    if (!reply) {
+      err << reply.Error() << std::endl;
+      return 1;
+    }
+    out << reply.Value().out;
+    err << reply.Value().err;
+    return reply.Value().exit_code;
+  }
+
+  // Fuzzes a target with the corpus, prints its statistics.
+  static int Fuzz(const std::vector<std::string>& args, std::ostream& out,
+                  std::ostream& err) {
+    if (args.size() < 3 || args.size() % 2 == 0) {
+      err << kCandDriverUsage;
+      return 2;
+    }
+    const FuzzTarget* target = FuzzTargets::Find(args[1]);
+    if (target == nullptr) {
+      err << kFuzzErrorUnknownTarget << std::endl;
+      return 2;
+    }
+    FuzzOptions options{.report_interval = std::chrono::seconds(10),
+                        .log = &out};
+    for (std::size_t i = 3; i < args.size(); i += 2) {
+      if (args[i] == "--runs") {
+        options.runs = std::strtoull(args[i + 1].c_str(), nullptr, 10);
+      } else if (args[i] == "--seconds") {
+        options.max_time = std::chrono::seconds(
+            std::strtoull(args[i + 1].c_str(), nullptr, 10));
+      } else if (args[i] == "--regressions") {
+        options.regressions = args[i + 1];
+      } else {
+        err << kCandDriverUsage;
+        return 2;
+      }
+    }
+    auto seeds = FuzzRunner::LoadCorpus(args[2]);
+    if (!seeds) {
+      err << seeds.Error() << std::endl;
+      return 1;
+    }
+    FuzzRunner runner(*target, options);
+    runner.Fuzz(seeds.Value());
+    runner.PrintStats(out);
+    return runner.Stats().slow.empty() ? 0 : 1;
+  }
+
+  // Runs the benchmark corpus, prints the time of each program and engine.
+  static int Bench(const std::vector<std::string>& args, std::ostream& out,
+                   std::ostream& err) {
+    if (args.size() < 2 || args.size() % 2 != 0) {
+      err << kCandDriverUsage;
+      return 2;
+    }
+    BenchCorpusOptions options;
+    std::optional<std::string> engine_names;
+    std::optional<std::filesystem::path> json;
+    bool aot = false;
+    for (std::size_t i = 2; i < args.size(); i += 2) {
+      if (args[i] == "--engines") {
+        engine_names = args[i + 1];
+      } else if (args[i] == "--repeats") {
+        options.repeats = std::strtoull(args[i + 1].c_str(), nullptr, 10);
+      } else if (args[i] == "--json") {
+        json = args[i + 1];
+      } else if (args[i] == "--aot") {
+        aot = true;
+        options.aot_include = std::filesystem::absolute(args[i + 1]);
+      } else {
+        err << kCandDriverUsage;
+        return 2;
+      }
+    }
+    std::vector<eBenchEngine> engines = BenchCorpus::Engines(aot);
+    if (engine_names) {
+      engines.clear();
+      std::istringstream names(*engine_names);
+      for (std::string name; std::getline(names, name, ',');) {
+        auto engine = BenchCorpus::FindEngine(name);
+        if (!engine) {
+          err << engine.Error() << std::endl;
+          return 2;
+        }
+        engines.push_back(engine.Value());
+      }
+    }
+    auto programs = BenchCorpus::Load(args[1]);
+    if (!programs) {
+      err << programs.Error() << std::endl;
+      return 1;
+    }
+    BenchCorpus corpus(options);
+    bool passed = corpus.RunAll(programs.Value(), engines);
+    corpus.PrintReport(out);
+    if (json) {
+      std::ofstream file(*json);
+      corpus.WriteJson(file);
+      if (!file) {
+        err << kCandcErrorCannotOpen << std::endl;
+        return 1;
+      }
+    }
+    return passed ? 0 : 1;
+  }
+
+  // Returns the exit code of the command. The compile, run and check
+  // commands use the given cache unless told of another. Run evaluates
+  // within the limits, and without the JIT when the dispatches are limited.
+  static int Main(const std::vector<std::string>& args, std::istream& in,
+                  std::ostream& out, std::ostream& err,
+                  ModuleCache* shared_cache = nullptr,
+                  EvaluatorLimits limits = kCandDriverRunLimits) {
+    std::string command = args.empty() ? "" : args[0];
+    if (command == "daemon") return Daemon(args, err);
+    if (command == "client") return Client(args, in, out, err);
+    if (command == "fuzz") return Fuzz(args, out, err);
+    if (command == "bench") return Bench(args, out, err);
+    std::optional<std::filesystem::path> input;
+    std::optional<std::filesystem::path> output;
+    bool optimize = false;
+    bool report = false;
+    std::optional<std::filesystem::path> cache_dir;
+    bool time_passes = false;
+    std::optional<std::filesystem::path> trace;
+    std::vector<std::string> untimed = {command};
+    for (std::size_t i = 1; i < args.size(); i++) {
+      if (args[i] == "--time-passes") {
+        time_passes = true;
+        continue;
+      } else if (args[i] == "--trace" && i + 1 < args.size()) {
+        trace = args[++i];
+        continue;
+      }
+      untimed.push_back(args[i]);
+      if (args[i] == "-O") {
+        optimize = true;
+      } else if (args[i] == "--report") {
+        report = true;
+      } else if (args[i] == "--cache" && i + 1 < args.size()) {
+        cache_dir = args[++i];
+        untimed.push_back(args[i]);
+      } else if (args[i] == "-o" && i + 1 < args.size()) {
+        output = args[++i];
+        untimed.push_back(args[i]);
+      } else if (!input && !args[i].starts_with("-")) {
+        input = args[i];
+      } else {
+        err << kCandDriverUsage;
+        return 2;
+      }
+    }
+    if ((command != "compile" && command != "run" && command != "check") ||
+        !input) {
+      err << kCandDriverUsage;
+      return 2;
+    }
+
+    if (time_passes || trace) {
+      PhaseTimer timer;
+      if (!timer.Start()) {
+        err << kCandDriverErrorTimerBusy << std::endl;
+        return Main(untimed, in, out, err, shared_cache, limits);
+      }
+      int exit_code = Main(untimed, in, out, err, shared_cache, limits);
+      timer.Stop();
+      if (time_passes) timer.PrintReport(err);
+      if (trace) {
+        std::ofstream file(*trace);
+        timer.WriteTrace(file);
+        if (!file) {
+          err << kCandcErrorCannotOpen << std::endl;
+          return 1;
+        }
+      }
+      return exit_code;
+    }
+
+    if (command == "check") {
+      ModuleGraph graph({.check = true}, 0, shared_cache);
+      auto loaded = graph.Load(*input);
+      if (!loaded) {
+        err << loaded.Error() << std::endl;
+        return 1;
+      }
+      // Stops at the first level of imports with a diagnostic.
+      graph.Build();
+      int exit_code = 0;
+      for (const auto& module : graph.Modules()) {
+        for (const auto& diagnostic : module.session.Diagnostics()) {
+          err << module.path.string() << ":" << diagnostic.line << ": "
+              << diagnostic.message << std::endl;
+          exit_code = 1;
+        }
+      }
+      return exit_code;
+    }
+
+    if (command == "compile") {
+      std::optional<ModuleCache> cache;
+      if (cache_dir) cache.emplace(*cache_dir);
+      auto code = CompileFile(*input, optimize, report ? &out : nullptr,
+                              cache ? &*cache : shared_cache);
+      if (!code) {
+        err << code.Error() << std::endl;
+        return 1;
+      }
+      auto path = output.value_or(
+          std::filesystem::path(*input).replace_extension(".candc"));
+      CAOCO_PHASE("write");
+      if (!CandcWriter::Save(code.Value(), path,
+                             optimize ? kCandcFlagOptimized : 0)) {
+        err << kCandcErrorCannotOpen << std::endl;
+        return 1;
+      }
+      return 0;
+    }
+
+    auto code = LoadProgram(*input, optimize, shared_cache);
+    if (!code) {
+      err << code.Error() << std::endl;
+      return 1;
+    }
+    Environment env;
+    try {
+      CAOCO_PHASE("evaluate");
+      Evaluator evaluator{env, in, out};
+      evaluator.SetLimits(limits);
+      if (limits.dispatches != 0) evaluator.EnableJit(false);
+      evaluator.Evaluate(code.Value());
+    } catch (const std::runtime_error& e) {
+      err << e.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: cand_driver.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_CAND_DRIVER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
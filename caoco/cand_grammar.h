@@ -117,6 +117,7 @@ using kEndmacro = STRING_CONSTANT("#endmacro");
 using kIf = STRING_CONSTANT("#if");
 using kElse = STRING_CONSTANT("#else");
 using kElif = STRING_CONSTANT("#elif");
+using kEndif = STRING_CONSTANT("#endif");
 }  // namespace directives
 
 namespace operators {
@@ -98,16 +98,52 @@ struct RtVal {
     return std::get<TYPE>(value);
   }
 
+  // Applies cmp to the native values. Strings compare by content.
+  template <class CmpT>
+  RtVal CompareOp(const RtVal& other, CmpT cmp) const {
+    if (type_ != other.type_) {
+      throw "Invalid types for comparison operation.";
+    }
+    switch (type_) {
+      case kInt:
+        return Make<BoolT>(cmp(GetInt(), other.GetInt()));
+      case kUnsigned:
+        return Make<BoolT>(cmp(GetUnsigned(), other.GetUnsigned()));
+      case kDouble:
+        return Make<BoolT>(cmp(GetDouble(), other.GetDouble()));
+      case kBool:
+        return Make<BoolT>(cmp(GetBool(), other.GetBool()));
+      case kByte:
+        return Make<BoolT>(cmp(GetByte(), other.GetByte()));
+      case kChar:
+        return Make<BoolT>(cmp(GetChar(), other.GetChar()));
+      case kString:
+        return Make<BoolT>(cmp(*GetString(), *other.GetString()));
+      default:
+        throw "Value type does not implement a comparison operation.";
+    }
+  }
+
+  // Construct a value holding exactly TYPE. Avoids the implicit promotions
+  // which would otherwise turn byte and char arithmetic into an int.
+  template <class TYPE>
+  static RtVal Make(TYPE native) {
+    return RtVal(NativeVariant(std::in_place_type<TYPE>, native));
+  }
+
  public:
-  constexpr IntT GetInt() const { 
-    return std::visit([](auto&& arg) -> IntT {
-      using T = std::decay_t<decltype(arg)>;
-      if constexpr (std::is_same_v<T, IntT>) {
-        return arg;
-      } else {
-        throw "GetInt: Requested value is not an integer.";
-      }
-    }, value); 
+  constexpr int Type() const { return type_; }
+  IntT GetInt() const {
+    return std::visit(
+        [](auto&& arg) -> IntT {
+          using T = std::decay_t<decltype(arg)>;
+          if constexpr (std::is_same_v<T, IntT>) {
+            return arg;
+          } else {
+            throw "GetInt: Requested value is not an integer.";
+          }
+        },
+        value);
   }
   UnsignedT GetUnsigned() const { return std::get<UnsignedT>(value); }
   DoubleT GetDouble() const { return std::get<DoubleT>(value); }
@@ -120,163 +156,224 @@ struct RtVal {
   MethodT GetMethod() const { return std::get<MethodT>(value); }
   ObjectT GetObject() const { return std::get<ObjectT>(value); }
 
-  // Binary Operators
-  constexpr RtVal& AddOp(const RtVal& other) {
-    // Apply addition operation to equivalent types.
-    RtVal&& result = std::visit(
-        [&other](auto&& arg) -> RtVal&& {
-        using T = std::decay_t<decltype(arg)>;
-          try {
-            if constexpr (std::is_same_v<T, IntT>) {
-              arg += other.GetInt();
-            } else if constexpr (std::is_same_v<T, UnsignedT>) {
-              arg += other.GetUnsigned();
-            } else if constexpr (std::is_same_v<T, DoubleT>) {
-              arg += other.GetDouble();
-            } else if constexpr (std::is_same_v<T, ByteT>) {
-              arg += other.GetByte();
-            } else if constexpr (std::is_same_v<T, CharT>) {
-              arg += other.GetChar();
-            } else if constexpr (std::is_same_v<T, StringT>) {
-              arg = StringT(new string(*arg + *other.GetString()));
-            } else {
-              throw "Value type does not implement an addition operation.";
-            }
-          } catch (const std::exception& e) {
-            string err = e.what();
-            err += "\nInvalid argument type for addition operation.";
-            throw err.c_str();
-          }
-        },
-        value);
+  template <class TYPE>
+  TYPE& GetAs() {
+    return std::get<TYPE>(value);
+  }
+  template <class TYPE>
+  const TYPE& GetAs() const {
+    return std::get<TYPE>(value);
+  }
 
-    // Move the result into this object. Type stays the same.
-    value = std::move(result.value);
+  // Ints wrap around on overflow, in two's complement, as in aot_runtime.h.
+  // The JIT leaves an overflowing operation to the interpreter, so every
+  // engine agrees: INT_MIN / -1 is INT_MIN and INT_MIN % -1 is 0.
+  template <class T>
+  static constexpr T WrappingAdd(T lhs, T rhs) {
+    if constexpr (std::is_same_v<T, IntT>) {
+      return static_cast<IntT>(static_cast<UnsignedT>(lhs) +
+                               static_cast<UnsignedT>(rhs));
+    } else {
+      return lhs + rhs;
+    }
+  }
+  template <class T>
+  static constexpr T WrappingSub(T lhs, T rhs) {
+    if constexpr (std::is_same_v<T, IntT>) {
+      return static_cast<IntT>(static_cast<UnsignedT>(lhs) -
+                               static_cast<UnsignedT>(rhs));
+    } else {
+      return lhs - rhs;
+    }
+  }
+  template <class T>
+  static constexpr T WrappingMul(T lhs, T rhs) {
+    if constexpr (std::is_same_v<T, IntT>) {
+      return static_cast<IntT>(static_cast<UnsignedT>(lhs) *
+                               static_cast<UnsignedT>(rhs));
+    } else {
+      return lhs * rhs;
+    }
+  }
+  // The divisor is not 0.
+  static constexpr IntT WrappingDiv(IntT lhs, IntT rhs) {
+    return rhs == -1 ? WrappingSub(0, lhs) : lhs / rhs;
+  }
+  static constexpr IntT WrappingMod(IntT lhs, IntT rhs) {
+    return rhs == -1 ? 0 : lhs % rhs;
+  }
 
-    // Return reference to this object.
-    return *this;
+  // Binary Operators
+  // Operators return a new value. Operands must be of equivalent types.
+  RtVal AddOp(const RtVal& other) const {
+    switch (type_) {
+      case kInt:
+        return Make<IntT>(WrappingAdd(GetInt(), other.GetInt()));
+      case kUnsigned:
+        return Make<UnsignedT>(GetUnsigned() + other.GetUnsigned());
+      case kDouble:
+        return Make<DoubleT>(GetDouble() + other.GetDouble());
+      case kByte:
+        return Make<ByteT>(GetByte() + other.GetByte());
+      case kChar:
+        return Make<CharT>(GetChar() + other.GetChar());
+      case kString:
+        return Make<StringT>(StringT(new string(*GetString() + *other.GetString())));
+      default:
+        throw "Value type does not implement an addition operation.";
+    }
   }
 
-  RtVal& SubOp(const RtVal& other) {
+  RtVal SubOp(const RtVal& other) const {
     switch (type_) {
       case kInt:
-        return RtVal(GetInt() - other.GetInt());
+        return Make<IntT>(WrappingSub(GetInt(), other.GetInt()));
       case kUnsigned:
-        return RtVal(GetUnsigned() - other.GetUnsigned());
+        return Make<UnsignedT>(GetUnsigned() - other.GetUnsigned());
       case kDouble:
-        return RtVal(GetDouble() - other.GetDouble());
+        return Make<DoubleT>(GetDouble() - other.GetDouble());
       case kByte:
-        return RtVal(GetByte() - other.GetByte());
+        return Make<ByteT>(GetByte() - other.GetByte());
       case kChar:
-        return RtVal(GetChar() - other.GetChar());
+        return Make<CharT>(GetChar() - other.GetChar());
       default:
         throw "Invalid types for subtraction operation.";
     }
   }
-  RtVal& MulOp(const RtVal& other) {
+  RtVal MulOp(const RtVal& other) const {
     switch (type_) {
       case kInt:
-        return RtVal(GetInt() * other.GetInt());
+        return Make<IntT>(WrappingMul(GetInt(), other.GetInt()));
       case kUnsigned:
-        return RtVal(GetUnsigned() * other.GetUnsigned());
+        return Make<UnsignedT>(GetUnsigned() * other.GetUnsigned());
       case kDouble:
-        return RtVal(GetDouble() * other.GetDouble());
+        return Make<DoubleT>(GetDouble() * other.GetDouble());
       case kByte:
-        return RtVal(GetByte() * other.GetByte());
+        return Make<ByteT>(GetByte() * other.GetByte());
       case kChar:
-        return RtVal(GetChar() * other.GetChar());
+        return Make<CharT>(GetChar() * other.GetChar());
       default:
         throw "Invalid types for multiplication operation.";
     }
   }
-  RtVal& DivOp(const RtVal& other) {
+  RtVal DivOp(const RtVal& other) const {
     switch (type_) {
       case kInt:
-        return RtVal(GetInt() / other.GetInt());
+        if (other.GetInt() == 0) throw "Integer division by zero.";
+        return Make<IntT>(WrappingDiv(GetInt(), other.GetInt()));
       case kUnsigned:
-        return RtVal(GetUnsigned() / other.GetUnsigned());
+        if (other.GetUnsigned() == 0) throw "Integer division by zero.";
+        return Make<UnsignedT>(GetUnsigned() / other.GetUnsigned());
       case kDouble:
-        return RtVal(GetDouble() / other.GetDouble());
+        return Make<DoubleT>(GetDouble() / other.GetDouble());
       case kByte:
-        return RtVal(GetByte() / other.GetByte());
+        if (other.GetByte() == 0) throw "Integer division by zero.";
+        return Make<ByteT>(GetByte() / other.GetByte());
       case kChar:
-        return RtVal(GetChar() / other.GetChar());
+        if (other.GetChar() == 0) throw "Integer division by zero.";
+        return Make<CharT>(GetChar() / other.GetChar());
       default:
         throw "Invalid types for division operation.";
     }
   }
-  RtVal& ModOp(const RtVal& other) const {
+  RtVal ModOp(const RtVal& other) const {
     switch (type_) {
       case kInt:
-        return RtVal(GetInt() % other.GetInt());
+        if (other.GetInt() == 0) throw "Integer division by zero.";
+        return Make<IntT>(WrappingMod(GetInt(), other.GetInt()));
       case kUnsigned:
-        return RtVal(GetUnsigned() % other.GetUnsigned());
+        if (other.GetUnsigned() == 0) throw "Integer division by zero.";
+        return Make<UnsignedT>(GetUnsigned() % other.GetUnsigned());
       case kByte:
-        return RtVal(GetByte() % other.GetByte());
+        if (other.GetByte() == 0) throw "Integer division by zero.";
+        return Make<ByteT>(GetByte() % other.GetByte());
       case kChar:
-        return RtVal(GetChar() % other.GetChar());
+        if (other.GetChar() == 0) throw "Integer division by zero.";
+        return Make<CharT>(GetChar() % other.GetChar());
       default:
         throw "Invalid types for modulo operation.";
     }
   }
 
+  // Comparison Operators
+  // Return a bool value. Operands must be of equivalent types.
+  RtVal EqOp(const RtVal& other) const {
+    return CompareOp(other, [](const auto& a, const auto& b) { return a == b; });
+  }
+  RtVal NeOp(const RtVal& other) const {
+    return CompareOp(other, [](const auto& a, const auto& b) { return a != b; });
+  }
+  RtVal LtOp(const RtVal& other) const {
+    return CompareOp(other, [](const auto& a, const auto& b) { return a < b; });
+  }
+  RtVal GtOp(const RtVal& other) const {
+    return CompareOp(other, [](const auto& a, const auto& b) { return a > b; });
+  }
+  RtVal LeOp(const RtVal& other) const {
+    return CompareOp(other, [](const auto& a, const auto& b) { return a <= b; });
+  }
+  RtVal GeOp(const RtVal& other) const {
+    return CompareOp(other, [](const auto& a, const auto& b) { return a >= b; });
+  }
+
   // Fast Unary Operators
-  RtVal& NegOp() {
+  RtVal NegOp() const {
     switch (type_) {
       case kInt:
-        return RtVal(-GetInt());
+        return Make<IntT>(WrappingSub(0, GetInt()));
       case kUnsigned:
-        return RtVal(-GetUnsigned());
+        return Make<UnsignedT>(-GetUnsigned());
       case kDouble:
-        return RtVal(-GetDouble());
+        return Make<DoubleT>(-GetDouble());
       case kByte:
-        return RtVal(-GetByte());
+        return Make<ByteT>(-GetByte());
       case kChar:
-        return RtVal(-GetChar());
+        return Make<CharT>(-GetChar());
       default:
         throw "Invalid types for negation operation.";
     }
   }
-  RtVal& NotOp() {
+  RtVal NotOp() const {
     switch (type_) {
       case kBool:
-        return RtVal(!GetBool());
+        return Make<BoolT>(!GetBool());
       default:
         throw "Invalid types for negation operation.";
     }
   }
-  RtVal& IncrementOp() const {
+  RtVal IncrementOp() const {
     switch (type_) {
       case kInt:
-        return RtVal(GetInt() + 1);
+        return Make<IntT>(WrappingAdd(GetInt(), 1));
       case kUnsigned:
-        return RtVal(GetUnsigned() + 1);
+        return Make<UnsignedT>(GetUnsigned() + 1);
       case kByte:
-        return RtVal(GetByte() + 1);
+        return Make<ByteT>(GetByte() + 1);
       case kChar:
-        return RtVal(GetChar() + 1);
+        return Make<CharT>(GetChar() + 1);
       default:
         throw "Invalid types for increment operation.";
     }
   }
-  RtVal& DecrementOp() const {
+  RtVal DecrementOp() const {
     switch (type_) {
       case kInt:
-        return RtVal(GetInt() - 1);
+        return Make<IntT>(WrappingSub(GetInt(), 1));
       case kUnsigned:
-        return RtVal(GetUnsigned() - 1);
+        return Make<UnsignedT>(GetUnsigned() - 1);
       case kByte:
-        return RtVal(GetByte() - 1);
+        return Make<ByteT>(GetByte() - 1);
       case kChar:
-        return RtVal(GetChar() - 1);
+        return Make<CharT>(GetChar() - 1);
       default:
         throw "Invalid types for decrement operation.";
     }
   }
 
-  constexpr RtVal() = default;
-  constexpr RtVal(size_t native_index) : type(type) {
-    switch (type) {
+  RtVal() = default;
+  // Create a default value of the native type at native_index.
+  explicit RtVal(size_t native_index) : type_(static_cast<int>(native_index)) {
+    switch (type_) {
       case kInt:
         value = IntT();
         break;
@@ -314,57 +411,28 @@ struct RtVal {
         throw "Invalid type.";
     }
   }
-  constexpr RtVal(NativeVariant native_variant) {
-    value = native_variant;
-    switch (value.index()) {
-      case kInt:
-        type = kInt;
-        break;
-      case kUnsigned:
-        type = kUnsigned;
-        break;
-      case kDouble:
-        type = kDouble;
-        break;
-      case kBool:
-        type = kBool;
-        break;
-      case kByte:
-        type = kByte;
-        break;
-      case kChar:
-        type = kChar;
-        break;
-      case kString:
-        type = kString;
-        break;
-      case kNone:
-        type = kNone;
-        break;
-      case kUndefined:
-        type = kUndefined;
-        break;
-      case kMethod:
-        type = kMethod;
-        break;
-      case kObject:
-        type = kObject;
-        break;
-      default:
-        break;
+  RtVal(NativeVariant native_variant)
+      : type_(static_cast<int>(native_variant.index())),
+        value(std::move(native_variant)) {}
+  // Create a value of the native type at native_index.
+  // ex. RtVal{RtVal::kInt, 10}
+  RtVal(size_t native_index, NativeVariant native_variant)
+      : RtVal(std::move(native_variant)) {
+    if (static_cast<size_t>(type_) != native_index) {
+      throw "Native value does not match the requested type.";
     }
   }
 
   // Create an undefined value.
-  static constexpr inline auto NewUndefined() { return RtVal{}; }
+  static inline auto NewUndefined() { return RtVal{}; }
 };
 
 enum class eNameCategory { kVar, kFunction, kClass };
-static const RtVal kRuntimeUndefined = {RtVal::Undefined::idx};
+static const RtVal kRuntimeUndefined = RtVal{RtVal::Undefined::idx};
 // - Memory management of the C& Runtime.
 class RuntimeEnv {
   using MemoryLocation = std::list<RtVal>::iterator;
-  RuntimeEnv* parent_;
+  RuntimeEnv* parent_{nullptr};
   std::list<RuntimeEnv> children_;
   std::list<RtVal> memory_;
   std::map<std::string, std::tuple<eNameCategory, MemoryLocation>> definitions_;
@@ -432,6 +500,54 @@ class RuntimeEnv {
   }
 };
 
+class CandMethod {
+  RuntimeEnv local_env_;
+  std::vector<std::string> args_;
+  Ast body_;
+  RtVal result;
+  std::size_t entry_line_{0};  // First IR line of the body.
+
+ public:
+  CandMethod(std::vector<std::string> args) : args_(args) {}
+  CandMethod(std::vector<std::string> args, std::size_t entry_line)
+      : args_(args), entry_line_(entry_line) {}
+
+  const std::vector<std::string>& Args() const { return args_; }
+  std::size_t EntryLine() const { return entry_line_; }
+
+  RtVal GetResultAndFlush() {
+    RtVal val = std::move(result);
+    local_env_.Flush();
+    return val;
+  }
+
+  CandMethod& call(std::vector<RtVal*> var_args, RuntimeEnv* context) {
+    // set parent of local env.
+    local_env_.setParentEnv(context);
+
+    // Based on args_, create local vars, get value from args...
+    for (auto index = 0; const auto& a : args_) {
+      local_env_.Define(a, eNameCategory::kVar, *var_args[index]);
+      index++;
+    }
+
+    // Evaluate body of func and store in result.
+    // result = Runtime::Evaluate(body_, local_env_);
+    // TEMP: function is returning 1 arg passed to it and adding 1.
+    auto& arg1 = local_env_.RetrieveLocal(args_[0], eNameCategory::kVar);
+    // add op
+    if (arg1.Type() == RtVal::Int::idx) {
+      auto& v = arg1.GetAs<RtVal::IntT>();
+      v += 100;
+      arg1.value = v;
+    }
+
+    // return op
+    result = arg1;
+    return *this;
+  }
+};
+
 struct CandObject {
   RuntimeEnv local_env;  // local encapsulated env for object containing member
                          // vars and methods.
@@ -454,20 +570,20 @@ struct CandObject {
         default_destructor(dtor) {}
 
   // Construct a new instance of the object using the default constructor.
-  void Construct() const {
+  void Construct() {
     if (default_constructor != nullptr) {
       // for now, constructors do not return anything.
-      [mabye_unused] RtVal none_result =
+      [[maybe_unused]] RtVal none_result =
           default_constructor->call({}, &local_env).GetResultAndFlush();
     }
     // Else object is empty.
   }
 
   // Destruct the object.
-  void Destruct() const {
+  void Destruct() {
     if (default_destructor != nullptr) {
       // for now, destructors do not return anything.
-      [mabye_unused] RtVal none_result =
+      [[maybe_unused]] RtVal none_result =
           default_destructor->call({}, &object_env).GetResultAndFlush();
     }
   }
@@ -477,7 +593,7 @@ struct CandObject {
                          std::vector<RtVal*> var_args) {
     auto& method =
         object_env.RetrieveLocal(method_name, eNameCategory::kFunction);
-    return method.Get<RtVal::MethodT>()
+    return method.GetMethod()
         ->call(var_args, &object_env)
         .GetResultAndFlush();
   }
@@ -499,48 +615,6 @@ struct CandObject {
   }
 };
 
-class CandMethod {
-  RuntimeEnv local_env_;
-  std::vector<std::string> args_;
-  Ast body_;
-  RtVal result;
-
- public:
-  CandMethod(std::vector<std::string> args) : args_(args) {}
-
-  RtVal&& GetResultAndFlush() {
-    RtVal&& val = std::move(result);
-    local_env_.Flush();
-    return std::move(val);
-  }
-
-  CandMethod& call(std::vector<RtVal*> var_args, RuntimeEnv* context) {
-    // set parent of local env.
-    local_env_.setParentEnv(context);
-
-    // Based on args_, create local vars, get value from args...
-    for (auto index = 0; const auto& a : args_) {
-      local_env_.Define(a, eNameCategory::kVar, *var_args[index]);
-      index++;
-    }
-
-    // Evaluate body of func and store in result.
-    // result = Runtime::Evaluate(body_, local_env_);
-    // TEMP: function is returning 1 arg passed to it and adding 1.
-    auto& arg1 = local_env_.RetrieveLocal(args_[0], eNameCategory::kVar);
-    // add op
-    if (arg1.type == RtVal::Int::idx) {
-      auto& v = arg1.Get<RtVal::IntT>();
-      v += 100;
-      arg1.value = v;
-    }
-
-    // return op
-    result = arg1;
-    return *this;
-  }
-};
-
 // C& Intermediate Language
 //
 
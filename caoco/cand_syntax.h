@@ -247,6 +247,8 @@ constexpr std::string ToStr(eTk t) {
       return "macro";
     case eTk::kDirEndmacro:
       return "endmacro";
+    case eTk::kDirEndif:
+      return "endif";
     case eTk::kUse:
       return "use";
     case eTk::kClass:
@@ -469,6 +471,8 @@ constexpr std::string ToStr(eAst t) {
       return "macro";
     case eAst::kEndmacro:
       return "endmacro";
+    case eAst::kEndif:
+      return "endif";
     case eAst::kEnter:
       return "enter";
     case eAst::kStart:
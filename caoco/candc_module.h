@@ -0,0 +1,494 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: candc_module.h
+//---------------------------------------------------------------------------//
+// Brief: Versioned binary module format (.candc) of compiled IR.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_CANDC_MODULE_H
+#define HEADER_GUARD_CAOCO_COMPILER_CANDC_MODULE_H
+// Includes:
+#include "expected.h"
+#include "import_stl.h"
+#include "ir_codegen.h"
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CAOCO_CANDC_MMAP 1
+#else
+#define CAOCO_CANDC_MMAP 0
+#endif
+
+//=-------------------------------------------------------------------------=//
+// Overview
+//---------------------------------------------------------------------------//
+// A module is a header followed by sections of fixed size little endian
+// records, each section 8 byte aligned:
+//   lines       CandcLine per IR line, in order.
+//   args        CandcArg, the arguments of each line are contiguous.
+//   strings     CandcString, offset and size into the string data.
+//   string data Bytes of the string constant pool.
+//   doubles     Double constant pool.
+//   symbols     CandcSymbol per declaration.
+//   line map    CandcLineMapEntry per run of lines with the same source line.
+// The header holds the version and a checksum of everything after it. A
+// module is validated once when it is opened, so that the accessors of
+// CandcModule then read its records from the mapped file without further
+// checks. The evaluator does not run the mapped records: ToIrCode copies
+// them into an IrCode, in a single pass.
+static constexpr std::array<char, 8> kCandcMagic = {'C', 'A', 'N', 'D',
+                                                    'C', '\0', '\r', '\n'};
+static constexpr std::uint32_t kCandcVersion = 2;
+static constexpr std::uint32_t kCandcFlagOptimized = 1;
+
+// Error codes
+static constexpr std::string_view kCandcErrorCannotOpen =
+    "[C&][ERROR][CRITICAL] Cannot open module file.";
+
+static constexpr std::string_view kCandcErrorTruncated =
+    "[C&][ERROR][CRITICAL] Module file is truncated.";
+
+static constexpr std::string_view kCandcErrorBadMagic =
+    "[C&][ERROR][CRITICAL] File is not a C& module.";
+
+static constexpr std::string_view kCandcErrorVersion =
+    "[C&][ERROR][CRITICAL] Module version is not supported.";
+
+static constexpr std::string_view kCandcErrorChecksum =
+    "[C&][ERROR][CRITICAL] Module checksum does not match its contents.";
+
+static constexpr std::string_view kCandcErrorMalformed =
+    "[C&][ERROR][CRITICAL] Module record is out of bounds.";
+
+struct CandcSection {
+  std::uint32_t offset;
+  std::uint32_t count;
+};
+
+struct CandcHeader {
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t flags;
+  std::uint64_t checksum;  // FNV-1a of the bytes following the header.
+  std::uint64_t size;      // Of the whole file.
+  CandcSection lines;
+  CandcSection args;
+  CandcSection strings;
+  CandcSection string_data;
+  CandcSection doubles;
+  CandcSection symbols;
+  CandcSection line_map;
+};
+
+struct CandcLine {
+  std::uint16_t op;
+  std::uint16_t arg_count;
+  std::uint32_t first_arg;
+};
+
+enum class eCandcArg : std::uint32_t { kInt, kDouble, kString, kBool };
+
+struct CandcArg {
+  eCandcArg kind;
+  std::int32_t value;  // Int or bool, else index into its pool.
+};
+
+struct CandcString {
+  std::uint32_t offset;
+  std::uint32_t size;
+};
+
+enum class eCandcSymbol : std::uint32_t { kVariable, kMethod, kClass };
+
+struct CandcSymbol {
+  std::uint32_t name;  // Index into the strings.
+  eCandcSymbol kind;
+  std::uint32_t line;  // IR line of the declaration.
+  std::uint32_t source_line;
+};
+
+struct CandcLineMapEntry {
+  std::uint32_t first_line;
+  std::uint32_t source_line;
+};
+
+static_assert(std::endian::native == std::endian::little,
+              "Modules are read in place as little endian records.");
+static_assert(sizeof(CandcHeader) == 88 && sizeof(CandcLine) == 8 &&
+              sizeof(CandcArg) == 8 && sizeof(CandcString) == 8 &&
+              sizeof(CandcSymbol) == 16 && sizeof(CandcLineMapEntry) == 8);
+
+inline std::uint64_t CandcChecksum(std::span<const char> bytes) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (char c : bytes) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+//=-------------------------------------------------------------------------=//
+// CandcWriter
+//---------------------------------------------------------------------------//
+class CandcWriter {
+ public:
+  static std::vector<char> Write(const IrCode& code, std::uint32_t flags = 0) {
+    CandcWriter writer;
+    for (const auto& line : code.GetLines()) writer.AddLine(line);
+
+    std::vector<char> bytes(sizeof(CandcHeader));
+    CandcHeader header{};
+    header.magic = kCandcMagic;
+    header.version = kCandcVersion;
+    header.flags = flags;
+    header.lines = AppendSection(bytes, writer.lines_);
+    header.args = AppendSection(bytes, writer.args_);
+    header.strings = AppendSection(bytes, writer.strings_);
+    header.string_data = AppendSection(bytes, writer.string_data_);
+    header.doubles = AppendSection(bytes, writer.doubles_);
+    header.symbols = AppendSection(bytes, writer.symbols_);
+    header.line_map = AppendSection(bytes, writer.line_map_);
+    header.size = bytes.size();
+    header.checksum = CandcChecksum(
+        std::span<const char>(bytes).subspan(sizeof(CandcHeader)));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    return bytes;
+  }
+
+  // Returns false if the file could not be written.
+  static bool Save(const IrCode& code, const std::filesystem::path& path,
+                   std::uint32_t flags = 0) {
+    auto bytes = Write(code, flags);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+  }
+
+ private:
+  std::vector<CandcLine> lines_;
+  std::vector<CandcArg> args_;
+  std::vector<CandcString> strings_;
+  std::vector<char> string_data_;
+  std::vector<double> doubles_;
+  std::vector<CandcSymbol> symbols_;
+  std::vector<CandcLineMapEntry> line_map_;
+  std::unordered_map<std::string, std::uint32_t> string_indices_;
+
+  template <typename T>
+  static CandcSection AppendSection(std::vector<char>& bytes,
+                                    const std::vector<T>& records) {
+    bytes.resize((bytes.size() + 7) / 8 * 8, '\0');
+    CandcSection section{static_cast<std::uint32_t>(bytes.size()),
+                         static_cast<std::uint32_t>(records.size())};
+    auto data = reinterpret_cast<const char*>(records.data());
+    bytes.insert(bytes.end(), data, data + records.size() * sizeof(T));
+    return section;
+  }
+
+  std::uint32_t AddString(const std::string& value) {
+    auto [it, added] = string_indices_.try_emplace(
+        value, static_cast<std::uint32_t>(strings_.size()));
+    if (added) {
+      strings_.push_back({static_cast<std::uint32_t>(string_data_.size()),
+                          static_cast<std::uint32_t>(value.size())});
+      string_data_.insert(string_data_.end(), value.begin(), value.end());
+    }
+    return it->second;
+  }
+
+  void AddLine(const IrLine& line) {
+    auto index = static_cast<std::uint32_t>(lines_.size());
+    lines_.push_back({static_cast<std::uint16_t>(line.op),
+                      static_cast<std::uint16_t>(line.args.size()),
+                      static_cast<std::uint32_t>(args_.size())});
+    for (const auto& arg : line.args) {
+      std::visit(
+          [&](auto&& value) {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, IrInt>) {
+              args_.push_back({eCandcArg::kInt, value});
+            } else if constexpr (std::is_same_v<T, IrDouble>) {
+              args_.push_back({eCandcArg::kDouble,
+                               static_cast<std::int32_t>(doubles_.size())});
+              doubles_.push_back(value);
+            } else if constexpr (std::is_same_v<T, IrString>) {
+              args_.push_back({eCandcArg::kString,
+                               static_cast<std::int32_t>(AddString(value))});
+            } else {
+              args_.push_back({eCandcArg::kBool, value.value ? 1 : 0});
+            }
+          },
+          arg);
+    }
+
+    auto source_line = static_cast<std::uint32_t>(line.source_line);
+    if (line_map_.empty() || line_map_.back().source_line != source_line) {
+      line_map_.push_back({index, source_line});
+    }
+    std::optional<eCandcSymbol> kind;
+    if (line.op == eIrOp::DECLARE_VARIABLE) {
+      kind = eCandcSymbol::kVariable;
+    } else if (line.op == eIrOp::DECLARE_METHOD) {
+      kind = eCandcSymbol::kMethod;
+    } else if (line.op == eIrOp::DECLARE_OBJECT) {
+      kind = eCandcSymbol::kClass;
+    }
+    // The name is the first string argument.
+    auto name = std::find_if(line.args.begin(), line.args.end(),
+                             [](const IrVariant& arg) {
+                               return std::holds_alternative<IrString>(arg);
+                             });
+    if (kind && name != line.args.end()) {
+      symbols_.push_back(
+          {AddString(std::get<IrString>(*name)), *kind, index, source_line});
+    }
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// CandcFile
+//---------------------------------------------------------------------------//
+// Read only contents of a module file, mapped where mmap is available.
+class CandcFile {
+ public:
+  explicit CandcFile(const std::filesystem::path& path) {
+#if CAOCO_CANDC_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info {};
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+      void* data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                          PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        data_ = static_cast<const char*>(data);
+        size_ = static_cast<std::size_t>(info.st_size);
+      }
+    }
+    ::close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return;
+    buffer_.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+  }
+  CandcFile(const CandcFile&) = delete;
+  CandcFile& operator=(const CandcFile&) = delete;
+  ~CandcFile() {
+#if CAOCO_CANDC_MMAP
+    if (data_ != nullptr) ::munmap(const_cast<char*>(data_), size_);
+#endif
+  }
+
+  bool Valid() const { return data_ != nullptr; }
+  std::span<const char> Bytes() const { return {data_, size_}; }
+
+ private:
+  const char* data_{nullptr};
+  std::size_t size_{0};
+#if !CAOCO_CANDC_MMAP
+  std::vector<char> buffer_;
+#endif
+};
+
+//=-------------------------------------------------------------------------=//
+// CandcModule
+//---------------------------------------------------------------------------//
+// Validated view of a module. Keeps the file it was loaded from alive.
+class CandcModule {
+ public:
+  CandcModule() = default;
+
+  static Expected<CandcModule> Load(const std::filesystem::path& path) {
+    auto file = std::make_shared<const CandcFile>(path);
+    if (!file->Valid()) {
+      return Expected<CandcModule>::Failure(std::string(kCandcErrorCannotOpen));
+    }
+    auto module = View(file->Bytes());
+    if (!module) return module;
+    auto loaded = module.Extract();
+    loaded.file_ = std::move(file);
+    return Expected<CandcModule>::Success(std::move(loaded));
+  }
+
+  // The bytes must outlive the module.
+  static Expected<CandcModule> View(std::span<const char> bytes) {
+    lambda xFail = [](std::string_view error) {
+      return Expected<CandcModule>::Failure(std::string(error));
+    };
+    if (bytes.size() < sizeof(CandcHeader)) return xFail(kCandcErrorTruncated);
+    CandcModule module;
+    module.bytes_ = bytes;
+    const auto& header = module.Header();
+    if (header.magic != kCandcMagic) return xFail(kCandcErrorBadMagic);
+    if (header.version != kCandcVersion) return xFail(kCandcErrorVersion);
+    if (header.size != bytes.size()) return xFail(kCandcErrorTruncated);
+    if (header.checksum !=
+        CandcChecksum(bytes.subspan(sizeof(CandcHeader)))) {
+      return xFail(kCandcErrorChecksum);
+    }
+    if (!module.Validate()) return xFail(kCandcErrorMalformed);
+    return Expected<CandcModule>::Success(std::move(module));
+  }
+
+  std::uint32_t Flags() const { return Header().flags; }
+  std::size_t Size() const { return Lines().size(); }
+  eIrOp Op(std::size_t line) const {
+    return static_cast<eIrOp>(Lines()[line].op);
+  }
+  std::size_t ArgCount(std::size_t line) const {
+    return Lines()[line].arg_count;
+  }
+  IrVariant Arg(std::size_t line, std::size_t i) const {
+    const auto& arg = Args()[Lines()[line].first_arg + i];
+    switch (arg.kind) {
+      case eCandcArg::kInt:
+        return IrInt{arg.value};
+      case eCandcArg::kDouble:
+        return Doubles()[static_cast<std::size_t>(arg.value)];
+      case eCandcArg::kString:
+        return IrString(String(static_cast<std::size_t>(arg.value)));
+      default:
+        return IrBool{arg.value != 0};
+    }
+  }
+  std::string_view String(std::size_t index) const {
+    const auto& string = Strings()[index];
+    return {bytes_.data() + Header().string_data.offset + string.offset,
+            string.size};
+  }
+  std::span<const CandcSymbol> Symbols() const {
+    return Section<CandcSymbol>(Header().symbols);
+  }
+  // Source line of an IR line, 0 if unknown.
+  std::size_t SourceLine(std::size_t line) const {
+    auto map = Section<CandcLineMapEntry>(Header().line_map);
+    auto it = std::upper_bound(
+        map.begin(), map.end(), line,
+        [](std::size_t l, const CandcLineMapEntry& e) { return l < e.first_line; });
+    return it == map.begin() ? 0 : std::prev(it)->source_line;
+  }
+
+  // Copies every line into the IR the evaluator executes, in a single pass.
+  // Loading a module saves the compile, not this copy.
+  IrCode ToIrCode() const {
+    IrCode code;
+    auto map = Section<CandcLineMapEntry>(Header().line_map);
+    auto next_run = map.begin();
+    std::size_t source_line = 0;
+    for (std::size_t i = 0; i < Size(); i++) {
+      if (next_run != map.end() && next_run->first_line == i) {
+        source_line = next_run->source_line;
+        next_run++;
+      }
+      std::vector<IrVariant> args;
+      args.reserve(ArgCount(i));
+      for (std::size_t a = 0; a < ArgCount(i); a++) args.push_back(Arg(i, a));
+      code.AddLine(i, Op(i), std::move(args)).source_line = source_line;
+    }
+    return code;
+  }
+
+ private:
+  std::span<const char> bytes_;
+  std::shared_ptr<const CandcFile> file_;
+
+  const CandcHeader& Header() const {
+    return *reinterpret_cast<const CandcHeader*>(bytes_.data());
+  }
+  template <typename T>
+  std::span<const T> Section(const CandcSection& section) const {
+    return {reinterpret_cast<const T*>(bytes_.data() + section.offset),
+            section.count};
+  }
+  std::span<const CandcLine> Lines() const {
+    return Section<CandcLine>(Header().lines);
+  }
+  std::span<const CandcArg> Args() const {
+    return Section<CandcArg>(Header().args);
+  }
+  std::span<const CandcString> Strings() const {
+    return Section<CandcString>(Header().strings);
+  }
+  std::span<const double> Doubles() const {
+    return Section<double>(Header().doubles);
+  }
+
+  template <typename T>
+  bool SectionInBounds(const CandcSection& section) const {
+    return section.offset % alignof(T) == 0 &&
+           section.offset >= sizeof(CandcHeader) &&
+           section.offset <= bytes_.size() &&
+           section.count <= (bytes_.size() - section.offset) / sizeof(T);
+  }
+
+  // Checks every index once, so that accessors need not.
+  bool Validate() const {
+    const auto& header = Header();
+    if (!SectionInBounds<CandcLine>(header.lines) ||
+        !SectionInBounds<CandcArg>(header.args) ||
+        !SectionInBounds<CandcString>(header.strings) ||
+        !SectionInBounds<char>(header.string_data) ||
+        !SectionInBounds<double>(header.doubles) ||
+        !SectionInBounds<CandcSymbol>(header.symbols) ||
+        !SectionInBounds<CandcLineMapEntry>(header.line_map)) {
+      return false;
+    }
+    constexpr auto kOpCount = static_cast<std::uint16_t>(eIrOp::UNARY_NOT) + 1;
+    for (const auto& line : Lines()) {
+      if (line.op >= kOpCount ||
+          std::size_t{line.first_arg} + line.arg_count > Args().size()) {
+        return false;
+      }
+    }
+    for (const auto& arg : Args()) {
+      auto index = static_cast<std::size_t>(arg.value);
+      if ((arg.kind == eCandcArg::kDouble &&
+           (arg.value < 0 || index >= Doubles().size())) ||
+          (arg.kind == eCandcArg::kString &&
+           (arg.value < 0 || index >= Strings().size())) ||
+          arg.kind > eCandcArg::kBool) {
+        return false;
+      }
+    }
+    for (const auto& string : Strings()) {
+      if (std::size_t{string.offset} + string.size > header.string_data.count) {
+        return false;
+      }
+    }
+    for (const auto& symbol : Symbols()) {
+      if (symbol.name >= Strings().size()) return false;
+    }
+    auto map = Section<CandcLineMapEntry>(header.line_map);
+    for (std::size_t i = 0; i < map.size(); i++) {
+      if (i > 0 && map[i].first_line <= map[i - 1].first_line) return false;
+    }
+    return true;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: candc_module.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_CANDC_MODULE_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -1,8 +1,11 @@
 //=-------------------------------------------------------------------------=//
 // Global Dependencies
 //---------------------------------------------------------------------------//
+// The allocation budget tests need the counting operator new, which a test
+// build enables with -DCAOCO_COUNT_ALLOCATIONS=1, see allocation_counter.h.
 #include "import_stl.h"
 #include "minitest.h"  // Minimal Unit Testing Framework
+#include "minibench.h"  // Benchmarks of the framework
 //---------------------------------------------------------------------------//
 //=-------------------------------------------------------------------------=//
 
@@ -23,8 +26,23 @@
 #include "token_scope.h"
 
 // Compiler Tools
+#include "aot_runtime.h"
+#include "bench_corpus.h"
+#include "cand_driver.h"
+#include "candc_module.h"
+#include "evaluator.h"
+#include "fuzz_targets.h"
+#include "ir_cfg.h"
+#include "ir_codegen.h"
+#include "ir_fusion_table.h"
+#include "ir_optimizer.h"
+#include "ir_ssa.h"
+#include "ir_superinstructions.h"
+#include "ir_transpiler.h"
+#include "jit_x86_64.h"
 #include "lark_parser.h"
 #include "lexer.h"
+#include "tier_manager.h"
 //---------------------------------------------------------------------------//
 //=-------------------------------------------------------------------------=//
 
@@ -78,17 +96,45 @@
 //              1.3.CAOCO_UNIT_TEST0_PARSER_UTILS_FrameScopeFinder
 //              1.4.CAOCO_UNIT_TEST0_PARSER_UTILS_StatementScopeFinder
 
+#include "ut0_allocation_budgets.h"
+#include "ut0_bench_corpus.h"
+#include "ut0_candc_module.h"
+#include "ut0_compilation_session.h"
+#include "ut0_compiler_daemon.h"
 #include "ut0_expected.h"
+#include "ut0_fuzz_targets.h"
+#include "ut0_ir_control_flow.h"
+#include "ut0_ir_escape.h"
+#include "ut0_ir_inliner.h"
+#include "ut0_ir_optimizer.h"
+#include "ut0_ir_ssa.h"
+#include "ut0_ir_superinstructions.h"
+#include "ut0_ir_transpiler.h"
+#include "ut0_ir_types.h"
+#include "ut0_jit_x86_64.h"
 #include "ut0_lexer.h"
+#include "ut0_minibench.h"
+#include "ut0_module_cache.h"
+#include "ut0_module_graph.h"
 #include "ut0_parser_basics.h"
+#include "ut0_phase_timer.h"
+#include "ut0_preprocessor.h"
+#include "ut0_sema.h"
+#include "ut0_symbol_table.h"
 #include "ut0_system_io.h"
+#include "ut0_tail_calls.h"
+#include "ut0_tier_manager.h"
 #include "ut0_token_scope.h"
 //#include "ut0_runtime.h"
+FINISH_MINIBENCHES;  // Defines RunMinibenches, called by main
 FINISH_MINITESTS;  // Macro to finish the test suite
 // Undefine all the minitest macros except MINITEST_RESULT
 #undef MINITEST
 #undef END_MINITEST
 #undef FINISH_MINITESTS
+#undef MINIBENCH
+#undef END_MINIBENCH
+#undef FINISH_MINIBENCHES
 #undef EXPECT_TRUE
 #undef EXPECT_FALSE
 #undef EXPECT_EQ
@@ -99,4 +145,13 @@ FINISH_MINITESTS;  // Macro to finish the test suite
 //---------------------------------------------------------------------------//
 //=-------------------------------------------------------------------------=//
 
-int main() { std::cout << "Hello World!\n"; }
+// Without a command, runs the benchmarks and the unit tests, failing if any
+// failed.
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    bool benches = minitest::RunMinibenches();
+    return MINITESTS_RESULT && benches ? 0 : 1;
+  }
+  return CandDriver::Main({argv + 1, argv + argc}, std::cin, std::cout,
+                          std::cerr);
+}
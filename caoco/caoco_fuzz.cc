@@ -0,0 +1,72 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: caoco_fuzz.cc
+//---------------------------------------------------------------------------//
+// Brief: libFuzzer entry point of a fuzz target, see fuzz_targets.h.
+// Build one binary per target with clang, for example of the parser:
+//       clang++ -std=c++20 -g -O1 -fsanitize=fuzzer,address
+//               -DCAOCO_FUZZ_TARGET=\"parse\" caoco_fuzz.cc -o fuzz_parse
+//       ./fuzz_parse -max_len=4096 corpus fuzz_corpus
+// The first directory collects the inputs found, fuzz_corpus holds the
+// seeds. Every 10 seconds and at exit the target prints its execs per
+// second, and the superlinear inputs it found are written to the directory
+// in CAOCO_FUZZ_REGRESSIONS, default perf_regressions.
+//---------------------------------------------------------------------------//
+#include "import_stl.h"
+#include "fuzz_targets.h"
+
+#ifndef CAOCO_FUZZ_TARGET
+#define CAOCO_FUZZ_TARGET "parse"
+#endif
+#ifndef CAOCO_FUZZ_REGRESSIONS
+#define CAOCO_FUZZ_REGRESSIONS "perf_regressions"
+#endif
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+static FuzzRunner& CaocoFuzzRunner() {
+  static FuzzRunner runner = [] {
+    const FuzzTarget* target = FuzzTargets::Find(CAOCO_FUZZ_TARGET);
+    if (target == nullptr) {
+      std::cerr << kFuzzErrorUnknownTarget << std::endl;
+      std::abort();
+    }
+    return FuzzRunner(*target,
+                      {.regressions = CAOCO_FUZZ_REGRESSIONS,
+                       .report_interval = std::chrono::seconds(10),
+                       .log = &std::cerr});
+  }();
+  return runner;
+}
+
+extern "C" int LLVMFuzzerInitialize(int*, char***) {
+  std::atexit([] { CaocoFuzzRunner().PrintStats(std::cerr); });
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data,
+                                      std::size_t size) {
+  CaocoFuzzRunner().Run(
+      {reinterpret_cast<const char*>(data), size});
+  return 0;
+}
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: caoco_fuzz.cc
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,204 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: compilation_session.h
+//---------------------------------------------------------------------------//
+// Brief: State of one compilation, sessions compile concurrently.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_COMPILATION_SESSION_H
+#define HEADER_GUARD_CAOCO_COMPILER_COMPILATION_SESSION_H
+// Includes:
+#include "expected.h"
+#include "import_stl.h"
+#include "ir_codegen.h"
+#include "ir_optimizer.h"
+#include "lark_parser.h"
+#include "lexer.h"
+#include "phase_timer.h"
+#include "preprocessor.h"
+#include "sema.h"
+#include "symbol_table.h"
+#include "work_stealing_pool.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+struct CompilationOptions {
+  bool optimize = false;  // Runs the standard IR pass pipeline.
+  bool check = false;     // Resolves the names first, fails on a diagnostic.
+  std::size_t sema_threads = 1;  // 0 for one per hardware thread.
+};
+
+//=-------------------------------------------------------------------------=//
+// CompilationSession
+//---------------------------------------------------------------------------//
+// Owns everything a compilation writes: the options, the tokens and tree of
+// the source, the interned names, the diagnostics of the check and the
+// preprocessor with its cache of included files. The
+// stages only share immutable statics, so sessions on different threads do
+// not interact.
+// A session compiles one source at a time.
+class CompilationSession {
+  CompilationOptions options_;
+  CeSymbolInterner symbols_;
+  Preprocessor preprocessor_;
+  TkVector tokens_;
+  Ast tree_;
+  std::vector<SemaExport> imports_;
+  std::vector<SemaDiagnostic> diagnostics_;
+
+ public:
+  explicit CompilationSession(CompilationOptions options = {})
+      : options_(options) {}
+
+  const CompilationOptions& Options() const { return options_; }
+  CeSymbolInterner& Symbols() { return symbols_; }
+  const CeSymbolInterner& Symbols() const { return symbols_; }
+  const Ast& Tree() const { return tree_; }
+  // To predefine macros, see preprocessor.h.
+  Preprocessor& Directives() { return preprocessor_; }
+  // Of the last check, in source order.
+  const std::vector<SemaDiagnostic>& Diagnostics() const {
+    return diagnostics_;
+  }
+
+  // Lexes and parses a source, the tree is kept until the next call. The
+  // file of the source locates its includes.
+  Expected<const Ast*> Parse(const std::string& source,
+                             const std::filesystem::path& file = {}) {
+    TkVector lexed;
+    {
+      CAOCO_PHASE("lex");
+      auto tokens = Lexer::Lex(source);
+      if (!tokens) return Expected<const Ast*>::Failure(tokens.Error());
+      lexed = tokens.Extract();
+    }
+    return Parse(std::move(lexed), file);
+  }
+
+  // Preprocesses and parses the tokens of a source.
+  Expected<const Ast*> Parse(TkVector tokens,
+                             const std::filesystem::path& file = {}) {
+    diagnostics_.clear();
+    if (Preprocessor::HasDirectives(tokens)) {
+      CAOCO_PHASE("preprocess");
+      auto preprocessed = preprocessor_.Run(tokens, file);
+      if (!preprocessed) {
+        return Expected<const Ast*>::Failure(preprocessed.Error());
+      }
+      tokens = std::move(preprocessed.Extract().tokens);
+    }
+    tokens_ = std::move(tokens);
+    CAOCO_PHASE("parse");
+    auto ast = LarkParser::Parse(tokens_);
+    if (!ast) return Expected<const Ast*>::Failure(ast.Error());
+    tree_ = ast.Extract();
+    return Expected<const Ast*>::Success(&tree_);
+  }
+
+  // Declarations of other modules the checks resolve names to.
+  void Import(const std::vector<SemaExport>& exports) {
+    imports_.insert(imports_.end(), exports.begin(), exports.end());
+  }
+
+  // Resolves the names of the parsed tree, see sema.h.
+  void Check() {
+    CAOCO_PHASE("sema");
+    diagnostics_ = SemanticAnalyzer::Analyze(tree_, symbols_,
+                                             options_.sema_threads, imports_)
+                       .diagnostics;
+  }
+
+  // Parses and resolves the names of a source.
+  BoolError Check(const std::string& source) {
+    auto ast = Parse(source);
+    if (!ast) return ast.Error();
+    Check();
+    return BoolError();
+  }
+
+  // The IR of the parsed tree, without its main for an imported module.
+  Expected<IrCode> Generate(bool with_main = true) const {
+    const Ast* program = &tree_;
+    Ast without_main;
+    if (!with_main) {
+      without_main = Ast(eAst::kProgram, std::string());
+      for (const auto& decl : tree_.Children()) {
+        if (decl.TypeIsnt(eAst::kMainDeclaration)) without_main.PushBack(decl);
+      }
+      program = &without_main;
+    }
+    CAOCO_PHASE("irgen");
+    IrGen gen;
+    auto code = gen.GenerateIr(*program);
+    if (code.isAborted()) {
+      const auto& args = code.GetLines().back().args;
+      return Expected<IrCode>::Failure(
+          args.empty() || !std::holds_alternative<IrString>(args.front())
+              ? std::string(kIrErrorNoProgramDefinition)
+              : std::get<IrString>(args.front()));
+    }
+    return Expected<IrCode>::Success(std::move(code));
+  }
+
+  // Lexes, parses and generates the IR of a program.
+  Expected<IrCode> Compile(const std::string& source) {
+    if (options_.check) {
+      auto checked = Check(source);
+      if (!checked) return Expected<IrCode>::Failure(checked.Error());
+      if (!diagnostics_.empty()) {
+        return Expected<IrCode>::Failure(diagnostics_.front().message);
+      }
+    } else {
+      auto ast = Parse(source);
+      if (!ast) return Expected<IrCode>::Failure(ast.Error());
+    }
+    auto generated = Generate();
+    if (!generated) return generated;
+    auto code = generated.Extract();
+    if (options_.optimize) {
+      CAOCO_PHASE("optimize");
+      auto optimized = IrPassManager::StandardPipeline().Run(code);
+      if (!optimized) return Expected<IrCode>::Failure(optimized.Error());
+    }
+    return Expected<IrCode>::Success(std::move(code));
+  }
+
+  // Compiles each source in its own session on a work stealing pool. The
+  // results are in the order of the sources.
+  static std::vector<Expected<IrCode>> CompileAll(
+      const std::vector<std::string>& sources, CompilationOptions options,
+      std::size_t threads = 0) {
+    std::vector<std::optional<Expected<IrCode>>> results(sources.size());
+    std::vector<WorkStealingPool::Task> tasks;
+    for (std::size_t i = 0; i < sources.size(); i++) {
+      tasks.push_back([&sources, &results, options, i] {
+        results[i] = CompilationSession(options).Compile(sources[i]);
+      });
+    }
+    WorkStealingPool(threads).Run(std::move(tasks));
+    std::vector<Expected<IrCode>> compiled;
+    for (auto& result : results) compiled.push_back(std::move(*result));
+    return compiled;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: compilation_session.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_COMPILATION_SESSION_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,375 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: compiler_daemon.h
+//---------------------------------------------------------------------------//
+// Brief: Compiler process serving command lines over a local socket.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_COMPILER_DAEMON_H
+#define HEADER_GUARD_CAOCO_COMPILER_COMPILER_DAEMON_H
+// Includes:
+#include "expected.h"
+#include "import_stl.h"
+#include "module_cache.h"
+
+#if defined(__unix__)
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define CAOCO_DAEMON_SOCKETS 1
+#else
+#define CAOCO_DAEMON_SOCKETS 0
+#endif
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+static constexpr std::string_view kDaemonErrorUnsupported =
+    "The compiler daemon needs Unix domain sockets.";
+static constexpr std::string_view kDaemonErrorListen =
+    "Cannot listen on socket: ";
+static constexpr std::string_view kDaemonErrorConnect =
+    "Cannot connect to daemon: ";
+static constexpr std::string_view kDaemonErrorReply =
+    "The daemon closed the connection before replying.";
+// A request of this single argument stops the daemon.
+static constexpr std::string_view kDaemonStopCommand = "stop";
+static constexpr std::uintmax_t kDaemonMemoryCapacity = 256ull << 20;
+// Bounds of a message, a peer claiming more is disconnected before any
+// memory is allocated for it.
+static constexpr std::uint32_t kDaemonMaxArgs = 4096;
+static constexpr std::uint32_t kDaemonMaxStringSize = 64u << 20;
+// Clients served at once, the next wait in the backlog of the socket.
+static constexpr std::size_t kDaemonDefaultMaxClients = 16;
+
+//=-------------------------------------------------------------------------=//
+// CompilerDaemon
+//---------------------------------------------------------------------------//
+// Listens on a Unix domain socket and runs the command line of each client
+// on its own thread, at most max_clients at once, against one module cache
+// kept in memory for the life of the process. A library imported by every
+// request is read, parsed and generated once, later requests only hash its
+// source.
+// A request is the argument count, the arguments and the standard input of
+// the command. The reply is the exit code, the standard output and the
+// standard error. Counts and lengths are 32 bit in the host byte order,
+// both ends are on the same machine. The socket is readable and writable by
+// its owner only.
+class CompilerDaemon {
+ public:
+  // Runs a command line, returns its exit code.
+  using Handler = std::function<int(
+      const std::vector<std::string>& args, std::istream& in,
+      std::ostream& out, std::ostream& err, ModuleCache& cache)>;
+
+  struct Reply {
+    int exit_code = 0;
+    std::string out;
+    std::string err;
+  };
+
+ private:
+  std::filesystem::path socket_path_;
+  Handler handler_;
+  ModuleCache cache_;
+  int listen_fd_ = -1;
+  std::atomic<bool> stopping_ = false;
+  std::atomic<std::size_t> served_ = 0;
+  std::mutex clients_mutex_;  // Guards clients_.
+  std::condition_variable clients_changed_;
+  std::size_t clients_ = 0;
+  std::size_t max_clients_;
+
+#if CAOCO_DAEMON_SOCKETS
+  static bool WriteAll(int fd, const void* data, std::size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+      auto sent = ::send(fd, bytes, size, MSG_NOSIGNAL);
+      if (sent < 0 && errno == EINTR) continue;
+      if (sent <= 0) return false;
+      bytes += sent;
+      size -= static_cast<std::size_t>(sent);
+    }
+    return true;
+  }
+
+  static bool ReadAll(int fd, void* data, std::size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+      auto received = ::recv(fd, bytes, size, 0);
+      if (received < 0 && errno == EINTR) continue;
+      if (received <= 0) return false;
+      bytes += received;
+      size -= static_cast<std::size_t>(received);
+    }
+    return true;
+  }
+
+  static bool WriteCount(int fd, std::uint32_t count) {
+    return WriteAll(fd, &count, sizeof(count));
+  }
+
+  static std::optional<std::uint32_t> ReadCount(int fd) {
+    std::uint32_t count = 0;
+    if (!ReadAll(fd, &count, sizeof(count))) return std::nullopt;
+    return count;
+  }
+
+  static bool WriteString(int fd, std::string_view text) {
+    return WriteCount(fd, static_cast<std::uint32_t>(text.size())) &&
+           WriteAll(fd, text.data(), text.size());
+  }
+
+  static std::optional<std::string> ReadString(int fd) {
+    auto size = ReadCount(fd);
+    if (!size || *size > kDaemonMaxStringSize) return std::nullopt;
+    std::string text(*size, '\0');
+    if (!ReadAll(fd, text.data(), text.size())) return std::nullopt;
+    return text;
+  }
+
+  static std::optional<sockaddr_un> Address(
+      const std::filesystem::path& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    auto name = path.string();
+    if (name.size() >= sizeof(address.sun_path)) return std::nullopt;
+    std::memcpy(address.sun_path, name.c_str(), name.size() + 1);
+    return address;
+  }
+
+  void Serve(int fd) {
+    std::vector<std::string> args;
+    std::optional<std::string> in;
+    auto count = ReadCount(fd);
+    if (count && *count > kDaemonMaxArgs) count = std::nullopt;
+    for (std::uint32_t i = 0; count && i < *count; i++) {
+      auto arg = ReadString(fd);
+      if (!arg) break;
+      args.push_back(std::move(*arg));
+    }
+    if (count && args.size() == *count) in = ReadString(fd);
+    if (in) {
+      std::istringstream input(*in);
+      std::ostringstream out;
+      std::ostringstream err;
+      int exit_code = 0;
+      if (args.size() == 1 && args[0] == kDaemonStopCommand) {
+        Stop();
+      } else {
+        try {
+          exit_code = handler_(args, input, out, err, cache_);
+        } catch (const std::exception& e) {
+          err << e.what() << std::endl;
+          exit_code = 1;
+        }
+      }
+      served_++;
+      WriteCount(fd, static_cast<std::uint32_t>(exit_code)) &&
+          WriteString(fd, out.str()) && WriteString(fd, err.str());
+    }
+    ::close(fd);
+  }
+#endif
+
+ public:
+  CompilerDaemon(std::filesystem::path socket_path,
+                 std::filesystem::path cache_dir, Handler handler,
+                 std::uintmax_t memory_capacity = kDaemonMemoryCapacity,
+                 std::size_t max_clients = kDaemonDefaultMaxClients)
+      : socket_path_(std::move(socket_path)),
+        handler_(std::move(handler)),
+        cache_(std::move(cache_dir), kModuleCacheDefaultCapacity,
+               memory_capacity),
+        max_clients_(std::max<std::size_t>(max_clients, 1)) {}
+
+  CompilerDaemon(const CompilerDaemon&) = delete;
+  CompilerDaemon& operator=(const CompilerDaemon&) = delete;
+
+  ~CompilerDaemon() {
+#if CAOCO_DAEMON_SOCKETS
+    if (listen_fd_ >= 0) {
+      ::close(listen_fd_);
+      ::unlink(socket_path_.c_str());
+    }
+#endif
+  }
+
+  ModuleCache& Cache() { return cache_; }
+  // Requests replied to, the stop request included.
+  std::size_t Served() const { return served_; }
+
+  // Binds the socket, replacing a socket file left by a daemon which died.
+  BoolError Listen() {
+#if CAOCO_DAEMON_SOCKETS
+    auto address = Address(socket_path_);
+    if (!address) {
+      return std::string(kDaemonErrorListen) + socket_path_.string();
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      return std::string(kDaemonErrorListen) + socket_path_.string();
+    }
+    ::unlink(socket_path_.c_str());
+    // Clients cannot connect before listen, so no other user can before
+    // the chmod.
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&*address),
+               sizeof(*address)) != 0 ||
+        ::chmod(socket_path_.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0) {
+      ::close(fd);
+      return std::string(kDaemonErrorListen) + socket_path_.string();
+    }
+    listen_fd_ = fd;
+    stopping_ = false;
+    return BoolError();
+#else
+    return std::string(kDaemonErrorUnsupported);
+#endif
+  }
+
+  // Accepts clients until stopped, then waits for the requests in flight.
+  // While max_clients are served, the next client is accepted once one of
+  // them is replied to.
+  void Serve() {
+#if CAOCO_DAEMON_SOCKETS
+    while (!stopping_) {
+      {
+        std::unique_lock lock(clients_mutex_);
+        clients_changed_.wait(lock, [this] {
+          return clients_ < max_clients_ || stopping_;
+        });
+      }
+      if (stopping_) break;
+      int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+        break;
+      }
+      {
+        std::lock_guard lock(clients_mutex_);
+        clients_++;
+      }
+      std::thread([this, fd] {
+        Serve(fd);
+        std::lock_guard lock(clients_mutex_);
+        clients_--;
+        clients_changed_.notify_all();
+      }).detach();
+    }
+    std::unique_lock lock(clients_mutex_);
+    clients_changed_.wait(lock, [this] { return clients_ == 0; });
+#endif
+  }
+
+  // Wakes Serve from any thread.
+  void Stop() {
+    {
+      std::lock_guard lock(clients_mutex_);
+      stopping_ = true;
+    }
+    clients_changed_.notify_all();
+#if CAOCO_DAEMON_SOCKETS
+    if (listen_fd_ >= 0) ::shutdown(listen_fd_, SHUT_RDWR);
+#endif
+  }
+
+  // Sends a command line to the daemon at a socket and waits for its reply.
+  static Expected<Reply> Request(const std::filesystem::path& socket_path,
+                                 const std::vector<std::string>& args,
+                                 std::string_view in = {}) {
+#if CAOCO_DAEMON_SOCKETS
+    auto address = Address(socket_path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (!address || fd < 0 ||
+        ::connect(fd, reinterpret_cast<const sockaddr*>(&*address),
+                  sizeof(*address)) != 0) {
+      if (fd >= 0) ::close(fd);
+      return Expected<Reply>::Failure(std::string(kDaemonErrorConnect) +
+                                      socket_path.string());
+    }
+    bool sent = WriteCount(fd, static_cast<std::uint32_t>(args.size()));
+    for (const auto& arg : args) sent = sent && WriteString(fd, arg);
+    sent = sent && WriteString(fd, in);
+    Reply reply;
+    std::optional<std::uint32_t> exit_code;
+    std::optional<std::string> out;
+    std::optional<std::string> err;
+    if (sent && (exit_code = ReadCount(fd)) && (out = ReadString(fd)) &&
+        (err = ReadString(fd))) {
+      reply = {static_cast<int>(*exit_code), std::move(*out),
+               std::move(*err)};
+    }
+    ::close(fd);
+    if (!err) return Expected<Reply>::Failure(std::string(kDaemonErrorReply));
+    return Expected<Reply>::Success(std::move(reply));
+#else
+    return Expected<Reply>::Failure(std::string(kDaemonErrorUnsupported));
+#endif
+  }
+
+  // Which arguments of a command line are paths.
+  struct CommandPaths {
+    std::string_view command;
+    // Indices of the paths among the arguments after the command which are
+    // neither flags nor their values.
+    std::vector<std::size_t> positions;
+    std::vector<std::string_view> path_flags;  // Followed by a path.
+    std::vector<std::string_view> value_flags;  // Followed by another value.
+  };
+
+  // The daemon has its own working directory, so the client makes the
+  // paths of a command line absolute, as described by the CommandPaths of
+  // its command. The arguments of other commands are left as they are.
+  static std::vector<std::string> AbsoluteArgs(
+      const std::vector<std::string>& args,
+      const std::vector<CommandPaths>& commands) {
+    std::vector<std::string> absolute = args;
+    auto paths = std::find_if(
+        commands.begin(), commands.end(), [&args](const CommandPaths& c) {
+          return !args.empty() && c.command == args[0];
+        });
+    if (paths == commands.end()) return absolute;
+    lambda xIsIn = [](const auto& names, const auto& arg) {
+      return std::find(names.begin(), names.end(), arg) != names.end();
+    };
+    std::size_t position = 0;
+    for (std::size_t i = 1; i < absolute.size(); i++) {
+      bool path = false;
+      if (xIsIn(paths->path_flags, absolute[i])) {
+        path = ++i < absolute.size();
+      } else if (xIsIn(paths->value_flags, absolute[i])) {
+        i++;
+      } else if (!absolute[i].starts_with("-")) {
+        path = xIsIn(paths->positions, position++);
+      }
+      if (!path) continue;
+      std::error_code ec;
+      auto absolute_path = std::filesystem::absolute(absolute[i], ec);
+      if (!ec) absolute[i] = absolute_path.lexically_normal().string();
+    }
+    return absolute;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: compiler_daemon.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_COMPILER_DAEMON_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
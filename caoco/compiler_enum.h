@@ -144,6 +144,7 @@ enum class eTk : int {
   kDirIf,
   kDirElse,
   kDirElif,
+  kDirEndif,
   // directive keywords
   kLib,
   kMain,
@@ -286,6 +287,7 @@ enum class eAst : int {
   kInclude,
   kMacro,
   kEndmacro,
+  kEndif,
 
   // directive keywords
   kEnter,
@@ -16,6 +16,7 @@
 // Includes:
 #include "cand_syntax.h"
 #include "import_stl.h"
+#include "token_cursor.h"
 
 namespace compiler_error {
 namespace tokenizer {
@@ -51,6 +52,17 @@ static constexpr lambda xProgrammerLogicError =
     };
 }  // namespace tokenizer
 namespace parser {
+// The token a parser error is at. A cursor at its end is at the Eof sentinel,
+// where its iterator could not be dereferenced.
+class TkErrorLocation {
+  const Tk* token_;
+
+ public:
+  constexpr TkErrorLocation(TkVectorConstIter it) : token_(&*it) {}
+  constexpr TkErrorLocation(const TkCursor& cursor) : token_(&cursor.Get()) {}
+  constexpr const Tk& operator*() const { return *token_; }
+};
+
 static constexpr lambda xPrettyPrintToken = [](const Tk& token) {
   std::stringstream ss;
   ss << "\nToken: " << ToStr(token.Type()) << "\nline: " << token.Line()
@@ -59,7 +71,7 @@ static constexpr lambda xPrettyPrintToken = [](const Tk& token) {
 };
 
 static lambda xProgrammerLogicError =
-    [](eAst attempted_astnode_type, TkVectorConstIter error_location,
+    [](eAst attempted_astnode_type, TkErrorLocation error_location,
        std::string error_message = "",
        std::source_location err_loc = std::source_location::current()) {
       std::stringstream ss;
@@ -76,7 +88,7 @@ static lambda xProgrammerLogicError =
     };
 
 static constexpr lambda xOperationMissingOperand =
-    [](eAst attempted_operator_type, TkVectorConstIter error_location,
+    [](eAst attempted_operator_type, TkErrorLocation error_location,
        std::string error_message = "") {
       std::stringstream ss;
       ss << "\n[User Syntax Error]: ";
@@ -88,7 +100,7 @@ static constexpr lambda xOperationMissingOperand =
     };
 
 static lambda xMismatchedParentheses =
-    [](TkVectorConstIter error_location, std::string error_message = "",
+    [](TkErrorLocation error_location, std::string error_message = "",
        std::source_location err_loc = std::source_location::current()) {
       std::stringstream ss;
       ss << "\n[C&][ERROR][xMismatchedParentheses]: ";
@@ -104,7 +116,7 @@ static lambda xMismatchedParentheses =
     };
 
 static lambda xInvalidForLoopConditionSyntax =
-    [](TkVectorConstIter error_location, std::string error_message = "",
+    [](TkErrorLocation error_location, std::string error_message = "",
        std::source_location err_loc = std::source_location::current()) {
       std::stringstream ss;
       ss << "\n[C&][ERROR][xInvalidForLoopConditionSyntax]: ";
@@ -120,7 +132,7 @@ static lambda xInvalidForLoopConditionSyntax =
     };
 
 static constexpr lambda xInvalidExpression =
-    [](TkVectorConstIter error_location, std::string error_message = "") {
+    [](TkErrorLocation error_location, std::string error_message = "") {
       std::stringstream ss;
       ss << "\n[User Syntax Error]: ";
       ss << "\nInvalid expression at: "
@@ -145,7 +157,7 @@ static lambda xExpectedToken =
       return ss.str();
     };
 
-static constexpr lambda xUserSyntaxError = [](TkVectorConstIter error_location,
+static constexpr lambda xUserSyntaxError = [](TkErrorLocation error_location,
                                               std::string error_message = "") {
   std::stringstream ss;
   ss << "\n[C&][ERROR][User Syntax Error]: "
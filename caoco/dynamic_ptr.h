@@ -60,9 +60,9 @@ class UniqueVoidPtr {
   constexpr UniqueVoidPtr() = default;
   constexpr UniqueVoidPtr(const UniqueVoidPtr&) = delete;
   constexpr UniqueVoidPtr& operator=(const UniqueVoidPtr&) = delete;
-  constexpr UniqueVoidPtr& operator=(UniqueVoidPtr&&) = default;
+  UniqueVoidPtr& operator=(UniqueVoidPtr&&) = default;
 
-  constexpr UniqueVoidPtr(UniqueVoidPtr&& other) {
+  UniqueVoidPtr(UniqueVoidPtr&& other) {
     ptr_ = MakeStdVoidUptr(std::move(other.ptr_.get()));
   }
 
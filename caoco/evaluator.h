@@ -1,7 +1,14 @@
 #pragma once
+#include "aot_runtime.h"
 #include "cand_lang.h"
 #include "import_stl.h"
 #include "ir_codegen.h"
+#include "ir_escape.h"
+#include "ir_fusion_table.h"
+#include "ir_superinstructions.h"
+#include "ir_types.h"
+#include "jit_x86_64.h"
+#include "tier_manager.h"
 
 // There will only be one instance of this class per C& program.
 // Naming convention taken from llvm: "TheContext.h"
@@ -10,15 +17,14 @@ class TheContext;
 
 class Environment {
  public:
-  using NameMap =
-      std::unordered_map<std::string, std::list<NativeVariant>::iterator>;
-  using MemoryList = std::list<NativeVariant>;
+  using NameMap = std::unordered_map<std::string, std::list<RtVal>::iterator>;
+  using MemoryList = std::list<RtVal>;
   using EnvironmentList = std::list<Environment>;
   using EnvironmentListIter = EnvironmentList::iterator;
   using MemoryIter = MemoryList::iterator;
 
-  std::string_view name{"global"};  // Default name for the root environment.
   Environment& parent{*this};
+  std::string_view name{"global"};  // Default name for the root environment.
   EnvironmentList subenvs;
 
   // Names are associated with a location in memory.
@@ -27,161 +33,1060 @@ class Environment {
   NameMap types;
 
   // local static memory
-  MemoryList local_memory{NativeVariant(
-      NativeCaUndefined())};  // The first element is a placeholder.
-                              // Sentinel none value. Variables
-                              // Without a value will point to this.
+  MemoryList local_memory{kRuntimeUndefined};  // The first element is a
+                                               // placeholder. Sentinel
+                                               // undefined value.
   MemoryList& global_memory{this->local_memory};
 
   // Local Memory for unnamed values.
-  MemoryList local_hot_memory{NativeVariant(NativeCaUndefined())};
+  MemoryList local_hot_memory{kRuntimeUndefined};
   MemoryList& global_hot_memory{this->local_hot_memory};
 
-  // Allocations/Dealloc
-  MemoryIter GMAlloc(NativeVariant value);  // Global
-  bool GMRelease(MemoryIter mem_location);
-  MemoryIter LMAlloc(NativeVariant value);  // Local
-  bool LMRelease(MemoryIter mem_location);
-  MemoryIter HMAlloc(NativeVariant value);  // Hot
-  bool HMRelease(MemoryIter mem_location);
-
   bool isRoot() const { return &parent == this; }
   EnvironmentListIter AddSubEnv(std::string_view name) {
     subenvs.emplace_back(*this, name);
     return std::prev(subenvs.end());
   }
   MemoryIter LastLocalAllocation() { return std::prev(local_memory.end()); }
+
+  // Allocates a new named variable in this environment.
+  MemoryIter DeclareVariable(const std::string& var_name, RtVal value) {
+    local_memory.push_back(std::move(value));
+    variables[var_name] = LastLocalAllocation();
+    return variables[var_name];
+  }
+
+  // Finds a variable in this or any enclosing environment.
+  RtVal* LookupVariable(const std::string& var_name) {
+    auto found = variables.find(var_name);
+    if (found != variables.end()) {
+      return &*found->second;
+    }
+    if (isRoot()) {
+      return nullptr;
+    }
+    return parent.LookupVariable(var_name);
+  }
+
   Environment() = default;  // Creates the root environment.
   Environment(Environment& parent, std::string_view name)
       : parent(parent), name(name) {}
 };
 
+// Instances kept for reuse by each allocation which does not escape. Nested
+// frames may each hold one, such as the frames of a recursion.
+static constexpr std::size_t kFrameObjectLimit = 8;
+
+static constexpr std::string_view kEvaluatorErrorDispatchLimit =
+    "[C&][ERROR] Evaluation exceeded its limit of dispatches.";
+static constexpr std::string_view kEvaluatorErrorFrameLimit =
+    "[C&][ERROR] Evaluation exceeded its limit of nested calls.";
+// Nested calls of a program run by the driver. Each call nests several
+// native frames of the evaluator, an unoptimized build overflows its stack
+// at a few thousand. Tail calls reuse their frame and do not count.
+static constexpr std::size_t kEvaluatorDefaultFrameLimit = 1000;
+
+// Bounds an evaluation of untrusted code, such as a fuzzed program. An
+// exceeded limit throws. 0 is unlimited. Compiled regions do not count
+// their dispatches, so disable the JIT along with a dispatch limit.
+struct EvaluatorLimits {
+  std::size_t dispatches{0};
+  std::size_t frames{0};  // Nested calls and constructors.
+};
+
+// Interprets IrCode. See ir_codegen.h for the format of the IR.
 class Evaluator {
+  // Call frame of a method or constructor. Frames live on the C++ stack.
+  struct Frame {
+    Environment* base;                // Outermost scope of the frame.
+    std::shared_ptr<CandObject> self; // Instance of a member call, or null.
+    bool constructing{false};         // Executing a class body.
+    std::size_t entry{0};             // First line of the body.
+  };
+
+  // Resolved call of a C& method, with its evaluated arguments.
+  struct MethodCall {
+    RtVal::MethodT method;
+    std::vector<RtVal> args;
+    std::shared_ptr<CandObject> self;
+  };
+
   Environment& env;
+  std::istream& in_;
+  std::ostream& out_;
+  std::vector<const IrLine*> code_;  // Line index to line.
+  Environment* scope_{&env};          // Innermost lexical scope.
+  Frame frame_{&env, nullptr, false};
+  bool returning_{false};  // Set by RETURN until the frame is left.
+  RtVal return_value_{kRuntimeUndefined};
+  std::optional<MethodCall> tail_call_;  // Replaces the frame once left.
+  std::list<RuntimeEnv> class_envs_;  // Static environment of each class.
+
+  // Superinstructions, see ir_superinstructions.h.
+  bool fusion_{true};
+  std::vector<eIrFusedOp> fused_;  // Line index to superinstruction.
+  std::vector<RtVal> literals_;    // Decoded literal operands of fused lines.
+
+  // Types of the operands of binary lines, kAny unless proven, see
+  // ir_types.h.
+  bool type_inference_{true};
+  std::vector<eIrType> typed_;
 
-  // Evaluates lines then places the result on the hot memory of the
-  // environment.
-  void EvaluateToLocal(std::list<IrLine>& lines,
-                       std::list<IrLine>::iterator beg,
-                       std::list<IrLine>::iterator end) {
-    env.local_memory.push_back(Evaluate(lines, beg, end));
+  // Instances of the allocations which do not escape, by line, see
+  // ir_escape.h. An instance is reused once its variable released it.
+  bool escape_analysis_{true};
+  std::vector<bool> local_objects_;  // Line index to true if it is local.
+  std::vector<std::vector<std::shared_ptr<CandObject>>> frame_objects_;
+  std::size_t allocations_{0};  // Instances created by the heap.
+
+  // Tiers, see tier_manager.h.
+  TierOptions tier_;
+  TierManager tiers_;
+
+  // Baseline JIT, see jit_x86_64.h. Regions are indexed by start line.
+  JitOptions jit_;
+  std::vector<std::unique_ptr<JitRegion>> jit_regions_;
+  std::vector<void*> jit_slots_;
+
+  EvaluatorLimits limits_;
+  std::size_t frames_{0};  // Nested frames of the current evaluation.
+
+  // Profiling.
+  bool profiling_{false};
+  std::size_t dispatches_{0};
+  std::vector<std::size_t> line_counts_;  // Line index to dispatch count.
+
+  void IndexLines(const std::list<IrLine>& lines) {
+    code_.clear();
+    code_.reserve(lines.size());
+    for (const auto& line : lines) {
+      if (line.index != code_.size()) {
+        throw std::runtime_error("IR line index does not match its position.");
+      }
+      code_.push_back(&line);
+    }
+
+    typed_.assign(code_.size(), eIrType::kAny);
+    if (type_inference_) {
+      auto types = IrTypeInference::Infer(code_);
+      for (std::size_t i = 0; i < code_.size(); i++) {
+        const IrLine& line = *code_[i];
+        if (!IrOpIsTypedArithmetic(line.op) || line.OperandCount() != 2) {
+          continue;
+        }
+        auto type = types[line.OperandBegin(0)];
+        if ((type == eIrType::kInt || type == eIrType::kDouble) &&
+            type == types[line.OperandBegin(1)]) {
+          typed_[i] = type;
+        }
+      }
+    }
+
+    local_objects_ = escape_analysis_ ? IrEscapeAnalysis::Run(code_)
+                                      : std::vector<bool>(code_.size(), false);
+    frame_objects_.clear();
+    frame_objects_.resize(code_.size());
+    allocations_ = 0;
+
+    // Without tiers every line starts in the bytecode tier.
+    fused_.assign(code_.size(), eIrFusedOp::kNone);
+    literals_.assign(code_.size(), kRuntimeUndefined);
+    bool eager = !tier_.enabled || tier_.bytecode_threshold == 0;
+    tiers_.Reset(code_, eager && Fusing() ? eTier::kBytecode
+                                          : eTier::kInterpreter);
+    if (eager) SelectFused(0, code_.size());
+    dispatches_ = 0;
+    line_counts_.assign(profiling_ ? code_.size() : 0, 0);
+    jit_regions_.clear();
+    jit_regions_.resize(code_.size());
   }
 
- public:
-  NativeVariant Evaluate(std::list<IrLine>& lines,
-                         std::list<IrLine>::iterator beg,
-                         std::list<IrLine>::iterator end) {
-    for (std::list<IrLine>::iterator line = beg; line != end;line++) {
-      switch (line->op) {
-        case eIrOp::DECLARE_VARIABLE: {
-          // Arg1: Type Constraint
-          if (!std::holds_alternative<IrInt>(line->args[0])) {
-            throw std::runtime_error("Expected IrInt for Type Constraint");
-          }
+  // A profile counts every line, so it runs without superinstructions.
+  bool Fusing() const { return fusion_ && !profiling_; }
 
-          if (!std::holds_alternative<IrString>(line->args[1])) {
-            throw std::runtime_error("Expected IrString for variable name");
-          }
-          // Check if the variable already exists in the current environment.
-          auto& var_name = std::get<IrString>(line->args[1]);
+  // Selects the superinstructions of lines [begin, end).
+  void SelectFused(std::size_t begin, std::size_t end) {
+    if (!Fusing()) return;
+    IrFusion::Select(code_, kIrFusionTable, begin, end, fused_);
+    for (std::size_t i = begin; i < end; i++) {
+      for (std::size_t j = i; j < i + IrFusedOpSize(fused_[i]); j++) {
+        if (code_[j]->op == eIrOp::ALLOCATE_LITERAL) {
+          literals_[j] = IrLiteralToRtVal(code_[j]->args[0]);
+        }
+      }
+    }
+  }
 
-          if (env.variables.find(var_name.data()) != env.variables.end()) {
-            throw std::runtime_error("Variable already exists");
-          }
+  void CountDispatch(std::size_t index) {
+    dispatches_++;
+    if (profiling_) line_counts_[index]++;
+    if (limits_.dispatches != 0 && dispatches_ > limits_.dispatches) {
+      throw std::runtime_error(std::string(kEvaluatorErrorDispatchLimit));
+    }
+  }
 
-          // Add the variable to the current environment.
-          // Point to sentinel undefined.
-          env.variables[var_name.data()] = env.local_memory.begin();
-          // Check for an initializer.
-
-          // Next argument is the lines which define the variable.
-          if (!std::holds_alternative<IrInt>(line->args[2]) &&
-              !std::holds_alternative<IrInt>(line->args[3])) {
-            throw std::runtime_error(
-                "Expected IrInt for start and end lines of variable "
-                "definition.");
-          }
+  // Counts a loop back edge to, or a call of, the unit starting at index,
+  // and promotes the unit once the count reaches a tier's threshold.
+  void CountHot(std::size_t index, bool back_edge) {
+    if (profiling_ || index >= code_.size()) return;
+    auto count = tiers_.Count(index);
+    if (count == tier_.bytecode_threshold && tier_.enabled && Fusing()) {
+      SelectFused(index, tiers_.End(index));
+      tiers_.Promote(index, eTier::kBytecode, back_edge);
+    }
+    if (count != jit_.threshold || !jit_.enabled) return;
+    jit_regions_[index] = JitCompiler::Compile(
+        code_, index, [this](const std::string& var_name) {
+          RtVal* value = LookupVariable(var_name);
+          return value == nullptr ? -1 : value->Type();
+        });
+    if (jit_regions_[index] != nullptr && jit_regions_[index]->Valid()) {
+      tiers_.Promote(index, eTier::kJit, back_edge);
+    }
+  }
 
-          auto def_start_line =
-              std::get<IrInt>(line->args[2]);  // Offset from this line.
-          auto def_n_lines =
-              std::get<IrInt>(line->args[3]);  // Number of lines to consume.
-
-          auto def_it = std::next(line, def_start_line - line->index);
-          auto def_it_end = std::next(def_it, def_n_lines);
-          EvaluateToLocal(lines, def_it, def_it_end);
-
-          // Point the variable name to the top of the local stack.
-          env.variables.at(var_name.data()) = env.LastLocalAllocation();
-
-        } break;
-        case eIrOp::DEFINE_VARIABLE: {
-          // Set the value of a global variable.
-          // There should be 2 arguments.
-          if (line->args.size() != 3) {
-            throw std::runtime_error(
-                "Expected 3 arguments for DEFINE_VARIABLE");
-          }
+  // Runs the region starting at index. Returns nullopt if a guard failed,
+  // the region did not run.
+  std::optional<JitExit> EnterRegion(JitRegion& region, RtVal& result) {
+    jit_slots_.resize(region.SlotCount() + 1);
+    for (std::size_t slot = 0; slot < region.SlotCount(); slot++) {
+      RtVal* value = LookupVariable(region.Name(slot));
+      if (value == nullptr || value->Type() != region.Type(slot)) {
+        region.GuardFailed();
+        return std::nullopt;
+      }
+      jit_slots_[slot] =
+          value->Type() == RtVal::kInt
+              ? static_cast<void*>(&value->GetAs<RtVal::IntT>())
+              : static_cast<void*>(&value->GetAs<RtVal::BoolT>());
+    }
+    // The result cell, see JitRegion::Run.
+    jit_slots_.back() = reinterpret_cast<void*>(static_cast<std::intptr_t>(-1));
+    auto exit = region.Run(jit_slots_.data());
+    for (std::size_t i = 0; i < exit.scopes; i++) {
+      scope_ = &*scope_->AddSubEnv("scope");
+    }
+    auto last = reinterpret_cast<std::intptr_t>(jit_slots_.back());
+    if (last >= 0) {
+      result = *LookupVariable(region.Name(static_cast<std::size_t>(last)));
+    }
+    return exit;
+  }
 
-          // Check that the 1st argument is a string.
-          if (!std::holds_alternative<IrString>(line->args[0])) {
-            throw std::runtime_error("Expected string for variable name");
-          }
+  const IrLine& LineAt(IrInt index) const {
+    if (index < 0 || static_cast<std::size_t>(index) >= code_.size()) {
+      throw std::runtime_error("IR line index out of range.");
+    }
+    return *code_[index];
+  }
 
-          // Check that the variable exists.
-          auto& var_name = std::get<IrString>(line->args[0]);
-          if (!env.variables.contains(var_name.data())) {
-            throw std::runtime_error("Variable not found");
-          }
+  static const IrString& StringArg(const IrLine& line, std::size_t arg) {
+    if (arg >= line.args.size() ||
+        !std::holds_alternative<IrString>(line.args[arg])) {
+      throw std::runtime_error("Expected IrString argument for " +
+                               std::string(ToStr(line.op)));
+    }
+    return std::get<IrString>(line.args[arg]);
+  }
+
+  static std::size_t TargetArg(const IrLine& line, std::size_t arg) {
+    if (arg >= line.args.size() ||
+        !std::holds_alternative<IrInt>(line.args[arg]) ||
+        std::get<IrInt>(line.args[arg]) < 0) {
+      throw std::runtime_error("Expected line index argument for " +
+                               std::string(ToStr(line.op)));
+    }
+    return static_cast<std::size_t>(std::get<IrInt>(line.args[arg]));
+  }
+
+  // Scopes of the current frame, then members of self, then globals.
+  RtVal* LookupVariable(const std::string& var_name) {
+    for (Environment* scope = scope_; scope != &env; scope = &scope->parent) {
+      auto found = scope->variables.find(var_name);
+      if (found != scope->variables.end()) {
+        return &*found->second;
+      }
+    }
+    if (frame_.self != nullptr &&
+        frame_.self->local_env.ContainsLocal(var_name, eNameCategory::kVar)) {
+      return &frame_.self->local_env.RetrieveLocal(var_name,
+                                                   eNameCategory::kVar);
+    }
+    auto found = env.variables.find(var_name);
+    return found == env.variables.end() ? nullptr : &*found->second;
+  }
+
+  static RtVal::MethodT FindMethod(CandObject& object,
+                                   const std::string& method_name) {
+    if (!object.object_env.ContainsLocal(method_name,
+                                         eNameCategory::kFunction)) {
+      return nullptr;
+    }
+    return object.object_env
+        .RetrieveLocal(method_name, eNameCategory::kFunction)
+        .GetMethod();
+  }
+
+  std::vector<RtVal> EvaluateOperands(const IrLine& line, std::size_t first) {
+    std::vector<RtVal> values;
+    for (std::size_t i = first; i < line.OperandCount(); i++) {
+      values.push_back(EvaluateExpr(line.OperandBegin(i)));
+    }
+    return values;
+  }
+
+  // Runs the body starting at entry in a new frame. Returns the value of
+  // its RETURN.
+  RtVal RunFrame(std::size_t entry, const std::vector<std::string>& params,
+                 const std::vector<RtVal>& args,
+                 std::shared_ptr<CandObject> self, bool constructing) {
+    if (params.size() != args.size()) {
+      throw std::runtime_error("Wrong number of arguments in call.");
+    }
+    if (limits_.frames != 0 && frames_ >= limits_.frames) {
+      throw std::runtime_error(std::string(kEvaluatorErrorFrameLimit));
+    }
+    frames_++;
+    auto frame_env = env.AddSubEnv("frame");
+    for (std::size_t i = 0; i < params.size(); i++) {
+      frame_env->DeclareVariable(params[i], args[i]);
+    }
+    Frame caller = frame_;
+    Environment* caller_scope = scope_;
+    frame_ = Frame{&*frame_env, std::move(self), constructing, entry};
+    scope_ = &*frame_env;
+    CountHot(entry, false);
+
+    RtVal result = kRuntimeUndefined;
+    for (std::size_t line = entry;;) {
+      while (line < code_.size() && !returning_) {
+        line = EvaluateStatement(line, result);
+      }
+      if (!tail_call_.has_value()) break;
+      // A tail call runs the callee in this frame.
+      auto call = std::move(*tail_call_);
+      tail_call_.reset();
+      returning_ = false;
+      line = call.method->EntryLine();
+      ReuseFrame(call);
+      CountHot(line, false);
+    }
+    result = std::move(return_value_);
+    return_value_ = kRuntimeUndefined;
+    returning_ = false;
+
+    frame_ = std::move(caller);
+    scope_ = caller_scope;
+    env.subenvs.erase(frame_env);
+    frames_--;
+    return result;
+  }
+
+  // Instance of a class for the allocation at index. An allocation which
+  // does not escape reuses an instance no variable refers to anymore, its
+  // class body assigns the members in place.
+  std::shared_ptr<CandObject> Allocate(const CandObject& prototype,
+                                       std::size_t index) {
+    auto& pool = frame_objects_[index];
+    for (auto& instance : pool) {
+      if (instance.use_count() == 1 &&
+          &instance->object_env == &prototype.object_env) {
+        return instance;
+      }
+    }
+    allocations_++;
+    auto instance = std::make_shared<CandObject>(
+        prototype.object_env, prototype.default_constructor, nullptr);
+    if (local_objects_[index] && pool.size() < kFrameObjectLimit) {
+      pool.push_back(instance);
+    }
+    return instance;
+  }
+
+  RtVal Instantiate(const std::string& type_name,
+                    const std::vector<RtVal>& args, std::size_t index) {
+    const auto& prototype = env.types.at(type_name)->GetObject();
+    auto instance = Allocate(*prototype, index);
+    RunFrame(prototype->default_constructor->EntryLine(), {}, args, instance,
+             true);
+    return RtVal(RtVal::NativeVariant(std::in_place_type<RtVal::ObjectT>,
+                                      instance));
+  }
+
+  // Built in methods. Returns nullopt if name is not a builtin.
+  std::optional<RtVal> CallBuiltin(const std::string& name,
+                                   const std::vector<RtVal>& args) {
+    if (name == "cout" || name == "print") {
+      for (const auto& arg : args) {
+        out_ << ToDisplayString(arg);
+      }
+      out_ << std::endl;
+      return kRuntimeUndefined;
+    }
+    if (name == "cin") {
+      std::string read;
+      std::getline(in_, read);
+      return IrLiteralToRtVal(IrString(read));
+    }
+    return std::nullopt;
+  }
+
+  // Resolves a call and evaluates its arguments. Calls of types and
+  // builtins are evaluated, their value is returned instead.
+  std::variant<MethodCall, RtVal> ResolveCall(const IrLine& line) {
+    const auto& name = StringArg(line, 0);
+    if (line.op == eIrOp::CALL_MEMBER) {
+      if (line.OperandCount() == 0) {
+        throw std::runtime_error("Expected object operand for CALL_MEMBER");
+      }
+      RtVal object = EvaluateExpr(line.OperandBegin(0));
+      if (object.Type() != RtVal::kObject) {
+        throw std::runtime_error("Member call on a non object: " + name);
+      }
+      auto method = FindMethod(*object.GetObject(), name);
+      if (method == nullptr) {
+        throw std::runtime_error("Method not found: " + name);
+      }
+      return MethodCall{method, EvaluateOperands(line, 1), object.GetObject()};
+    }
+
+    auto args = EvaluateOperands(line, 0);
+    if (frame_.self != nullptr) {
+      if (auto method = FindMethod(*frame_.self, name)) {
+        return MethodCall{method, std::move(args), frame_.self};
+      }
+    }
+    if (auto found = env.functions.find(name); found != env.functions.end()) {
+      return MethodCall{found->second->GetMethod(), std::move(args), nullptr};
+    }
+    if (env.types.contains(name)) {
+      return Instantiate(name, args, line.index);
+    }
+    if (auto result = CallBuiltin(name, args)) {
+      return *result;
+    }
+    throw std::runtime_error("Method not found: " + name);
+  }
+
+  RtVal EvaluateCall(const IrLine& line) {
+    auto call = ResolveCall(line);
+    if (auto* value = std::get_if<RtVal>(&call)) return std::move(*value);
+    auto& method = std::get<MethodCall>(call);
+    return RunFrame(method.method->EntryLine(), method.method->Args(),
+                    method.args, std::move(method.self), false);
+  }
+
+  // Rebinds the current frame to a tail call, its scopes are unwound.
+  void ReuseFrame(MethodCall& call) {
+    const auto& params = call.method->Args();
+    if (params.size() != call.args.size()) {
+      throw std::runtime_error("Wrong number of arguments in call.");
+    }
+    Environment& base = *frame_.base;
+    if (call.method->EntryLine() == frame_.entry &&
+        base.local_memory.size() == params.size() + 1) {
+      // Self recursion with only the parameters declared, which follow the
+      // sentinel in order: the arguments are assigned in place.
+      auto value = std::next(base.local_memory.begin());
+      for (auto& arg : call.args) *value++ = std::move(arg);
+      frame_.self = std::move(call.self);
+      return;
+    }
+    base.variables.clear();
+    base.local_memory.resize(1);  // Keeps the sentinel.
+    for (std::size_t i = 0; i < params.size(); i++) {
+      base.DeclareVariable(params[i], std::move(call.args[i]));
+    }
+    frame_.self = std::move(call.self);
+    frame_.entry = call.method->EntryLine();
+  }
 
-          // Next argument is the lines which define the variable.
-          if (!std::holds_alternative<IrInt>(line->args[1]) &&
-              !std::holds_alternative<IrInt>(line->args[2])) {
-            throw std::runtime_error(
-                "Expected IrInt for start and end lines of variable "
-                "definition.");
+  RtVal EvaluateExpr(IrInt index) {
+    const IrLine& line = LineAt(index);
+    CountDispatch(index);
+    if (fused_[index] != eIrFusedOp::kNone) {
+      return EvaluateFusedBinary(fused_[index], index);
+    }
+    switch (line.op) {
+      case eIrOp::ALLOCATE_LITERAL:
+        if (line.args.size() != 1) {
+          throw std::runtime_error("Expected 1 argument for ALLOCATE_LITERAL");
+        }
+        return IrLiteralToRtVal(line.args[0]);
+      case eIrOp::LOAD_VARIABLE: {
+        const auto& var_name = StringArg(line, 0);
+        RtVal* value = LookupVariable(var_name);
+        if (value == nullptr) {
+          throw std::runtime_error("Variable not found: " + var_name);
+        }
+        return *value;
+      }
+      case eIrOp::BINARY_AND:
+      case eIrOp::BINARY_OR: {
+        if (line.OperandCount() != 2) {
+          throw std::runtime_error("Expected 2 operands for " +
+                                   std::string(ToStr(line.op)));
+        }
+        // Short circuit: the right operand is only evaluated when needed.
+        RtVal lhs = EvaluateExpr(line.OperandBegin(0));
+        if (lhs.Type() != RtVal::kBool) {
+          throw std::runtime_error("Logical operand must be a bool.");
+        }
+        if (lhs.GetBool() == (line.op == eIrOp::BINARY_OR)) {
+          return lhs;
+        }
+        return ApplyBinaryOp(line.op, lhs, EvaluateExpr(line.OperandBegin(1)));
+      }
+      case eIrOp::UNARY_NOT: {
+        if (line.OperandCount() != 1) {
+          throw std::runtime_error("Expected 1 operand for UNARY_NOT");
+        }
+        RtVal operand = EvaluateExpr(line.OperandBegin(0));
+        if (operand.Type() != RtVal::kBool) {
+          throw std::runtime_error("Logical operand must be a bool.");
+        }
+        return operand.NotOp();
+      }
+      case eIrOp::CALL:
+      case eIrOp::CALL_MEMBER:
+        return EvaluateCall(line);
+      default:
+        if (IrOpIsBinary(line.op)) {
+          if (line.OperandCount() != 2) {
+            throw std::runtime_error("Expected 2 operands for " +
+                                     std::string(ToStr(line.op)));
+          }
+          if (typed_[index] == eIrType::kInt) {
+            return TypedBinary<IrInt>(line);
           }
+          if (typed_[index] == eIrType::kDouble) {
+            return TypedBinary<IrDouble>(line);
+          }
+          RtVal lhs = EvaluateExpr(line.OperandBegin(0));
+          RtVal rhs = EvaluateExpr(line.OperandBegin(1));
+          return ApplyBinaryOp(line.op, lhs, rhs);
+        }
+        throw std::runtime_error("Operation is not an expression: " +
+                                 std::string(ToStr(line.op)));
+    }
+  }
 
-          auto def_start_line =
-              std::get<IrInt>(line->args[1]);  // Offset from this line.
-          auto def_n_lines =
-              std::get<IrInt>(line->args[2]);  // Number of lines to consume.
-
-          auto def_it = std::next(line, def_start_line);
-          auto def_it_end = std::next(def_it, def_n_lines);
-          EvaluateToLocal(lines, def_it, def_it_end);
-
-          // Point the variable name to the top of the local stack.
-          env.variables.at(var_name.data()) = env.LastLocalAllocation();
-
-          // Advance line
-        } break;
-        case eIrOp::ENTER_PROGRAM_DEFINITION:
-          // Initialize env, for now do nothing.
-          break;
-        case eIrOp::ALLOCATE_LITERAL:
-          // For now only int.
-          // Arg1: Type Constraint
-          if (!std::holds_alternative<IrInt>(line->args[0])) {
-            throw std::runtime_error("Expected IrInt for Literal Value");
+  // Operand line of a superinstruction: a variable, or a literal decoded
+  // when the code was indexed.
+  template <bool kVar>
+  const RtVal& FusedLeaf(std::size_t index) {
+    if constexpr (kVar) {
+      const auto& var_name = std::get<IrString>(code_[index]->args[0]);
+      RtVal* value = LookupVariable(var_name);
+      if (value == nullptr) {
+        throw std::runtime_error("Variable not found: " + var_name);
+      }
+      return *value;
+    } else {
+      return literals_[index];
+    }
+  }
+
+  template <bool kLhsVar, bool kRhsVar>
+  RtVal FusedBinary(std::size_t index) {
+    const RtVal& lhs = FusedLeaf<kLhsVar>(index + 1);
+    if (typed_[index] != eIrType::kAny) {
+      return ApplyTypedBinaryOp(code_[index]->op, typed_[index], lhs,
+                                FusedLeaf<kRhsVar>(index + 2));
+    }
+    return ApplyBinaryOp(code_[index]->op, lhs, FusedLeaf<kRhsVar>(index + 2));
+  }
+
+  template <class T>
+  static RtVal TypedBinaryOp(eIrOp op, T lhs, T rhs) {
+    using NativeVariant = RtVal::NativeVariant;
+    switch (op) {
+      case eIrOp::BINARY_ADD:
+        return RtVal(NativeVariant(std::in_place_type<T>,
+                                     RtVal::WrappingAdd(lhs, rhs)));
+      case eIrOp::BINARY_SUB:
+        return RtVal(NativeVariant(std::in_place_type<T>,
+                                     RtVal::WrappingSub(lhs, rhs)));
+      case eIrOp::BINARY_MUL:
+        return RtVal(NativeVariant(std::in_place_type<T>,
+                                     RtVal::WrappingMul(lhs, rhs)));
+      case eIrOp::BINARY_EQ:
+        return RtVal(NativeVariant(std::in_place_type<bool>, lhs == rhs));
+      case eIrOp::BINARY_NE:
+        return RtVal(NativeVariant(std::in_place_type<bool>, lhs != rhs));
+      case eIrOp::BINARY_LT:
+        return RtVal(NativeVariant(std::in_place_type<bool>, lhs < rhs));
+      case eIrOp::BINARY_GT:
+        return RtVal(NativeVariant(std::in_place_type<bool>, lhs > rhs));
+      case eIrOp::BINARY_LE:
+        return RtVal(NativeVariant(std::in_place_type<bool>, lhs <= rhs));
+      case eIrOp::BINARY_GE:
+        return RtVal(NativeVariant(std::in_place_type<bool>, lhs >= rhs));
+      default:
+        throw std::runtime_error("Operation is not typed arithmetic: " +
+                                 std::string(ToStr(op)));
+    }
+  }
+
+  // Value of an operand proven to be a T, see ir_types.h. Variables and
+  // literals are read in place and typed arithmetic stays unboxed: no RtVal
+  // is built until the value leaves the expression.
+  template <class T>
+  T EvaluateTyped(IrInt index) {
+    const IrLine& line = LineAt(index);
+    switch (line.op) {
+      case eIrOp::LOAD_VARIABLE: {
+        CountDispatch(index);
+        const auto& var_name = StringArg(line, 0);
+        RtVal* value = LookupVariable(var_name);
+        if (value == nullptr) {
+          throw std::runtime_error("Variable not found: " + var_name);
+        }
+        return value->GetAs<T>();
+      }
+      case eIrOp::ALLOCATE_LITERAL:
+        CountDispatch(index);
+        return std::get<T>(line.args.at(0));
+      case eIrOp::BINARY_ADD:
+      case eIrOp::BINARY_SUB:
+      case eIrOp::BINARY_MUL:
+        if (typed_[index] != eIrType::kAny &&
+            fused_[index] == eIrFusedOp::kNone) {
+          CountDispatch(index);
+          T lhs = EvaluateTyped<T>(line.OperandBegin(0));
+          T rhs = EvaluateTyped<T>(line.OperandBegin(1));
+          if (line.op == eIrOp::BINARY_ADD) return RtVal::WrappingAdd(lhs, rhs);
+          if (line.op == eIrOp::BINARY_SUB) return RtVal::WrappingSub(lhs, rhs);
+          return RtVal::WrappingMul(lhs, rhs);
+        }
+        [[fallthrough]];
+      default:
+        return EvaluateExpr(index).GetAs<T>();
+    }
+  }
+
+  template <class T>
+  RtVal TypedBinary(const IrLine& line) {
+    T lhs = EvaluateTyped<T>(line.OperandBegin(0));
+    T rhs = EvaluateTyped<T>(line.OperandBegin(1));
+    return TypedBinaryOp(line.op, lhs, rhs);
+  }
+
+  // Applies a BINARY_* op to operands proven to be ints or doubles, without
+  // the dispatch on their tags.
+  static RtVal ApplyTypedBinaryOp(eIrOp op, eIrType type, const RtVal& lhs,
+                                  const RtVal& rhs) {
+    if (type == eIrType::kInt) {
+      return TypedBinaryOp(op, lhs.GetAs<RtVal::IntT>(),
+                           rhs.GetAs<RtVal::IntT>());
+    }
+    return TypedBinaryOp(op, lhs.GetAs<RtVal::DoubleT>(),
+                         rhs.GetAs<RtVal::DoubleT>());
+  }
+
+  RtVal EvaluateFusedBinary(eIrFusedOp op, std::size_t index) {
+    switch (op) {
+      case eIrFusedOp::kBinaryVarVar:
+        return FusedBinary<true, true>(index);
+      case eIrFusedOp::kBinaryVarLit:
+        return FusedBinary<true, false>(index);
+      case eIrFusedOp::kBinaryLitVar:
+        return FusedBinary<false, true>(index);
+      default:
+        throw std::runtime_error("Superinstruction is not an expression: " +
+                                 std::string(ToStr(op)));
+    }
+  }
+
+  // Value of the operand tree of a fused DEFINE_VARIABLE or JUMP_IF_FALSE,
+  // which starts on the next line.
+  RtVal EvaluateFusedOperand(eIrFusedOp op, std::size_t index) {
+    switch (op) {
+      case eIrFusedOp::kDefineVar:
+      case eIrFusedOp::kBranchVar:
+        return FusedLeaf<true>(index + 1);
+      case eIrFusedOp::kDefineLit:
+        return FusedLeaf<false>(index + 1);
+      case eIrFusedOp::kDefineBinaryVarVar:
+      case eIrFusedOp::kBranchBinaryVarVar:
+        return FusedBinary<true, true>(index + 1);
+      case eIrFusedOp::kDefineBinaryVarLit:
+      case eIrFusedOp::kBranchBinaryVarLit:
+        return FusedBinary<true, false>(index + 1);
+      case eIrFusedOp::kDefineBinaryLitVar:
+      case eIrFusedOp::kBranchBinaryLitVar:
+        return FusedBinary<false, true>(index + 1);
+      default:
+        throw std::runtime_error("Superinstruction has no operand: " +
+                                 std::string(ToStr(op)));
+    }
+  }
+
+  // Executes the fused statement at index. Returns the index of the next
+  // statement.
+  std::size_t EvaluateFusedStatement(eIrFusedOp op, std::size_t index,
+                                     RtVal& result) {
+    const IrLine& line = *code_[index];
+    RtVal value = EvaluateFusedOperand(op, index);
+    if (line.op == eIrOp::JUMP_IF_FALSE) {
+      if (value.Type() != RtVal::kBool) {
+        throw std::runtime_error("Condition must be a bool.");
+      }
+      if (!value.GetBool()) {
+        return TargetArg(line, 0);
+      }
+    } else {
+      const auto& var_name = std::get<IrString>(line.args[0]);
+      RtVal* target = LookupVariable(var_name);
+      if (target == nullptr) {
+        throw std::runtime_error("Variable not found: " + var_name);
+      }
+      *target = std::move(value);
+      result = *target;
+    }
+    return index + IrFusedOpSize(op);
+  }
+
+  // Leaves every scope of the current frame.
+  void UnwindScopes() {
+    while (scope_ != frame_.base) {
+      Environment* parent = &scope_->parent;
+      parent->subenvs.pop_back();
+      scope_ = parent;
+    }
+  }
+
+  // Executes the statement at index. Returns the index of the next statement.
+  std::size_t EvaluateStatement(std::size_t index, RtVal& result) {
+    const IrLine& line = *code_[index];
+    if (jit_regions_[index] != nullptr) {
+      if (jit_regions_[index]->Valid()) {
+        // A deoptimized first statement runs in the interpreter.
+        auto exit = EnterRegion(*jit_regions_[index], result);
+        if (exit.has_value() && !(exit->deopt && exit->next == index)) {
+          CountDispatch(index);
+          return exit->next;
+        }
+      } else {
+        tiers_.Deoptimize(index);
+      }
+    }
+    if (fused_[index] != eIrFusedOp::kNone &&
+        !IrFusedOpIsExpression(fused_[index])) {
+      CountDispatch(index);
+      return EvaluateFusedStatement(fused_[index], index, result);
+    }
+    if (!IrOpIsExpression(line.op)) CountDispatch(index);
+    switch (line.op) {
+      case eIrOp::ENTER_PROGRAM_DEFINITION:
+        // Initialize env, for now do nothing.
+        break;
+      case eIrOp::ABORT_AND_ERROR:
+        throw std::runtime_error(StringArg(line, 0));
+      case eIrOp::DECLARE_VARIABLE: {
+        // Arg1: Type Constraint
+        if (line.args.empty() || !std::holds_alternative<IrInt>(line.args[0])) {
+          throw std::runtime_error("Expected IrInt for Type Constraint");
+        }
+        const auto& var_name = StringArg(line, 1);
+        RtVal value = line.OperandCount() == 1
+                          ? EvaluateExpr(line.OperandBegin(0))
+                          : kRuntimeUndefined;
+        auto type_constraint = std::get<IrInt>(line.args[0]);
+        if (type_constraint != kIrTypeConstraintAny &&
+            type_constraint != value.Type() &&
+            value.Type() != RtVal::kUndefined) {
+          throw std::runtime_error("Type constraint violated: " + var_name);
+        }
+        if (frame_.constructing && scope_ == frame_.base) {
+          auto& members = frame_.self->local_env;
+          if (members.ContainsLocal(var_name, eNameCategory::kVar)) {
+            members.RetrieveLocal(var_name, eNameCategory::kVar) = value;
+          } else {
+            members.Define(var_name, eNameCategory::kVar, value);
+          }
+        } else {
+          // Optimizer temporaries may be redeclared by each loop iteration.
+          if (scope_->variables.contains(var_name) &&
+              !var_name.starts_with(kIrTempPrefix)) {
+            throw std::runtime_error("Variable already exists: " + var_name);
           }
-          // Allocate literal value onto local env.
-          env.local_memory.push_back(std::get<IrInt>(line->args[0]));
-          break;
+          scope_->DeclareVariable(var_name, value);
+        }
+        result = std::move(value);
+      } break;
+      case eIrOp::DEFINE_VARIABLE: {
+        const auto& var_name = StringArg(line, 0);
+        if (line.OperandCount() != 1) {
+          throw std::runtime_error("Expected 1 operand for DEFINE_VARIABLE");
+        }
+        RtVal value = EvaluateExpr(line.OperandBegin(0));
+        RtVal* target = LookupVariable(var_name);
+        if (target == nullptr) {
+          throw std::runtime_error("Variable not found: " + var_name);
+        }
+        *target = std::move(value);
+        result = *target;
+      } break;
+      case eIrOp::DECLARE_METHOD: {
+        const auto& method_name = StringArg(line, 0);
+        std::vector<std::string> params;
+        for (std::size_t arg = 2; arg < line.args.size(); arg++) {
+          params.push_back(StringArg(line, arg));
+        }
+        RtVal method(RtVal::NativeVariant(
+            std::in_place_type<RtVal::MethodT>,
+            std::make_shared<CandMethod>(params, index + 1)));
+        if (frame_.constructing && scope_ == frame_.base) {
+          // Each instance runs the class body, define the method only once.
+          auto& object_env = frame_.self->object_env;
+          if (!object_env.ContainsLocal(method_name,
+                                        eNameCategory::kFunction)) {
+            object_env.Define(method_name, eNameCategory::kFunction, method);
+          }
+        } else {
+          env.local_memory.push_back(std::move(method));
+          env.functions[method_name] = env.LastLocalAllocation();
+        }
+        return TargetArg(line, 1);
+      }
+      case eIrOp::DECLARE_OBJECT: {
+        const auto& type_name = StringArg(line, 0);
+        class_envs_.emplace_back();
+        auto prototype = std::make_shared<CandObject>(
+            class_envs_.back(),
+            std::make_shared<CandMethod>(std::vector<std::string>{}, index + 1),
+            nullptr);
+        env.local_memory.push_back(RtVal(RtVal::NativeVariant(
+            std::in_place_type<RtVal::ObjectT>, std::move(prototype))));
+        env.types[type_name] = env.LastLocalAllocation();
+        return TargetArg(line, 1);
+      }
+      case eIrOp::RETURN:
+        return_value_ = line.OperandCount() == 1
+                            ? EvaluateExpr(line.OperandBegin(0))
+                            : kRuntimeUndefined;
+        UnwindScopes();
+        returning_ = true;
+        return code_.size();
+      case eIrOp::TAIL_CALL: {
+        if (line.OperandCount() != 1) {
+          throw std::runtime_error("Expected 1 operand for TAIL_CALL");
+        }
+        auto call_index = line.OperandBegin(0);
+        const IrLine& call_line = LineAt(call_index);
+        std::variant<MethodCall, RtVal> call = kRuntimeUndefined;
+        if (frame_.base != &env && !frame_.constructing &&
+            (call_line.op == eIrOp::CALL ||
+             call_line.op == eIrOp::CALL_MEMBER)) {
+          CountDispatch(call_index);
+          call = ResolveCall(call_line);
+        } else {
+          call = EvaluateExpr(call_index);
+        }
+        UnwindScopes();
+        if (auto* value = std::get_if<RtVal>(&call)) {
+          return_value_ = std::move(*value);
+          returning_ = true;
+          return code_.size();
+        }
+        auto& method = std::get<MethodCall>(call);
+        if (method.method->EntryLine() == frame_.entry) {
+          // Self recursion loops back to the entry of the method.
+          ReuseFrame(method);
+          CountHot(frame_.entry, true);
+          return frame_.entry;
+        }
+        tail_call_ = std::move(method);
+        returning_ = true;
+        return code_.size();
+      }
+      case eIrOp::JUMP: {
+        auto target = TargetArg(line, 0);
+        if (target <= index) CountHot(target, true);
+        return target;
+      }
+      case eIrOp::JUMP_IF_FALSE: {
+        if (line.OperandCount() != 1) {
+          throw std::runtime_error("Expected 1 operand for JUMP_IF_FALSE");
+        }
+        RtVal condition = EvaluateExpr(line.OperandBegin(0));
+        if (condition.Type() != RtVal::kBool) {
+          throw std::runtime_error("Condition must be a bool.");
+        }
+        if (!condition.GetBool()) {
+          return TargetArg(line, 0);
+        }
+      } break;
+      case eIrOp::ENTER_SCOPE:
+        scope_ = &*scope_->AddSubEnv("scope");
+        break;
+      case eIrOp::EXIT_SCOPE: {
+        if (scope_ == frame_.base) {
+          throw std::runtime_error("EXIT_SCOPE without ENTER_SCOPE.");
+        }
+        Environment* parent = &scope_->parent;
+        parent->subenvs.pop_back();
+        scope_ = parent;
+      } break;
+      default:
+        // Expression statement.
+        result = EvaluateExpr(static_cast<IrInt>(index));
+        break;
+    }
+    return line.ExtentEnd() + 1;
+  }
 
+ public:
+  // Applies a BINARY_* op. Shared with the optimizer so that folded
+  // literals have exactly the runtime semantics.
+  static RtVal ApplyBinaryOp(eIrOp op, const RtVal& lhs, const RtVal& rhs) {
+    // Runtime operators report errors by throwing a C string.
+    try {
+      switch (op) {
         case eIrOp::BINARY_ADD:
-
+          return lhs.AddOp(rhs);
+        case eIrOp::BINARY_SUB:
+          return lhs.SubOp(rhs);
+        case eIrOp::BINARY_MUL:
+          return lhs.MulOp(rhs);
+        case eIrOp::BINARY_DIV:
+          return lhs.DivOp(rhs);
+        case eIrOp::BINARY_MOD:
+          return lhs.ModOp(rhs);
+        case eIrOp::BINARY_EQ:
+          return lhs.EqOp(rhs);
+        case eIrOp::BINARY_NE:
+          return lhs.NeOp(rhs);
+        case eIrOp::BINARY_LT:
+          return lhs.LtOp(rhs);
+        case eIrOp::BINARY_GT:
+          return lhs.GtOp(rhs);
+        case eIrOp::BINARY_LE:
+          return lhs.LeOp(rhs);
+        case eIrOp::BINARY_GE:
+          return lhs.GeOp(rhs);
+        case eIrOp::BINARY_AND:
+          return IrLiteralToRtVal(IrBool{lhs.GetBool() && rhs.GetBool()});
+        case eIrOp::BINARY_OR:
+          return IrLiteralToRtVal(IrBool{lhs.GetBool() || rhs.GetBool()});
         default:
-          throw std::runtime_error("Unknown operation");
+          throw std::runtime_error("Operation is not a binary operator: " +
+                                   std::string(ToStr(op)));
       }
+    } catch (const char* what) {
+      throw std::runtime_error(what);
+    } catch (const std::bad_variant_access&) {
+      throw std::runtime_error("Operand types do not match.");
+    }
+  }
+
+  // Text written by the cout builtin. Shared with compiled programs.
+  static std::string ToDisplayString(const RtVal& value) {
+    return AotDisplayString(value);
+  }
+
+  // Evaluates the statements in [beg, end). Returns the value of the last
+  // evaluated statement. A RETURN outside of a method ends the evaluation.
+  RtVal Evaluate(const std::list<IrLine>& lines,
+                 std::list<IrLine>::const_iterator beg,
+                 std::list<IrLine>::const_iterator end) {
+    IndexLines(lines);
+    scope_ = &env;
+    frame_ = Frame{&env, nullptr, false};
+    frames_ = 0;
+    returning_ = false;
+    std::size_t first = beg == lines.end() ? code_.size() : beg->index;
+    std::size_t last = end == lines.end() ? code_.size() : end->index;
+    RtVal result = kRuntimeUndefined;
+    for (std::size_t line = first; line < last && !returning_;) {
+      line = EvaluateStatement(line, result);
     }
+    if (returning_) {
+      result = std::move(return_value_);
+      return_value_ = kRuntimeUndefined;
+      returning_ = false;
+    }
+    return result;
+  }
+
+  RtVal Evaluate(const IrCode& code) {
+    if (code.isAborted()) {
+      throw std::runtime_error(
+          std::get<IrString>(code.GetLines().back().args.at(0)));
+    }
+    return Evaluate(code.GetLines(), code.GetLines().begin(),
+                    code.GetLines().end());
   }
 
  public:
-  Evaluator(Environment& env) : env(env) {}
+  // Superinstructions are on by default. Disabling them only changes the
+  // number of dispatches, never the result.
+  Evaluator& EnableFusion(bool enable) {
+    fusion_ = enable;
+    return *this;
+  }
+  // Type inference is on by default. Disabling it only changes how binary
+  // ops check their operands, never the result.
+  Evaluator& EnableTypeInference(bool enable) {
+    type_inference_ = enable;
+    return *this;
+  }
+  // Escape analysis is on by default. Disabling it only changes how many
+  // instances are allocated, never the result.
+  Evaluator& EnableEscapeAnalysis(bool enable) {
+    escape_analysis_ = enable;
+    return *this;
+  }
+  // Counts the dispatches of each line, see IrNgramProfiler. Profiled code
+  // runs without superinstructions.
+  Evaluator& EnableProfiling(bool enable) {
+    profiling_ = enable;
+    return *this;
+  }
+  // Thresholds of the bytecode tier, see tier_manager.h.
+  Evaluator& SetTierOptions(const TierOptions& options) {
+    tier_ = options;
+    return *this;
+  }
+  Evaluator& SetJitOptions(const JitOptions& options) {
+    jit_ = options;
+    return *this;
+  }
+  Evaluator& EnableJit(bool enable) {
+    jit_.enabled = enable;
+    return *this;
+  }
+  Evaluator& SetLimits(const EvaluatorLimits& limits) {
+    limits_ = limits;
+    return *this;
+  }
+  // Compiled regions of the last evaluation.
+  std::vector<const JitRegion*> JitRegions() const {
+    std::vector<const JitRegion*> regions;
+    for (const auto& region : jit_regions_) {
+      if (region != nullptr) regions.push_back(region.get());
+    }
+    return regions;
+  }
+  // Tier transitions of the last evaluation.
+  const std::vector<TierTransition>& TierTransitions() const {
+    return tiers_.Transitions();
+  }
+  const TierManager& Tiers() const { return tiers_; }
+  // Instances allocated by the last evaluation.
+  std::size_t ObjectAllocations() const { return allocations_; }
+  // Dispatches of the last evaluation.
+  std::size_t Dispatches() const { return dispatches_; }
+  // Dispatches of each line in the last evaluation, empty unless profiling.
+  const std::vector<std::size_t>& LineCounts() const { return line_counts_; }
+
+  Evaluator(Environment& env, std::istream& in = std::cin,
+            std::ostream& out = std::cout)
+      : env(env), in_(in), out_(out) {}
 };
 
 class TheContext {
   Environment global_env;
   Evaluator evaluator{global_env};
-};
\ No newline at end of file
+};
@@ -47,10 +47,10 @@ class Expected {
   std::string error_{""};
 
   constexpr Expected(T expected) : expected_(expected) {}
-  template <typename T>
-  constexpr Expected(T&& expected) : expected_(expected) {}
-  template <typename T>
-  constexpr Expected(const T& expected) : expected_(expected) {}
+  template <typename U>
+  constexpr Expected(U&& expected) : expected_(expected) {}
+  template <typename U>
+  constexpr Expected(const U& expected) : expected_(expected) {}
 
   #pragma warning(disable : 4100) // Disable unused parameter warning for std::nullopt_t
                                   // Cannot be instantiated directly from type.
@@ -98,12 +98,12 @@ class PartialExpected {
   std::optional<T> value_{std::nullopt};
   std::string error_{""};
 
-  template <typename T, typename AlwaysT>
-  constexpr PartialExpected(const AlwaysT& always, T expected)
+  template <typename U, typename AlwaysU>
+  constexpr PartialExpected(const AlwaysU& always, U expected)
       : always_(always), value_(expected) {}
 
-  template <typename AlwaysT>
-  constexpr PartialExpected(const AlwaysT& always) : always_(always) {}
+  template <typename AlwaysU>
+  constexpr PartialExpected(const AlwaysU& always) : always_(always) {}
 
  public:
   constexpr bool Valid() const { return value_.has_value(); }
@@ -0,0 +1,436 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: fuzz_targets.h
+//---------------------------------------------------------------------------//
+// Brief: In-process fuzz targets of the compiler phases, and a runner which
+//        tracks their throughput and the inputs whose time grows faster
+//        than their size.
+// Sample Use:
+//       caoco fuzz parse fuzz_corpus --runs 100000 --regressions slow
+//     Or, coverage guided with libFuzzer, see caoco_fuzz.cc.
+//
+// A target takes any bytes. A failure the phases report, as an error result
+// or a std::runtime_error, is a normal outcome. Anything else, such as a
+// crash, a hang or another exception, is a finding.
+//
+// The runner probes an input for superlinear time when it is the slowest
+// per byte yet: it grows the input by repeating it, and by nesting its
+// first pair of each kind of bracket, to about FuzzOptions::probe_length bytes and to 8
+// times as many. When the time per byte grows by more than
+// FuzzOptions::superlinear_ratio between the two, the larger input is a
+// performance regression case, written to the regressions directory.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_FUZZ_TARGETS_H
+#define HEADER_GUARD_CAOCO_COMPILER_FUZZ_TARGETS_H
+// Includes:
+#include "evaluator.h"
+#include "import_stl.h"
+#include "ir_codegen.h"
+#include "lark_parser.h"
+#include "lexer.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+static constexpr std::string_view kFuzzErrorUnknownTarget =
+    "Unknown fuzz target, expected lex, parse, irgen or evaluate.";
+static constexpr std::string_view kFuzzErrorCannotReadCorpus =
+    "Cannot read the fuzz corpus directory.";
+
+struct FuzzTarget {
+  std::string_view name;
+  void (*run)(std::string_view input);
+};
+
+//=-------------------------------------------------------------------------=//
+// FuzzTargets
+//---------------------------------------------------------------------------//
+// Each target runs the phases up to and including its own.
+class FuzzTargets {
+  // Bounds the evaluation of a fuzzed program.
+  static constexpr EvaluatorLimits kEvaluateLimits{.dispatches = 20000,
+                                                   .frames = 64};
+
+  // The phases also reject some inputs by throwing a std::runtime_error,
+  // such as the parser on an unbalanced scope.
+  static void Rejecting(const std::function<void()>& phase) {
+    try {
+      phase();
+    } catch (const std::runtime_error&) {
+    }
+  }
+
+  static std::optional<TkVector> LexInput(std::string_view input) {
+    auto tokens = Lexer::Lex(std::string(input));
+    if (!tokens.Valid()) return std::nullopt;
+    return tokens.Extract();
+  }
+
+  static std::optional<Ast> ParseInput(std::string_view input) {
+    auto tokens = LexInput(input);
+    if (!tokens) return std::nullopt;
+    auto ast = LarkParser::Parse(*tokens);
+    if (!ast.Valid()) return std::nullopt;
+    return ast.Extract();
+  }
+
+  static std::optional<IrCode> IrGenInput(std::string_view input) {
+    auto ast = ParseInput(input);
+    if (!ast) return std::nullopt;
+    ::IrGen gen;
+    auto code = gen.GenerateIr(*ast);
+    if (code.isAborted()) return std::nullopt;
+    return code;
+  }
+
+ public:
+  static void Lex(std::string_view input) {
+    Rejecting([&] { LexInput(input); });
+  }
+
+  static void Parse(std::string_view input) {
+    Rejecting([&] { ParseInput(input); });
+  }
+
+  static void IrGen(std::string_view input) {
+    Rejecting([&] { IrGenInput(input); });
+  }
+
+  // Runs the program with no input, discarding its output.
+  static void Evaluate(std::string_view input) {
+    Rejecting([&] {
+      auto code = IrGenInput(input);
+      if (!code) return;
+      Environment env;
+      std::istringstream in;
+      std::ostringstream out;
+      Evaluator{env, in, out}
+          .EnableJit(false)
+          .SetLimits(kEvaluateLimits)
+          .Evaluate(*code);
+    });
+  }
+
+  static const FuzzTarget* Find(std::string_view name) {
+    static constexpr std::array<FuzzTarget, 4> kTargets{{
+        {"lex", &Lex},
+        {"parse", &Parse},
+        {"irgen", &IrGen},
+        {"evaluate", &Evaluate},
+    }};
+    for (const auto& target : kTargets) {
+      if (target.name == name) return &target;
+    }
+    return nullptr;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// FuzzGrowth
+//---------------------------------------------------------------------------//
+// Larger versions of an input, to measure how the time of a target scales.
+class FuzzGrowth {
+ public:
+  static std::string Repeat(std::string_view input, std::size_t times) {
+    std::string grown;
+    grown.reserve(input.size() * times);
+    for (std::size_t i = 0; i < times; i++) grown.append(input);
+    return grown;
+  }
+
+  static constexpr std::string_view kOpen = "({[";
+  static constexpr std::string_view kClose = ")}]";
+
+  // Repeats the brackets of the first balanced pair opened by one of opens,
+  // nesting its contents depth times. Nullopt when there is no pair.
+  static std::optional<std::string> Nest(std::string_view input,
+                                         std::size_t depth,
+                                         std::string_view opens = kOpen) {
+    auto open = input.find_first_of(opens);
+    if (open == std::string_view::npos) return std::nullopt;
+    char open_char = input[open];
+    char close_char = kClose[kOpen.find(open_char)];
+    std::size_t level = 0;
+    for (std::size_t close = open; close < input.size(); close++) {
+      if (input[close] == open_char) level++;
+      if (input[close] != close_char || --level != 0) continue;
+      std::string grown(input.substr(0, open));
+      grown.append(depth, open_char);
+      grown.append(input.substr(open + 1, close - open - 1));
+      grown.append(depth, close_char);
+      grown.append(input.substr(close + 1));
+      return grown;
+    }
+    return std::nullopt;
+  }
+};
+
+struct FuzzOptions {
+  std::size_t runs = 10000;  // Mutated inputs after the seeds.
+  std::chrono::milliseconds max_time{0};  // Of the mutated runs, 0 is none.
+  std::uint64_t seed = 1;
+  std::size_t max_length = 4096;  // Of a mutated input.
+  // Growth of the time per byte, between two sizes 8 times apart, from
+  // which an input is superlinear. Linear is 1, quadratic is 8.
+  double superlinear_ratio = 3.0;
+  std::size_t probe_length = 1024;  // The smaller of the two sizes.
+  std::optional<std::filesystem::path> regressions{};  // Written when set.
+  std::chrono::milliseconds report_interval{0};  // Of the log, 0 is none.
+  std::ostream* log = nullptr;
+};
+
+struct FuzzSlowInput {
+  std::string input;  // The larger of the two grown inputs.
+  std::string_view growth;  // "repeat" or "nest".
+  double ratio = 0;  // Growth of the time per byte.
+  std::optional<std::filesystem::path> path;  // Where it was written.
+};
+
+struct FuzzStats {
+  std::uint64_t execs = 0;
+  std::uint64_t bytes = 0;
+  std::chrono::nanoseconds time{0};  // Spent in the target.
+  std::chrono::nanoseconds wall{0};  // Of the run, probes included.
+  std::uint64_t probes = 0;
+  double worst_ns_per_byte = 0;
+  std::vector<FuzzSlowInput> slow;
+
+  double ExecsPerSecond() const {
+    return wall.count() == 0 ? 0 : execs * 1e9 / wall.count();
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// FuzzRunner
+//---------------------------------------------------------------------------//
+// Runs a target on seeds and on random mutations of them. The mutations are
+// not coverage guided, libFuzzer is, see caoco_fuzz.cc which runs each of
+// its inputs through Run.
+class FuzzRunner {
+  // Too short to time per byte.
+  static constexpr std::size_t kMinProbeLength = 8;
+  static constexpr std::size_t kProbeGrowth = 8;
+  static constexpr std::size_t kTimings = 3;  // The fastest is kept.
+  // Spliced in by the mutations.
+  static constexpr std::array<std::string_view, 14> kDictionary{
+      "(",     ")",   "{",   "}",  "[", "]", ";", "def @", "fn@", "class@",
+      "main:", "if(", "while(", "return "};
+
+  const FuzzTarget& target_;
+  FuzzOptions options_;
+  FuzzStats stats_;
+  std::mt19937_64 random_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point last_report_;
+  std::unordered_set<std::size_t> recorded_;  // Hashes of the slow inputs.
+
+  std::chrono::nanoseconds Time(std::string_view input) const {
+    auto start = std::chrono::steady_clock::now();
+    target_.run(input);
+    return std::chrono::steady_clock::now() - start;
+  }
+
+  std::chrono::nanoseconds FastestTime(std::string_view input) const {
+    auto fastest = Time(input);
+    for (std::size_t i = 1; i < kTimings; i++) {
+      fastest = std::min(fastest, Time(input));
+    }
+    return fastest;
+  }
+
+  std::optional<FuzzSlowInput> ProbeGrowth(std::string_view growth,
+                                           const std::string& small,
+                                           const std::string& large) {
+    stats_.probes++;
+    double small_ns = static_cast<double>(FastestTime(small).count());
+    double large_ns = static_cast<double>(FastestTime(large).count());
+    double ratio = (large_ns / large.size()) /
+                   (std::max(small_ns, 1.0) / small.size());
+    if (ratio <= options_.superlinear_ratio) return std::nullopt;
+    return FuzzSlowInput{large, growth, ratio, std::nullopt};
+  }
+
+  // Records each superlinear input once.
+  void Record(FuzzSlowInput slow) {
+    std::size_t hash = std::hash<std::string>{}(slow.input);
+    if (!recorded_.insert(hash).second) return;
+    if (options_.regressions) {
+      std::error_code error;
+      std::filesystem::create_directories(*options_.regressions, error);
+      std::ostringstream name;
+      name << target_.name << "-" << slow.growth << "-" << std::hex
+           << hash << ".cand";
+      auto path = *options_.regressions / name.str();
+      std::ofstream file(path, std::ios::binary);
+      file << slow.input;
+      if (file) slow.path = path;
+    }
+    if (options_.log != nullptr) {
+      *options_.log << "[Fuzz " << target_.name << "] superlinear "
+                    << slow.growth << " input of " << slow.input.size()
+                    << " bytes, time per byte grew " << slow.ratio << "x"
+                    << (slow.path ? ": " + slow.path->string() : "")
+                    << std::endl;
+    }
+    stats_.slow.push_back(std::move(slow));
+  }
+
+  void Execute(std::string_view input, bool probe) {
+    auto time = Time(input);
+    stats_.execs++;
+    stats_.bytes += input.size();
+    stats_.time += time;
+    stats_.wall = std::chrono::steady_clock::now() - start_;
+    if (input.size() >= kMinProbeLength) {
+      double ns_per_byte = static_cast<double>(time.count()) / input.size();
+      if (ns_per_byte > stats_.worst_ns_per_byte) {
+        stats_.worst_ns_per_byte = ns_per_byte;
+        probe = true;
+      }
+      if (probe) {
+        if (auto slow = Probe(input)) Record(std::move(*slow));
+      }
+    }
+    if (options_.log != nullptr && options_.report_interval.count() != 0 &&
+        std::chrono::steady_clock::now() - last_report_ >=
+            options_.report_interval) {
+      last_report_ = std::chrono::steady_clock::now();
+      PrintStats(*options_.log);
+    }
+  }
+
+  std::string Mutate(const std::vector<std::string>& seeds) {
+    auto pick = [this](std::size_t size) {
+      return static_cast<std::size_t>(random_() % std::max<std::size_t>(
+                                                      size, 1));
+    };
+    std::string input = seeds.empty() ? "" : seeds[pick(seeds.size())];
+    for (std::size_t edits = 1 + pick(4); edits > 0; edits--) {
+      std::size_t at = pick(input.size() + 1);
+      switch (pick(5)) {
+        case 0:  // Replace a byte.
+          if (at < input.size()) input[at] = static_cast<char>(random_());
+          break;
+        case 1:  // Erase a range.
+          input.erase(std::min(at, input.size()), pick(16));
+          break;
+        case 2:  // Duplicate a range.
+          input.insert(at, input.substr(pick(input.size() + 1), pick(32)));
+          break;
+        case 3:  // Insert a token.
+          input.insert(at, kDictionary[pick(kDictionary.size())]);
+          break;
+        default: {  // Splice a range of another seed.
+          const auto& other = seeds.empty() ? input : seeds[pick(seeds.size())];
+          input.insert(at, other.substr(pick(other.size() + 1), pick(64)));
+        }
+      }
+    }
+    if (input.size() > options_.max_length) input.resize(options_.max_length);
+    return input;
+  }
+
+ public:
+  FuzzRunner(const FuzzTarget& target, FuzzOptions options = {})
+      : target_(target),
+        options_(std::move(options)),
+        random_(options_.seed),
+        start_(std::chrono::steady_clock::now()),
+        last_report_(start_) {}
+
+  // Runs an input, probing it when it is the slowest per byte yet.
+  void Run(std::string_view input) { Execute(input, false); }
+
+  // Whether the time per byte of the target on the input grows faster than
+  // its size, when repeated or nested.
+  std::optional<FuzzSlowInput> Probe(std::string_view input) {
+    std::size_t times = std::max<std::size_t>(
+        options_.probe_length / std::max<std::size_t>(input.size(), 1), 1);
+    auto repeated =
+        ProbeGrowth("repeat", FuzzGrowth::Repeat(input, times),
+                    FuzzGrowth::Repeat(input, times * kProbeGrowth));
+    if (repeated) return repeated;
+    // Each level of nesting adds two bytes.
+    std::size_t depth = std::max<std::size_t>(options_.probe_length / 2, 1);
+    for (char open : FuzzGrowth::kOpen) {
+      std::string_view opens(&open, 1);
+      auto small = FuzzGrowth::Nest(input, depth, opens);
+      if (!small) continue;
+      auto nested = ProbeGrowth(
+          "nest", *small,
+          *FuzzGrowth::Nest(input, depth * kProbeGrowth, opens));
+      if (nested) return nested;
+    }
+    return std::nullopt;
+  }
+
+  // Probes and runs each seed, then runs mutations of them.
+  const FuzzStats& Fuzz(const std::vector<std::string>& seeds) {
+    for (const auto& seed : seeds) Execute(seed, true);
+    auto deadline = std::chrono::steady_clock::now() + options_.max_time;
+    for (std::size_t i = 0; i < options_.runs; i++) {
+      if (options_.max_time.count() != 0 &&
+          std::chrono::steady_clock::now() >= deadline) {
+        break;
+      }
+      Run(Mutate(seeds));
+    }
+    return stats_;
+  }
+
+  const FuzzStats& Stats() const { return stats_; }
+
+  void PrintStats(std::ostream& out) const {
+    out << "[Fuzz " << target_.name << "] execs: " << stats_.execs
+        << ", execs/sec: " << static_cast<std::uint64_t>(
+                                  stats_.ExecsPerSecond())
+        << ", in target: "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(stats_.time)
+               .count()
+        << "ms, worst ns/byte: "
+        << static_cast<std::uint64_t>(stats_.worst_ns_per_byte)
+        << ", probes: " << stats_.probes
+        << ", superlinear: " << stats_.slow.size() << std::endl;
+  }
+
+  // The files of a directory, in name order.
+  static Expected<std::vector<std::string>> LoadCorpus(
+      const std::filesystem::path& dir) {
+    using Result = Expected<std::vector<std::string>>;
+    std::error_code error;
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, error)) {
+      if (entry.is_regular_file()) paths.push_back(entry.path());
+    }
+    if (error) return Result::Failure(std::string(kFuzzErrorCannotReadCorpus));
+    std::sort(paths.begin(), paths.end());
+    std::vector<std::string> seeds;
+    for (const auto& path : paths) {
+      std::ifstream file(path, std::ios::binary);
+      seeds.emplace_back(std::istreambuf_iterator<char>(file),
+                         std::istreambuf_iterator<char>());
+    }
+    return Result::Success(std::move(seeds));
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: fuzz_targets.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_FUZZ_TARGETS_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -21,6 +21,7 @@
 // Includes:
 #include "cand_syntax.h"
 #include "import_stl.h"
+#include "symbol_table.h"  // CeIdentityTable, CeTypeTable
 //---------------------------------------------------------------------------//
 //=-------------------------------------------------------------------------=//
 
@@ -30,8 +31,6 @@ using IndexT = std::size_t;
 using CeString = std::string;
 using CeVoidPtr = void*;
 using VoidPtr = void*;
-using CeScopeIndex = std::size_t;
-using CeTypeIndex = std::size_t;
 
 struct CandTypes {
   using Str = std::string;
@@ -158,157 +157,6 @@ struct CeValue {
   }
 };
 
-enum class eIdentityCategory : std::size_t {
-  kUnknown,
-  kVariable,
-  kMethod,
-  kObject,
-  kNamespace,
-  kLibrary,
-  kMain,
-};
-
-struct CeIdentity {
-  CeString name;
-  eIdentityCategory category;
-  CeScopeIndex scope_index;
-};
-
-class CeIdentityTable {
-  using OptIdentityConstRef =
-      std::optional<std::reference_wrapper<const CeIdentity>>;
-  std::set<CeIdentity> table_;
-
-  inline OptIdentityConstRef MakeIdRef(const std::string& name,
-                                       eIdentityCategory category,
-                                       std::size_t scope) const {
-    return std::cref(*table_.find(CeIdentity{name, category, scope}));
-  }
-
- public:
-  bool Contains(const std::string& name, eIdentityCategory category,
-                std::size_t scope) const {
-    return table_.contains(CeIdentity{name, category, scope});
-  }
-
-  OptIdentityConstRef Get(const std::string& name, eIdentityCategory category,
-                          std::size_t scope) const {
-    if (not Contains(name, category, scope)) {
-      // Element does not exist.
-      return std::nullopt;
-    } else {
-      return MakeIdRef(name, category, scope);
-    }
-  }
-
-  OptIdentityConstRef Add(const std::string& name, eIdentityCategory category,
-                          std::size_t scope) {
-    auto inserted = table_.insert(CeIdentity{name, category, scope});
-    if (not inserted.second) {
-      // Element already exists.
-      return std::nullopt;
-    } else {
-      // Return inserted element reference
-      return std::cref(*table_.find(CeIdentity{name, category, scope}));
-    }
-  }
-
-  void Remove(const std::string& name, eIdentityCategory category,
-              std::size_t scope) {
-    table_.erase(CeIdentity{name, category, scope});
-  }
-
-  void Clear() { table_.clear(); }
-
-  bool IsEmpty() { return table_.empty(); }
-};
-
-struct CeTypeDescriptor {
-  CeString name;
-  CeScopeIndex scope_index;
-  CeTypeIndex type_index;
-
-  bool operator<(const CeTypeDescriptor& other) const {
-    return std::tie(name, scope_index) <
-           std::tie(other.name, other.scope_index);
-  }
-};
-
-class CeTypeTable {
-  using OptTypeDescConstRef =
-      std::optional<std::reference_wrapper<const CeTypeDescriptor>>;
-
- private:
-  std::set<CeTypeDescriptor> table_;
-
-  inline OptTypeDescConstRef MakeTypeConstRef(const std::string& name,
-                                              CeScopeIndex scope) const {
-    return std::cref(*table_.find(CeTypeDescriptor(name, scope)));
-  }
-
- public:
-  bool Contains(const std::string& name, CeScopeIndex scope) const {
-    return table_.contains(CeTypeDescriptor(name, scope));
-  }
-
-  OptTypeDescConstRef Get(const std::string& name, CeScopeIndex scope) const {
-    auto found = table_.find(CeTypeDescriptor{name, scope});
-    if (found == table_.end()) {
-      return std::nullopt;
-    } else {
-      return std::cref(*found);
-    }
-  }
-
-  OptTypeDescConstRef Add(const std::string& name, CeScopeIndex scope,
-                          CeTypeIndex type_index) {
-    auto inserted = table_.insert(CeTypeDescriptor{name, scope, type_index});
-    if (inserted.second == false) {
-      return std::nullopt;
-    } else {
-      return MakeTypeConstRef(name, scope);
-    }
-  }
-
-  OptTypeDescConstRef Replace(const std::string& name, CeScopeIndex scope,
-                              CeTypeIndex type_index) {
-    auto found = table_.find(CeTypeDescriptor{name, scope});
-    if (found == table_.end()) {
-      return std::nullopt;
-    } else {
-      auto extracted = table_.extract(found);
-      extracted.value().type_index = type_index;
-      table_.insert(std::move(extracted));
-      return Get(name, scope);
-    }
-  }
-
-  OptTypeDescConstRef Alias(const std::string& name, CeScopeIndex scope,
-                            const std::string& alias_name,
-                            CeScopeIndex alias_scope) {
-    auto found = Get(name, scope);
-    if (!found.has_value()) {
-      return std::nullopt;
-    } else {
-      if (Contains(alias_name, alias_scope)) {
-        return std::nullopt;
-      } else {
-        auto inserted = table_.insert(
-            CeTypeDescriptor(alias_name, alias_scope, found->get().type_index));
-        return std::cref(*(inserted.first));
-      }
-    }
-  }
-
-  void Remove(const std::string& name, CeScopeIndex scope) {
-    table_.erase(CeTypeDescriptor{name, scope, 0});
-  }
-
-  void Clear() { table_.clear(); }
-
-  bool IsEmpty() const { return table_.empty(); }
-};
-
 struct CeVariableInstance {
   CeString name;
   CeScopeIndex scope_index;
@@ -28,18 +28,32 @@
 #include <stack>
 #include <tuple>
 #include <unordered_map>  // std::unordered_map
+#include <unordered_set>  // std::unordered_set
 #include <vector>         // std::vector
 #include <set>
 
 // Utils
+#include <bit>         // std::endian
+#include <chrono>      // std::chrono::steady_clock
 #include <cstdlib>     // numeric string conversions
+#include <cstring>     // std::memcpy
 #include <functional>  // std::reference_wrapper
 #include <iterator>    // reverse_iterator
 #include <limits>      // std::numeric_limits
 #include <memory>      // std::unique_ptr , std::shared_ptr
 #include <optional>
 #include <variant>
+
+// Concurrency
+#include <atomic>
+#include <condition_variable>
+#include <future>  // std::async
+#include <mutex>
+#include <thread>
 // Algorithms
+#include <cmath>    // std::ceil
+#include <numeric>  // std::iota
+#include <random>   // std::shuffle engines, before the lambda macro
 #include <algorithm>  // std::move, std::forward, std::get, std::ref, std::cref, std::any_of
 
 // Type
@@ -50,7 +64,9 @@
 
 // Error handling
 #include <cassert>
+#include <filesystem>  // std::filesystem::path
 #include <fstream>
+#include <iomanip>  // std::setw
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
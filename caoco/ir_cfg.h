@@ -0,0 +1,262 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_cfg.h
+//---------------------------------------------------------------------------//
+// Brief: Statement trees and basic block graph of the IR.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_IR_CFG_H
+#define HEADER_GUARD_CAOCO_COMPILER_IR_CFG_H
+// Includes:
+#include "import_stl.h"
+#include "ir_codegen.h"
+
+//=-------------------------------------------------------------------------=//
+// IrNode / IrTree / IrCfg
+//---------------------------------------------------------------------------//
+// Tree view of an IR line and the operand lines it owns. Passes rewrite the
+// trees then re-encode them, which renumbers the lines and operand ranges.
+struct IrNode {
+  eIrOp op;
+  std::vector<IrVariant> args{};  // Scalar arguments only.
+  std::vector<IrNode> operands{};
+  std::size_t source_line{0};
+
+  // Variable name of a DECLARE_VARIABLE, DEFINE_VARIABLE or LOAD_VARIABLE.
+  const IrString& Name() const {
+    return std::get<IrString>(args.at(op == eIrOp::DECLARE_VARIABLE ? 1 : 0));
+  }
+};
+
+class IrTree {
+ public:
+  static IrNode Decode(const std::vector<const IrLine*>& code,
+                       std::size_t index) {
+    const IrLine& line = *code[index];
+    IrNode node{line.op, {}, {}, line.source_line};
+    auto scalars = std::min(IrOpScalarArgCount(line.op), line.args.size());
+    node.args.assign(line.args.begin(), line.args.begin() + scalars);
+    for (std::size_t i = 0; i < line.OperandCount(); i++) {
+      node.operands.push_back(Decode(code, line.OperandBegin(i)));
+    }
+    return node;
+  }
+
+  // Appends the node and its operands. Returns the line of the node.
+  static IrLine& Encode(const IrNode& node, IrCode& code) {
+    // std::list keeps the reference valid while operands are appended.
+    IrLine& line = code.AddLine(code.Size(), node.op, node.args);
+    line.source_line = node.source_line;
+    for (const auto& operand : node.operands) {
+      auto begin = static_cast<IrInt>(code.Size());
+      Encode(operand, code);
+      line.args.push_back(begin);
+      line.args.push_back(static_cast<IrInt>(code.Size()) - 1);
+    }
+    return line;
+  }
+
+  // Structural key of a pure expression. Equal keys compute equal values.
+  static std::string Key(const IrNode& node) {
+    std::string key{ToStr(node.op)};
+    for (const auto& arg : node.args) {
+      std::visit(
+          [&key](auto&& arg) {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, IrString>) {
+              key += "[s" + std::to_string(arg.size()) + ":" + arg + "]";
+            } else if constexpr (std::is_same_v<T, IrDouble>) {
+              std::ostringstream os;
+              os.precision(std::numeric_limits<IrDouble>::max_digits10);
+              os << arg;
+              key += "[d" + os.str() + "]";
+            } else if constexpr (std::is_same_v<T, IrBool>) {
+              key += arg.value ? "[b1]" : "[b0]";
+            } else {
+              key += "[i" + std::to_string(arg) + "]";
+            }
+          },
+          arg);
+    }
+    key += "(";
+    for (const auto& operand : node.operands) {
+      key += Key(operand) + ",";
+    }
+    key += ")";
+    return key;
+  }
+
+  static bool IsPure(const IrNode& node) {
+    return IrOpIsPure(node.op) &&
+           std::all_of(node.operands.begin(), node.operands.end(), &IsPure);
+  }
+
+  static bool ContainsCall(const IrNode& node) {
+    return node.op == eIrOp::CALL || node.op == eIrOp::CALL_MEMBER ||
+           std::any_of(node.operands.begin(), node.operands.end(),
+                       &ContainsCall);
+  }
+
+  static bool IsScopeBoundary(const IrNode& node) {
+    return node.op == eIrOp::ENTER_SCOPE || node.op == eIrOp::EXIT_SCOPE;
+  }
+
+  static bool IsWrite(const IrNode& node) {
+    return node.op == eIrOp::DECLARE_VARIABLE ||
+           node.op == eIrOp::DEFINE_VARIABLE;
+  }
+
+  static bool Reads(const IrNode& node, const IrString& name) {
+    if (node.op == eIrOp::LOAD_VARIABLE && node.Name() == name) {
+      return true;
+    }
+    return std::any_of(
+        node.operands.begin(), node.operands.end(),
+        [&name](const IrNode& operand) { return Reads(operand, name); });
+  }
+
+  static void CountReads(const IrNode& node,
+                         std::unordered_map<std::string, std::size_t>& reads) {
+    if (node.op == eIrOp::LOAD_VARIABLE) {
+      reads[node.Name()]++;
+    }
+    for (const auto& operand : node.operands) {
+      CountReads(operand, reads);
+    }
+  }
+};
+
+// A straight line run of statements. Only the last statement of a block may
+// transfer control, and only the first may be a jump target.
+struct IrBlock {
+  std::vector<IrNode> statements;
+};
+
+// Control flow graph of a program. In the statement trees, the jump target
+// argument of a control flow op holds a block id instead of a line index.
+// The id Blocks().size() is the end of the program. Empty blocks are kept so
+// that the ids stay stable, jumps to them continue at the next block.
+class IrCfg {
+  std::vector<IrBlock> blocks_;
+
+  static IrInt& TargetArg(IrNode& node) {
+    return std::get<IrInt>(node.args.at(*IrOpJumpTargetArg(node.op)));
+  }
+
+ public:
+  std::vector<IrBlock>& Blocks() { return blocks_; }
+  const std::vector<IrBlock>& Blocks() const { return blocks_; }
+  std::size_t End() const { return blocks_.size(); }
+
+  static std::size_t Target(const IrNode& node) {
+    return std::get<IrInt>(node.args.at(*IrOpJumpTargetArg(node.op)));
+  }
+
+  // Blocks which may execute after the block. The body following a
+  // DECLARE_METHOD or DECLARE_OBJECT is entered by calls.
+  std::vector<std::size_t> Successors(std::size_t block) const {
+    const auto& statements = blocks_[block].statements;
+    if (statements.empty()) {
+      return {block + 1};
+    }
+    const IrNode& last = statements.back();
+    switch (last.op) {
+      case eIrOp::JUMP:
+        return {Target(last)};
+      case eIrOp::JUMP_IF_FALSE:
+      case eIrOp::DECLARE_METHOD:
+      case eIrOp::DECLARE_OBJECT:
+        return {Target(last), block + 1};
+      case eIrOp::RETURN:
+      case eIrOp::TAIL_CALL:
+      case eIrOp::ABORT_AND_ERROR:
+        return {};
+      default:
+        return {block + 1};
+    }
+  }
+
+  // Code must have passed the IrVerifier.
+  static IrCfg Decode(const IrCode& code) {
+    std::vector<const IrLine*> index;
+    index.reserve(code.Size());
+    for (const auto& line : code.GetLines()) {
+      index.push_back(&line);
+    }
+
+    // Leaders: the first statement, jump targets and the statements which
+    // follow a terminator.
+    std::vector<bool> leaders(index.size() + 1, false);
+    leaders[0] = true;
+    for (std::size_t i = 0; i < index.size(); i = index[i]->ExtentEnd() + 1) {
+      const IrLine& line = *index[i];
+      if (auto target_arg = IrOpJumpTargetArg(line.op)) {
+        leaders[std::get<IrInt>(line.args[*target_arg])] = true;
+      }
+      if (IrOpIsTerminator(line.op)) {
+        leaders[line.ExtentEnd() + 1] = true;
+      }
+    }
+
+    IrCfg cfg;
+    std::unordered_map<std::size_t, std::size_t> block_of_line;
+    for (std::size_t i = 0; i < index.size(); i = index[i]->ExtentEnd() + 1) {
+      if (leaders[i]) {
+        block_of_line[i] = cfg.blocks_.size();
+        cfg.blocks_.emplace_back();
+      }
+      cfg.blocks_.back().statements.push_back(IrTree::Decode(index, i));
+    }
+    block_of_line[index.size()] = cfg.End();
+
+    for (auto& block : cfg.blocks_) {
+      auto& last = block.statements.back();
+      if (IrOpJumpTargetArg(last.op)) {
+        TargetArg(last) = static_cast<IrInt>(block_of_line.at(TargetArg(last)));
+      }
+    }
+    return cfg;
+  }
+
+  IrCode Encode() const {
+    IrCode code;
+    std::vector<std::size_t> block_begin;
+    std::vector<std::pair<IrLine*, std::size_t>> jumps;
+    for (const auto& block : blocks_) {
+      block_begin.push_back(code.Size());
+      for (const auto& statement : block.statements) {
+        IrLine& line = IrTree::Encode(statement, code);
+        if (IrOpJumpTargetArg(line.op)) {
+          jumps.emplace_back(&line, Target(statement));
+        }
+      }
+    }
+    block_begin.push_back(code.Size());
+    for (auto& [line, target] : jumps) {
+      line->args[*IrOpJumpTargetArg(line->op)] =
+          static_cast<IrInt>(block_begin.at(target));
+    }
+    return code;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_cfg.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_IR_CFG_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
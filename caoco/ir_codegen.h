@@ -40,6 +40,30 @@ static constexpr std::string_view kIrErrorInvalidStringLiteral =
 static constexpr std::string_view kIrErrorInvalidPrimaryExpression =
     "[C&][ERROR][CRITICAL] Invalid primary expression.";
 
+static constexpr std::string_view kIrErrorStatementCannotAppearInContext =
+    "[C&][ERROR][CRITICAL] Statement cannot appear in this context.";
+
+static constexpr std::string_view kIrErrorInvalidAssignmentTarget =
+    "[C&][ERROR][CRITICAL] Assignment target must be a variable name.";
+
+// Format of the intermediate representation:
+// - The IR is a flat list of lines. Each line holds an operation and its
+//   arguments. A line's index is always equal to its position in the list.
+// - Expressions are stored in prefix order: an operation line is followed by
+//   the lines of its operands. Operand lines are referenced by an inclusive
+//   [begin, end] pair of line indices appended after the scalar arguments.
+//   The operand ranges of a line are contiguous and directly follow the line.
+// - Statements are the lines which are not an operand of any other line.
+// See IrOpScalarArgCount for the number of scalar arguments of each op.
+// - Control flow uses absolute line indices of statements as jump targets.
+//   A target equal to the number of lines jumps to the end of the program.
+//   JUMP [target] and JUMP_IF_FALSE [target] + condition range.
+// - DECLARE_METHOD [name, skip, params...] and DECLARE_OBJECT [name, skip]
+//   register a method or class whose body starts on the next line, then
+//   continue at skip. Bodies end with a RETURN. A class body is executed
+//   as the constructor of each new instance.
+// - Lexical scopes are delimited by ENTER_SCOPE and EXIT_SCOPE. Jumps never
+//   cross a scope boundary, RETURN unwinds the scopes of its frame.
 enum class eIrOp {
   // Program
   ENTER_PROGRAM_DEFINITION,
@@ -50,10 +74,15 @@ enum class eIrOp {
   // Variables
   DECLARE_VARIABLE,
   DEFINE_VARIABLE,
+  LOAD_VARIABLE,
 
   // Methods
   DECLARE_METHOD,
   DEFINE_METHOD,
+  CALL,
+  CALL_MEMBER,
+  RETURN,
+  TAIL_CALL,
 
   // Object
   DECLARE_OBJECT,
@@ -66,7 +95,10 @@ enum class eIrOp {
   ADD_OBJECT_DESTRUCTOR,
 
   // Control flow
-
+  JUMP,
+  JUMP_IF_FALSE,
+  ENTER_SCOPE,
+  EXIT_SCOPE,
 
   // Operators
   BINARY_ADD,
@@ -74,18 +106,285 @@ enum class eIrOp {
   BINARY_MUL,
   BINARY_DIV,
   BINARY_MOD,
+  BINARY_EQ,
+  BINARY_NE,
+  BINARY_LT,
+  BINARY_GT,
+  BINARY_LE,
+  BINARY_GE,
+  BINARY_AND,
+  BINARY_OR,
+  UNARY_NOT,
 };
 
+constexpr std::string_view ToStr(eIrOp op) {
+  switch (op) {
+    case eIrOp::ENTER_PROGRAM_DEFINITION:
+      return "ENTER_PROGRAM_DEFINITION";
+    case eIrOp::ABORT_AND_ERROR:
+      return "ABORT_AND_ERROR";
+    case eIrOp::ALLOCATE_LITERAL:
+      return "ALLOCATE_LITERAL";
+    case eIrOp::ALLOCATE_STACK_VALUE:
+      return "ALLOCATE_STACK_VALUE";
+    case eIrOp::DECLARE_VARIABLE:
+      return "DECLARE_VARIABLE";
+    case eIrOp::DEFINE_VARIABLE:
+      return "DEFINE_VARIABLE";
+    case eIrOp::LOAD_VARIABLE:
+      return "LOAD_VARIABLE";
+    case eIrOp::DECLARE_METHOD:
+      return "DECLARE_METHOD";
+    case eIrOp::DEFINE_METHOD:
+      return "DEFINE_METHOD";
+    case eIrOp::CALL:
+      return "CALL";
+    case eIrOp::CALL_MEMBER:
+      return "CALL_MEMBER";
+    case eIrOp::RETURN:
+      return "RETURN";
+    case eIrOp::TAIL_CALL:
+      return "TAIL_CALL";
+    case eIrOp::DECLARE_OBJECT:
+      return "DECLARE_OBJECT";
+    case eIrOp::DEFINE_OBJECT:
+      return "DEFINE_OBJECT";
+    case eIrOp::ADD_OBJECT_STATIC_MEMBER:
+      return "ADD_OBJECT_STATIC_MEMBER";
+    case eIrOp::ADD_OBJECT_STATIC_METHOD:
+      return "ADD_OBJECT_STATIC_METHOD";
+    case eIrOp::ADD_OBJECT_MEMBER:
+      return "ADD_OBJECT_MEMBER";
+    case eIrOp::ADD_OBJECT_METHOD:
+      return "ADD_OBJECT_METHOD";
+    case eIrOp::ADD_OBJECT_CONSTRUCTOR:
+      return "ADD_OBJECT_CONSTRUCTOR";
+    case eIrOp::ADD_OBJECT_DESTRUCTOR:
+      return "ADD_OBJECT_DESTRUCTOR";
+    case eIrOp::BINARY_ADD:
+      return "BINARY_ADD";
+    case eIrOp::BINARY_SUB:
+      return "BINARY_SUB";
+    case eIrOp::BINARY_MUL:
+      return "BINARY_MUL";
+    case eIrOp::BINARY_DIV:
+      return "BINARY_DIV";
+    case eIrOp::BINARY_MOD:
+      return "BINARY_MOD";
+    case eIrOp::JUMP:
+      return "JUMP";
+    case eIrOp::JUMP_IF_FALSE:
+      return "JUMP_IF_FALSE";
+    case eIrOp::ENTER_SCOPE:
+      return "ENTER_SCOPE";
+    case eIrOp::EXIT_SCOPE:
+      return "EXIT_SCOPE";
+    case eIrOp::BINARY_EQ:
+      return "BINARY_EQ";
+    case eIrOp::BINARY_NE:
+      return "BINARY_NE";
+    case eIrOp::BINARY_LT:
+      return "BINARY_LT";
+    case eIrOp::BINARY_GT:
+      return "BINARY_GT";
+    case eIrOp::BINARY_LE:
+      return "BINARY_LE";
+    case eIrOp::BINARY_GE:
+      return "BINARY_GE";
+    case eIrOp::BINARY_AND:
+      return "BINARY_AND";
+    case eIrOp::BINARY_OR:
+      return "BINARY_OR";
+    case eIrOp::UNARY_NOT:
+      return "UNARY_NOT";
+  }
+  return "UNKNOWN_IR_OP";
+}
+
+// Ops which do not have operand ranges. All of their arguments are scalar.
+static constexpr std::size_t kIrOpNoOperands =
+    std::numeric_limits<std::size_t>::max();
+
+// Number of scalar arguments preceding the operand ranges of an op.
+// DECLARE_VARIABLE: [type, name] + optional initializer range.
+// DEFINE_VARIABLE: [name] + value range.
+// BINARY_*: [] + left range + right range. UNARY_*: [] + operand range.
+// JUMP_IF_FALSE: [target] + condition range.
+// CALL: [name] + argument ranges.
+// CALL_MEMBER: [name] + object range + argument ranges.
+// RETURN: [] + optional value range.
+// TAIL_CALL: [] + range of the CALL or CALL_MEMBER whose value is returned.
+constexpr std::size_t IrOpScalarArgCount(eIrOp op) {
+  switch (op) {
+    case eIrOp::DECLARE_VARIABLE:
+      return 2;
+    case eIrOp::DEFINE_VARIABLE:
+    case eIrOp::JUMP_IF_FALSE:
+    case eIrOp::CALL:
+    case eIrOp::CALL_MEMBER:
+      return 1;
+    case eIrOp::RETURN:
+    case eIrOp::TAIL_CALL:
+    case eIrOp::BINARY_ADD:
+    case eIrOp::BINARY_SUB:
+    case eIrOp::BINARY_MUL:
+    case eIrOp::BINARY_DIV:
+    case eIrOp::BINARY_MOD:
+    case eIrOp::BINARY_EQ:
+    case eIrOp::BINARY_NE:
+    case eIrOp::BINARY_LT:
+    case eIrOp::BINARY_GT:
+    case eIrOp::BINARY_LE:
+    case eIrOp::BINARY_GE:
+    case eIrOp::BINARY_AND:
+    case eIrOp::BINARY_OR:
+    case eIrOp::UNARY_NOT:
+      return 0;
+    default:
+      return kIrOpNoOperands;
+  }
+}
+
+// Index of the jump target argument of a control flow op.
+constexpr std::optional<std::size_t> IrOpJumpTargetArg(eIrOp op) {
+  switch (op) {
+    case eIrOp::JUMP:
+    case eIrOp::JUMP_IF_FALSE:
+      return 0;
+    case eIrOp::DECLARE_METHOD:
+    case eIrOp::DECLARE_OBJECT:
+      return 1;
+    default:
+      return std::nullopt;
+  }
+}
+
+// Ops which end a basic block.
+constexpr bool IrOpIsTerminator(eIrOp op) {
+  return op == eIrOp::RETURN || op == eIrOp::TAIL_CALL ||
+         IrOpJumpTargetArg(op).has_value();
+}
+
+// Pure ops may be removed, duplicated or reordered by the optimizer.
+constexpr bool IrOpIsPure(eIrOp op) {
+  switch (op) {
+    case eIrOp::ALLOCATE_LITERAL:
+    case eIrOp::LOAD_VARIABLE:
+    case eIrOp::BINARY_ADD:
+    case eIrOp::BINARY_SUB:
+    case eIrOp::BINARY_MUL:
+    case eIrOp::BINARY_DIV:
+    case eIrOp::BINARY_MOD:
+    case eIrOp::BINARY_EQ:
+    case eIrOp::BINARY_NE:
+    case eIrOp::BINARY_LT:
+    case eIrOp::BINARY_GT:
+    case eIrOp::BINARY_LE:
+    case eIrOp::BINARY_GE:
+    case eIrOp::BINARY_AND:
+    case eIrOp::BINARY_OR:
+    case eIrOp::UNARY_NOT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Ops which produce a value and may appear as an operand.
+constexpr bool IrOpIsExpression(eIrOp op) {
+  return IrOpIsPure(op) || op == eIrOp::CALL || op == eIrOp::CALL_MEMBER;
+}
+
+constexpr bool IrOpIsBinary(eIrOp op) {
+  return op == eIrOp::BINARY_ADD || op == eIrOp::BINARY_SUB ||
+         op == eIrOp::BINARY_MUL || op == eIrOp::BINARY_DIV ||
+         op == eIrOp::BINARY_MOD || op == eIrOp::BINARY_EQ ||
+         op == eIrOp::BINARY_NE || op == eIrOp::BINARY_LT ||
+         op == eIrOp::BINARY_GT || op == eIrOp::BINARY_LE ||
+         op == eIrOp::BINARY_GE || op == eIrOp::BINARY_AND ||
+         op == eIrOp::BINARY_OR;
+}
+
 using IrInt = int;
 using IrDouble = double;
-using IrString = std::string_view;
-using IrVariant = std::variant<int, double, std::string_view>;
+using IrString = std::string;
+// Wrapped so that string literals never convert to a bool argument.
+struct IrBool {
+  bool value;
+  bool operator==(const IrBool&) const = default;
+};
+inline std::ostream& operator<<(std::ostream& os, IrBool b) {
+  return os << (b.value ? "true" : "false");
+}
+using IrVariant = std::variant<IrInt, IrDouble, IrString, IrBool>;
 static const std::vector<IrVariant> kIrOpNullArguments = {};
 
+// Type constraint argument of a declaration which accepts any value.
+static constexpr IrInt kIrTypeConstraintAny = -1;
+
+// Names of compiler generated variables start with this prefix. The prefix
+// is not a valid identifier character so they can't clash with user names.
+static constexpr std::string_view kIrTempPrefix = "%";
+
+// Conversions between IR literals and runtime values.
+inline RtVal IrLiteralToRtVal(const IrVariant& literal) {
+  return std::visit(
+      [](auto&& arg) -> RtVal {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, IrString>) {
+          return RtVal(RtVal::NativeVariant(std::in_place_type<RtVal::StringT>,
+                                            std::make_shared<string>(arg)));
+        } else if constexpr (std::is_same_v<T, IrBool>) {
+          return RtVal(RtVal::NativeVariant(std::in_place_type<RtVal::BoolT>,
+                                            arg.value));
+        } else {
+          return RtVal(RtVal::NativeVariant(std::in_place_type<T>, arg));
+        }
+      },
+      literal);
+}
+
+// Returns nullopt if the value has no literal representation in the IR.
+inline std::optional<IrVariant> RtValToIrLiteral(const RtVal& value) {
+  switch (value.Type()) {
+    case RtVal::kInt:
+      return IrVariant{value.GetInt()};
+    case RtVal::kDouble:
+      return IrVariant{value.GetDouble()};
+    case RtVal::kBool:
+      return IrVariant{IrBool{value.GetBool()}};
+    case RtVal::kString:
+      if (value.GetString() == nullptr) return std::nullopt;
+      return IrVariant{*value.GetString()};
+    default:
+      return std::nullopt;
+  }
+}
+
 struct IrLine {
   std::size_t index;
   eIrOp op;
   std::vector<IrVariant> args;
+  std::size_t source_line{0};  // Line of the statement in the source, 0 if
+                               // unknown.
+
+  // Number of [begin, end] operand ranges following the scalar arguments.
+  std::size_t OperandCount() const {
+    auto scalars = IrOpScalarArgCount(op);
+    if (scalars == kIrOpNoOperands || args.size() <= scalars) return 0;
+    return (args.size() - scalars) / 2;
+  }
+  IrInt OperandBegin(std::size_t operand) const {
+    return std::get<IrInt>(args[IrOpScalarArgCount(op) + operand * 2]);
+  }
+  IrInt OperandEnd(std::size_t operand) const {
+    return std::get<IrInt>(args[IrOpScalarArgCount(op) + operand * 2 + 1]);
+  }
+  // Index of the last line owned by this line, itself if it has no operands.
+  std::size_t ExtentEnd() const {
+    auto n = OperandCount();
+    return n == 0 ? index : static_cast<std::size_t>(OperandEnd(n - 1));
+  }
 };
 
 struct IrCode {
@@ -108,70 +407,44 @@ struct IrCode {
       lines.push_back(line);
     }
   }
+  // Appends the lines of another program but its ENTER_PROGRAM_DEFINITION.
+  // Its line indices, jump targets and operand ranges are shifted past the
+  // lines of this one, a jump to its end now lands on the next line.
+  void Append(const IrCode& other) {
+    if (other.lines.empty()) return;
+    auto offset = static_cast<IrInt>(lines.size()) - 1;
+    for (auto it = std::next(other.lines.begin()); it != other.lines.end();
+         ++it) {
+      IrLine line = *it;
+      line.index += offset;
+      if (auto target = IrOpJumpTargetArg(line.op)) {
+        std::get<IrInt>(line.args[*target]) += offset;
+      }
+      auto scalars = IrOpScalarArgCount(line.op);
+      if (scalars != kIrOpNoOperands) {
+        for (auto arg = scalars; arg < line.args.size(); arg++) {
+          std::get<IrInt>(line.args[arg]) += offset;
+        }
+      }
+      lines.push_back(std::move(line));
+    }
+  }
   std::list<IrLine>& GetLines() { return lines; }
+  const std::list<IrLine>& GetLines() const { return lines; }
+  std::size_t Size() const { return lines.size(); }
 
-  bool isAborted() {
-    if (lines.back().op == eIrOp::ABORT_AND_ERROR) {
-      return true;
-    } else {
-      return false;
-    }
+  bool isAborted() const {
+    return !lines.empty() && lines.back().op == eIrOp::ABORT_AND_ERROR;
   }
 
-  void PrintDisassembly() {
+  void PrintDisassembly(std::ostream& os = std::cout) const {
     for (const auto& line : lines) {
-      std::cout << "Line " << line.index << ": ";
-      switch (line.op) {
-        case eIrOp::ENTER_PROGRAM_DEFINITION:
-          std::cout << "ENTER_PROGRAM_DEFINITION";
-          break;
-        case eIrOp::ABORT_AND_ERROR:
-          std::cout << "ABORT_AND_ERROR";
-          break;
-        case eIrOp::ALLOCATE_LITERAL:
-          std::cout << "ALLOCATE_LITERAL";
-          break;
-        case eIrOp::ALLOCATE_STACK_VALUE:
-          std::cout << "ALLOCATE_STACK_VALUE";
-          break;
-        case eIrOp::DECLARE_VARIABLE:
-          std::cout << "DECLARE_VARIABLE";
-          break;
-        case eIrOp::DEFINE_VARIABLE:
-          std::cout << "DEFINE_VARIABLE";
-          break;
-        case eIrOp::BINARY_ADD:
-          std::cout << "BINARY_ADD";
-          break;
-        case eIrOp::BINARY_SUB:
-          std::cout << "BINARY_SUB";
-          break;
-        case eIrOp::BINARY_MUL:
-          std::cout << "BINARY_MUL";
-          break;
-        case eIrOp::BINARY_DIV:
-          std::cout << "BINARY_DIV";
-          break;
-        case eIrOp::BINARY_MOD:
-          std::cout << "BINARY_MOD";
-          break;
-      }
-      std::cout << " Args: ";
+      os << "Line " << line.index << ": " << ToStr(line.op);
+      os << " Args: ";
       for (const auto& arg : line.args) {
-        std::visit(
-            [](auto&& arg) {
-              using T = std::decay_t<decltype(arg)>;
-              if constexpr (std::is_same_v<T, int>) {
-                std::cout << arg << " ";
-              } else if constexpr (std::is_same_v<T, double>) {
-                std::cout << arg << " ";
-              } else if constexpr (std::is_same_v<T, std::string_view>) {
-                std::cout << arg << " ";
-              }
-            },
-            arg);
+        std::visit([&os](auto&& arg) { os << arg << " "; }, arg);
       }
-      std::cout << std::endl;
+      os << std::endl;
     }
   }
 };
@@ -181,6 +454,7 @@ class IrGen {
   using LineIndex = std::size_t;
   IrCode ir;
   LineIndex line_index = 0;
+  std::size_t method_depth = 0;  // Method bodies being generated.
 
   static IrLine LineGenNumberLiteral(LineIndex line_index,
                                      std::string literal) {
@@ -189,19 +463,19 @@ class IrGen {
       value = std::stoi(literal);
     } catch (const std::exception&) {
       return IrLine(line_index, eIrOp::ABORT_AND_ERROR,
-                    {kIrErrorInvalidNumberLiteral});
+                    {IrString(kIrErrorInvalidNumberLiteral)});
     }
     return IrLine(line_index, eIrOp::ALLOCATE_LITERAL, {value});
   }
 
   static IrLine LineGenDoubleLiteral(LineIndex line_index,
                                      std::string literal) {
-    float value{};
+    double value{};
     try {
-      value = std::stof(literal);
+      value = std::stod(literal);
     } catch (const std::exception&) {
       return IrLine(line_index, eIrOp::ABORT_AND_ERROR,
-                    {kIrErrorInvalidNumberLiteral});
+                    {IrString(kIrErrorInvalidNumberLiteral)});
     }
     return IrLine(line_index, eIrOp::ALLOCATE_LITERAL, {value});
   }
@@ -221,7 +495,7 @@ class IrGen {
         if (c == value.end()) {
           // Invalid escape sequence
           return IrLine(line_index, eIrOp::ABORT_AND_ERROR,
-                        {kIrErrorInvalidStringLiteral});
+                        {IrString(kIrErrorInvalidStringLiteral)});
         }
         switch (*c) {
           case 'n':
@@ -248,7 +522,7 @@ class IrGen {
           default:
             // Invalid escape sequence
             return IrLine(line_index, eIrOp::ABORT_AND_ERROR,
-                          {kIrErrorInvalidNumberLiteral});
+                          {IrString(kIrErrorInvalidNumberLiteral)});
         }
       } else {
         // Process regular character
@@ -277,9 +551,34 @@ class IrGen {
       case eAst::kStringLiteral:
         xLineGenLiteral(ast.Literal(), &LineGenStringLiteral);
         break;
+      case eAst::kTrueLiteral:
+      case eAst::kFalseLiteral:
+        ir.AddLine(line_index, eIrOp::ALLOCATE_LITERAL,
+                   {IrBool{ast.TypeIs(eAst::kTrueLiteral)}});
+        line_index++;
+        break;
       default:
         ir.AddLine(IrLine(line_index, eIrOp::ABORT_AND_ERROR,
-                          {kIrErrorInvalidLiteralAstType}));
+                          {IrString(kIrErrorInvalidLiteralAstType)}));
+    }
+  }
+
+  void Abort(std::string_view error) {
+    ir.AddLine(line_index, eIrOp::ABORT_AND_ERROR, {IrString(error)});
+  }
+
+  // Generates an op line followed by the operand range of each operand.
+  void GenOperation(eIrOp op, std::vector<IrVariant> scalar_args,
+                    const std::vector<const Ast*>& operands) {
+    auto& op_line = ir.AddLine(line_index, op, scalar_args);
+    line_index++;
+    for (const Ast* operand : operands) {
+      op_line.args.push_back((int)line_index);
+      GenPrimaryExpr(*operand);
+      if (ir.isAborted()) {
+        return;
+      }
+      op_line.args.push_back((int)line_index - 1);
     }
   }
 
@@ -288,75 +587,99 @@ class IrGen {
     if (ast.IsLiteral()) {
       GenLiteral(ast);
     } 
+    // Handle variable reads
+    else if (ast.TypeIs(eAst::kIdentifier)) {
+      ir.AddLine(line_index, eIrOp::LOAD_VARIABLE, {IrString(ast.Literal())});
+      line_index++;
+    }
     // Handle binary operations
-    else if (ast.IsArithmeticBinaryOp()) {
+    else if (ast.IsArithmeticBinaryOp() || ast.IsComparisonBinaryOp() ||
+             ast.IsLogicalBinaryOp()) {
       GenBinaryExpr(ast);
     } 
+    else if (ast.TypeIs(eAst::kFunctionCall)) {
+      GenCall(ast);
+    }
+    else if (ast.TypeIs(eAst::kNegation) && ast.Size() == 1) {
+      GenOperation(eIrOp::UNARY_NOT, {}, {&ast[0]});
+    }
     else
         ir.AddLine(line_index, eIrOp::ABORT_AND_ERROR,
-                   {kIrErrorInvalidPrimaryExpression});
+                   {IrString(kIrErrorInvalidPrimaryExpression)});
   }
 
   void GenBinaryExpr(const Ast& ast) {
-    auto binop_type = ast.Type();
-    std::vector<IrVariant> args;
-    // Generate the binary operation
-    IrLine* binop_line = nullptr;
-    switch (binop_type) {
+    eIrOp binop;
+    switch (ast.Type()) {
       case eAst::kAddition:
-        binop_line =
-            &ir.AddLine(line_index, eIrOp::BINARY_ADD, kIrOpNullArguments);
+        binop = eIrOp::BINARY_ADD;
         break;
       case eAst::kSubtraction:
-        binop_line =
-            &ir.AddLine(line_index, eIrOp::BINARY_SUB, kIrOpNullArguments);
+        binop = eIrOp::BINARY_SUB;
         break;
       case eAst::kMultiplication:
-        binop_line =
-            &ir.AddLine(line_index, eIrOp::BINARY_MUL, kIrOpNullArguments);
+        binop = eIrOp::BINARY_MUL;
         break;
       case eAst::kDivision:
-        binop_line =
-            &ir.AddLine(line_index, eIrOp::BINARY_DIV, kIrOpNullArguments);
+        binop = eIrOp::BINARY_DIV;
         break;
       case eAst::kRemainder:
-        binop_line =
-            &ir.AddLine(line_index, eIrOp::BINARY_MOD, kIrOpNullArguments);
+        binop = eIrOp::BINARY_MOD;
+        break;
+      case eAst::kEqual:
+        binop = eIrOp::BINARY_EQ;
+        break;
+      case eAst::kNotEqual:
+        binop = eIrOp::BINARY_NE;
+        break;
+      case eAst::kLessThan:
+        binop = eIrOp::BINARY_LT;
+        break;
+      case eAst::kGreaterThan:
+        binop = eIrOp::BINARY_GT;
+        break;
+      case eAst::kLessThanOrEqual:
+        binop = eIrOp::BINARY_LE;
+        break;
+      case eAst::kGreaterThanOrEqual:
+        binop = eIrOp::BINARY_GE;
+        break;
+      case eAst::kLogicalAnd:
+        binop = eIrOp::BINARY_AND;
+        break;
+      case eAst::kLogicalOr:
+        binop = eIrOp::BINARY_OR;
         break;
       default:
-        binop_line = &ir.AddLine(line_index, eIrOp::ABORT_AND_ERROR,
-                                 {kIrErrorInvalidLiteralAstType});
+        Abort(kIrErrorInvalidLiteralAstType);
+        return;
     }
+    // First child is the left operand, second child is the right operand.
+    GenOperation(binop, {}, {&ast[0], &ast[1]});
+  }
 
-    // Return early if binary operation type does not exist.
-    if (ir.isAborted()) {
-      return;
-    }
-
-    // Advance the line index
-    line_index++;
-
-    // First child is the left operand
-    const auto& left_operand_ast = ast[0];
-    auto left_operand_start = line_index;
-    args.push_back((int)line_index);
-    GenPrimaryExpr(left_operand_ast);
-    args.push_back((int)line_index-1);
-    if (ir.isAborted()) {
+  // Format: [FunctionCall] -> [Identifier | Period[object, member]],
+  //                           [Arguments] -> [Expr]...
+  void GenCall(const Ast& ast) {
+    const Ast& callee = ast[0];
+    std::vector<const Ast*> operands;
+    eIrOp call_op = eIrOp::CALL;
+    if (callee.TypeIs(eAst::kPeriod) && callee.Size() == 2 &&
+        callee[1].TypeIs(eAst::kIdentifier)) {
+      call_op = eIrOp::CALL_MEMBER;
+      operands.push_back(&callee[0]);
+    } else if (!callee.TypeIs(eAst::kIdentifier)) {
+      Abort(kIrErrorInvalidPrimaryExpression);
       return;
     }
-
-    // Second child is the right operand
-    const auto& right_operand_ast = ast[1];
-    args.push_back((int)line_index);
-    GenPrimaryExpr(right_operand_ast);
-    args.push_back((int)line_index-1);
-    if (ir.isAborted()) {
-      return;
+    if (ast.Size() > 1) {
+      for (const auto& argument : ast[1].Children()) {
+        operands.push_back(&argument);
+      }
     }
-
-    // Set the lines for the binop args.
-    binop_line->args = args;
+    const auto& name =
+        call_op == eIrOp::CALL ? callee.Literal() : callee[1].Literal();
+    GenOperation(call_op, {IrString(name)}, operands);
   }
 
   void GenVariableDeclaration(const Ast& ast) {
@@ -368,7 +691,7 @@ class IrGen {
     // Second child is the type constraint. TEMP ignore for now
     //const auto& type_constraint_ast = ast[1];
     // For now always push 'any' type index
-    var_decl_line.args.push_back((int)RtVal::Any::idx);
+    var_decl_line.args.push_back(kIrTypeConstraintAny);
 
     // Third child is the identifier
     const auto& identifier_ast = ast[2];
@@ -381,10 +704,286 @@ class IrGen {
       const auto& initializer_ast = ast[3][0]; // Get first child of initializer
       // Ast has children. Must be an expression.
       GenPrimaryExpr(initializer_ast);
-      var_decl_line.args.push_back((int)line_index);
+      if (ir.isAborted()) {
+        return;
+      }
+      var_decl_line.args.push_back((int)line_index - 1);
+    }
+  }
+
+  // Assignments, increments and decrements lower to a DEFINE_VARIABLE.
+  // Compound assignments read the target: a += b -> a = a + b.
+  void GenAssignment(const Ast& ast) {
+    const Ast& target = ast[0];
+    if (!target.TypeIs(eAst::kIdentifier)) {
+      Abort(kIrErrorInvalidAssignmentTarget);
+      return;
+    }
+    std::optional<eIrOp> compound_op;
+    switch (ast.Type()) {
+      case eAst::kAdditionAssignment:
+      case eAst::kIncrement:
+        compound_op = eIrOp::BINARY_ADD;
+        break;
+      case eAst::kSubtractionAssignment:
+      case eAst::kDecrement:
+        compound_op = eIrOp::BINARY_SUB;
+        break;
+      case eAst::kMultiplicationAssignment:
+        compound_op = eIrOp::BINARY_MUL;
+        break;
+      case eAst::kDivisionAssignment:
+        compound_op = eIrOp::BINARY_DIV;
+        break;
+      case eAst::kRemainderAssignment:
+        compound_op = eIrOp::BINARY_MOD;
+        break;
+      default:
+        break;
+    }
+
+    auto& define_line = ir.AddLine(line_index, eIrOp::DEFINE_VARIABLE,
+                                   {IrString(target.Literal())});
+    line_index++;
+    define_line.args.push_back((int)line_index);
+    if (!compound_op) {
+      GenPrimaryExpr(ast[1]);
+    } else {
+      auto& op_line = ir.AddLine(line_index, *compound_op, kIrOpNullArguments);
+      line_index++;
+      op_line.args = {(int)line_index, (int)line_index};
+      ir.AddLine(line_index, eIrOp::LOAD_VARIABLE,
+                 {IrString(target.Literal())});
+      line_index++;
+      op_line.args.push_back((int)line_index);
+      if (ast.TypeIs(eAst::kIncrement) || ast.TypeIs(eAst::kDecrement)) {
+        ir.AddLine(line_index, eIrOp::ALLOCATE_LITERAL, {1});
+        line_index++;
+      } else {
+        GenPrimaryExpr(ast[1]);
+      }
+      if (ir.isAborted()) {
+        return;
+      }
+      op_line.args.push_back((int)line_index - 1);
+    }
+    if (ir.isAborted()) {
+      return;
+    }
+    define_line.args.push_back((int)line_index - 1);
+  }
+
+  // Statements of a block, in a new lexical scope.
+  void GenScopedBlock(const Ast& ast) {
+    ir.AddLine(line_index++, eIrOp::ENTER_SCOPE, kIrOpNullArguments);
+    for (const auto& statement_ast : ast.Children()) {
+      GenStatement(statement_ast);
+      if (ir.isAborted()) {
+        return;
+      }
+    }
+    ir.AddLine(line_index++, eIrOp::EXIT_SCOPE, kIrOpNullArguments);
+  }
+
+  // Emits a JUMP_IF_FALSE on cond. Returns the line to patch with the target.
+  IrLine* GenConditionalJump(const Ast& cond) {
+    auto& jump_line = ir.AddLine(line_index, eIrOp::JUMP_IF_FALSE, {0});
+    line_index++;
+    jump_line.args.push_back((int)line_index);
+    GenPrimaryExpr(cond);
+    if (ir.isAborted()) {
+      return nullptr;
+    }
+    jump_line.args.push_back((int)line_index - 1);
+    return &jump_line;
+  }
+
+  // Format: [While] -> [Cond], [MethodDefinition]
+  //   cond: JUMP_IF_FALSE end, (cond)
+  //         <scoped body>
+  //         JUMP cond
+  //   end:
+  void GenWhile(const Ast& ast) {
+    auto cond_line = (int)line_index;
+    IrLine* exit_jump = GenConditionalJump(ast[0]);
+    if (exit_jump == nullptr) return;
+    GenScopedBlock(ast[1]);
+    if (ir.isAborted()) return;
+    ir.AddLine(line_index++, eIrOp::JUMP, {cond_line});
+    exit_jump->args[0] = (int)line_index;
+  }
+
+  // Format: [For] -> [Init], [Cond], [Increment], [MethodDefinition]
+  // The init declaration is scoped to the loop.
+  void GenFor(const Ast& ast) {
+    ir.AddLine(line_index++, eIrOp::ENTER_SCOPE, kIrOpNullArguments);
+    GenStatement(ast[0]);
+    if (ir.isAborted()) return;
+    auto cond_line = (int)line_index;
+    IrLine* exit_jump = GenConditionalJump(ast[1]);
+    if (exit_jump == nullptr) return;
+    GenScopedBlock(ast[3]);
+    if (ir.isAborted()) return;
+    GenStatement(ast[2]);
+    if (ir.isAborted()) return;
+    ir.AddLine(line_index++, eIrOp::JUMP, {cond_line});
+    exit_jump->args[0] = (int)line_index;
+    ir.AddLine(line_index++, eIrOp::EXIT_SCOPE, kIrOpNullArguments);
+  }
+
+  // Format: [IfStatement] -> [If[cond, body]], [Elif[cond, body]]...,
+  //                          [Else[body]]?
+  // Each taken branch jumps past the remaining branches.
+  void GenIf(const Ast& ast) {
+    std::vector<IrLine*> end_jumps;
+    for (const auto& branch : ast.Children()) {
+      if (branch.TypeIs(eAst::kElse)) {
+        GenScopedBlock(branch[0]);
+        if (ir.isAborted()) return;
+        break;
+      }
+      IrLine* next_jump = GenConditionalJump(branch[0]);
+      if (next_jump == nullptr) return;
+      GenScopedBlock(branch[1]);
+      if (ir.isAborted()) return;
+      end_jumps.push_back(&ir.AddLine(line_index++, eIrOp::JUMP, {0}));
+      next_jump->args[0] = (int)line_index;
+    }
+    for (IrLine* end_jump : end_jumps) {
+      end_jump->args[0] = (int)line_index;
+    }
+  }
+
+  // A call returned by a method is in tail position, it becomes a
+  // TAIL_CALL which reuses the frame of the method.
+  void GenReturn(const Ast& ast) {
+    if (ast.Empty()) {
+      ir.AddLine(line_index++, eIrOp::RETURN, kIrOpNullArguments);
+      return;
+    }
+    auto first = ir.Size();
+    GenOperation(eIrOp::RETURN, {}, {&ast[0]});
+    if (method_depth == 0 || ir.isAborted() || ir.Size() < first + 2) return;
+    auto ret = std::next(ir.lines.begin(), first);
+    auto operand = std::next(ret)->op;
+    if (operand == eIrOp::CALL || operand == eIrOp::CALL_MEMBER) {
+      ret->op = eIrOp::TAIL_CALL;
     }
   }
 
+  // Sets the source line of the lines generated since first which have none.
+  // Nested statements are stamped first, with their own line.
+  void StampSourceLine(std::size_t first, const Ast& ast) {
+    auto line = ast.Line();
+    for (auto it = std::next(ir.lines.begin(), first); it != ir.lines.end();
+         it++) {
+      if (it->source_line == 0) it->source_line = line;
+    }
+  }
+
+  void GenStatement(const Ast& ast) {
+    auto first = ir.Size();
+    GenStatementLines(ast);
+    StampSourceLine(first, ast);
+  }
+
+  void GenStatementLines(const Ast& ast) {
+    switch (ast.Type()) {
+      case eAst::kVariableDeclaration:
+        GenVariableDeclaration(ast);
+        break;
+      case eAst::kSimpleAssignment:
+      case eAst::kAdditionAssignment:
+      case eAst::kSubtractionAssignment:
+      case eAst::kMultiplicationAssignment:
+      case eAst::kDivisionAssignment:
+      case eAst::kRemainderAssignment:
+      case eAst::kIncrement:
+      case eAst::kDecrement:
+        GenAssignment(ast);
+        break;
+      case eAst::kWhile:
+        GenWhile(ast);
+        break;
+      case eAst::kFor:
+        GenFor(ast);
+        break;
+      case eAst::kIfStatement:
+        GenIf(ast);
+        break;
+      case eAst::kReturn:
+        GenReturn(ast);
+        break;
+      case eAst::kMethodDeclaration:
+      case eAst::kClassDeclaration:
+      case eAst::kMainDeclaration:
+        Abort(kIrErrorDeclarationCannotAppearInContext);
+        break;
+      default:
+        // Expression statement.
+        GenPrimaryExpr(ast);
+        break;
+    }
+  }
+
+  // Format: [MethodDeclaration] -> [Modifiers], [Identifier],
+  //                                [MethodSignature], [MethodDefinition]?
+  void GenMethodDeclaration(const Ast& ast) {
+    auto& method_line =
+        ir.AddLine(line_index, eIrOp::DECLARE_METHOD,
+                   {IrString(ast[1].Literal()), 0});
+    line_index++;
+    // Parameters: [MethodSignature] -> [MethodParameterList] ->
+    //             [MethodParameter] -> [Modifiers], [Type], [Identifier]
+    const Ast& signature = ast[2];
+    if (!signature.Empty()) {
+      for (const auto& parameter : signature[0].Children()) {
+        if (parameter.Size() == 3) {
+          method_line.args.push_back(IrString(parameter[2].Literal()));
+        }
+      }
+    }
+    if (ast.Size() == 4) {
+      method_depth++;
+      for (const auto& statement_ast : ast[3].Children()) {
+        GenStatement(statement_ast);
+        if (ir.isAborted()) return;
+      }
+      method_depth--;
+    }
+    ir.AddLine(line_index++, eIrOp::RETURN, kIrOpNullArguments);
+    method_line.args[1] = (int)line_index;
+  }
+
+  // Format: [ClassDeclaration] -> [Modifiers], [Identifier],
+  //                               [ClassDefinition] -> [Declaration]...
+  void GenClassDeclaration(const Ast& ast) {
+    auto& class_line = ir.AddLine(line_index, eIrOp::DECLARE_OBJECT,
+                                  {IrString(ast[1].Literal()), 0});
+    line_index++;
+    if (ast.Size() == 3) {
+      for (const auto& decl_ast : ast[2].Children()) {
+        switch (decl_ast.Type()) {
+          case eAst::kVariableDeclaration:
+            GenVariableDeclaration(decl_ast);
+            break;
+          case eAst::kMethodDeclaration:
+            GenMethodDeclaration(decl_ast);
+            break;
+          default:
+            Abort(kIrErrorStatementCannotAppearInContext);
+            break;
+        }
+        if (ir.isAborted()) return;
+      }
+    }
+    ir.AddLine(line_index++, eIrOp::RETURN, kIrOpNullArguments);
+    class_line.args[1] = (int)line_index;
+  }
+
+  // Format: [MainDeclaration] -> [MethodSignature], [MainDefinition]
+  void GenMain(const Ast& ast) { GenScopedBlock(ast[1]); }
+
  public:
   IrCode GenerateIr(const Ast& ast) {
     // Create the entry initial block
@@ -394,22 +993,46 @@ class IrGen {
     // First AST node must always be a Program
     if (ast.Empty() || ast.TypeIsnt(eAst::kProgram)) {
       ir.AddLine(line_index, eIrOp::ABORT_AND_ERROR,
-                 {kIrErrorNoProgramDefinition});
+                 {IrString(kIrErrorNoProgramDefinition)});
       return ir;
     }
 
-    // Read all declarations in the program from top to bottom.
+    // Read all declarations in the program from top to bottom. Main runs
+    // last so that every declaration is visible to it.
+    const Ast* main_ast = nullptr;
     for (const auto& decl_ast : ast.Children()) {
+      auto first = ir.Size();
       switch (decl_ast.Type()) {
         case eAst::kVariableDeclaration:
           GenVariableDeclaration(decl_ast);
           break;
+        case eAst::kMethodDeclaration:
+          GenMethodDeclaration(decl_ast);
+          break;
+        case eAst::kClassDeclaration:
+          GenClassDeclaration(decl_ast);
+          break;
+        case eAst::kMainDeclaration:
+          main_ast = &decl_ast;
+          break;
+        // Resolved by the module loader, see module_graph.h.
+        case eAst::kImportDeclaration:
+          break;
         // Default case, invalid declaration in this context.
         default:
           ir.AddLine(line_index, eIrOp::ABORT_AND_ERROR,
-                     {kIrErrorDeclarationCannotAppearInContext});
+                     {IrString(kIrErrorDeclarationCannotAppearInContext)});
           return ir;
       }
+      if (ir.isAborted()) {
+        return ir;
+      }
+      StampSourceLine(first, decl_ast);
+    }
+    if (main_ast != nullptr) {
+      auto first = ir.Size();
+      GenMain(*main_ast);
+      StampSourceLine(first, *main_ast);
     }
 
     return ir;
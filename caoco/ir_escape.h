@@ -0,0 +1,91 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_escape.h
+//---------------------------------------------------------------------------//
+// Brief: Escape analysis of the objects allocated by the IR.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_IR_ESCAPE_H
+#define HEADER_GUARD_CAOCO_COMPILER_IR_ESCAPE_H
+// Includes:
+#include "import_stl.h"
+#include "ir_codegen.h"
+
+//=-------------------------------------------------------------------------=//
+// IrEscapeAnalysis
+//---------------------------------------------------------------------------//
+// Finds the allocations whose instance never outlives the variable it is
+// assigned to. An allocation is a call of a declared class without
+// arguments, assigned directly to a variable by its declaration or an
+// assignment. The instance escapes unless every read of that name, in any
+// frame and scope, is the receiver of a member call. A method has no way to
+// refer to its receiver, so the instance dies with the variable, when it is
+// reassigned or its scope exits.
+class IrEscapeAnalysis {
+ public:
+  // Line index to true for the allocations which do not escape.
+  static std::vector<bool> Run(const std::vector<const IrLine*>& code) {
+    std::unordered_set<std::string> classes;
+    std::unordered_set<std::string> escaping;
+    std::vector<std::size_t> parents(code.size(), code.size());
+    for (const auto* line : code) {
+      if (line->op == eIrOp::DECLARE_OBJECT) {
+        classes.insert(std::get<IrString>(line->args.at(0)));
+      }
+      for (std::size_t i = 0; i < line->OperandCount(); i++) {
+        auto operand = static_cast<std::size_t>(line->OperandBegin(i));
+        if (operand < code.size()) parents[operand] = line->index;
+      }
+    }
+    for (const auto* line : code) {
+      if (line->op != eIrOp::LOAD_VARIABLE) continue;
+      auto parent = parents[line->index];
+      bool receiver = parent < code.size() &&
+                      code[parent]->op == eIrOp::CALL_MEMBER &&
+                      code[parent]->OperandCount() > 0 &&
+                      code[parent]->OperandBegin(0) ==
+                          static_cast<IrInt>(line->index);
+      if (!receiver) escaping.insert(std::get<IrString>(line->args.at(0)));
+    }
+
+    std::vector<bool> local(code.size(), false);
+    for (const auto* line : code) {
+      auto parent = parents[line->index];
+      if (line->op != eIrOp::CALL || line->OperandCount() != 0 ||
+          parent >= code.size() ||
+          !classes.contains(std::get<IrString>(line->args.at(0)))) {
+        continue;
+      }
+      const IrLine& store = *code[parent];
+      if (store.op != eIrOp::DECLARE_VARIABLE &&
+          store.op != eIrOp::DEFINE_VARIABLE) {
+        continue;
+      }
+      const auto& name = std::get<IrString>(
+          store.args.at(store.op == eIrOp::DECLARE_VARIABLE ? 1 : 0));
+      local[line->index] = !escaping.contains(name);
+    }
+    return local;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_escape.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_IR_ESCAPE_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
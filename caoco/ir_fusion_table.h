@@ -0,0 +1,46 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_fusion_table.h
+//---------------------------------------------------------------------------//
+// Brief: Superinstructions enabled in the evaluator. Generated, do not edit.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_IR_FUSION_TABLE_H
+#define HEADER_GUARD_CAOCO_COMPILER_IR_FUSION_TABLE_H
+// Includes:
+#include "ir_superinstructions.h"
+
+// Output of IrNgramProfiler::EmitTable over the optimized and profiled
+// corpus of ut0_ir_superinstructions.h, most dispatches saved first. The
+// TestCaseFusionTable unit test prints the regenerated table when it is out
+// of date.
+static constexpr IrFusionTableEntry kIrFusionTable[] = {
+    {eIrFusedOp::kDefineBinaryVarLit, 42165},
+    {eIrFusedOp::kBranchBinaryVarLit, 33330},
+    {eIrFusedOp::kBinaryVarLit, 23100},
+    {eIrFusedOp::kDefineVar, 15558},
+    {eIrFusedOp::kBinaryVarVar, 10000},
+    {eIrFusedOp::kDefineBinaryVarVar, 6912},
+    {eIrFusedOp::kDefineLit, 656},
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_fusion_table.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_IR_FUSION_TABLE_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
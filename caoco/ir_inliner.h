@@ -0,0 +1,265 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_inliner.h
+//---------------------------------------------------------------------------//
+// Brief: Devirtualization and inlining of small methods.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_IR_INLINER_H
+#define HEADER_GUARD_CAOCO_COMPILER_IR_INLINER_H
+// Includes:
+#include "import_stl.h"
+#include "ir_cfg.h"
+#include "ir_codegen.h"
+
+//=-------------------------------------------------------------------------=//
+// IrInliner
+//---------------------------------------------------------------------------//
+// A method whose body starts by returning a pure expression of its
+// parameters is replaced by that expression at its call sites, so no frame
+// is set up and no name is looked up.
+// - Member calls are devirtualized first: a variable which every write of
+//   the program, under any scope, assigns a new instance of the same class
+//   holds that class. Its members are the methods declared directly in the
+//   class body.
+// - A member read by a member method is a constant if the class body
+//   declares it once with a literal and nothing else writes its name.
+// - Top level methods are inlined at call sites after their declaration,
+//   unless a class declares a method of the same name, which a call from a
+//   member would find first.
+// Arguments must be pure since the expression may read a parameter once,
+// many times or never.
+static constexpr std::size_t kIrInlineBudget = 8;  // Nodes of an expression.
+
+class IrInliner {
+  struct Method {
+    std::vector<std::string> params;
+    std::optional<IrNode> value;  // Returned expression, if inlinable.
+    std::size_t block;            // Of the declaration.
+  };
+  struct Class {
+    std::unordered_map<std::string, std::vector<Method>> methods;
+    std::unordered_map<std::string, IrNode> literals;  // Member initializers.
+  };
+  struct Body {
+    std::string cls;  // Name of a class body, empty for a method.
+    std::size_t end;  // Block after the body.
+    std::size_t depth;
+  };
+
+  std::unordered_map<std::string, std::vector<Class>> classes_;
+  std::unordered_map<std::string, std::vector<Method>> functions_;
+  std::unordered_set<std::string> member_names_;  // Every member method.
+  std::unordered_map<std::string, std::size_t> writes_;
+  std::unordered_map<std::string, std::string> types_;  // "" if unknown.
+  std::size_t budget_;
+  std::size_t inlined_{0};
+
+  static std::size_t NodeCount(const IrNode& node) {
+    std::size_t count = 1;
+    for (const auto& operand : node.operands) count += NodeCount(operand);
+    return count;
+  }
+
+  void Write(const std::string& name, const std::string& type) {
+    writes_[name]++;
+    auto [it, inserted] = types_.try_emplace(name, type);
+    if (!inserted && it->second != type) it->second.clear();
+  }
+
+  void Collect(const IrCfg& cfg) {
+    std::vector<Body> bodies;
+    for (std::size_t b = 0; b < cfg.Blocks().size(); b++) {
+      while (!bodies.empty() && bodies.back().end <= b) bodies.pop_back();
+      for (const auto& statement : cfg.Blocks()[b].statements) {
+        Body* top = bodies.empty() ? nullptr : &bodies.back();
+        switch (statement.op) {
+          case eIrOp::ENTER_SCOPE:
+            if (top) top->depth++;
+            break;
+          case eIrOp::EXIT_SCOPE:
+            if (top && top->depth > 0) top->depth--;
+            break;
+          case eIrOp::DECLARE_VARIABLE:
+          case eIrOp::DEFINE_VARIABLE: {
+            const auto& name = statement.Name();
+            const IrNode* value =
+                statement.operands.empty() ? nullptr : &statement.operands[0];
+            std::string type;
+            if (value && value->op == eIrOp::CALL && value->operands.empty()) {
+              type = std::get<IrString>(value->args[0]);
+            }
+            Write(name, type);
+            if (top && !top->cls.empty() && top->depth == 0 &&
+                statement.op == eIrOp::DECLARE_VARIABLE && value &&
+                value->op == eIrOp::ALLOCATE_LITERAL) {
+              classes_[top->cls].back().literals.emplace(name, *value);
+            }
+          } break;
+          case eIrOp::DECLARE_OBJECT: {
+            const auto& name = std::get<IrString>(statement.args[0]);
+            classes_[name].emplace_back();
+            bodies.push_back({name, IrCfg::Target(statement), 0});
+          } break;
+          case eIrOp::DECLARE_METHOD: {
+            const auto& name = std::get<IrString>(statement.args[0]);
+            Method method{{}, std::nullopt, b};
+            for (std::size_t arg = 2; arg < statement.args.size(); arg++) {
+              method.params.push_back(std::get<IrString>(statement.args[arg]));
+              Write(method.params.back(), "");
+            }
+            const auto& body = b + 1 < cfg.Blocks().size()
+                                   ? cfg.Blocks()[b + 1].statements
+                                   : std::vector<IrNode>{};
+            if (!body.empty() && body[0].op == eIrOp::RETURN &&
+                body[0].operands.size() == 1 &&
+                IrTree::IsPure(body[0].operands[0]) &&
+                NodeCount(body[0].operands[0]) <= budget_) {
+              method.value = body[0].operands[0];
+            }
+            if (top && !top->cls.empty() && top->depth == 0) {
+              member_names_.insert(name);
+              classes_[top->cls].back().methods[name].push_back(
+                  std::move(method));
+            } else {
+              // Methods nested in a scope are registered globally when
+              // their declaration runs, a call may find either.
+              if (top) method.value.reset();
+              functions_[name].push_back(std::move(method));
+            }
+            bodies.push_back({"", IrCfg::Target(statement), 0});
+          } break;
+          default:
+            break;
+        }
+      }
+    }
+  }
+
+  // Replaces reads of the parameters with the arguments, and reads of
+  // constant members with their literal. Returns false if the expression
+  // reads anything else.
+  bool Substitute(IrNode& node, const Method& method,
+                  const std::vector<IrNode>& args, const Class* cls) const {
+    if (node.op == eIrOp::LOAD_VARIABLE) {
+      const auto& name = node.Name();
+      auto param = std::find(method.params.begin(), method.params.end(), name);
+      if (param != method.params.end()) {
+        node = args[param - method.params.begin()];
+        return true;
+      }
+      if (cls == nullptr) return false;
+      auto literal = cls->literals.find(name);
+      if (literal == cls->literals.end() || writes_.at(name) != 1) {
+        return false;
+      }
+      node = literal->second;
+      return true;
+    }
+    for (auto& operand : node.operands) {
+      if (!Substitute(operand, method, args, cls)) return false;
+    }
+    return true;
+  }
+
+  // Returns the inlined expression of a call, if any.
+  std::optional<IrNode> Inline(const IrNode& call, std::size_t block) const {
+    const std::string& name = std::get<IrString>(call.args[0]);
+    const Method* method = nullptr;
+    const Class* cls = nullptr;
+    std::vector<IrNode> args;
+    if (call.op == eIrOp::CALL_MEMBER) {
+      if (call.operands.empty() ||
+          call.operands[0].op != eIrOp::LOAD_VARIABLE) {
+        return std::nullopt;
+      }
+      auto type = types_.find(call.operands[0].Name());
+      if (type == types_.end() || type->second.empty()) return std::nullopt;
+      // The constructor call must reach the class.
+      auto found = classes_.find(type->second);
+      if (found == classes_.end() || found->second.size() != 1 ||
+          functions_.contains(type->second) ||
+          member_names_.contains(type->second)) {
+        return std::nullopt;
+      }
+      cls = &found->second[0];
+      auto methods = cls->methods.find(name);
+      if (methods == cls->methods.end() || methods->second.size() != 1) {
+        return std::nullopt;
+      }
+      method = &methods->second[0];
+      args.assign(call.operands.begin() + 1, call.operands.end());
+    } else {
+      auto found = functions_.find(name);
+      if (found == functions_.end() || found->second.size() != 1 ||
+          member_names_.contains(name) || found->second[0].block >= block) {
+        return std::nullopt;
+      }
+      method = &found->second[0];
+      args = call.operands;
+    }
+    if (!method->value || method->params.size() != args.size() ||
+        !std::all_of(args.begin(), args.end(), &IrTree::IsPure)) {
+      return std::nullopt;
+    }
+    IrNode value = *method->value;
+    if (!Substitute(value, *method, args, cls)) return std::nullopt;
+    lambda xStamp = [&](auto& self, IrNode& node) -> void {
+      node.source_line = call.source_line;
+      for (auto& operand : node.operands) self(self, operand);
+    };
+    xStamp(xStamp, value);
+    return value;
+  }
+
+  void Rewrite(IrNode& node, std::size_t block) {
+    for (auto& operand : node.operands) Rewrite(operand, block);
+    if (node.op != eIrOp::CALL && node.op != eIrOp::CALL_MEMBER) return;
+    if (auto value = Inline(node, block)) {
+      node = std::move(*value);
+      inlined_++;
+    }
+  }
+
+  explicit IrInliner(std::size_t budget) : budget_(budget) {}
+
+ public:
+  // Inlines the call sites of the program. Returns how many were inlined.
+  static std::size_t Run(IrCfg& cfg, std::size_t budget = kIrInlineBudget) {
+    IrInliner inliner(budget);
+    inliner.Collect(cfg);
+    for (std::size_t b = 0; b < cfg.Blocks().size(); b++) {
+      for (auto& statement : cfg.Blocks()[b].statements) {
+        inliner.Rewrite(statement, b);
+        // An inlined tail call is a plain return.
+        if (statement.op == eIrOp::TAIL_CALL &&
+            statement.operands[0].op != eIrOp::CALL &&
+            statement.operands[0].op != eIrOp::CALL_MEMBER) {
+          statement.op = eIrOp::RETURN;
+        }
+      }
+    }
+    return inliner.inlined_;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_inliner.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_IR_INLINER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
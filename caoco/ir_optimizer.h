@@ -0,0 +1,904 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_optimizer.h
+//---------------------------------------------------------------------------//
+// Brief: Verifier, pass manager and optimization passes over IrCode.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_IR_OPTIMIZER_H
+#define HEADER_GUARD_CAOCO_COMPILER_IR_OPTIMIZER_H
+// Includes:
+#include "evaluator.h"
+#include "expected.h"
+#include "import_stl.h"
+#include "ir_cfg.h"
+#include "ir_codegen.h"
+#include "ir_inliner.h"
+#include "ir_ssa.h"
+
+//=-------------------------------------------------------------------------=//
+// IrVerifier
+//---------------------------------------------------------------------------//
+// Checks the structural invariants documented in ir_codegen.h. Runs on the
+// input of the pass manager and after every pass which changed the code.
+class IrVerifier {
+  const std::vector<const IrLine*>& code_;
+  std::vector<bool> statement_starts_;  // Valid jump targets.
+
+  static BoolError LineError(const IrLine& line, std::string_view message) {
+    return BoolError("[C&][IR VERIFIER] Line " + std::to_string(line.index) +
+                     " " + std::string(ToStr(line.op)) + ": " +
+                     std::string(message));
+  }
+
+  static bool ArgIsString(const IrLine& line, std::size_t arg) {
+    return arg < line.args.size() &&
+           std::holds_alternative<IrString>(line.args[arg]);
+  }
+
+  bool ArgIsTarget(const IrLine& line, std::size_t arg) const {
+    if (arg >= line.args.size() ||
+        !std::holds_alternative<IrInt>(line.args[arg])) {
+      return false;
+    }
+    auto target = std::get<IrInt>(line.args[arg]);
+    return target >= 0 &&
+           static_cast<std::size_t>(target) < statement_starts_.size() &&
+           statement_starts_[target];
+  }
+
+  BoolError VerifyArgs(const IrLine& line) const {
+    auto scalars = IrOpScalarArgCount(line.op);
+    if (scalars != kIrOpNoOperands) {
+      if (line.args.size() < scalars || (line.args.size() - scalars) % 2 != 0) {
+        return LineError(line, "Malformed operand ranges.");
+      }
+      for (auto arg = scalars; arg < line.args.size(); arg++) {
+        if (!std::holds_alternative<IrInt>(line.args[arg])) {
+          return LineError(line, "Operand range bound is not an IrInt.");
+        }
+      }
+    }
+
+    switch (line.op) {
+      case eIrOp::ENTER_PROGRAM_DEFINITION:
+        if (line.index != 0) {
+          return LineError(line, "Program definition must be the first line.");
+        }
+        break;
+      case eIrOp::ABORT_AND_ERROR:
+        if (line.index + 1 != code_.size() || !ArgIsString(line, 0)) {
+          return LineError(line, "Abort must be the last line with a message.");
+        }
+        break;
+      case eIrOp::ALLOCATE_LITERAL:
+        if (line.args.size() != 1) {
+          return LineError(line, "Expected exactly one literal argument.");
+        }
+        break;
+      case eIrOp::LOAD_VARIABLE:
+        if (line.args.size() != 1 || !ArgIsString(line, 0)) {
+          return LineError(line, "Expected a variable name.");
+        }
+        break;
+      case eIrOp::DECLARE_VARIABLE:
+        if (!std::holds_alternative<IrInt>(line.args[0]) ||
+            !ArgIsString(line, 1) || line.OperandCount() > 1) {
+          return LineError(line, "Expected [type, name] and an initializer.");
+        }
+        break;
+      case eIrOp::DEFINE_VARIABLE:
+        if (!ArgIsString(line, 0) || line.OperandCount() != 1) {
+          return LineError(line, "Expected [name] and a value.");
+        }
+        break;
+      case eIrOp::CALL:
+        if (!ArgIsString(line, 0)) {
+          return LineError(line, "Expected a method name.");
+        }
+        break;
+      case eIrOp::CALL_MEMBER:
+        if (!ArgIsString(line, 0) || line.OperandCount() < 1) {
+          return LineError(line, "Expected a method name and an object.");
+        }
+        break;
+      case eIrOp::RETURN:
+        if (line.OperandCount() > 1) {
+          return LineError(line, "Expected at most one return value.");
+        }
+        break;
+      case eIrOp::TAIL_CALL:
+        if (line.OperandCount() != 1) {
+          return LineError(line, "Expected a returned call.");
+        }
+        break;
+      case eIrOp::JUMP:
+        if (line.args.size() != 1 || !ArgIsTarget(line, 0)) {
+          return LineError(line, "Expected a statement as jump target.");
+        }
+        break;
+      case eIrOp::JUMP_IF_FALSE:
+        if (!ArgIsTarget(line, 0) || line.OperandCount() != 1) {
+          return LineError(line, "Expected a jump target and a condition.");
+        }
+        break;
+      case eIrOp::DECLARE_METHOD:
+      case eIrOp::DECLARE_OBJECT:
+        if (!ArgIsString(line, 0) || !ArgIsTarget(line, 1) ||
+            std::get<IrInt>(line.args[1]) <= static_cast<IrInt>(line.index)) {
+          return LineError(line, "Expected a name and a forward skip target.");
+        }
+        for (std::size_t arg = 2; arg < line.args.size(); arg++) {
+          if (line.op == eIrOp::DECLARE_OBJECT || !ArgIsString(line, arg)) {
+            return LineError(line, "Expected parameter names.");
+          }
+        }
+        break;
+      case eIrOp::UNARY_NOT:
+        if (line.OperandCount() != 1) {
+          return LineError(line, "Expected one operand.");
+        }
+        break;
+      default:
+        if (IrOpIsBinary(line.op) && line.OperandCount() != 2) {
+          return LineError(line, "Expected two operands.");
+        }
+        break;
+    }
+    return true;
+  }
+
+  // Verifies the line at index and every line it owns.
+  BoolError VerifyNode(std::size_t index) const {
+    const IrLine& line = *code_[index];
+    if (auto args = VerifyArgs(line); !args) {
+      return args;
+    }
+
+    // Operand ranges must be contiguous, directly follow the line, and each
+    // must span exactly the extent of the expression rooted at its begin.
+    auto expected_begin = static_cast<IrInt>(index) + 1;
+    for (std::size_t i = 0; i < line.OperandCount(); i++) {
+      auto begin = line.OperandBegin(i);
+      auto end = line.OperandEnd(i);
+      if (begin != expected_begin || end < begin ||
+          static_cast<std::size_t>(end) >= code_.size()) {
+        return LineError(line, "Operand range is out of order or bounds.");
+      }
+      const IrLine& operand = *code_[begin];
+      if (!IrOpIsExpression(operand.op)) {
+        return LineError(line, "Operand is not an expression.");
+      }
+      if (auto verified = VerifyNode(begin); !verified) {
+        return verified;
+      }
+      if (operand.ExtentEnd() != static_cast<std::size_t>(end)) {
+        return LineError(line, "Operand range does not match its extent.");
+      }
+      expected_begin = end + 1;
+    }
+    return true;
+  }
+
+  explicit IrVerifier(const std::vector<const IrLine*>& code) : code_(code) {}
+
+ public:
+  static BoolError Verify(const IrCode& code) {
+    if (code.GetLines().empty()) {
+      return BoolError("[C&][IR VERIFIER] Code is empty.");
+    }
+    std::vector<const IrLine*> index;
+    index.reserve(code.Size());
+    for (const auto& line : code.GetLines()) {
+      if (line.index != index.size()) {
+        return LineError(line, "Line index does not match its position.");
+      }
+      index.push_back(&line);
+    }
+    if (index.front()->op != eIrOp::ENTER_PROGRAM_DEFINITION) {
+      return BoolError("[C&][IR VERIFIER] Missing program definition.");
+    }
+
+    // Statement starts are found first so that forward jumps can be checked.
+    // The extents are validated by VerifyNode before they are relied upon.
+    IrVerifier verifier{index};
+    verifier.statement_starts_.assign(index.size() + 1, false);
+    verifier.statement_starts_[index.size()] = true;
+    for (std::size_t i = 0; i < index.size();) {
+      verifier.statement_starts_[i] = true;
+      auto next = index[i]->ExtentEnd() + 1;
+      if (next <= i || next > index.size()) {
+        return LineError(*index[i], "Statement extent is out of bounds.");
+      }
+      i = next;
+    }
+    for (std::size_t i = 0; i < index.size(); i = index[i]->ExtentEnd() + 1) {
+      if (auto verified = verifier.VerifyNode(i); !verified) {
+        return verified;
+      }
+    }
+    return true;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// Passes
+//---------------------------------------------------------------------------//
+class IrPass {
+ public:
+  virtual ~IrPass() = default;
+  virtual std::string_view Name() const = 0;
+  // Returns true if the code was changed.
+  virtual bool Run(IrCode& code) = 0;
+  // Whether the pass manager reruns the pass until the code stops changing.
+  // Non iterative passes only run in the first iteration.
+  virtual bool IsIterative() const { return true; }
+};
+
+// Base of the passes which rewrite the control flow graph of the program.
+// Unless noted otherwise the passes are local to a basic block. Scope
+// boundaries and calls, which may write any global or member, end what a
+// pass knows about variables.
+class IrCfgPass : public IrPass {
+ public:
+  bool Run(IrCode& code) override {
+    auto cfg = IrCfg::Decode(code);
+    if (!RunOnCfg(cfg)) {
+      return false;
+    }
+    code = cfg.Encode();
+    return true;
+  }
+  virtual bool RunOnCfg(IrCfg& cfg) = 0;
+};
+
+// Replaces operations on literals with the resulting literal. Operations
+// which fail, such as division by zero, are left for the runtime to report.
+// Conditional jumps on a literal become unconditional or are removed.
+class IrLiteralFoldingPass : public IrCfgPass {
+  static bool IsLiteral(const IrNode& node) {
+    return node.op == eIrOp::ALLOCATE_LITERAL;
+  }
+
+  static bool Fold(IrNode& node) {
+    bool changed = false;
+    for (auto& operand : node.operands) {
+      changed |= Fold(operand);
+    }
+    if (node.op == eIrOp::UNARY_NOT && IsLiteral(node.operands[0]) &&
+        std::holds_alternative<IrBool>(node.operands[0].args[0])) {
+      auto value = std::get<IrBool>(node.operands[0].args[0]).value;
+      node = IrNode{eIrOp::ALLOCATE_LITERAL, {IrBool{!value}}, {}};
+      return true;
+    }
+    if (!IrOpIsBinary(node.op) || !IsLiteral(node.operands[0]) ||
+        !IsLiteral(node.operands[1])) {
+      return changed;
+    }
+    try {
+      auto folded = RtValToIrLiteral(Evaluator::ApplyBinaryOp(
+          node.op, IrLiteralToRtVal(node.operands[0].args[0]),
+          IrLiteralToRtVal(node.operands[1].args[0])));
+      if (!folded) {
+        return changed;
+      }
+      node = IrNode{eIrOp::ALLOCATE_LITERAL, {*folded}, {}};
+      return true;
+    } catch (const std::runtime_error&) {
+      return changed;
+    }
+  }
+
+ public:
+  std::string_view Name() const override { return "literal-folding"; }
+  bool RunOnCfg(IrCfg& cfg) override {
+    bool changed = false;
+    for (auto& block : cfg.Blocks()) {
+      for (auto& statement : block.statements) {
+        changed |= Fold(statement);
+      }
+      if (block.statements.empty()) continue;
+      auto& last = block.statements.back();
+      if (last.op != eIrOp::JUMP_IF_FALSE || !IsLiteral(last.operands[0]) ||
+          !std::holds_alternative<IrBool>(last.operands[0].args[0])) {
+        continue;
+      }
+      if (std::get<IrBool>(last.operands[0].args[0]).value) {
+        block.statements.pop_back();
+      } else {
+        last = IrNode{eIrOp::JUMP, {last.args[0]}, {}};
+      }
+      changed = true;
+    }
+    return changed;
+  }
+};
+
+// Replaces reads of a variable which holds a copy of a literal or of
+// another variable with the copied value, until either is written.
+class IrCopyPropagationPass : public IrCfgPass {
+  using CopyMap = std::unordered_map<std::string, IrNode>;
+
+  // Operands evaluated after a call may observe its writes.
+  static bool Substitute(IrNode& node, const CopyMap& copies,
+                         bool& after_call) {
+    if (after_call) {
+      return false;
+    }
+    if (node.op == eIrOp::LOAD_VARIABLE) {
+      auto found = copies.find(node.Name());
+      if (found == copies.end()) {
+        return false;
+      }
+      node = found->second;
+      return true;
+    }
+    bool changed = false;
+    for (auto& operand : node.operands) {
+      changed |= Substitute(operand, copies, after_call);
+    }
+    if (node.op == eIrOp::CALL || node.op == eIrOp::CALL_MEMBER) {
+      after_call = true;
+    }
+    return changed;
+  }
+
+  static bool RunOnBlock(IrBlock& block) {
+    CopyMap copies;
+    bool changed = false;
+    for (auto& statement : block.statements) {
+      bool after_call = false;
+      for (auto& operand : statement.operands) {
+        changed |= Substitute(operand, copies, after_call);
+      }
+      if (IrTree::IsScopeBoundary(statement) ||
+          IrTree::ContainsCall(statement)) {
+        copies.clear();
+      }
+      if (!IrTree::IsWrite(statement)) {
+        continue;
+      }
+      const auto& name = statement.Name();
+      std::erase_if(copies, [&name](const auto& entry) {
+        return entry.first == name || IrTree::Reads(entry.second, name);
+      });
+      if (statement.operands.size() != 1) {
+        continue;
+      }
+      // Sources which are still copies were substituted above.
+      const IrNode& value = statement.operands[0];
+      if (value.op == eIrOp::ALLOCATE_LITERAL ||
+          (value.op == eIrOp::LOAD_VARIABLE && value.Name() != name)) {
+        copies[name] = value;
+      }
+    }
+    return changed;
+  }
+
+ public:
+  std::string_view Name() const override { return "copy-propagation"; }
+  bool RunOnCfg(IrCfg& cfg) override {
+    bool changed = false;
+    for (auto& block : cfg.Blocks()) {
+      changed |= RunOnBlock(block);
+    }
+    return changed;
+  }
+};
+
+// Local common subexpression elimination. Reuses the variable holding a
+// previously computed expression while none of its inputs were reassigned.
+// Expressions repeated within one statement are hoisted into a temporary.
+class IrLocalCsePass : public IrCfgPass {
+  struct Available {
+    IrNode expr;
+    std::string holder;
+  };
+  using AvailableMap = std::unordered_map<std::string, Available>;
+  using NameSet = std::unordered_set<std::string>;
+  std::size_t next_temp_{0};
+
+  static void CountSubexpressions(
+      const IrNode& node, std::unordered_map<std::string, std::size_t>& counts,
+      std::vector<const IrNode*>& order) {
+    if (IrOpIsBinary(node.op) && IrTree::IsPure(node)) {
+      auto& count = counts[IrTree::Key(node)];
+      if (count++ == 0) {
+        order.push_back(&node);
+      }
+    }
+    for (const auto& operand : node.operands) {
+      CountSubexpressions(operand, counts, order);
+    }
+  }
+
+  static void CollectReads(const IrNode& node, NameSet& names) {
+    if (node.op == eIrOp::LOAD_VARIABLE) {
+      names.insert(node.Name());
+    }
+    for (const auto& operand : node.operands) {
+      CollectReads(operand, names);
+    }
+  }
+
+  static bool Replace(IrNode& node, const std::string& key,
+                      const std::string& holder) {
+    if (IrOpIsBinary(node.op) && IrTree::Key(node) == key) {
+      node = IrNode{eIrOp::LOAD_VARIABLE, {holder}, {}};
+      return true;
+    }
+    bool changed = false;
+    for (auto& operand : node.operands) {
+      changed |= Replace(operand, key, holder);
+    }
+    return changed;
+  }
+
+  // Operands evaluated after a call may observe its writes.
+  static bool ReplaceAvailable(IrNode& node, const AvailableMap& available,
+                               bool& after_call) {
+    if (after_call) {
+      return false;
+    }
+    if (IrOpIsBinary(node.op)) {
+      auto found = available.find(IrTree::Key(node));
+      if (found != available.end()) {
+        node = IrNode{eIrOp::LOAD_VARIABLE, {found->second.holder}, {}};
+        return true;
+      }
+    }
+    bool changed = false;
+    for (auto& operand : node.operands) {
+      changed |= ReplaceAvailable(operand, available, after_call);
+    }
+    if (node.op == eIrOp::CALL || node.op == eIrOp::CALL_MEMBER) {
+      after_call = true;
+    }
+    return changed;
+  }
+
+  std::string NewTemp(NameSet& names) {
+    std::string name;
+    do {
+      name = std::string(kIrTempPrefix) + "cse." + std::to_string(next_temp_++);
+    } while (names.contains(name));
+    names.insert(name);
+    return name;
+  }
+
+  // Hoists the outermost expression repeated within the statement until
+  // none are left.
+  bool HoistRepeated(IrNode& statement, std::vector<IrNode>& result,
+                     AvailableMap& available, NameSet& mentioned,
+                     NameSet& names) {
+    bool changed = false;
+    while (true) {
+      std::unordered_map<std::string, std::size_t> counts;
+      std::vector<const IrNode*> order;
+      for (const auto& operand : statement.operands) {
+        CountSubexpressions(operand, counts, order);
+      }
+      auto repeated = std::find_if(
+          order.begin(), order.end(), [&counts](const IrNode* node) {
+            return counts[IrTree::Key(*node)] > 1;
+          });
+      if (repeated == order.end()) {
+        return changed;
+      }
+      IrNode expr = **repeated;
+      auto key = IrTree::Key(expr);
+      auto temp = NewTemp(names);
+      for (auto& operand : statement.operands) {
+        Replace(operand, key, temp);
+      }
+      result.push_back(
+          IrNode{eIrOp::DECLARE_VARIABLE, {kIrTypeConstraintAny, temp}, {expr}});
+      CollectReads(expr, mentioned);
+      mentioned.insert(temp);
+      available[key] = Available{std::move(expr), temp};
+      changed = true;
+    }
+  }
+
+  bool RunOnBlock(IrBlock& block, NameSet& names) {
+    AvailableMap available;
+    NameSet mentioned;  // Names read or held by an available expression.
+    std::vector<IrNode> result;
+    result.reserve(block.statements.size());
+    bool changed = false;
+
+    for (auto& statement : block.statements) {
+      if (IrTree::IsScopeBoundary(statement)) {
+        available.clear();
+        mentioned.clear();
+        result.push_back(std::move(statement));
+        continue;
+      }
+      bool after_call = false;
+      for (auto& operand : statement.operands) {
+        changed |= ReplaceAvailable(operand, available, after_call);
+      }
+      if (IrTree::ContainsCall(statement)) {
+        available.clear();
+        mentioned.clear();
+      } else {
+        changed |=
+            HoistRepeated(statement, result, available, mentioned, names);
+      }
+
+      if (IrTree::IsWrite(statement)) {
+        const auto& name = statement.Name();
+        // Forget expressions which read or are held by the written variable.
+        if (mentioned.contains(name)) {
+          std::erase_if(available, [&name](const auto& entry) {
+            return entry.second.holder == name ||
+                   IrTree::Reads(entry.second.expr, name);
+          });
+        }
+        if (statement.operands.size() == 1 &&
+            IrOpIsBinary(statement.operands[0].op) &&
+            IrTree::IsPure(statement.operands[0]) &&
+            !IrTree::Reads(statement.operands[0], name)) {
+          auto [entry, inserted] = available.try_emplace(
+              IrTree::Key(statement.operands[0]),
+              Available{statement.operands[0], name});
+          if (inserted) {
+            CollectReads(entry->second.expr, mentioned);
+            mentioned.insert(name);
+          }
+        }
+      }
+      result.push_back(std::move(statement));
+    }
+    block.statements = std::move(result);
+    return changed;
+  }
+
+ public:
+  std::string_view Name() const override { return "local-cse"; }
+  bool RunOnCfg(IrCfg& cfg) override {
+    NameSet names;
+    for (const auto& block : cfg.Blocks()) {
+      for (const auto& statement : block.statements) {
+        if (IrTree::IsWrite(statement)) names.insert(statement.Name());
+      }
+    }
+    bool changed = false;
+    for (auto& block : cfg.Blocks()) {
+      changed |= RunOnBlock(block, names);
+    }
+    return changed;
+  }
+};
+
+// Removes unreachable blocks, jumps to the following block, pure expression
+// statements, unread temporaries and stores which are overwritten in the
+// same block before being read. Program level variables remain observable
+// after evaluation so their declarations are always kept.
+class IrDeadCodeEliminationPass : public IrCfgPass {
+  static bool IsTemp(const std::string& name) {
+    return name.starts_with(kIrTempPrefix);
+  }
+
+  // True if the assignment at index is overwritten before any read.
+  static bool IsDeadStore(const std::vector<IrNode>& statements,
+                          std::size_t index) {
+    const auto& name = statements[index].Name();
+    for (auto next = index + 1; next < statements.size(); next++) {
+      const auto& statement = statements[next];
+      for (const auto& operand : statement.operands) {
+        if (IrTree::Reads(operand, name)) {
+          return false;
+        }
+      }
+      if (IrTree::ContainsCall(statement) ||
+          IrTree::IsScopeBoundary(statement) ||
+          (statement.op == eIrOp::DECLARE_VARIABLE &&
+           statement.Name() == name)) {
+        return false;
+      }
+      if (statement.op == eIrOp::DEFINE_VARIABLE && statement.Name() == name) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static bool RemoveUnreachableBlocks(IrCfg& cfg) {
+    std::vector<bool> reachable(cfg.End() + 1, false);
+    std::vector<std::size_t> worklist{0};
+    reachable[0] = true;
+    while (!worklist.empty()) {
+      auto block = worklist.back();
+      worklist.pop_back();
+      if (block == cfg.End()) continue;
+      for (auto successor : cfg.Successors(block)) {
+        if (!reachable[successor]) {
+          reachable[successor] = true;
+          worklist.push_back(successor);
+        }
+      }
+    }
+    bool changed = false;
+    for (std::size_t block = 0; block < cfg.End(); block++) {
+      auto& statements = cfg.Blocks()[block].statements;
+      if (!reachable[block] && !statements.empty()) {
+        statements.clear();
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  static bool RemoveJumpsToNextBlock(IrCfg& cfg) {
+    bool changed = false;
+    auto& blocks = cfg.Blocks();
+    for (std::size_t block = 0; block < blocks.size(); block++) {
+      auto& statements = blocks[block].statements;
+      if (statements.empty() || statements.back().op != eIrOp::JUMP) {
+        continue;
+      }
+      auto target = IrCfg::Target(statements.back());
+      if (target <= block) continue;
+      bool skips_code = false;
+      for (auto between = block + 1; between < target; between++) {
+        skips_code |= !blocks[between].statements.empty();
+      }
+      if (!skips_code) {
+        statements.pop_back();
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  static bool RemoveDeadStatements(IrCfg& cfg) {
+    bool changed = false;
+    bool removed = true;
+    while (removed) {
+      removed = false;
+      std::unordered_map<std::string, std::size_t> reads;
+      for (const auto& block : cfg.Blocks()) {
+        for (const auto& statement : block.statements) {
+          IrTree::CountReads(statement, reads);
+        }
+      }
+      for (auto& block : cfg.Blocks()) {
+        auto& statements = block.statements;
+        for (std::size_t i = 0; i < statements.size(); i++) {
+          const auto& statement = statements[i];
+          bool dead = false;
+          if (IrTree::IsPure(statement)) {
+            dead = true;
+          } else if (statement.op == eIrOp::DECLARE_VARIABLE) {
+            dead = IsTemp(statement.Name()) && !reads[statement.Name()] &&
+                   std::all_of(statement.operands.begin(),
+                               statement.operands.end(), &IrTree::IsPure);
+          } else if (statement.op == eIrOp::DEFINE_VARIABLE) {
+            bool unread_temp =
+                IsTemp(statement.Name()) && !reads[statement.Name()];
+            if (unread_temp && !IrTree::IsPure(statement.operands[0])) {
+              // Keep the side effects of the value, as an expression.
+              statements[i] = IrNode(statement.operands[0]);
+              removed = changed = true;
+              break;
+            }
+            dead = IrTree::IsPure(statement.operands[0]) &&
+                   (unread_temp || IsDeadStore(statements, i));
+          }
+          if (dead) {
+            statements.erase(statements.begin() + i);
+            removed = changed = true;
+            break;
+          }
+        }
+        if (removed) break;
+      }
+    }
+    return changed;
+  }
+
+ public:
+  std::string_view Name() const override { return "dead-code-elimination"; }
+  bool RunOnCfg(IrCfg& cfg) override {
+    bool changed = RemoveUnreachableBlocks(cfg);
+    changed |= RemoveJumpsToNextBlock(cfg);
+    changed |= RemoveDeadStatements(cfg);
+    return changed;
+  }
+};
+
+// Devirtualizes member calls and inlines small methods, see ir_inliner.h.
+// Inlined expressions are left for the following passes to fold.
+class IrInliningPass : public IrCfgPass {
+  std::size_t budget_{kIrInlineBudget};
+
+ public:
+  IrInliningPass() = default;
+  explicit IrInliningPass(std::size_t budget) : budget_(budget) {}
+  std::string_view Name() const override { return "inline"; }
+  bool RunOnCfg(IrCfg& cfg) override {
+    return IrInliner::Run(cfg, budget_) > 0;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// IrSsaPass
+//---------------------------------------------------------------------------//
+// Global optimizations on the SSA form of the program, see ir_ssa.h. The
+// lowered code renames every temporary, so the pass runs once.
+class IrSsaPass : public IrPass {
+  SsaOptions options_;
+
+  static bool SameCode(const IrCode& a, const IrCode& b) {
+    if (a.Size() != b.Size()) return false;
+    return std::equal(a.GetLines().begin(), a.GetLines().end(),
+                      b.GetLines().begin(),
+                      [](const IrLine& lhs, const IrLine& rhs) {
+                        return lhs.op == rhs.op && lhs.args == rhs.args;
+                      });
+  }
+
+ public:
+  IrSsaPass() = default;
+  explicit IrSsaPass(SsaOptions options) : options_(options) {}
+  std::string_view Name() const override { return "ssa"; }
+  bool IsIterative() const override { return false; }
+  bool Run(IrCode& code) override {
+    auto optimized = SsaOptimizer::Optimize(code, options_);
+    if (!optimized || SameCode(code, *optimized)) {
+      return false;
+    }
+    code = std::move(*optimized);
+    return true;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// IrPassManager
+//---------------------------------------------------------------------------//
+struct IrPassTiming {
+  std::string name;
+  bool enabled{true};
+  std::size_t runs{0};
+  std::size_t changes{0};
+  std::size_t lines_before{0};
+  std::size_t lines_after{0};
+  std::chrono::nanoseconds elapsed{0};
+};
+
+// Runs the enabled passes in order until none of them changes the code or
+// the iteration limit is reached. Passes are looked up by their Name().
+class IrPassManager {
+  std::vector<std::unique_ptr<IrPass>> passes_;
+  std::vector<IrPassTiming> timings_;
+  bool verify_each_pass_{true};
+  std::size_t max_iterations_{4};
+
+  IrPassTiming* FindTiming(std::string_view name) {
+    for (auto& timing : timings_) {
+      if (timing.name == name) return &timing;
+    }
+    return nullptr;
+  }
+
+ public:
+  IrPassManager& AddPass(std::unique_ptr<IrPass> pass) {
+    timings_.push_back(IrPassTiming{std::string(pass->Name())});
+    passes_.push_back(std::move(pass));
+    return *this;
+  }
+  template <class PassT, class... ArgTs>
+  IrPassManager& AddPass(ArgTs&&... args) {
+    return AddPass(std::make_unique<PassT>(std::forward<ArgTs>(args)...));
+  }
+
+  // Returns false if no pass has the given name.
+  bool SetEnabled(std::string_view name, bool enabled) {
+    auto timing = FindTiming(name);
+    if (timing == nullptr) return false;
+    timing->enabled = enabled;
+    return true;
+  }
+  bool Enable(std::string_view name) { return SetEnabled(name, true); }
+  bool Disable(std::string_view name) { return SetEnabled(name, false); }
+  bool IsEnabled(std::string_view name) {
+    auto timing = FindTiming(name);
+    return timing != nullptr && timing->enabled;
+  }
+  void SetVerifyEachPass(bool verify) { verify_each_pass_ = verify; }
+  void SetMaxIterations(std::size_t iterations) {
+    max_iterations_ = iterations;
+  }
+
+  // Optimizes code in place. Aborted code is left untouched for the
+  // evaluator to report its error.
+  BoolError Run(IrCode& code) {
+    if (code.isAborted()) {
+      return true;
+    }
+    if (auto verified = IrVerifier::Verify(code); !verified) {
+      return BoolError("[input] " + verified.Error());
+    }
+    for (std::size_t iteration = 0; iteration < max_iterations_; iteration++) {
+      bool changed = false;
+      for (std::size_t i = 0; i < passes_.size(); i++) {
+        auto& timing = timings_[i];
+        if (!timing.enabled) continue;
+        if (iteration > 0 && !passes_[i]->IsIterative()) continue;
+
+        auto lines_before = code.Size();
+        auto start = std::chrono::steady_clock::now();
+        bool pass_changed = passes_[i]->Run(code);
+        timing.elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+        timing.runs++;
+        if (timing.runs == 1) timing.lines_before = lines_before;
+        timing.lines_after = code.Size();
+        if (!pass_changed) continue;
+
+        timing.changes++;
+        changed = true;
+        if (verify_each_pass_) {
+          if (auto verified = IrVerifier::Verify(code); !verified) {
+            return BoolError("[" + timing.name + "] " + verified.Error());
+          }
+        }
+      }
+      if (!changed) break;
+    }
+    return true;
+  }
+
+  const std::vector<IrPassTiming>& Timings() const { return timings_; }
+  void ResetTimings() {
+    for (auto& timing : timings_) {
+      timing = IrPassTiming{timing.name, timing.enabled};
+    }
+  }
+  void PrintTimings(std::ostream& os = std::cout) const {
+    os << "[IR PASS TIMINGS]\n";
+    for (const auto& timing : timings_) {
+      os << "  " << timing.name << (timing.enabled ? "" : " (disabled)")
+         << ": runs=" << timing.runs << " changes=" << timing.changes
+         << " lines=" << timing.lines_before << "->" << timing.lines_after
+         << " time=" << timing.elapsed.count() / 1000.0 << "us\n";
+    }
+  }
+
+  // inline exposes the bodies of small methods to the other passes.
+  // copy-propagation exposes literals to literal-folding, which produces new
+  // copies; local-cse and dead-code-elimination clean up what is left. ssa
+  // then optimizes across blocks, and the local passes tidy its output.
+  static IrPassManager StandardPipeline() {
+    IrPassManager manager;
+    manager.AddPass<IrInliningPass>()
+        .AddPass<IrCopyPropagationPass>()
+        .AddPass<IrLiteralFoldingPass>()
+        .AddPass<IrLocalCsePass>()
+        .AddPass<IrDeadCodeEliminationPass>()
+        .AddPass<IrSsaPass>();
+    return manager;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_optimizer.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_IR_OPTIMIZER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
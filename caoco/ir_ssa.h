@@ -0,0 +1,1889 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_ssa.h
+//---------------------------------------------------------------------------//
+// Brief: SSA form mid level IR, its analyses and global optimizations.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_IR_SSA_H
+#define HEADER_GUARD_CAOCO_COMPILER_IR_SSA_H
+// Includes:
+#include "evaluator.h"
+#include "import_stl.h"
+#include "ir_cfg.h"
+#include "ir_codegen.h"
+
+//=-------------------------------------------------------------------------=//
+// SsaInst / SsaBlock / SsaFunction
+//---------------------------------------------------------------------------//
+// Each program, method and class body is an SsaFunction. Local variables
+// which only their own frame can reach are promoted to SSA values. Globals,
+// members and parameters stay in memory and are accessed by name through
+// kLoad and kStore. Values are the ids of the instructions defining them.
+using SsaId = std::size_t;
+using SsaBlockId = std::size_t;
+
+enum class eSsaOp {
+  kConst,          // [literal]
+  kUndef,          // Value of a variable which was declared without one.
+  kPhi,            // operands[i] flows in from the block incoming[i].
+  kVarLoad,        // [variable] Promoted variable, removed by the SsaBuilder.
+  kVarStore,       // [variable] + value. Removed by the SsaBuilder.
+  kLoad,           // [name]
+  kStore,          // [name] + value
+  kDeclare,        // [type, name] + optional value
+  kBinary,         // lhs, rhs. The BINARY_* op is in ir_op.
+  kNot,            // operand
+  kCall,           // [name] + arguments
+  kCallMember,     // [name] + object, arguments
+  kEnterScope,     //
+  kExitScope,      //
+  kDeclareMethod,  // [name, skip, params...] Body is the function child.
+  kDeclareObject,  // [name, skip] Body is the function child.
+  kJump,           // targets[0]
+  kBranch,         // condition, targets {true, false}
+  kReturn,         // optional value
+  kExit,           // End of the program.
+};
+
+constexpr std::string_view ToStr(eSsaOp op) {
+  switch (op) {
+    case eSsaOp::kConst:
+      return "const";
+    case eSsaOp::kUndef:
+      return "undef";
+    case eSsaOp::kPhi:
+      return "phi";
+    case eSsaOp::kVarLoad:
+      return "var_load";
+    case eSsaOp::kVarStore:
+      return "var_store";
+    case eSsaOp::kLoad:
+      return "load";
+    case eSsaOp::kStore:
+      return "store";
+    case eSsaOp::kDeclare:
+      return "declare";
+    case eSsaOp::kBinary:
+      return "binary";
+    case eSsaOp::kNot:
+      return "not";
+    case eSsaOp::kCall:
+      return "call";
+    case eSsaOp::kCallMember:
+      return "call_member";
+    case eSsaOp::kEnterScope:
+      return "enter_scope";
+    case eSsaOp::kExitScope:
+      return "exit_scope";
+    case eSsaOp::kDeclareMethod:
+      return "declare_method";
+    case eSsaOp::kDeclareObject:
+      return "declare_object";
+    case eSsaOp::kJump:
+      return "jump";
+    case eSsaOp::kBranch:
+      return "branch";
+    case eSsaOp::kReturn:
+      return "return";
+    case eSsaOp::kExit:
+      return "exit";
+    default:
+      return "unknown";
+  }
+}
+
+constexpr bool SsaOpIsTerminator(eSsaOp op) {
+  return op == eSsaOp::kJump || op == eSsaOp::kBranch ||
+         op == eSsaOp::kReturn || op == eSsaOp::kExit;
+}
+
+// Ops without side effects, removed when their value is unused. Like
+// IrOpIsPure, binary ops which may throw count as pure.
+constexpr bool SsaOpIsPure(eSsaOp op) {
+  return op == eSsaOp::kConst || op == eSsaOp::kUndef ||
+         op == eSsaOp::kPhi || op == eSsaOp::kLoad ||
+         op == eSsaOp::kBinary || op == eSsaOp::kNot;
+}
+
+constexpr bool SsaOpHasValue(eSsaOp op) {
+  return SsaOpIsPure(op) || op == eSsaOp::kVarLoad || op == eSsaOp::kCall ||
+         op == eSsaOp::kCallMember;
+}
+
+struct SsaInst {
+  eSsaOp op;
+  std::vector<IrVariant> args{};
+  std::vector<SsaId> operands{};
+  std::vector<SsaBlockId> targets{};   // Successors of a terminator.
+  std::vector<SsaBlockId> incoming{};  // Predecessor of each phi operand.
+  eIrOp ir_op{eIrOp::BINARY_ADD};
+  std::size_t child{0};  // Function index of a declared body.
+  SsaBlockId block{0};
+  bool removed{false};
+};
+
+struct SsaBlock {
+  std::vector<SsaId> insts;  // Phis first, the terminator last.
+  std::vector<SsaBlockId> preds;
+  bool removed{false};
+};
+
+enum class eSsaFunctionKind { kProgram, kMethod, kObject };
+
+struct SsaFunction {
+  std::string name;
+  eSsaFunctionKind kind{eSsaFunctionKind::kProgram};
+  std::vector<SsaBlock> blocks;  // blocks[0] is the entry.
+  std::vector<SsaInst> insts;
+  std::vector<SsaBlockId> layout;  // Order of the blocks in the lowered code.
+  std::size_t var_count{0};        // Promoted variables, before renaming.
+  bool scoped{false};  // A scope declares memory variables, keep the scopes.
+
+  SsaBlockId NewBlock() {
+    blocks.emplace_back();
+    return blocks.size() - 1;
+  }
+
+  SsaId Insert(SsaBlockId block, std::size_t position, SsaInst inst) {
+    inst.block = block;
+    insts.push_back(std::move(inst));
+    auto& list = blocks[block].insts;
+    list.insert(list.begin() + position, insts.size() - 1);
+    return insts.size() - 1;
+  }
+  SsaId Append(SsaBlockId block, SsaInst inst) {
+    return Insert(block, blocks[block].insts.size(), std::move(inst));
+  }
+
+  bool HasTerminator(SsaBlockId block) const {
+    const auto& list = blocks[block].insts;
+    return !list.empty() && SsaOpIsTerminator(insts[list.back()].op);
+  }
+  SsaInst& Terminator(SsaBlockId block) {
+    return insts[blocks[block].insts.back()];
+  }
+  const SsaInst& Terminator(SsaBlockId block) const {
+    return insts[blocks[block].insts.back()];
+  }
+
+  std::vector<SsaBlockId> Successors(SsaBlockId block) const {
+    if (!HasTerminator(block)) return {};
+    auto targets = Terminator(block).targets;
+    if (targets.size() == 2 && targets[0] == targets[1]) targets.pop_back();
+    return targets;
+  }
+
+  std::vector<SsaId> Phis(SsaBlockId block) const {
+    std::vector<SsaId> phis;
+    for (auto id : blocks[block].insts) {
+      if (insts[id].op == eSsaOp::kPhi) phis.push_back(id);
+    }
+    return phis;
+  }
+
+  void RebuildPredecessors() {
+    for (auto& block : blocks) {
+      block.preds.clear();
+    }
+    for (SsaBlockId block = 0; block < blocks.size(); block++) {
+      if (blocks[block].removed) continue;
+      for (auto successor : Successors(block)) {
+        blocks[successor].preds.push_back(block);
+      }
+    }
+  }
+
+  // Sends the edge from -> to through via. Phis are left to the caller.
+  void RedirectEdge(SsaBlockId from, SsaBlockId to, SsaBlockId via) {
+    for (auto& target : Terminator(from).targets) {
+      if (target == to) target = via;
+    }
+  }
+  void RenameIncoming(SsaBlockId block, SsaBlockId from, SsaBlockId to) {
+    for (auto phi : Phis(block)) {
+      for (auto& incoming : insts[phi].incoming) {
+        if (incoming == from) incoming = to;
+      }
+    }
+  }
+  void RemoveIncoming(SsaBlockId block, SsaBlockId from) {
+    for (auto phi : Phis(block)) {
+      auto& inst = insts[phi];
+      for (std::size_t i = inst.incoming.size(); i-- > 0;) {
+        if (inst.incoming[i] != from) continue;
+        inst.incoming.erase(inst.incoming.begin() + i);
+        inst.operands.erase(inst.operands.begin() + i);
+      }
+    }
+  }
+
+  // Moves an instruction in front of the terminator of block.
+  void MoveBeforeTerminator(SsaId id, SsaBlockId block) {
+    auto& from = blocks[insts[id].block].insts;
+    from.erase(std::find(from.begin(), from.end(), id));
+    auto& to = blocks[block].insts;
+    to.insert(HasTerminator(block) ? to.end() - 1 : to.end(), id);
+    insts[id].block = block;
+  }
+
+  void RemoveBlock(SsaBlockId block) {
+    if (blocks[block].removed) return;
+    for (auto successor : Successors(block)) {
+      RemoveIncoming(successor, block);
+    }
+    for (auto id : blocks[block].insts) {
+      insts[id].removed = true;
+    }
+    blocks[block].insts.clear();
+    blocks[block].removed = true;
+    layout.erase(std::remove(layout.begin(), layout.end(), block),
+                 layout.end());
+  }
+
+  // Removes the blocks which can't be reached from the entry block.
+  bool RemoveUnreachableBlocks() {
+    std::vector<bool> reached(blocks.size(), false);
+    std::vector<SsaBlockId> worklist{0};
+    reached[0] = true;
+    while (!worklist.empty()) {
+      auto block = worklist.back();
+      worklist.pop_back();
+      for (auto successor : Successors(block)) {
+        if (reached[successor]) continue;
+        reached[successor] = true;
+        worklist.push_back(successor);
+      }
+    }
+    bool changed = false;
+    for (SsaBlockId block = 0; block < blocks.size(); block++) {
+      if (reached[block] || blocks[block].removed) continue;
+      RemoveBlock(block);
+      changed = true;
+    }
+    RebuildPredecessors();
+    return changed;
+  }
+
+  // Drops the ids of removed instructions from their blocks.
+  void PruneRemoved() {
+    for (auto& block : blocks) {
+      std::erase_if(block.insts, [this](SsaId id) { return insts[id].removed; });
+    }
+  }
+
+  // Rewrites every operand through the replacements, following chains.
+  void ReplaceUses(const std::unordered_map<SsaId, SsaId>& replacements) {
+    if (replacements.empty()) return;
+    for (auto& inst : insts) {
+      if (inst.removed) continue;
+      for (auto& operand : inst.operands) {
+        for (auto it = replacements.find(operand); it != replacements.end();
+             it = replacements.find(operand)) {
+          operand = it->second;
+        }
+      }
+    }
+  }
+
+  void Print(std::ostream& os) const {
+    os << "function " << name << "\n";
+    for (auto block : layout) {
+      os << "  b" << block << ":";
+      for (auto pred : blocks[block].preds) {
+        os << " <- b" << pred;
+      }
+      os << "\n";
+      for (auto id : blocks[block].insts) {
+        const auto& inst = insts[id];
+        os << "    ";
+        if (SsaOpHasValue(inst.op)) os << "v" << id << " = ";
+        os << ToStr(inst.op);
+        if (inst.op == eSsaOp::kBinary) os << " " << ToStr(inst.ir_op);
+        for (const auto& arg : inst.args) {
+          std::visit([&os](auto&& arg) { os << " [" << arg << "]"; }, arg);
+        }
+        for (std::size_t i = 0; i < inst.operands.size(); i++) {
+          os << " v" << inst.operands[i];
+          if (i < inst.incoming.size()) os << ":b" << inst.incoming[i];
+        }
+        for (auto target : inst.targets) {
+          os << " b" << target;
+        }
+        if (inst.op == eSsaOp::kDeclareMethod ||
+            inst.op == eSsaOp::kDeclareObject) {
+          os << " function " << inst.child;
+        }
+        os << "\n";
+      }
+    }
+  }
+};
+
+struct SsaModule {
+  std::vector<SsaFunction> functions;  // functions[0] is the program.
+  bool supported{true};  // False if the code has a construct SSA can't model.
+
+  void Print(std::ostream& os) const {
+    for (const auto& function : functions) {
+      function.Print(os);
+    }
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// SsaUses / SsaDominatorTree / SsaLiveness
+//---------------------------------------------------------------------------//
+// Def-use chains. The use-def direction is SsaInst::operands.
+class SsaUses {
+  std::vector<std::vector<SsaId>> users_;
+
+ public:
+  explicit SsaUses(const SsaFunction& fn) : users_(fn.insts.size()) {
+    for (const auto& block : fn.blocks) {
+      for (auto id : block.insts) {
+        for (auto operand : fn.insts[id].operands) {
+          users_[operand].push_back(id);
+        }
+      }
+    }
+  }
+
+  const std::vector<SsaId>& Users(SsaId value) const { return users_[value]; }
+  std::size_t Count(SsaId value) const { return users_[value].size(); }
+};
+
+// Cooper, Harvey and Kennedy's iterative dominator algorithm. Predecessors
+// of the function must be up to date.
+class SsaDominatorTree {
+  static constexpr SsaBlockId kNone = std::numeric_limits<SsaBlockId>::max();
+  std::vector<SsaBlockId> rpo_;
+  std::vector<std::size_t> rpo_index_;
+  std::vector<SsaBlockId> idom_;
+  std::vector<std::vector<SsaBlockId>> children_;
+  std::vector<std::vector<SsaBlockId>> frontier_;
+
+  SsaBlockId Intersect(SsaBlockId a, SsaBlockId b) const {
+    while (a != b) {
+      while (rpo_index_[a] > rpo_index_[b]) a = idom_[a];
+      while (rpo_index_[b] > rpo_index_[a]) b = idom_[b];
+    }
+    return a;
+  }
+
+ public:
+  explicit SsaDominatorTree(const SsaFunction& fn) {
+    auto count = fn.blocks.size();
+    rpo_index_.assign(count, kNone);
+    idom_.assign(count, kNone);
+    children_.resize(count);
+    frontier_.resize(count);
+
+    std::vector<SsaBlockId> postorder;
+    std::vector<bool> visited(count, false);
+    std::vector<std::pair<SsaBlockId, std::size_t>> stack{{0, 0}};
+    visited[0] = true;
+    while (!stack.empty()) {
+      auto block = stack.back().first;
+      auto successors = fn.Successors(block);
+      if (stack.back().second < successors.size()) {
+        auto successor = successors[stack.back().second++];
+        if (!visited[successor]) {
+          visited[successor] = true;
+          stack.emplace_back(successor, 0);
+        }
+      } else {
+        postorder.push_back(block);
+        stack.pop_back();
+      }
+    }
+    rpo_.assign(postorder.rbegin(), postorder.rend());
+    for (std::size_t i = 0; i < rpo_.size(); i++) {
+      rpo_index_[rpo_[i]] = i;
+    }
+
+    idom_[0] = 0;
+    for (bool changed = true; changed;) {
+      changed = false;
+      for (std::size_t i = 1; i < rpo_.size(); i++) {
+        auto block = rpo_[i];
+        auto new_idom = kNone;
+        for (auto pred : fn.blocks[block].preds) {
+          if (idom_[pred] == kNone) continue;
+          new_idom = new_idom == kNone ? pred : Intersect(pred, new_idom);
+        }
+        if (idom_[block] != new_idom) {
+          idom_[block] = new_idom;
+          changed = true;
+        }
+      }
+    }
+
+    for (auto block : rpo_) {
+      if (block != 0) children_[idom_[block]].push_back(block);
+    }
+    for (auto block : rpo_) {
+      const auto& preds = fn.blocks[block].preds;
+      if (preds.size() < 2) continue;
+      for (auto pred : preds) {
+        if (!Reachable(pred)) continue;
+        for (auto runner = pred; runner != idom_[block]; runner = idom_[runner]) {
+          auto& frontier = frontier_[runner];
+          if (std::find(frontier.begin(), frontier.end(), block) ==
+              frontier.end()) {
+            frontier.push_back(block);
+          }
+        }
+      }
+    }
+  }
+
+  const std::vector<SsaBlockId>& ReversePostorder() const { return rpo_; }
+  bool Reachable(SsaBlockId block) const { return rpo_index_[block] != kNone; }
+  SsaBlockId Idom(SsaBlockId block) const { return idom_[block]; }
+  const std::vector<SsaBlockId>& Children(SsaBlockId block) const {
+    return children_[block];
+  }
+  const std::vector<SsaBlockId>& Frontier(SsaBlockId block) const {
+    return frontier_[block];
+  }
+  bool Dominates(SsaBlockId a, SsaBlockId b) const {
+    if (!Reachable(b)) return false;
+    while (a != b) {
+      if (b == 0) return false;
+      b = idom_[b];
+    }
+    return true;
+  }
+};
+
+// Values live on entry to and exit from each block. A phi is defined at the
+// top of its block, its operands are live out of the matching predecessor.
+class SsaLiveness {
+  std::vector<std::vector<bool>> live_in_;
+  std::vector<std::vector<bool>> live_out_;
+
+ public:
+  explicit SsaLiveness(const SsaFunction& fn) {
+    auto values = fn.insts.size();
+    live_in_.assign(fn.blocks.size(), std::vector<bool>(values, false));
+    live_out_ = live_in_;
+    for (bool changed = true; changed;) {
+      changed = false;
+      for (auto block = fn.blocks.size(); block-- > 0;) {
+        if (fn.blocks[block].removed) continue;
+        std::vector<bool> live(values, false);
+        for (auto successor : fn.Successors(block)) {
+          for (std::size_t value = 0; value < values; value++) {
+            if (live_in_[successor][value]) live[value] = true;
+          }
+          for (auto phi : fn.Phis(successor)) {
+            const auto& inst = fn.insts[phi];
+            for (std::size_t i = 0; i < inst.incoming.size(); i++) {
+              if (inst.incoming[i] == block) live[inst.operands[i]] = true;
+            }
+          }
+        }
+        auto live_out = live;
+        const auto& insts = fn.blocks[block].insts;
+        for (auto id = insts.rbegin(); id != insts.rend(); id++) {
+          const auto& inst = fn.insts[*id];
+          live[*id] = false;
+          if (inst.op == eSsaOp::kPhi) continue;
+          for (auto operand : inst.operands) {
+            live[operand] = true;
+          }
+        }
+        if (live != live_in_[block] || live_out != live_out_[block]) {
+          live_in_[block] = std::move(live);
+          live_out_[block] = std::move(live_out);
+          changed = true;
+        }
+      }
+    }
+  }
+
+  bool IsLiveIn(SsaId value, SsaBlockId block) const {
+    return live_in_[block][value];
+  }
+  bool IsLiveOut(SsaId value, SsaBlockId block) const {
+    return live_out_[block][value];
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// SsaBuilder
+//---------------------------------------------------------------------------//
+// Builds the SSA form of verified IR. Variable names are resolved with the
+// lexical scopes of the IR, then promoted variables are renamed into values
+// with phis at the iterated dominance frontier of their stores. Promoted are
+// the temporaries, the locals of methods and the locals of nested scopes of
+// the program. Declarations with a type constraint stay in memory.
+class SsaBuilder {
+  struct Scope {
+    bool promote;
+    // Promoted variable of each name, nullopt for memory variables.
+    std::unordered_map<std::string, std::optional<std::size_t>> names;
+  };
+  static constexpr SsaBlockId kUnmapped =
+      std::numeric_limits<SsaBlockId>::max();
+
+  const IrCfg& cfg_;
+  SsaModule& module_;
+  std::size_t fn_index_{0};
+  std::vector<Scope> scopes_;
+  std::vector<SsaBlockId> block_map_;  // IrCfg block -> SsaBlock.
+  SsaBlockId cur_{0};
+
+  SsaBuilder(const IrCfg& cfg, SsaModule& module)
+      : cfg_(cfg), module_(module) {}
+
+  // Only valid until a nested body is built, which may grow the module.
+  SsaFunction& Fn() { return module_.functions[fn_index_]; }
+
+  SsaId Add(SsaInst inst) { return Fn().Append(cur_, std::move(inst)); }
+  SsaId AddJump(SsaBlockId target) {
+    SsaInst jump{eSsaOp::kJump};
+    jump.targets = {target};
+    return Add(std::move(jump));
+  }
+
+  SsaBlockId Map(std::size_t cfg_block) {
+    auto block = block_map_.at(cfg_block);
+    if (block == kUnmapped) {
+      // Control leaves the body, which IrGen never emits.
+      module_.supported = false;
+      return block_map_.back();
+    }
+    return block;
+  }
+
+  std::optional<std::size_t> Resolve(const std::string& name) const {
+    for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); scope++) {
+      if (auto it = scope->names.find(name); it != scope->names.end()) {
+        return it->second;
+      }
+    }
+    return std::nullopt;
+  }
+
+  static std::size_t Var(const SsaInst& inst) {
+    return static_cast<std::size_t>(std::get<IrInt>(inst.args[0]));
+  }
+
+  // An operand which can be evaluated without side effects or errors.
+  bool IsSafeOperand(const IrNode& node) const {
+    return node.op == eIrOp::ALLOCATE_LITERAL ||
+           (node.op == eIrOp::LOAD_VARIABLE && Resolve(node.Name()));
+  }
+
+  SsaId Expr(const IrNode& node) {
+    switch (node.op) {
+      case eIrOp::ALLOCATE_LITERAL:
+        return Add(SsaInst{eSsaOp::kConst, node.args});
+      case eIrOp::LOAD_VARIABLE:
+        if (auto var = Resolve(node.Name())) {
+          return Add(SsaInst{eSsaOp::kVarLoad, {static_cast<IrInt>(*var)}});
+        }
+        return Add(SsaInst{eSsaOp::kLoad, node.args});
+      case eIrOp::UNARY_NOT: {
+        auto operand = Expr(node.operands[0]);
+        return Add(SsaInst{eSsaOp::kNot, {}, {operand}});
+      }
+      case eIrOp::CALL:
+      case eIrOp::CALL_MEMBER: {
+        std::vector<SsaId> operands;
+        for (const auto& operand : node.operands) {
+          operands.push_back(Expr(operand));
+        }
+        return Add(SsaInst{node.op == eIrOp::CALL ? eSsaOp::kCall
+                                                  : eSsaOp::kCallMember,
+                           node.args, std::move(operands)});
+      }
+      case eIrOp::BINARY_AND:
+      case eIrOp::BINARY_OR:
+        if (!IsSafeOperand(node.operands[1])) return ShortCircuit(node);
+        [[fallthrough]];
+      default: {
+        auto lhs = Expr(node.operands[0]);
+        auto rhs = Expr(node.operands[1]);
+        SsaInst binary{eSsaOp::kBinary, {}, {lhs, rhs}};
+        binary.ir_op = node.op;
+        return Add(std::move(binary));
+      }
+    }
+  }
+
+  // The rhs of && and || only runs when the lhs doesn't decide the result.
+  SsaId ShortCircuit(const IrNode& node) {
+    bool is_and = node.op == eIrOp::BINARY_AND;
+    auto lhs = Expr(node.operands[0]);
+    auto lhs_end = cur_;
+    auto rhs_block = Fn().NewBlock();
+    auto join = Fn().NewBlock();
+    auto& layout = Fn().layout;
+    layout.insert(std::find(layout.begin(), layout.end(), cur_) + 1,
+                  {rhs_block, join});
+
+    SsaInst branch{eSsaOp::kBranch, {}, {lhs}};
+    branch.targets = is_and ? std::vector<SsaBlockId>{rhs_block, join}
+                            : std::vector<SsaBlockId>{join, rhs_block};
+    Add(std::move(branch));
+
+    cur_ = rhs_block;
+    auto rhs = Expr(node.operands[1]);
+    SsaInst binary{eSsaOp::kBinary, {}, {lhs, rhs}};
+    binary.ir_op = node.op;
+    auto result = Add(std::move(binary));
+    auto rhs_end = cur_;
+    AddJump(join);
+
+    cur_ = join;
+    SsaInst phi{eSsaOp::kPhi, {}, {lhs, result}};
+    phi.incoming = {lhs_end, rhs_end};
+    return Add(std::move(phi));
+  }
+
+  void Declare(const IrNode& node) {
+    auto type = std::get<IrInt>(node.args[0]);
+    const auto& name = node.Name();
+    std::optional<SsaId> value;
+    if (!node.operands.empty()) value = Expr(node.operands[0]);
+
+    if (name.starts_with(kIrTempPrefix) ||
+        (scopes_.back().promote && type == kIrTypeConstraintAny)) {
+      auto var = Fn().var_count++;
+      scopes_.back().names[name] = var;
+      auto stored = value ? *value : Add(SsaInst{eSsaOp::kUndef});
+      Add(SsaInst{eSsaOp::kVarStore, {static_cast<IrInt>(var)}, {stored}});
+      return;
+    }
+    scopes_.back().names[name] = std::nullopt;
+    if (scopes_.size() > 1) Fn().scoped = true;
+    SsaInst declare{eSsaOp::kDeclare, node.args};
+    if (value) declare.operands.push_back(*value);
+    Add(std::move(declare));
+  }
+
+  void Define(const IrNode& node) {
+    auto value = Expr(node.operands[0]);
+    if (auto var = Resolve(node.Name())) {
+      Add(SsaInst{eSsaOp::kVarStore, {static_cast<IrInt>(*var)}, {value}});
+    } else {
+      Add(SsaInst{eSsaOp::kStore, node.args, {value}});
+    }
+  }
+
+  void DeclareBody(std::size_t block, const IrNode& declaration) {
+    bool method = declaration.op == eIrOp::DECLARE_METHOD;
+    auto skip = IrCfg::Target(declaration);
+    auto child =
+        SsaBuilder(cfg_, module_)
+            .BuildFunction(block + 1, skip,
+                           method ? eSsaFunctionKind::kMethod
+                                  : eSsaFunctionKind::kObject,
+                           std::get<IrString>(declaration.args[0]));
+    SsaInst declare{method ? eSsaOp::kDeclareMethod : eSsaOp::kDeclareObject,
+                    declaration.args};
+    declare.child = child;
+    Add(std::move(declare));
+    AddJump(Map(skip));
+  }
+
+  void TranslateBlock(std::size_t block) {
+    for (const auto& statement : cfg_.Blocks()[block].statements) {
+      switch (statement.op) {
+        case eIrOp::ENTER_PROGRAM_DEFINITION:
+          break;
+        case eIrOp::DECLARE_VARIABLE:
+          Declare(statement);
+          break;
+        case eIrOp::DEFINE_VARIABLE:
+          Define(statement);
+          break;
+        case eIrOp::ENTER_SCOPE:
+          scopes_.push_back(Scope{true, {}});
+          Add(SsaInst{eSsaOp::kEnterScope});
+          break;
+        case eIrOp::EXIT_SCOPE:
+          if (scopes_.size() > 1) scopes_.pop_back();
+          Add(SsaInst{eSsaOp::kExitScope});
+          break;
+        case eIrOp::JUMP:
+          AddJump(Map(IrCfg::Target(statement)));
+          return;
+        case eIrOp::JUMP_IF_FALSE: {
+          auto condition = Expr(statement.operands[0]);
+          SsaInst branch{eSsaOp::kBranch, {}, {condition}};
+          branch.targets = {Map(block + 1), Map(IrCfg::Target(statement))};
+          Add(std::move(branch));
+          return;
+        }
+        case eIrOp::RETURN:
+        case eIrOp::TAIL_CALL: {
+          SsaInst ret{eSsaOp::kReturn};
+          ret.ir_op = statement.op;  // Kept through to the lowered code.
+          if (!statement.operands.empty()) {
+            ret.operands.push_back(Expr(statement.operands[0]));
+          }
+          Add(std::move(ret));
+          return;
+        }
+        case eIrOp::DECLARE_METHOD:
+        case eIrOp::DECLARE_OBJECT:
+          DeclareBody(block, statement);
+          return;
+        case eIrOp::ABORT_AND_ERROR:
+          module_.supported = false;
+          Add(SsaInst{eSsaOp::kReturn});
+          return;
+        default:
+          Expr(statement);  // Expression statement.
+          break;
+      }
+    }
+    AddJump(Map(block + 1));
+  }
+
+  // Builds the blocks [begin, end) of the IrCfg, skipping nested bodies.
+  std::size_t BuildFunction(std::size_t begin, std::size_t end,
+                            eSsaFunctionKind kind, const std::string& name) {
+    fn_index_ = module_.functions.size();
+    module_.functions.emplace_back();
+    Fn().name = name;
+    Fn().kind = kind;
+
+    auto entry = Fn().NewBlock();
+    block_map_.assign(cfg_.End() + 1, kUnmapped);
+    std::vector<std::size_t> order;
+    for (auto block = begin; block < end;) {
+      order.push_back(block);
+      block_map_[block] = Fn().NewBlock();
+      const auto& statements = cfg_.Blocks()[block].statements;
+      bool declaration =
+          !statements.empty() &&
+          (statements.back().op == eIrOp::DECLARE_METHOD ||
+           statements.back().op == eIrOp::DECLARE_OBJECT);
+      block = declaration ? IrCfg::Target(statements.back()) : block + 1;
+    }
+    auto exit = Fn().NewBlock();
+    block_map_[end] = exit;
+    Fn().layout.push_back(entry);
+    for (auto block : order) {
+      Fn().layout.push_back(block_map_[block]);
+    }
+    Fn().layout.push_back(exit);
+
+    cur_ = entry;
+    AddJump(Map(begin));
+    scopes_ = {Scope{kind == eSsaFunctionKind::kMethod, {}}};
+    for (auto block : order) {
+      cur_ = block_map_[block];
+      TranslateBlock(block);
+    }
+    cur_ = exit;
+    Add(SsaInst{kind == eSsaFunctionKind::kProgram ? eSsaOp::kExit
+                                                   : eSsaOp::kReturn});
+    PromoteVariables();
+    return fn_index_;
+  }
+
+  static void Rename(SsaFunction& fn, const SsaDominatorTree& dom,
+                     SsaBlockId block,
+                     const std::vector<std::map<std::size_t, SsaId>>& var_phis,
+                     std::vector<std::vector<SsaId>>& stacks,
+                     std::unordered_map<SsaId, SsaId>& replacements) {
+    auto resolve = [&replacements](SsaId id) {
+      for (auto it = replacements.find(id); it != replacements.end();
+           it = replacements.find(id)) {
+        id = it->second;
+      }
+      return id;
+    };
+    std::vector<std::size_t> pushed;
+    for (auto id : fn.blocks[block].insts) {
+      auto& inst = fn.insts[id];
+      if (inst.op == eSsaOp::kPhi && !inst.args.empty()) {
+        stacks[Var(inst)].push_back(id);
+        pushed.push_back(Var(inst));
+      } else if (inst.op == eSsaOp::kVarLoad) {
+        replacements[id] = stacks[Var(inst)].back();
+        inst.removed = true;
+      } else if (inst.op == eSsaOp::kVarStore) {
+        stacks[Var(inst)].push_back(resolve(inst.operands[0]));
+        pushed.push_back(Var(inst));
+        inst.removed = true;
+      }
+    }
+    for (auto successor : fn.Successors(block)) {
+      for (const auto& [var, phi] : var_phis[successor]) {
+        fn.insts[phi].operands.push_back(stacks[var].back());
+        fn.insts[phi].incoming.push_back(block);
+      }
+    }
+    for (auto child : dom.Children(block)) {
+      Rename(fn, dom, child, var_phis, stacks, replacements);
+    }
+    for (auto var : pushed) {
+      stacks[var].pop_back();
+    }
+  }
+
+  void PromoteVariables() {
+    auto& fn = Fn();
+    fn.RemoveUnreachableBlocks();
+    SsaDominatorTree dom(fn);
+    auto undef = fn.Insert(0, 0, SsaInst{eSsaOp::kUndef});
+
+    std::vector<std::vector<SsaBlockId>> def_blocks(fn.var_count);
+    for (SsaBlockId block = 0; block < fn.blocks.size(); block++) {
+      for (auto id : fn.blocks[block].insts) {
+        if (fn.insts[id].op == eSsaOp::kVarStore) {
+          def_blocks[Var(fn.insts[id])].push_back(block);
+        }
+      }
+    }
+    std::vector<std::map<std::size_t, SsaId>> var_phis(fn.blocks.size());
+    for (std::size_t var = 0; var < fn.var_count; var++) {
+      auto worklist = def_blocks[var];
+      while (!worklist.empty()) {
+        auto block = worklist.back();
+        worklist.pop_back();
+        for (auto frontier : dom.Frontier(block)) {
+          if (var_phis[frontier].count(var)) continue;
+          var_phis[frontier][var] = fn.Insert(
+              frontier, 0, SsaInst{eSsaOp::kPhi, {static_cast<IrInt>(var)}});
+          worklist.push_back(frontier);
+        }
+      }
+    }
+
+    std::vector<std::vector<SsaId>> stacks(fn.var_count,
+                                           std::vector<SsaId>{undef});
+    std::unordered_map<SsaId, SsaId> replacements;
+    Rename(fn, dom, 0, var_phis, stacks, replacements);
+    fn.ReplaceUses(replacements);
+    for (auto& inst : fn.insts) {
+      if (inst.op == eSsaOp::kPhi) inst.args.clear();
+    }
+    fn.PruneRemoved();
+  }
+
+ public:
+  static SsaModule Build(const IrCode& code) {
+    auto cfg = IrCfg::Decode(code);
+    SsaModule module;
+    SsaBuilder(cfg, module)
+        .BuildFunction(0, cfg.End(), eSsaFunctionKind::kProgram, "program");
+    return module;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// SsaDeadCodeElimination
+//---------------------------------------------------------------------------//
+// Removes pure instructions whose values never reach a side effect,
+// including cycles of phis which only feed each other.
+class SsaDeadCodeElimination {
+ public:
+  static bool Run(SsaFunction& fn) {
+    std::vector<bool> live(fn.insts.size(), false);
+    std::vector<SsaId> worklist;
+    for (const auto& block : fn.blocks) {
+      for (auto id : block.insts) {
+        if (SsaOpIsPure(fn.insts[id].op)) continue;
+        live[id] = true;
+        worklist.push_back(id);
+      }
+    }
+    while (!worklist.empty()) {
+      auto id = worklist.back();
+      worklist.pop_back();
+      for (auto operand : fn.insts[id].operands) {
+        if (live[operand]) continue;
+        live[operand] = true;
+        worklist.push_back(operand);
+      }
+    }
+    bool changed = false;
+    for (auto& block : fn.blocks) {
+      std::erase_if(block.insts, [&](SsaId id) {
+        if (live[id]) return false;
+        fn.insts[id].removed = true;
+        changed = true;
+        return true;
+      });
+    }
+    return changed;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// SsaSccp
+//---------------------------------------------------------------------------//
+// Wegman and Zadeck's sparse conditional constant propagation. Values are
+// folded with the runtime operators, branches on constants become jumps and
+// the blocks they no longer reach are removed.
+class SsaSccp {
+  enum class eState { kTop, kConst, kBottom };
+  struct Cell {
+    eState state{eState::kTop};
+    IrVariant value{};
+  };
+
+  SsaFunction& fn_;
+  SsaUses uses_;
+  std::vector<Cell> cells_;
+  std::vector<bool> executable_;
+  std::set<std::pair<SsaBlockId, SsaBlockId>> edges_;
+  std::vector<std::pair<SsaBlockId, SsaBlockId>> flow_worklist_;
+  std::vector<SsaId> value_worklist_;
+
+  explicit SsaSccp(SsaFunction& fn)
+      : fn_(fn),
+        uses_(fn),
+        cells_(fn.insts.size()),
+        executable_(fn.blocks.size(), false) {}
+
+  static Cell Meet(const Cell& a, const Cell& b) {
+    if (a.state == eState::kTop) return b;
+    if (b.state == eState::kTop) return a;
+    if (a.state == eState::kConst && b.state == eState::kConst &&
+        a.value == b.value) {
+      return a;
+    }
+    return Cell{eState::kBottom};
+  }
+
+  bool EdgeExecutable(SsaBlockId from, SsaBlockId to) const {
+    return edges_.count({from, to}) > 0;
+  }
+
+  Cell Evaluate(const SsaInst& inst) const {
+    switch (inst.op) {
+      case eSsaOp::kConst:
+        return Cell{eState::kConst, inst.args[0]};
+      case eSsaOp::kPhi: {
+        Cell result;
+        for (std::size_t i = 0; i < inst.operands.size(); i++) {
+          if (EdgeExecutable(inst.incoming[i], inst.block)) {
+            result = Meet(result, cells_[inst.operands[i]]);
+          }
+        }
+        return result;
+      }
+      case eSsaOp::kNot: {
+        const auto& operand = cells_[inst.operands[0]];
+        if (operand.state != eState::kConst) return Cell{operand.state};
+        if (!std::holds_alternative<IrBool>(operand.value)) {
+          return Cell{eState::kBottom};
+        }
+        return Cell{eState::kConst,
+                    IrBool{!std::get<IrBool>(operand.value).value}};
+      }
+      case eSsaOp::kBinary: {
+        const auto& lhs = cells_[inst.operands[0]];
+        const auto& rhs = cells_[inst.operands[1]];
+        if (lhs.state == eState::kBottom || rhs.state == eState::kBottom) {
+          return Cell{eState::kBottom};
+        }
+        if (lhs.state == eState::kTop || rhs.state == eState::kTop) {
+          return Cell{eState::kTop};
+        }
+        try {
+          auto folded = RtValToIrLiteral(
+              Evaluator::ApplyBinaryOp(inst.ir_op, IrLiteralToRtVal(lhs.value),
+                                       IrLiteralToRtVal(rhs.value)));
+          if (folded) return Cell{eState::kConst, *folded};
+        } catch (const std::runtime_error&) {
+          // Left for the runtime to report.
+        }
+        return Cell{eState::kBottom};
+      }
+      default:
+        return Cell{eState::kBottom};
+    }
+  }
+
+  void Lower(SsaId id, Cell cell) {
+    auto& current = cells_[id];
+    if (current.state == eState::kBottom) return;
+    if (current.state == eState::kConst && cell.state == eState::kConst &&
+        current.value != cell.value) {
+      cell = Cell{eState::kBottom};
+    }
+    if (current.state == cell.state &&
+        (cell.state != eState::kConst || current.value == cell.value)) {
+      return;
+    }
+    current = cell;
+    value_worklist_.push_back(id);
+  }
+
+  void Visit(SsaId id) {
+    const auto& inst = fn_.insts[id];
+    switch (inst.op) {
+      case eSsaOp::kJump:
+        flow_worklist_.emplace_back(inst.block, inst.targets[0]);
+        return;
+      case eSsaOp::kBranch: {
+        const auto& condition = cells_[inst.operands[0]];
+        if (condition.state == eState::kTop) return;
+        if (condition.state == eState::kConst &&
+            std::holds_alternative<IrBool>(condition.value)) {
+          auto taken = std::get<IrBool>(condition.value).value ? 0 : 1;
+          flow_worklist_.emplace_back(inst.block, inst.targets[taken]);
+          return;
+        }
+        flow_worklist_.emplace_back(inst.block, inst.targets[0]);
+        flow_worklist_.emplace_back(inst.block, inst.targets[1]);
+        return;
+      }
+      default:
+        if (SsaOpHasValue(inst.op)) Lower(id, Evaluate(inst));
+        return;
+    }
+  }
+
+  void Solve() {
+    executable_[0] = true;
+    for (auto id : fn_.blocks[0].insts) {
+      Visit(id);
+    }
+    while (!flow_worklist_.empty() || !value_worklist_.empty()) {
+      while (!flow_worklist_.empty()) {
+        auto edge = flow_worklist_.back();
+        flow_worklist_.pop_back();
+        if (!edges_.insert(edge).second) continue;
+        auto block = edge.second;
+        bool first_visit = !executable_[block];
+        executable_[block] = true;
+        for (auto id : fn_.blocks[block].insts) {
+          if (first_visit || fn_.insts[id].op == eSsaOp::kPhi) Visit(id);
+        }
+      }
+      while (!value_worklist_.empty()) {
+        auto id = value_worklist_.back();
+        value_worklist_.pop_back();
+        for (auto user : uses_.Users(id)) {
+          if (executable_[fn_.insts[user].block]) Visit(user);
+        }
+      }
+    }
+  }
+
+  bool Apply() {
+    bool changed = false;
+    for (SsaBlockId block = 0; block < fn_.blocks.size(); block++) {
+      if (!executable_[block]) continue;
+      for (auto id : fn_.blocks[block].insts) {
+        auto& inst = fn_.insts[id];
+        bool foldable = inst.op == eSsaOp::kBinary ||
+                        inst.op == eSsaOp::kNot || inst.op == eSsaOp::kPhi;
+        if (!foldable || cells_[id].state != eState::kConst) continue;
+        inst.op = eSsaOp::kConst;
+        inst.args = {cells_[id].value};
+        inst.operands.clear();
+        inst.incoming.clear();
+        changed = true;
+      }
+      auto& terminator = fn_.Terminator(block);
+      if (terminator.op != eSsaOp::kBranch) continue;
+      const auto& condition = cells_[terminator.operands[0]];
+      if (condition.state != eState::kConst ||
+          !std::holds_alternative<IrBool>(condition.value)) {
+        continue;
+      }
+      bool value = std::get<IrBool>(condition.value).value;
+      auto taken = terminator.targets[value ? 0 : 1];
+      auto other = terminator.targets[value ? 1 : 0];
+      if (other != taken) fn_.RemoveIncoming(other, block);
+      terminator.op = eSsaOp::kJump;
+      terminator.operands.clear();
+      terminator.targets = {taken};
+      changed = true;
+    }
+    for (SsaBlockId block = 0; block < fn_.blocks.size(); block++) {
+      if (executable_[block] || fn_.blocks[block].removed) continue;
+      fn_.RemoveBlock(block);
+      changed = true;
+    }
+    for (SsaBlockId block = 0; block < fn_.blocks.size(); block++) {
+      for (auto phi : fn_.Phis(block)) {
+        auto& inst = fn_.insts[phi];
+        for (std::size_t i = inst.incoming.size(); i-- > 0;) {
+          if (EdgeExecutable(inst.incoming[i], block)) continue;
+          inst.incoming.erase(inst.incoming.begin() + i);
+          inst.operands.erase(inst.operands.begin() + i);
+          changed = true;
+        }
+      }
+    }
+    fn_.RebuildPredecessors();
+    return changed;
+  }
+
+ public:
+  static bool Run(SsaFunction& fn) {
+    SsaSccp sccp(fn);
+    sccp.Solve();
+    return sccp.Apply();
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// SsaGvn
+//---------------------------------------------------------------------------//
+// Dominator based global value numbering. A pure value equal to one which
+// dominates it is replaced, as is a phi whose inputs are all the same value.
+class SsaGvn {
+  using Replacements = std::unordered_map<SsaId, SsaId>;
+
+  static SsaId Resolve(const Replacements& replacements, SsaId id) {
+    for (auto it = replacements.find(id); it != replacements.end();
+         it = replacements.find(id)) {
+      id = it->second;
+    }
+    return id;
+  }
+
+  static std::optional<std::string> Key(const SsaInst& inst,
+                                        const Replacements& replacements) {
+    std::string key{ToStr(inst.op)};
+    switch (inst.op) {
+      case eSsaOp::kConst:
+        return key + IrTree::Key(IrNode{eIrOp::ALLOCATE_LITERAL, inst.args});
+      case eSsaOp::kBinary:
+        key += ToStr(inst.ir_op);
+        break;
+      case eSsaOp::kNot:
+        break;
+      case eSsaOp::kPhi: {
+        // Phis of one block are equal if they merge the same values.
+        std::vector<std::pair<SsaBlockId, SsaId>> inputs;
+        for (std::size_t i = 0; i < inst.operands.size(); i++) {
+          inputs.emplace_back(inst.incoming[i],
+                              Resolve(replacements, inst.operands[i]));
+        }
+        std::sort(inputs.begin(), inputs.end());
+        key += "b" + std::to_string(inst.block);
+        for (const auto& [block, value] : inputs) {
+          key += " b" + std::to_string(block) + ":v" + std::to_string(value);
+        }
+        return key;
+      }
+      default:
+        return std::nullopt;
+    }
+    for (auto operand : inst.operands) {
+      key += " v" + std::to_string(Resolve(replacements, operand));
+    }
+    return key;
+  }
+
+  static void Visit(SsaFunction& fn, const SsaDominatorTree& dom,
+                    SsaBlockId block,
+                    std::unordered_map<std::string, SsaId>& table,
+                    Replacements& replacements, bool& changed) {
+    std::vector<std::string> added;
+    for (auto id : fn.blocks[block].insts) {
+      auto& inst = fn.insts[id];
+      if (inst.op == eSsaOp::kPhi) {
+        std::optional<SsaId> same;
+        bool trivial = true;
+        for (auto operand : inst.operands) {
+          operand = Resolve(replacements, operand);
+          if (operand == id) continue;
+          if (same && *same != operand) {
+            trivial = false;
+            break;
+          }
+          same = operand;
+        }
+        if (trivial && same) {
+          replacements[id] = *same;
+          inst.removed = true;
+          changed = true;
+          continue;
+        }
+      }
+      auto key = Key(inst, replacements);
+      if (!key) continue;
+      if (auto it = table.find(*key); it != table.end()) {
+        replacements[id] = it->second;
+        inst.removed = true;
+        changed = true;
+      } else {
+        table.emplace(*key, id);
+        added.push_back(std::move(*key));
+      }
+    }
+    for (auto child : dom.Children(block)) {
+      Visit(fn, dom, child, table, replacements, changed);
+    }
+    for (const auto& key : added) {
+      table.erase(key);
+    }
+  }
+
+ public:
+  static bool Run(SsaFunction& fn) {
+    fn.RebuildPredecessors();
+    SsaDominatorTree dom(fn);
+    std::unordered_map<std::string, SsaId> table;
+    Replacements replacements;
+    bool changed = false;
+    Visit(fn, dom, 0, table, replacements, changed);
+    fn.ReplaceUses(replacements);
+    fn.PruneRemoved();
+    return changed;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// SsaKinds / SsaLoops / SsaLicm
+//---------------------------------------------------------------------------//
+// Runtime type of each value, as far as the function alone shows it. Used to
+// prove that an operation can't throw.
+class SsaKinds {
+ public:
+  enum eKind { kUnknown, kInt, kDouble, kBool, kString, kAny };
+
+ private:
+  std::vector<eKind> kinds_;
+
+  static eKind Join(eKind a, eKind b) {
+    if (a == kUnknown) return b;
+    if (b == kUnknown) return a;
+    return a == b ? a : kAny;
+  }
+
+  static eKind OfLiteral(const IrVariant& literal) {
+    return std::visit(
+        [](auto&& arg) -> eKind {
+          using T = std::decay_t<decltype(arg)>;
+          if constexpr (std::is_same_v<T, IrInt>) {
+            return kInt;
+          } else if constexpr (std::is_same_v<T, IrDouble>) {
+            return kDouble;
+          } else if constexpr (std::is_same_v<T, IrBool>) {
+            return kBool;
+          } else {
+            return kString;
+          }
+        },
+        literal);
+  }
+
+  // Matches the operators of RtVal, kAny where they throw.
+  static eKind OfBinary(eIrOp op, eKind lhs, eKind rhs) {
+    if (lhs == kUnknown || rhs == kUnknown) return kUnknown;
+    if (lhs != rhs || lhs == kAny) return kAny;
+    switch (op) {
+      case eIrOp::BINARY_ADD:
+        return lhs == kBool ? kAny : lhs;
+      case eIrOp::BINARY_SUB:
+      case eIrOp::BINARY_MUL:
+      case eIrOp::BINARY_DIV:
+        return lhs == kInt || lhs == kDouble ? lhs : kAny;
+      case eIrOp::BINARY_MOD:
+        return lhs == kInt ? kInt : kAny;
+      case eIrOp::BINARY_AND:
+      case eIrOp::BINARY_OR:
+        return lhs == kBool ? kBool : kAny;
+      default:
+        return kBool;  // Comparisons.
+    }
+  }
+
+ public:
+  explicit SsaKinds(const SsaFunction& fn) : kinds_(fn.insts.size(), kUnknown) {
+    for (bool changed = true; changed;) {
+      changed = false;
+      for (const auto& block : fn.blocks) {
+        for (auto id : block.insts) {
+          const auto& inst = fn.insts[id];
+          if (!SsaOpHasValue(inst.op)) continue;
+          auto kind = kAny;
+          switch (inst.op) {
+            case eSsaOp::kConst:
+              kind = OfLiteral(inst.args[0]);
+              break;
+            case eSsaOp::kPhi:
+              kind = kUnknown;
+              for (auto operand : inst.operands) {
+                kind = Join(kind, kinds_[operand]);
+              }
+              break;
+            case eSsaOp::kNot: {
+              auto operand = kinds_[inst.operands[0]];
+              kind = operand == kUnknown ? kUnknown
+                                         : (operand == kBool ? kBool : kAny);
+            } break;
+            case eSsaOp::kBinary:
+              kind = OfBinary(inst.ir_op, kinds_[inst.operands[0]],
+                              kinds_[inst.operands[1]]);
+              break;
+            default:
+              break;
+          }
+          if (kind != kinds_[id]) {
+            kinds_[id] = kind;
+            changed = true;
+          }
+        }
+      }
+    }
+  }
+
+  eKind Kind(SsaId value) const {
+    return kinds_[value] == kUnknown ? kAny : kinds_[value];
+  }
+
+  bool CanThrow(const SsaFunction& fn, const SsaInst& inst) const {
+    switch (inst.op) {
+      case eSsaOp::kConst:
+        return false;
+      case eSsaOp::kNot:
+        return Kind(inst.operands[0]) != kBool;
+      case eSsaOp::kBinary: {
+        auto lhs = Kind(inst.operands[0]);
+        if (OfBinary(inst.ir_op, lhs, Kind(inst.operands[1])) == kAny) {
+          return true;
+        }
+        if (lhs == kInt && (inst.ir_op == eIrOp::BINARY_DIV ||
+                            inst.ir_op == eIrOp::BINARY_MOD)) {
+          const auto& divisor = fn.insts[inst.operands[1]];
+          return divisor.op != eSsaOp::kConst ||
+                 std::get<IrInt>(divisor.args[0]) == 0;
+        }
+        return false;
+      }
+      default:
+        return true;
+    }
+  }
+};
+
+// A natural loop: the header and the blocks which reach a back edge to it
+// without passing through the header.
+struct SsaLoop {
+  SsaBlockId header;
+  std::vector<bool> body;
+  std::size_t size{0};
+};
+
+class SsaLoops {
+ public:
+  // Inner loops first.
+  static std::vector<SsaLoop> Find(const SsaFunction& fn,
+                                   const SsaDominatorTree& dom) {
+    std::map<SsaBlockId, SsaLoop> loops;
+    for (auto latch : dom.ReversePostorder()) {
+      for (auto header : fn.Successors(latch)) {
+        if (!dom.Dominates(header, latch)) continue;
+        auto [it, inserted] = loops.try_emplace(
+            header, SsaLoop{header, std::vector<bool>(fn.blocks.size())});
+        auto& loop = it->second;
+        if (inserted) {
+          loop.body[header] = true;
+          loop.size = 1;
+        }
+        std::vector<SsaBlockId> worklist{latch};
+        while (!worklist.empty()) {
+          auto block = worklist.back();
+          worklist.pop_back();
+          if (loop.body[block]) continue;
+          loop.body[block] = true;
+          loop.size++;
+          for (auto pred : fn.blocks[block].preds) {
+            if (dom.Reachable(pred)) worklist.push_back(pred);
+          }
+        }
+      }
+    }
+    std::vector<SsaLoop> result;
+    for (auto& [header, loop] : loops) {
+      result.push_back(std::move(loop));
+    }
+    std::stable_sort(result.begin(), result.end(),
+                     [](const SsaLoop& a, const SsaLoop& b) {
+                       return a.size < b.size;
+                     });
+    return result;
+  }
+};
+
+// Loop invariant code motion. Values computed from values defined outside
+// the loop move to the preheader. Only values which provably can't throw
+// are hoisted, since the loop body may never run.
+class SsaLicm {
+  // The block which runs right before the loop. Created when the loop has
+  // several entries, or its only entry also branches elsewhere.
+  static SsaBlockId Preheader(SsaFunction& fn, const SsaLoop& loop) {
+    std::vector<SsaBlockId> outside;
+    for (auto pred : fn.blocks[loop.header].preds) {
+      if (!loop.body[pred]) outside.push_back(pred);
+    }
+    if (outside.size() == 1 && fn.Successors(outside[0]).size() == 1) {
+      return outside[0];
+    }
+    auto preheader = fn.NewBlock();
+    SsaInst jump{eSsaOp::kJump};
+    jump.targets = {loop.header};
+    fn.Append(preheader, std::move(jump));
+    for (auto pred : outside) {
+      fn.RedirectEdge(pred, loop.header, preheader);
+    }
+    for (auto phi : fn.Phis(loop.header)) {
+      SsaInst merged{eSsaOp::kPhi};
+      std::vector<SsaId> operands;
+      std::vector<SsaBlockId> incoming;
+      const auto& inst = fn.insts[phi];
+      for (std::size_t i = 0; i < inst.operands.size(); i++) {
+        if (loop.body[inst.incoming[i]]) {
+          operands.push_back(inst.operands[i]);
+          incoming.push_back(inst.incoming[i]);
+        } else {
+          merged.operands.push_back(inst.operands[i]);
+          merged.incoming.push_back(inst.incoming[i]);
+        }
+      }
+      if (merged.operands.empty()) continue;
+      auto value = merged.operands.size() == 1
+                       ? merged.operands[0]
+                       : fn.Insert(preheader, 0, std::move(merged));
+      operands.push_back(value);
+      incoming.push_back(preheader);
+      fn.insts[phi].operands = std::move(operands);
+      fn.insts[phi].incoming = std::move(incoming);
+    }
+    auto& layout = fn.layout;
+    layout.insert(std::find(layout.begin(), layout.end(), loop.header),
+                  preheader);
+    fn.RebuildPredecessors();
+    return preheader;
+  }
+
+  static bool Hoist(SsaFunction& fn, const SsaDominatorTree& dom,
+                    const SsaLoop& loop) {
+    SsaKinds kinds(fn);
+    std::vector<bool> hoisted(fn.insts.size(), false);
+    std::vector<SsaId> invariant;
+    for (bool found = true; found;) {
+      found = false;
+      for (auto block : dom.ReversePostorder()) {
+        if (!loop.body[block]) continue;
+        for (auto id : fn.blocks[block].insts) {
+          const auto& inst = fn.insts[id];
+          bool candidate = inst.op == eSsaOp::kConst ||
+                           inst.op == eSsaOp::kBinary ||
+                           inst.op == eSsaOp::kNot;
+          if (hoisted[id] || !candidate || kinds.CanThrow(fn, inst)) continue;
+          bool operands_invariant = std::all_of(
+              inst.operands.begin(), inst.operands.end(), [&](SsaId operand) {
+                return hoisted[operand] ||
+                       !loop.body[fn.insts[operand].block];
+              });
+          if (!operands_invariant) continue;
+          hoisted[id] = true;
+          invariant.push_back(id);
+          found = true;
+        }
+      }
+    }
+    // Literals alone are not worth a preheader.
+    bool computes = std::any_of(invariant.begin(), invariant.end(),
+                                [&fn](SsaId id) {
+                                  return fn.insts[id].op != eSsaOp::kConst;
+                                });
+    if (!computes) return false;
+    auto preheader = Preheader(fn, loop);
+    for (auto id : invariant) {
+      fn.MoveBeforeTerminator(id, preheader);
+    }
+    return true;
+  }
+
+ public:
+  static bool Run(SsaFunction& fn) {
+    bool changed = false;
+    std::set<SsaBlockId> done;
+    while (true) {
+      fn.RebuildPredecessors();
+      SsaDominatorTree dom(fn);
+      auto loops = SsaLoops::Find(fn, dom);
+      auto loop = std::find_if(loops.begin(), loops.end(),
+                               [&done](const SsaLoop& loop) {
+                                 return !done.count(loop.header);
+                               });
+      if (loop == loops.end()) break;
+      done.insert(loop->header);
+      changed |= Hoist(fn, dom, *loop);
+    }
+    return changed;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// SsaLowering
+//---------------------------------------------------------------------------//
+// Lowers SSA back to executable IR. Values with a single use later in the
+// same block are rebuilt as operand trees when the tree evaluates them in
+// their original order. Other values and phis get a temporary declared at
+// the top of their function, phis are assigned at the end of predecessors.
+// Literals are rematerialized at every use.
+class SsaLowering {
+  static constexpr std::size_t kNoBlock = std::numeric_limits<std::size_t>::max();
+
+  struct FunctionState {
+    const SsaFunction& fn;
+    std::size_t index;
+    SsaUses uses;
+    std::vector<std::size_t> labels{};  // SsaBlock -> IrCfg block.
+    // Jump statements whose target is an SsaBlock: {cfg block, statement}.
+    std::vector<std::tuple<std::size_t, std::size_t, SsaBlockId>> jumps{};
+    std::vector<std::string> temps{};
+    std::unordered_set<std::string> declared{};
+    std::vector<SsaId> deferred{};  // Values waiting for their user.
+    std::unordered_map<SsaId, IrNode> trees{};
+  };
+
+  IrCfg cfg_;
+
+  std::size_t NewBlock() {
+    cfg_.Blocks().emplace_back();
+    return cfg_.End() - 1;
+  }
+  // Block for the next statement.
+  std::size_t StartBlock() {
+    if (cfg_.Blocks().back().statements.empty()) return cfg_.End() - 1;
+    return NewBlock();
+  }
+  void Append(IrNode node) {
+    bool terminator = IrOpIsTerminator(node.op);
+    cfg_.Blocks().back().statements.push_back(std::move(node));
+    if (terminator) NewBlock();
+  }
+  void AppendJump(FunctionState& state, eIrOp op, SsaBlockId target,
+                  std::vector<IrNode> operands = {}) {
+    state.jumps.emplace_back(cfg_.End() - 1,
+                             cfg_.Blocks().back().statements.size(), target);
+    Append(IrNode{op, {IrInt{0}}, std::move(operands)});
+  }
+
+  static const IrString& Name(FunctionState& state, std::string name) {
+    auto [it, inserted] = state.declared.insert(std::move(name));
+    if (inserted) state.temps.push_back(*it);
+    return *it;
+  }
+  static IrString Temp(FunctionState& state, SsaId id) {
+    return Name(state, std::string(kIrTempPrefix) + "s" +
+                           std::to_string(state.index) + "." +
+                           std::to_string(id));
+  }
+
+  static IrNode Ref(FunctionState& state, SsaId id) {
+    const auto& inst = state.fn.insts[id];
+    if (inst.op == eSsaOp::kConst) {
+      return IrNode{eIrOp::ALLOCATE_LITERAL, inst.args};
+    }
+    if (inst.op == eSsaOp::kUndef) {
+      return IrNode{eIrOp::LOAD_VARIABLE,
+                    {Name(state, std::string(kIrTempPrefix) + "undef")}};
+    }
+    return IrNode{eIrOp::LOAD_VARIABLE, {Temp(state, id)}};
+  }
+
+  static bool Inlinable(const FunctionState& state, SsaId id) {
+    const auto& inst = state.fn.insts[id];
+    if (!SsaOpHasValue(inst.op) || inst.op == eSsaOp::kConst ||
+        inst.op == eSsaOp::kUndef || inst.op == eSsaOp::kPhi ||
+        state.uses.Count(id) != 1) {
+      return false;
+    }
+    const auto& user = state.fn.insts[state.uses.Users(id)[0]];
+    return user.block == inst.block && user.op != eSsaOp::kPhi;
+  }
+
+  void Flush(FunctionState& state) {
+    for (auto id : state.deferred) {
+      Append(IrNode{eIrOp::DEFINE_VARIABLE,
+                    {Temp(state, id)},
+                    {std::move(state.trees.at(id))}});
+      state.trees.erase(id);
+    }
+    state.deferred.clear();
+  }
+
+  // Deferred operands on top of the stack become operand trees, in
+  // reverse order. The rest are read from their temporaries, which are
+  // written once, or at the end of a block for phis.
+  std::vector<IrNode> Operands(FunctionState& state, const SsaInst& inst) {
+    std::vector<std::optional<IrNode>> nodes(inst.operands.size());
+    auto remaining = inst.operands.size();
+    for (; remaining > 0; remaining--) {
+      auto operand = inst.operands[remaining - 1];
+      if (!state.trees.count(operand)) {
+        nodes[remaining - 1] = Ref(state, operand);
+      } else if (state.deferred.back() == operand) {
+        nodes[remaining - 1] = std::move(state.trees.at(operand));
+        state.trees.erase(operand);
+        state.deferred.pop_back();
+      } else {
+        break;
+      }
+    }
+    for (std::size_t i = 0; i < remaining; i++) {
+      if (state.trees.count(inst.operands[i])) Flush(state);
+    }
+    std::vector<IrNode> operands;
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+      operands.push_back(i < remaining ? Ref(state, inst.operands[i])
+                                       : std::move(*nodes[i]));
+    }
+    return operands;
+  }
+
+  static IrNode Node(const SsaInst& inst, std::vector<IrNode> operands) {
+    switch (inst.op) {
+      case eSsaOp::kBinary:
+        return IrNode{inst.ir_op, {}, std::move(operands)};
+      case eSsaOp::kNot:
+        return IrNode{eIrOp::UNARY_NOT, {}, std::move(operands)};
+      case eSsaOp::kLoad:
+        return IrNode{eIrOp::LOAD_VARIABLE, inst.args};
+      case eSsaOp::kCall:
+        return IrNode{eIrOp::CALL, inst.args, std::move(operands)};
+      case eSsaOp::kCallMember:
+        return IrNode{eIrOp::CALL_MEMBER, inst.args, std::move(operands)};
+      case eSsaOp::kStore:
+        return IrNode{eIrOp::DEFINE_VARIABLE, inst.args, std::move(operands)};
+      case eSsaOp::kDeclare:
+        return IrNode{eIrOp::DECLARE_VARIABLE, inst.args, std::move(operands)};
+      case eSsaOp::kEnterScope:
+        return IrNode{eIrOp::ENTER_SCOPE};
+      case eSsaOp::kExitScope:
+        return IrNode{eIrOp::EXIT_SCOPE};
+      default:
+        return IrNode{inst.ir_op == eIrOp::TAIL_CALL ? eIrOp::TAIL_CALL
+                                                     : eIrOp::RETURN,
+                      {},
+                      std::move(operands)};
+    }
+  }
+
+  // Assigns the phis of to along the edge from -> to. Copies go through
+  // fresh temporaries when a phi reads another phi of the same block.
+  void EmitPhiCopies(FunctionState& state, SsaBlockId from, SsaBlockId to) {
+    std::vector<std::pair<SsaId, SsaId>> copies;
+    bool parallel = false;
+    for (auto phi : state.fn.Phis(to)) {
+      const auto& inst = state.fn.insts[phi];
+      for (std::size_t i = 0; i < inst.incoming.size(); i++) {
+        if (inst.incoming[i] != from || inst.operands[i] == phi) continue;
+        copies.emplace_back(phi, inst.operands[i]);
+        const auto& value = state.fn.insts[inst.operands[i]];
+        parallel |= value.op == eSsaOp::kPhi && value.block == to;
+      }
+    }
+    for (const auto& [phi, value] : copies) {
+      auto target = parallel ? Name(state, std::string(kIrTempPrefix) + "c" +
+                                               std::to_string(state.index) +
+                                               "." + std::to_string(phi))
+                             : Temp(state, phi);
+      Append(IrNode{eIrOp::DEFINE_VARIABLE, {target}, {Ref(state, value)}});
+    }
+    if (!parallel) return;
+    for (const auto& [phi, value] : copies) {
+      Append(IrNode{eIrOp::DEFINE_VARIABLE,
+                    {Temp(state, phi)},
+                    {IrNode{eIrOp::LOAD_VARIABLE,
+                            {std::string(kIrTempPrefix) + "c" +
+                             std::to_string(state.index) + "." +
+                             std::to_string(phi)}}}});
+    }
+  }
+
+  void EmitDeclaration(const SsaModule& module, const SsaInst& inst) {
+    auto declaration_block = cfg_.End() - 1;
+    auto statement = cfg_.Blocks().back().statements.size();
+    Append(IrNode{inst.op == eSsaOp::kDeclareMethod ? eIrOp::DECLARE_METHOD
+                                                    : eIrOp::DECLARE_OBJECT,
+                  inst.args});
+    EmitFunction(module, inst.child);
+    auto resume = StartBlock();
+    cfg_.Blocks()[declaration_block].statements[statement].args[1] =
+        static_cast<IrInt>(resume);
+  }
+
+  void EmitBlock(const SsaModule& module, FunctionState& state,
+                 SsaBlockId block, SsaBlockId next) {
+    for (auto id : state.fn.blocks[block].insts) {
+      const auto& inst = state.fn.insts[id];
+      switch (inst.op) {
+        case eSsaOp::kConst:
+        case eSsaOp::kUndef:
+        case eSsaOp::kPhi:
+          break;
+        case eSsaOp::kEnterScope:
+        case eSsaOp::kExitScope:
+          if (!state.fn.scoped) break;
+          Flush(state);
+          Append(Node(inst, {}));
+          break;
+        case eSsaOp::kDeclareMethod:
+        case eSsaOp::kDeclareObject:
+          Flush(state);
+          EmitDeclaration(module, inst);
+          break;
+        case eSsaOp::kJump:
+          Flush(state);
+          EmitPhiCopies(state, block, inst.targets[0]);
+          if (inst.targets[0] != next) {
+            AppendJump(state, eIrOp::JUMP, inst.targets[0]);
+          }
+          break;
+        case eSsaOp::kBranch: {
+          auto condition = Operands(state, inst);
+          Flush(state);
+          AppendJump(state, eIrOp::JUMP_IF_FALSE, inst.targets[1],
+                     std::move(condition));
+          if (inst.targets[0] != next) {
+            AppendJump(state, eIrOp::JUMP, inst.targets[0]);
+          }
+        } break;
+        case eSsaOp::kExit:
+          // The exit block is the last block of the program.
+          Flush(state);
+          break;
+        default: {
+          auto node = Node(inst, Operands(state, inst));
+          if (Inlinable(state, id)) {
+            state.deferred.push_back(id);
+            state.trees.emplace(id, std::move(node));
+            break;
+          }
+          Flush(state);
+          if (SsaOpHasValue(inst.op) && state.uses.Count(id) > 0) {
+            Append(IrNode{eIrOp::DEFINE_VARIABLE,
+                          {Temp(state, id)},
+                          {std::move(node)}});
+          } else {
+            Append(std::move(node));
+          }
+        } break;
+      }
+    }
+  }
+
+  void EmitFunction(const SsaModule& module, std::size_t index) {
+    const auto& fn = module.functions[index];
+    FunctionState state{fn, index, SsaUses(fn)};
+    state.labels.assign(fn.blocks.size(), kNoBlock);
+    auto prologue = StartBlock();
+    NewBlock();
+    for (std::size_t i = 0; i < fn.layout.size(); i++) {
+      auto block = fn.layout[i];
+      state.labels[block] = StartBlock();
+      auto next = i + 1 < fn.layout.size() ? fn.layout[i + 1] : kNoBlock;
+      EmitBlock(module, state, block, next);
+    }
+    for (const auto& temp : state.temps) {
+      cfg_.Blocks()[prologue].statements.push_back(
+          IrNode{eIrOp::DECLARE_VARIABLE, {kIrTypeConstraintAny, temp}});
+    }
+    for (const auto& [block, statement, target] : state.jumps) {
+      cfg_.Blocks()[block].statements[statement].args[0] =
+          static_cast<IrInt>(state.labels.at(target));
+    }
+  }
+
+  // Edges from a branch into a block with phis get a block of their own
+  // to hold the phi copies.
+  static void SplitEdges(SsaFunction& fn) {
+    auto count = fn.blocks.size();
+    for (SsaBlockId block = 0; block < count; block++) {
+      if (fn.blocks[block].removed) continue;
+      auto successors = fn.Successors(block);
+      if (successors.size() < 2) continue;
+      for (auto successor : successors) {
+        if (fn.Phis(successor).empty()) continue;
+        auto split = fn.NewBlock();
+        SsaInst jump{eSsaOp::kJump};
+        jump.targets = {successor};
+        fn.Append(split, std::move(jump));
+        fn.RedirectEdge(block, successor, split);
+        fn.RenameIncoming(successor, block, split);
+        fn.layout.insert(
+            std::find(fn.layout.begin(), fn.layout.end(), successor), split);
+      }
+    }
+    fn.RebuildPredecessors();
+  }
+
+ public:
+  static IrCode Lower(SsaModule module) {
+    for (auto& fn : module.functions) {
+      SplitEdges(fn);
+    }
+    SsaLowering lowering;
+    lowering.cfg_.Blocks().emplace_back();
+    lowering.Append(IrNode{eIrOp::ENTER_PROGRAM_DEFINITION});
+    lowering.EmitFunction(module, 0);
+    return lowering.cfg_.Encode();
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// SsaOptimizer
+//---------------------------------------------------------------------------//
+struct SsaOptions {
+  bool sccp{true};
+  bool gvn{true};
+  bool licm{true};
+};
+
+class SsaOptimizer {
+ public:
+  static void Optimize(SsaFunction& fn, const SsaOptions& options = {}) {
+    SsaDeadCodeElimination::Run(fn);
+    if (options.sccp) SsaSccp::Run(fn);
+    if (options.gvn) SsaGvn::Run(fn);
+    if (options.licm) SsaLicm::Run(fn);
+    SsaDeadCodeElimination::Run(fn);
+  }
+
+  // Builds the SSA form of the code, optimizes every function and lowers it
+  // back. Returns nullopt if the code has constructs SSA doesn't model.
+  static std::optional<IrCode> Optimize(const IrCode& code,
+                                        const SsaOptions& options = {}) {
+    auto module = SsaBuilder::Build(code);
+    if (!module.supported) return std::nullopt;
+    for (auto& fn : module.functions) {
+      Optimize(fn, options);
+    }
+    return SsaLowering::Lower(std::move(module));
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_ssa.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_IR_SSA_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
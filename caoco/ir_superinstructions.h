@@ -0,0 +1,409 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_superinstructions.h
+//---------------------------------------------------------------------------//
+// Brief: Superinstructions of the evaluator and the n-gram profiler which
+//        selects them.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_IR_SUPERINSTRUCTIONS_H
+#define HEADER_GUARD_CAOCO_COMPILER_IR_SUPERINSTRUCTIONS_H
+// Includes:
+#include "import_stl.h"
+#include "ir_codegen.h"
+
+//=-------------------------------------------------------------------------=//
+// eIrFusedOp
+//---------------------------------------------------------------------------//
+// A superinstruction is a small statement or expression tree which the
+// evaluator executes with a single dispatch, reading its operand lines in
+// place instead of dispatching each one. The IR is not rewritten: the
+// evaluator tags the root line of each fused tree when it indexes the code.
+// Shapes, in prefix order, where BINARY is any binary op except && and ||,
+// VAR is a LOAD_VARIABLE and LIT an ALLOCATE_LITERAL:
+//   BINARY_<L>_<R>         BINARY L R
+//   DEFINE_<L>             DEFINE_VARIABLE L
+//   DEFINE_BINARY_<L>_<R>  DEFINE_VARIABLE BINARY L R
+//   BRANCH_VAR             JUMP_IF_FALSE VAR
+//   BRANCH_BINARY_<L>_<R>  JUMP_IF_FALSE BINARY L R
+// Trees of literals only are left to the optimizer.
+enum class eIrFusedOp : std::uint8_t {
+  kNone,
+  kBinaryVarVar,
+  kBinaryVarLit,
+  kBinaryLitVar,
+  kDefineVar,
+  kDefineLit,
+  kDefineBinaryVarVar,
+  kDefineBinaryVarLit,
+  kDefineBinaryLitVar,
+  kBranchVar,
+  kBranchBinaryVarVar,
+  kBranchBinaryVarLit,
+  kBranchBinaryLitVar,
+};
+static constexpr std::size_t kIrFusedOpCount = 13;
+
+constexpr std::string_view ToStr(eIrFusedOp op) {
+  switch (op) {
+    case eIrFusedOp::kNone:
+      return "NONE";
+    case eIrFusedOp::kBinaryVarVar:
+      return "BINARY_VAR_VAR";
+    case eIrFusedOp::kBinaryVarLit:
+      return "BINARY_VAR_LIT";
+    case eIrFusedOp::kBinaryLitVar:
+      return "BINARY_LIT_VAR";
+    case eIrFusedOp::kDefineVar:
+      return "DEFINE_VAR";
+    case eIrFusedOp::kDefineLit:
+      return "DEFINE_LIT";
+    case eIrFusedOp::kDefineBinaryVarVar:
+      return "DEFINE_BINARY_VAR_VAR";
+    case eIrFusedOp::kDefineBinaryVarLit:
+      return "DEFINE_BINARY_VAR_LIT";
+    case eIrFusedOp::kDefineBinaryLitVar:
+      return "DEFINE_BINARY_LIT_VAR";
+    case eIrFusedOp::kBranchVar:
+      return "BRANCH_VAR";
+    case eIrFusedOp::kBranchBinaryVarVar:
+      return "BRANCH_BINARY_VAR_VAR";
+    case eIrFusedOp::kBranchBinaryVarLit:
+      return "BRANCH_BINARY_VAR_LIT";
+    case eIrFusedOp::kBranchBinaryLitVar:
+      return "BRANCH_BINARY_LIT_VAR";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+// Name of the enumerator, used by the table generator.
+constexpr std::string_view ToEnumeratorStr(eIrFusedOp op) {
+  switch (op) {
+    case eIrFusedOp::kNone:
+      return "kNone";
+    case eIrFusedOp::kBinaryVarVar:
+      return "kBinaryVarVar";
+    case eIrFusedOp::kBinaryVarLit:
+      return "kBinaryVarLit";
+    case eIrFusedOp::kBinaryLitVar:
+      return "kBinaryLitVar";
+    case eIrFusedOp::kDefineVar:
+      return "kDefineVar";
+    case eIrFusedOp::kDefineLit:
+      return "kDefineLit";
+    case eIrFusedOp::kDefineBinaryVarVar:
+      return "kDefineBinaryVarVar";
+    case eIrFusedOp::kDefineBinaryVarLit:
+      return "kDefineBinaryVarLit";
+    case eIrFusedOp::kDefineBinaryLitVar:
+      return "kDefineBinaryLitVar";
+    case eIrFusedOp::kBranchVar:
+      return "kBranchVar";
+    case eIrFusedOp::kBranchBinaryVarVar:
+      return "kBranchBinaryVarVar";
+    case eIrFusedOp::kBranchBinaryVarLit:
+      return "kBranchBinaryVarLit";
+    case eIrFusedOp::kBranchBinaryLitVar:
+      return "kBranchBinaryLitVar";
+    default:
+      return "kNone";
+  }
+}
+
+// Number of lines a superinstruction executes, one dispatch instead of this
+// many.
+constexpr std::size_t IrFusedOpSize(eIrFusedOp op) {
+  switch (op) {
+    case eIrFusedOp::kNone:
+      return 1;
+    case eIrFusedOp::kDefineVar:
+    case eIrFusedOp::kDefineLit:
+    case eIrFusedOp::kBranchVar:
+      return 2;
+    case eIrFusedOp::kBinaryVarVar:
+    case eIrFusedOp::kBinaryVarLit:
+    case eIrFusedOp::kBinaryLitVar:
+      return 3;
+    default:
+      return 4;
+  }
+}
+
+// Superinstructions whose root is an expression rather than a statement.
+constexpr bool IrFusedOpIsExpression(eIrFusedOp op) {
+  return op == eIrFusedOp::kBinaryVarVar || op == eIrFusedOp::kBinaryVarLit ||
+         op == eIrFusedOp::kBinaryLitVar;
+}
+
+// Entry of the generated fusion table, see ir_fusion_table.h.
+struct IrFusionTableEntry {
+  eIrFusedOp op;
+  std::size_t saved_dispatches;  // Over the profiled corpus.
+};
+
+//=-------------------------------------------------------------------------=//
+// IrFusion
+//---------------------------------------------------------------------------//
+// Matches superinstruction shapes on indexed lines.
+class IrFusion {
+  enum class eLeaf { kNone, kVar, kLit };
+
+  static eLeaf LeafAt(const std::vector<const IrLine*>& code,
+                      std::size_t index) {
+    if (index >= code.size()) return eLeaf::kNone;
+    const IrLine& line = *code[index];
+    if (line.args.size() != 1) return eLeaf::kNone;
+    if (line.op == eIrOp::LOAD_VARIABLE &&
+        std::holds_alternative<IrString>(line.args[0])) {
+      return eLeaf::kVar;
+    }
+    if (line.op == eIrOp::ALLOCATE_LITERAL) return eLeaf::kLit;
+    return eLeaf::kNone;
+  }
+
+  // Single operand, on the next line, of a DEFINE_VARIABLE or JUMP_IF_FALSE.
+  static bool HasNextLineOperand(const IrLine& line, std::size_t scalars) {
+    return line.args.size() == scalars + 2 && line.OperandCount() == 1 &&
+           std::holds_alternative<IrInt>(line.args[scalars]) &&
+           line.OperandBegin(0) == static_cast<IrInt>(line.index) + 1;
+  }
+
+ public:
+  // Binary ops which always evaluate both operands.
+  static constexpr bool IsFusibleBinary(eIrOp op) {
+    return IrOpIsBinary(op) && op != eIrOp::BINARY_AND &&
+           op != eIrOp::BINARY_OR;
+  }
+
+  // Shape of the BINARY L R tree at index, kNone if it is not one.
+  static eIrFusedOp MatchBinary(const std::vector<const IrLine*>& code,
+                                std::size_t index) {
+    if (index >= code.size()) return eIrFusedOp::kNone;
+    const IrLine& line = *code[index];
+    if (!IsFusibleBinary(line.op) || line.args.size() != 4 ||
+        line.OperandCount() != 2 ||
+        line.OperandBegin(0) != static_cast<IrInt>(index) + 1 ||
+        line.OperandBegin(1) != static_cast<IrInt>(index) + 2) {
+      return eIrFusedOp::kNone;
+    }
+    auto lhs = LeafAt(code, index + 1);
+    auto rhs = LeafAt(code, index + 2);
+    if (lhs == eLeaf::kVar && rhs == eLeaf::kVar) {
+      return eIrFusedOp::kBinaryVarVar;
+    }
+    if (lhs == eLeaf::kVar && rhs == eLeaf::kLit) {
+      return eIrFusedOp::kBinaryVarLit;
+    }
+    if (lhs == eLeaf::kLit && rhs == eLeaf::kVar) {
+      return eIrFusedOp::kBinaryLitVar;
+    }
+    return eIrFusedOp::kNone;
+  }
+
+  // Superinstruction rooted at index, kNone if no shape matches.
+  static eIrFusedOp Match(const std::vector<const IrLine*>& code,
+                          std::size_t index) {
+    const IrLine& line = *code[index];
+    if (line.op == eIrOp::DEFINE_VARIABLE) {
+      if (!HasNextLineOperand(line, 1) ||
+          !std::holds_alternative<IrString>(line.args[0])) {
+        return eIrFusedOp::kNone;
+      }
+      switch (LeafAt(code, index + 1)) {
+        case eLeaf::kVar:
+          return eIrFusedOp::kDefineVar;
+        case eLeaf::kLit:
+          return eIrFusedOp::kDefineLit;
+        default:
+          break;
+      }
+      switch (MatchBinary(code, index + 1)) {
+        case eIrFusedOp::kBinaryVarVar:
+          return eIrFusedOp::kDefineBinaryVarVar;
+        case eIrFusedOp::kBinaryVarLit:
+          return eIrFusedOp::kDefineBinaryVarLit;
+        case eIrFusedOp::kBinaryLitVar:
+          return eIrFusedOp::kDefineBinaryLitVar;
+        default:
+          return eIrFusedOp::kNone;
+      }
+    }
+    if (line.op == eIrOp::JUMP_IF_FALSE) {
+      if (!HasNextLineOperand(line, 1)) return eIrFusedOp::kNone;
+      if (LeafAt(code, index + 1) == eLeaf::kVar) {
+        return eIrFusedOp::kBranchVar;
+      }
+      switch (MatchBinary(code, index + 1)) {
+        case eIrFusedOp::kBinaryVarVar:
+          return eIrFusedOp::kBranchBinaryVarVar;
+        case eIrFusedOp::kBinaryVarLit:
+          return eIrFusedOp::kBranchBinaryVarLit;
+        case eIrFusedOp::kBinaryLitVar:
+          return eIrFusedOp::kBranchBinaryLitVar;
+        default:
+          return eIrFusedOp::kNone;
+      }
+    }
+    return MatchBinary(code, index);
+  }
+
+  // Superinstruction of each line, restricted to the ops of the table.
+  // Operand lines of a fused tree are not tagged, they are never dispatched.
+  static std::vector<eIrFusedOp> Select(
+      const std::vector<const IrLine*>& code,
+      std::span<const IrFusionTableEntry> table) {
+    std::vector<eIrFusedOp> fused(code.size(), eIrFusedOp::kNone);
+    Select(code, table, 0, code.size(), fused);
+    return fused;
+  }
+
+  // Selects the superinstructions of lines [begin, end) into fused. begin
+  // must be the first line of a statement.
+  static void Select(const std::vector<const IrLine*>& code,
+                     std::span<const IrFusionTableEntry> table,
+                     std::size_t begin, std::size_t end,
+                     std::vector<eIrFusedOp>& fused) {
+    std::array<bool, kIrFusedOpCount> enabled{};
+    for (const auto& entry : table) {
+      enabled[static_cast<std::size_t>(entry.op)] = true;
+    }
+    for (std::size_t i = begin; i < end;) {
+      auto op = Match(code, i);
+      if (op != eIrFusedOp::kNone && enabled[static_cast<std::size_t>(op)]) {
+        fused[i] = op;
+        i += IrFusedOpSize(op);
+      } else {
+        i++;
+      }
+    }
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// IrNgramProfiler
+//---------------------------------------------------------------------------//
+// Counts opcode n-grams of executed code and ranks the superinstructions
+// which would cover them. Lines are weighted by their execution count from
+// Evaluator::LineCounts, or by one for a static profile.
+// The fusion table in ir_fusion_table.h is the output of EmitTable over the
+// corpus of ut0_ir_superinstructions.h. Regenerate it when the corpus, the
+// code generator or the optimizer change the shape of the code.
+class IrNgramProfiler {
+ public:
+  static constexpr std::size_t kMinLength = 2;
+  static constexpr std::size_t kMaxLength = 4;
+  using Ngram = std::vector<eIrOp>;
+
+ private:
+  std::map<Ngram, std::size_t> ngrams_;
+  std::map<eIrFusedOp, std::size_t> saved_;
+  std::size_t dispatches_{0};
+
+ public:
+  void Add(const IrCode& code, const std::vector<std::size_t>& counts = {}) {
+    std::vector<const IrLine*> lines;
+    lines.reserve(code.Size());
+    for (const auto& line : code.GetLines()) lines.push_back(&line);
+    lambda xWeight = [&](std::size_t index) -> std::size_t {
+      return counts.empty() ? 1 : (index < counts.size() ? counts[index] : 0);
+    };
+
+    // N-grams never cross a statement, the lines of a statement are visited
+    // in order so that a fused tree is not counted again for its operands.
+    for (std::size_t statement = 0; statement < lines.size();) {
+      std::size_t end = lines[statement]->ExtentEnd();
+      std::size_t fused_end = statement;
+      for (std::size_t i = statement; i <= end; i++) {
+        auto weight = xWeight(i);
+        dispatches_ += weight;
+        if (weight == 0) continue;
+        Ngram ngram{lines[i]->op};
+        for (std::size_t n = kMinLength; n <= kMaxLength && i + n - 1 <= end;
+             n++) {
+          ngram.push_back(lines[i + n - 1]->op);
+          ngrams_[ngram] += weight;
+        }
+        if (i < fused_end) continue;
+        auto fused = IrFusion::Match(lines, i);
+        if (fused != eIrFusedOp::kNone) {
+          saved_[fused] += weight * (IrFusedOpSize(fused) - 1);
+          fused_end = i + IrFusedOpSize(fused);
+        }
+      }
+      statement = end + 1;
+    }
+  }
+
+  // Executed lines, each one a dispatch without superinstructions.
+  std::size_t Dispatches() const { return dispatches_; }
+  std::size_t Count(const Ngram& ngram) const {
+    auto found = ngrams_.find(ngram);
+    return found == ngrams_.end() ? 0 : found->second;
+  }
+
+  // The most frequent n-grams, most frequent first.
+  std::vector<std::pair<Ngram, std::size_t>> Top(std::size_t limit) const {
+    std::vector<std::pair<Ngram, std::size_t>> top(ngrams_.begin(),
+                                                   ngrams_.end());
+    std::stable_sort(top.begin(), top.end(), [](const auto& a, const auto& b) {
+      return a.second > b.second;
+    });
+    if (top.size() > limit) top.resize(limit);
+    return top;
+  }
+
+  // Superinstructions seen in the profile, most dispatches saved first.
+  std::vector<IrFusionTableEntry> Table() const {
+    std::vector<IrFusionTableEntry> table;
+    for (const auto& [op, saved] : saved_) {
+      table.push_back(IrFusionTableEntry{op, saved});
+    }
+    std::stable_sort(table.begin(), table.end(),
+                     [](const auto& a, const auto& b) {
+                       return a.saved_dispatches > b.saved_dispatches;
+                     });
+    return table;
+  }
+
+  void PrintTop(std::size_t limit, std::ostream& os = std::cout) const {
+    for (const auto& [ngram, count] : Top(limit)) {
+      os << count << " ";
+      for (std::size_t i = 0; i < ngram.size(); i++) {
+        os << (i == 0 ? "" : " ") << ToStr(ngram[i]);
+      }
+      os << std::endl;
+    }
+  }
+
+  // C++ source of the table, as checked in to ir_fusion_table.h.
+  void EmitTable(std::ostream& os = std::cout) const {
+    os << "static constexpr IrFusionTableEntry kIrFusionTable[] = {\n";
+    for (const auto& entry : Table()) {
+      os << "    {eIrFusedOp::" << ToEnumeratorStr(entry.op) << ", "
+         << entry.saved_dispatches << "},\n";
+    }
+    os << "};\n";
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_superinstructions.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_IR_SUPERINSTRUCTIONS_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,580 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_transpiler.h
+//---------------------------------------------------------------------------//
+// Brief: Ahead of time backend. Lowers IrCode to C++ source which links the
+//        runtime library of aot_runtime.h.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_IR_TRANSPILER_H
+#define HEADER_GUARD_CAOCO_COMPILER_IR_TRANSPILER_H
+// Includes:
+#include "import_stl.h"
+#include "ir_codegen.h"
+
+//=-------------------------------------------------------------------------=//
+// IrTranspiler
+//---------------------------------------------------------------------------//
+// Each method and class body, and the program itself, becomes a C++
+// function. Statements are emitted in line order, jumps become gotos.
+// Variables are resolved when the code is transpiled wherever the Evaluator's
+// lookup is static:
+// - Locals of a frame become C++ locals. Scopes only exist at transpile
+//   time: jumps never cross a scope boundary.
+// - Variables declared in the outermost scope of the program become
+//   AotGlobal, checked to be declared on each access.
+// - Members of self are looked up by name, in the bodies of a class only.
+// Calls are resolved at runtime among the functions, classes and builtins
+// the name may refer to, see AotCallee.
+class IrTranspiler {
+  struct Body {
+    std::size_t entry;     // First line.
+    std::size_t end;       // One past the last line.
+    bool self;             // Body of a class or of one of its methods.
+    bool constructing;     // Body of a class.
+    std::vector<std::string> params;
+    std::string title;     // Comment of the emitted function.
+  };
+  using Scope = std::map<std::string, std::size_t>;  // Name to local.
+
+  std::vector<const IrLine*> code_;
+  std::vector<Body> bodies_;
+  std::set<std::size_t> targets_;  // Jump targets.
+  std::map<std::string, std::size_t> globals_;
+  std::map<std::string, std::size_t> functions_;
+  std::map<std::string, std::size_t> types_;
+  std::map<std::size_t, std::string> literals_;  // Line to initializer.
+  std::map<std::string, std::size_t> callees_;  // Called names.
+
+  // Function being emitted.
+  const Body* body_{nullptr};
+  std::vector<Scope> scopes_;
+  std::vector<std::string> locals_;  // Local to C& name.
+
+  static std::size_t Id(std::map<std::string, std::size_t>& ids,
+                        const std::string& name) {
+    return ids.emplace(name, ids.size()).first->second;
+  }
+
+  // C++ string literal of text.
+  static std::string CString(const std::string& text) {
+    std::ostringstream os;
+    os << '"';
+    for (unsigned char c : text) {
+      if (c == '"' || c == '\\') {
+        os << '\\' << c;
+      } else if (c >= 0x20 && c < 0x7F) {
+        os << c;
+      } else {
+        // Octal escapes end after 3 digits, unlike hex escapes.
+        os << '\\' << static_cast<char>('0' + ((c >> 6) & 7))
+           << static_cast<char>('0' + ((c >> 3) & 7))
+           << static_cast<char>('0' + (c & 7));
+      }
+    }
+    os << '"';
+    return os.str();
+  }
+
+  // std::string of text, which may contain null characters.
+  static std::string Quote(const std::string& text) {
+    return "std::string(" + CString(text) + ", " + std::to_string(text.size()) +
+           ")";
+  }
+
+  static std::string LiteralInitializer(const IrVariant& literal) {
+    return std::visit(
+        [](auto&& arg) -> std::string {
+          using T = std::decay_t<decltype(arg)>;
+          std::ostringstream os;
+          if constexpr (std::is_same_v<T, IrString>) {
+            os << "AotString(" << Quote(arg) << ")";
+          } else if constexpr (std::is_same_v<T, IrBool>) {
+            os << "AotBool(" << arg << ")";
+          } else if constexpr (std::is_same_v<T, IrDouble>) {
+            os << "AotDouble(" << std::hexfloat << arg << ")";
+          } else if (arg == std::numeric_limits<IrInt>::min()) {
+            os << "AotInt(std::numeric_limits<RtVal::IntT>::min())";
+          } else {
+            os << "AotInt(" << arg << ")";
+          }
+          return os.str();
+        },
+        literal);
+  }
+
+  // Next statement of a body. Method and class declarations skip the body.
+  std::size_t NextStatement(std::size_t index) const {
+    const IrLine& line = *code_[index];
+    if (line.op == eIrOp::DECLARE_METHOD || line.op == eIrOp::DECLARE_OBJECT) {
+      return static_cast<std::size_t>(std::get<IrInt>(line.args[1]));
+    }
+    return line.ExtentEnd() + 1;
+  }
+
+  // Finds the bodies declared in body, the globals and the jump targets.
+  void Discover(const Body& body) {
+    std::size_t depth = 0;
+    for (std::size_t i = body.entry; i < body.end; i = NextStatement(i)) {
+      const IrLine& line = *code_[i];
+      switch (line.op) {
+        case eIrOp::ENTER_SCOPE:
+          depth++;
+          break;
+        case eIrOp::EXIT_SCOPE:
+          if (depth > 0) depth--;
+          break;
+        case eIrOp::DECLARE_VARIABLE:
+          if (body.entry == 0 && depth == 0) {
+            Id(globals_, std::get<IrString>(line.args[1]));
+          }
+          break;
+        case eIrOp::JUMP:
+        case eIrOp::JUMP_IF_FALSE:
+          targets_.insert(static_cast<std::size_t>(std::get<IrInt>(line.args[0])));
+          break;
+        case eIrOp::DECLARE_METHOD: {
+          const auto& name = std::get<IrString>(line.args[0]);
+          std::vector<std::string> params;
+          for (std::size_t arg = 2; arg < line.args.size(); arg++) {
+            params.push_back(std::get<IrString>(line.args[arg]));
+          }
+          bool member = body.constructing && depth == 0;
+          if (!member) Id(functions_, name);
+          bodies_.push_back(Body{i + 1, NextStatement(i), member, false,
+                                 std::move(params),
+                                 (member ? "Method " : "Function ") + name});
+          Discover(Body(bodies_.back()));
+        } break;
+        case eIrOp::DECLARE_OBJECT: {
+          const auto& name = std::get<IrString>(line.args[0]);
+          Id(types_, name);
+          bodies_.push_back(
+              Body{i + 1, NextStatement(i), true, true, {}, "Class " + name});
+          Discover(Body(bodies_.back()));
+        } break;
+        default:
+          break;
+      }
+    }
+  }
+
+  std::string Global(const std::string& name) {
+    return "g" + std::to_string(globals_.at(name));
+  }
+
+  std::optional<std::size_t> FindLocal(const std::string& name) const {
+    for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); scope++) {
+      if (auto found = scope->find(name); found != scope->end()) {
+        return found->second;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Variable named name as an lvalue, or nullopt if it can't exist.
+  std::optional<std::string> Variable(const std::string& name) {
+    if (auto local = FindLocal(name)) {
+      return "l" + std::to_string(*local);
+    }
+    bool global = globals_.contains(name);
+    if (body_->self) {
+      return "AotLookup(call.self, " + Quote(name) + ", " +
+             (global ? "&" + Global(name) : "nullptr") + ")";
+    }
+    if (global) return Global(name) + ".Get()";
+    return std::nullopt;
+  }
+
+  static bool ContainsCall(const std::vector<const IrLine*>& code,
+                           std::size_t index) {
+    for (std::size_t i = index; i <= code[index]->ExtentEnd(); i++) {
+      if (code[i]->op == eIrOp::CALL || code[i]->op == eIrOp::CALL_MEMBER) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::string Operands(const IrLine& line, std::size_t first) {
+    std::string args = "{";
+    for (std::size_t i = first; i < line.OperandCount(); i++) {
+      if (i > first) args += ", ";
+      args += Expr(line.OperandBegin(i));
+    }
+    return args + "}";
+  }
+
+  std::string Callee(const std::string& name) {
+    return "c" + std::to_string(Id(callees_, name));
+  }
+
+  std::string CalleeInitializer(const std::string& name) {
+    std::string builtin = name == "cout" || name == "print" ? "kCout"
+                          : name == "cin"                   ? "kCin"
+                                                            : "kNone";
+    std::ostringstream os;
+    os << "{" << CString(name) << ", "
+       << (functions_.contains(name)
+               ? "&f" + std::to_string(functions_.at(name))
+               : "nullptr")
+       << ", "
+       << (types_.contains(name) ? "&t" + std::to_string(types_.at(name))
+                                 : "nullptr")
+       << ", eAotBuiltin::" << builtin << "}";
+    return os.str();
+  }
+
+  std::string Expr(IrInt index) {
+    const IrLine& line = *code_[index];
+    switch (line.op) {
+      case eIrOp::ALLOCATE_LITERAL:
+        literals_[line.index] = LiteralInitializer(line.args[0]);
+        return "k" + std::to_string(line.index);
+      case eIrOp::LOAD_VARIABLE: {
+        const auto& name = std::get<IrString>(line.args[0]);
+        if (auto variable = Variable(name)) return *variable;
+        return "AotFail(" + Quote("Variable not found: " + name) + ")";
+      }
+      case eIrOp::BINARY_AND:
+        return "(AotLogical(" + Expr(line.OperandBegin(0)) +
+               ") ? AotLogicalRhs(" + Expr(line.OperandBegin(1)) +
+               ") : AotBool(false))";
+      case eIrOp::BINARY_OR:
+        return "(AotLogical(" + Expr(line.OperandBegin(0)) +
+               ") ? AotBool(true) : AotLogicalRhs(" +
+               Expr(line.OperandBegin(1)) + "))";
+      case eIrOp::UNARY_NOT:
+        return "AotNot(" + Expr(line.OperandBegin(0)) + ")";
+      case eIrOp::CALL:
+        return "AotCallName(" + Callee(std::get<IrString>(line.args[0])) +
+               ", " + Operands(line, 0) + ", " +
+               (body_->self ? "call.self" : "nullptr") + ")";
+      case eIrOp::CALL_MEMBER:
+        return "AotResolveMember(" + Expr(line.OperandBegin(0)) + ", " +
+               Quote(std::get<IrString>(line.args[0])) + ").Call(" +
+               Operands(line, 1) + ")";
+      default:
+        break;
+    }
+    static const std::map<eIrOp, std::string> kMethods = {
+        {eIrOp::BINARY_ADD, "Add"}, {eIrOp::BINARY_SUB, "Sub"},
+        {eIrOp::BINARY_MUL, "Mul"}, {eIrOp::BINARY_DIV, "Div"},
+        {eIrOp::BINARY_MOD, "Mod"}, {eIrOp::BINARY_EQ, "Eq"},
+        {eIrOp::BINARY_NE, "Ne"},   {eIrOp::BINARY_LT, "Lt"},
+        {eIrOp::BINARY_GT, "Gt"},   {eIrOp::BINARY_LE, "Le"},
+        {eIrOp::BINARY_GE, "Ge"}};
+    if (auto method = kMethods.find(line.op); method != kMethods.end()) {
+      auto lhs = Expr(line.OperandBegin(0));
+      // A call in the right operand may assign the left one.
+      if (ContainsCall(code_, line.OperandBegin(1))) lhs = "RtVal(" + lhs + ")";
+      return "AotLhs{" + lhs + "}." + method->second + "(" +
+             Expr(line.OperandBegin(1)) + ")";
+    }
+    return "AotFail(" +
+           Quote("Operation is not an expression: " + std::string(ToStr(line.op))) +
+           ")";
+  }
+
+  std::string Target(IrInt target) const {
+    auto index = static_cast<std::size_t>(target);
+    return index < body_->end ? "L" + std::to_string(index) : "L_end";
+  }
+
+  // Emits the statement at index.
+  void Statement(std::size_t index, std::ostream& os) {
+    const IrLine& line = *code_[index];
+    bool base = scopes_.size() == 1;
+    switch (line.op) {
+      case eIrOp::ENTER_PROGRAM_DEFINITION:
+      case eIrOp::ALLOCATE_LITERAL:
+        break;
+      case eIrOp::ABORT_AND_ERROR:
+        os << "  AotThrow(" << Quote(std::get<IrString>(line.args[0]))
+           << ");\n";
+        break;
+      case eIrOp::DECLARE_VARIABLE: {
+        const auto& name = std::get<IrString>(line.args[1]);
+        auto value = line.OperandCount() == 1 ? Expr(line.OperandBegin(0))
+                                              : "kRuntimeUndefined";
+        auto type_constraint = std::get<IrInt>(line.args[0]);
+        if (type_constraint != kIrTypeConstraintAny) {
+          value = "AotConstrain(" + value + ", " +
+                  std::to_string(type_constraint) + ", " + Quote(name) + ")";
+        }
+        bool temp = name.starts_with(kIrTempPrefix);
+        if (body_->constructing && base) {
+          os << "  call.self->local_env.Define(" << Quote(name)
+             << ", eNameCategory::kVar, " << value << ");\n";
+        } else if (body_->entry == 0 && base) {
+          os << "  " << Global(name) << ".Declare(" << value << ", "
+             << (temp ? "true" : "false") << ");\n";
+        } else if (scopes_.back().contains(name) && !temp) {
+          os << "  { RtVal value = " << value << "; AotThrow("
+             << Quote("Variable already exists: " + name) << "); }\n";
+        } else {
+          if (!scopes_.back().contains(name)) {
+            locals_.push_back(name);
+            scopes_.back()[name] = locals_.size() - 1;
+          }
+          os << "  l" << scopes_.back()[name] << " = " << value << ";\n";
+        }
+      } break;
+      case eIrOp::DEFINE_VARIABLE: {
+        const auto& name = std::get<IrString>(line.args[0]);
+        auto value = Expr(line.OperandBegin(0));
+        if (auto variable = Variable(name)) {
+          os << "  " << *variable << " = " << value << ";\n";
+        } else {
+          os << "  { RtVal value = " << value << "; AotThrow("
+             << Quote("Variable not found: " + name) << "); }\n";
+        }
+      } break;
+      case eIrOp::DECLARE_METHOD: {
+        const auto& name = std::get<IrString>(line.args[0]);
+        auto entry = std::to_string(index + 1);
+        if (body_->constructing && base) {
+          os << "  AotDeclareMember(call.self, " << Quote(name) << ", {";
+          for (std::size_t arg = 2; arg < line.args.size(); arg++) {
+            os << (arg > 2 ? ", " : "")
+               << Quote(std::get<IrString>(line.args[arg]));
+          }
+          os << "}, " << entry << ");\n";
+        } else {
+          os << "  f" << functions_.at(name) << " = AotFunction{&Body" << entry
+             << ", " << line.args.size() - 2 << "};\n";
+        }
+      } break;
+      case eIrOp::DECLARE_OBJECT:
+        os << "  t" << types_.at(std::get<IrString>(line.args[0]))
+           << ".Declare(&Body" << index + 1 << ");\n";
+        break;
+      // Compiled calls stay C++ calls, which the C++ compiler may turn into
+      // jumps.
+      case eIrOp::RETURN:
+      case eIrOp::TAIL_CALL:
+        os << "  return "
+           << (line.OperandCount() == 1 ? Expr(line.OperandBegin(0))
+                                        : "kRuntimeUndefined")
+           << ";\n";
+        break;
+      case eIrOp::JUMP:
+        os << "  goto " << Target(std::get<IrInt>(line.args[0])) << ";\n";
+        break;
+      case eIrOp::JUMP_IF_FALSE:
+        os << "  if (!AotCondition(" << Expr(line.OperandBegin(0))
+           << ")) goto " << Target(std::get<IrInt>(line.args[0])) << ";\n";
+        break;
+      case eIrOp::ENTER_SCOPE:
+        scopes_.emplace_back();
+        break;
+      case eIrOp::EXIT_SCOPE:
+        if (base) {
+          os << "  AotThrow(\"EXIT_SCOPE without ENTER_SCOPE.\");\n";
+        } else {
+          scopes_.pop_back();
+        }
+        break;
+      default:
+        // Expression statement.
+        os << "  (void)" << Expr(static_cast<IrInt>(index)) << ";\n";
+        break;
+    }
+  }
+
+  void EmitBody(const Body& body, std::ostream& os) {
+    body_ = &body;
+    scopes_.assign(1, Scope{});
+    locals_ = body.params;
+    for (std::size_t i = 0; i < body.params.size(); i++) {
+      scopes_[0][body.params[i]] = i;
+    }
+    std::ostringstream statements;
+    for (std::size_t i = body.entry; i < body.end; i = NextStatement(i)) {
+      if (targets_.contains(i)) statements << " L" << i << ":;\n";
+      Statement(i, statements);
+    }
+
+    os << "// " << body.title << ".\n"
+       << "static RtVal Body" << body.entry
+       << "([[maybe_unused]] const AotCall& call) {\n";
+    for (std::size_t i = 0; i < locals_.size(); i++) {
+      os << "  RtVal l" << i;
+      if (i < body.params.size()) os << " = call.args[" << i << "]";
+      os << ";  // " << locals_[i] << "\n";
+    }
+    os << statements.str() << " L_end:;\n"
+       << "  return kRuntimeUndefined;\n"
+       << "}\n\n";
+  }
+
+  explicit IrTranspiler(const IrCode& code) {
+    for (const auto& line : code.GetLines()) code_.push_back(&line);
+  }
+
+  // The program without the include of the runtime. Inside namespace ns
+  // unless it is empty, where AotBodyAt is BodyAt and main is Main.
+  std::string Emit(const IrCode& code, const std::string& ns) {
+    bodies_.push_back(Body{0, code_.size(), false, false, {}, "Program"});
+    if (code.isAborted()) {
+      bodies_[0].end = 0;
+    } else {
+      Discover(Body(bodies_[0]));
+    }
+    std::ostringstream functions;
+    for (const auto& body : bodies_) EmitBody(body, functions);
+
+    std::ostringstream os;
+    if (!ns.empty()) os << "namespace " << ns << " {\n\n";
+    for (const auto& [name, id] : globals_) {
+      os << "static AotGlobal g" << id << "{" << Quote(name) << "};\n";
+    }
+    for (const auto& [name, id] : functions_) {
+      os << "static AotFunction f" << id << ";  // " << name << "\n";
+    }
+    for (const auto& [name, id] : types_) {
+      os << "static AotType t" << id << ";  // " << name << "\n";
+    }
+    for (const auto& [index, initializer] : literals_) {
+      os << "static const RtVal k" << index << " = " << initializer << ";\n";
+    }
+    for (const auto& [name, id] : callees_) {
+      os << "static const AotCallee c" << id << " = " << CalleeInitializer(name)
+         << ";\n";
+    }
+    os << "\n";
+    for (const auto& body : bodies_) {
+      os << "static RtVal Body" << body.entry << "(const AotCall& call);\n";
+    }
+    os << "\n" << functions.str();
+
+    os << (ns.empty() ? "AotBody AotBodyAt" : "AotBody BodyAt")
+       << "(std::size_t entry) {\n"
+       << "  switch (entry) {\n";
+    for (const auto& body : bodies_) {
+      os << "    case " << body.entry << ":\n"
+         << "      return &Body" << body.entry << ";\n";
+    }
+    os << "    default:\n"
+       << "      AotThrow(\"IR line index out of range.\");\n"
+       << "  }\n"
+       << "}\n\n";
+
+    os << (ns.empty() ? "int main() {\n" : "int Main() {\n");
+    if (code.isAborted()) {
+      os << "  return AotMain([](const AotCall&) -> RtVal {\n"
+         << "    AotThrow("
+         << Quote(std::get<IrString>(code.GetLines().back().args.at(0)))
+         << ");\n"
+         << "  });\n";
+    } else {
+      os << "  return AotMain(&Body0);\n";
+    }
+    os << "}\n";
+    if (!ns.empty()) os << "\n}  // namespace " << ns << "\n\n";
+    return os.str();
+  }
+
+  static constexpr std::string_view kHeader =
+      "// C& program compiled by IrTranspiler. Generated, do not edit.\n"
+      "#include \"aot_runtime.h\"\n\n";
+
+  // Writes source next to exe and compiles it, see Build.
+  static int Compile(const std::string& source,
+                     const std::filesystem::path& exe,
+                     const std::string& include_dir,
+                     const std::string& compiler) {
+    auto path = std::filesystem::path(exe).replace_extension(".cc");
+    {
+      std::ofstream file(path);
+      file << source;
+    }
+    auto command = compiler + " -I\"" + include_dir + "\" \"" +
+                   path.string() + "\" -o \"" + exe.string() + "\"";
+    return std::system(command.c_str());
+  }
+
+ public:
+  // C++ source of a program which runs code like Evaluator::Evaluate, reading
+  // cin and writing cout. Errors are written to cerr with a failure exit
+  // status.
+  static std::string Transpile(const IrCode& code) {
+    return std::string(kHeader) + IrTranspiler(code).Emit(code, "");
+  }
+
+  // C++ source of one executable holding several programs, which runs the
+  // program whose index is its first argument. A corpus built as a bundle
+  // compiles the runtime library once rather than once per program.
+  static std::string TranspileBundle(const std::vector<const IrCode*>& codes) {
+    std::ostringstream os;
+    os << kHeader;
+    for (std::size_t i = 0; i < codes.size(); i++) {
+      os << IrTranspiler(*codes[i]).Emit(*codes[i], "p" + std::to_string(i));
+    }
+    os << "static AotBody (*aot_body_at)(std::size_t) = nullptr;\n"
+       << "AotBody AotBodyAt(std::size_t entry) { return aot_body_at(entry); }"
+       << "\n\n"
+       << "int main(int argc, char* argv[]) {\n"
+       << "  switch (argc == 2 ? std::atoi(argv[1]) : -1) {\n";
+    for (std::size_t i = 0; i < codes.size(); i++) {
+      os << "    case " << i << ":\n"
+         << "      aot_body_at = &p" << i << "::BodyAt;\n"
+         << "      return p" << i << "::Main();\n";
+    }
+    os << "    default:\n"
+       << "      std::cerr << \"Expected the index of a program.\" << "
+       << "std::endl;\n"
+       << "      return 2;\n"
+       << "  }\n"
+       << "}\n";
+    return os.str();
+  }
+
+  // Writes the source of code next to exe and compiles it with the system
+  // compiler. include_dir holds aot_runtime.h. Returns the exit status of
+  // the compiler, 0 on success.
+  static int Build(const IrCode& code, const std::filesystem::path& exe,
+                   const std::string& include_dir = ".",
+                   const std::string& compiler = "c++ -std=c++20 -O2") {
+    return Compile(Transpile(code), exe, include_dir, compiler);
+  }
+
+  // Builds the programs into one executable, see TranspileBundle.
+  static int BuildBundle(const std::vector<const IrCode*>& codes,
+                         const std::filesystem::path& exe,
+                         const std::string& include_dir = ".",
+                         const std::string& compiler = "c++ -std=c++20 -O2") {
+    return Compile(TranspileBundle(codes), exe, include_dir, compiler);
+  }
+
+  // Whether the system compiler of Build runs.
+  static bool CompilerFound(const std::string& compiler = "c++") {
+#if defined(_WIN32)
+    auto command = compiler + " --version > NUL 2>&1";
+#else
+    auto command = compiler + " --version > /dev/null 2>&1";
+#endif
+    return std::system(command.c_str()) == 0;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_transpiler.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_IR_TRANSPILER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
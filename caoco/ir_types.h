@@ -0,0 +1,310 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_types.h
+//---------------------------------------------------------------------------//
+// Brief: Flow sensitive type inference of the local variables of the IR.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_IR_TYPES_H
+#define HEADER_GUARD_CAOCO_COMPILER_IR_TYPES_H
+// Includes:
+#include "import_stl.h"
+#include "ir_codegen.h"
+
+//=-------------------------------------------------------------------------=//
+// eIrType
+//---------------------------------------------------------------------------//
+// Static type of the value of an expression line. kAny when it is unknown,
+// or when evaluating the line throws.
+enum class eIrType { kUnknown, kInt, kDouble, kBool, kAny };
+
+constexpr std::string_view ToStr(eIrType type) {
+  switch (type) {
+    case eIrType::kUnknown:
+      return "unknown";
+    case eIrType::kInt:
+      return "int";
+    case eIrType::kDouble:
+      return "double";
+    case eIrType::kBool:
+      return "bool";
+    default:
+      return "any";
+  }
+}
+
+// Ops the evaluator applies to operands of a proven type without checking
+// their tags. Division and modulo still check for zero.
+constexpr bool IrOpIsTypedArithmetic(eIrOp op) {
+  switch (op) {
+    case eIrOp::BINARY_ADD:
+    case eIrOp::BINARY_SUB:
+    case eIrOp::BINARY_MUL:
+    case eIrOp::BINARY_EQ:
+    case eIrOp::BINARY_NE:
+    case eIrOp::BINARY_LT:
+    case eIrOp::BINARY_GT:
+    case eIrOp::BINARY_LE:
+    case eIrOp::BINARY_GE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+//=-------------------------------------------------------------------------=//
+// IrTypeInference
+//---------------------------------------------------------------------------//
+// Forward data flow over the statements of each frame: the program, each
+// method body and each class body. Only locals are typed, variables which
+// no other frame can reach: declarations in a scope of the program or of a
+// class body, and every declaration of a method body. Globals, members and
+// parameters are kAny, since calls and callers may assign them any value.
+// A local is typed from its declaration until its scope exits. Where paths
+// join, a local must be declared on every path with the same type.
+class IrTypeInference {
+  enum class eFrame { kProgram, kClass, kMethod };
+  struct Local {
+    eIrType type;
+    std::size_t depth;
+    bool operator==(const Local&) const = default;
+  };
+  struct State {
+    bool reached{false};
+    std::size_t depth{0};
+    std::map<std::string, Local> locals;
+  };
+
+  const std::vector<const IrLine*>& code_;
+  std::vector<State> in_;  // Statement index to the state before it.
+  std::vector<bool> visited_;
+  std::vector<eIrType> types_;
+
+  static eIrType Join(eIrType a, eIrType b) {
+    if (a == eIrType::kUnknown) return b;
+    if (b == eIrType::kUnknown) return a;
+    return a == b ? a : eIrType::kAny;
+  }
+
+  static const IrString& Name(const IrLine& line) {
+    return std::get<IrString>(
+        line.args.at(line.op == eIrOp::DECLARE_VARIABLE ? 1 : 0));
+  }
+
+  static eIrType OfLiteral(const IrVariant& literal) {
+    if (std::holds_alternative<IrInt>(literal)) return eIrType::kInt;
+    if (std::holds_alternative<IrDouble>(literal)) return eIrType::kDouble;
+    if (std::holds_alternative<IrBool>(literal)) return eIrType::kBool;
+    return eIrType::kAny;
+  }
+
+  // Matches the operators of RtVal, kAny where they throw.
+  static eIrType OfBinary(eIrOp op, eIrType lhs, eIrType rhs) {
+    if (lhs != rhs || lhs == eIrType::kAny) return eIrType::kAny;
+    bool numeric = lhs == eIrType::kInt || lhs == eIrType::kDouble;
+    switch (op) {
+      case eIrOp::BINARY_ADD:
+      case eIrOp::BINARY_SUB:
+      case eIrOp::BINARY_MUL:
+      case eIrOp::BINARY_DIV:
+        return numeric ? lhs : eIrType::kAny;
+      case eIrOp::BINARY_MOD:
+        return lhs == eIrType::kInt ? lhs : eIrType::kAny;
+      case eIrOp::BINARY_AND:
+      case eIrOp::BINARY_OR:
+        return lhs == eIrType::kBool ? lhs : eIrType::kAny;
+      default:
+        return eIrType::kBool;  // Comparisons.
+    }
+  }
+
+  eIrType TypeOf(std::size_t index, const State& state) const {
+    const IrLine& line = *code_[index];
+    switch (line.op) {
+      case eIrOp::ALLOCATE_LITERAL:
+        return line.args.size() == 1 ? OfLiteral(line.args[0])
+                                     : eIrType::kAny;
+      case eIrOp::LOAD_VARIABLE: {
+        auto local = state.locals.find(Name(line));
+        return local == state.locals.end() ? eIrType::kAny
+                                           : local->second.type;
+      }
+      case eIrOp::UNARY_NOT:
+        return line.OperandCount() == 1 &&
+                       TypeOf(line.OperandBegin(0), state) == eIrType::kBool
+                   ? eIrType::kBool
+                   : eIrType::kAny;
+      default:
+        if (!IrOpIsBinary(line.op) || line.OperandCount() != 2) {
+          return eIrType::kAny;
+        }
+        return OfBinary(line.op, TypeOf(line.OperandBegin(0), state),
+                        TypeOf(line.OperandBegin(1), state));
+    }
+  }
+
+  // Records the types of the expression lines of a reached statement.
+  void Record(std::size_t index, const State& state) {
+    const IrLine& line = *code_[index];
+    for (std::size_t i = 0; i < line.OperandCount(); i++) {
+      lambda xRecord = [&](auto& self, std::size_t operand) -> void {
+        types_[operand] = TypeOf(operand, state);
+        const IrLine& expr = *code_[operand];
+        for (std::size_t j = 0; j < expr.OperandCount(); j++) {
+          self(self, expr.OperandBegin(j));
+        }
+      };
+      xRecord(xRecord, line.OperandBegin(i));
+    }
+  }
+
+  State Transfer(std::size_t index, eFrame frame, State state) const {
+    const IrLine& line = *code_[index];
+    switch (line.op) {
+      case eIrOp::ENTER_SCOPE:
+        state.depth++;
+        break;
+      case eIrOp::EXIT_SCOPE:
+        std::erase_if(state.locals, [&](const auto& local) {
+          return local.second.depth == state.depth;
+        });
+        if (state.depth > 0) state.depth--;
+        break;
+      case eIrOp::DECLARE_VARIABLE: {
+        auto type = line.OperandCount() == 1
+                        ? TypeOf(line.OperandBegin(0), state)
+                        : eIrType::kAny;
+        if (frame == eFrame::kMethod || state.depth > 0) {
+          state.locals[Name(line)] = Local{type, state.depth};
+        } else {
+          state.locals.erase(Name(line));
+        }
+      } break;
+      case eIrOp::DEFINE_VARIABLE: {
+        // Assigns the innermost declaration, which is the local if any.
+        auto local = state.locals.find(Name(line));
+        if (local != state.locals.end()) {
+          local->second.type = line.OperandCount() == 1
+                                   ? TypeOf(line.OperandBegin(0), state)
+                                   : eIrType::kAny;
+        }
+      } break;
+      default:
+        break;
+    }
+    return state;
+  }
+
+  // Statements which may run next. Bodies are frames of their own.
+  std::vector<std::size_t> Successors(std::size_t index) const {
+    const IrLine& line = *code_[index];
+    std::size_t next = line.ExtentEnd() + 1;
+    lambda xTarget = [&](std::size_t arg) {
+      return static_cast<std::size_t>(std::get<IrInt>(line.args.at(arg)));
+    };
+    switch (line.op) {
+      case eIrOp::JUMP:
+        return {xTarget(0)};
+      case eIrOp::JUMP_IF_FALSE:
+        return {xTarget(0), next};
+      case eIrOp::DECLARE_METHOD:
+      case eIrOp::DECLARE_OBJECT:
+        return {xTarget(1)};
+      case eIrOp::RETURN:
+      case eIrOp::TAIL_CALL:
+      case eIrOp::ABORT_AND_ERROR:
+        return {};
+      default:
+        return {next};
+    }
+  }
+
+  // Returns true if the state before index changed.
+  bool Merge(std::size_t index, const State& state) {
+    auto& in = in_[index];
+    if (!in.reached) {
+      in = state;
+      return true;
+    }
+    bool changed = false;
+    for (auto it = in.locals.begin(); it != in.locals.end();) {
+      auto other = state.locals.find(it->first);
+      if (other == state.locals.end() ||
+          other->second.depth != it->second.depth) {
+        it = in.locals.erase(it);
+        changed = true;
+        continue;
+      }
+      auto type = Join(it->second.type, other->second.type);
+      if (type != it->second.type) {
+        it->second.type = type;
+        changed = true;
+      }
+      ++it;
+    }
+    return changed;
+  }
+
+  void RunFrame(std::size_t entry, eFrame frame) {
+    if (entry >= code_.size()) return;
+    State start;
+    start.reached = true;
+    Merge(entry, start);
+    std::vector<std::size_t> worklist{entry};
+    std::vector<std::size_t> statements;
+    while (!worklist.empty()) {
+      auto index = worklist.back();
+      worklist.pop_back();
+      if (!visited_[index]) statements.push_back(index);
+      visited_[index] = true;
+      auto out = Transfer(index, frame, in_[index]);
+      for (auto next : Successors(index)) {
+        if (next < code_.size() && Merge(next, out)) worklist.push_back(next);
+      }
+    }
+    for (auto index : statements) Record(index, in_[index]);
+  }
+
+  explicit IrTypeInference(const std::vector<const IrLine*>& code)
+      : code_(code),
+        in_(code.size()),
+        visited_(code.size(), false),
+        types_(code.size(), eIrType::kAny) {}
+
+ public:
+  // Type of the value of each line, kAny for lines which are not
+  // expressions or which no frame reaches.
+  static std::vector<eIrType> Infer(const std::vector<const IrLine*>& code) {
+    IrTypeInference inference(code);
+    inference.RunFrame(0, eFrame::kProgram);
+    for (std::size_t i = 0; i < code.size(); i++) {
+      if (code[i]->op == eIrOp::DECLARE_METHOD) {
+        inference.RunFrame(i + 1, eFrame::kMethod);
+      } else if (code[i]->op == eIrOp::DECLARE_OBJECT) {
+        inference.RunFrame(i + 1, eFrame::kClass);
+      }
+    }
+    return std::move(inference.types_);
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: ir_types.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_IR_TYPES_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
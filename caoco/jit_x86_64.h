@@ -0,0 +1,621 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: jit_x86_64.h
+//---------------------------------------------------------------------------//
+// Brief: Baseline template JIT of hot IR regions for x86-64 Linux.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_JIT_X86_64_H
+#define HEADER_GUARD_CAOCO_COMPILER_JIT_X86_64_H
+// Includes:
+#include "cand_lang.h"
+#include "import_stl.h"
+#include "ir_codegen.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define CAOCO_JIT_SUPPORTED 1
+#else
+#define CAOCO_JIT_SUPPORTED 0
+#endif
+
+// Compile every region on its first loop back edge or call. Build the suite
+// with -DCAOCO_JIT_FORCE=1 to check that the JIT never changes a result.
+#ifndef CAOCO_JIT_FORCE
+#define CAOCO_JIT_FORCE 0
+#endif
+
+//=-------------------------------------------------------------------------=//
+// Overview
+//---------------------------------------------------------------------------//
+// A region is a run of consecutive statements starting at a loop header or
+// a method entry, made of DEFINE_VARIABLE, JUMP and JUMP_IF_FALSE over int
+// and bool variables and literals, and of ENTER_SCOPE and EXIT_SCOPE. It
+// ends at the first other statement. A region declares nothing, so its
+// scopes are never created: an exit inside a scope reports its depth and
+// the evaluator creates them before it continues.
+// Each IR op has a machine code template over a value stack on the native
+// stack. Variables stay in their RtVal: the evaluator passes a table with
+// the address of the native value of each variable of the region, after a
+// guard checked that the variable still exists with the compiled type.
+// The code returns the line index at which the interpreter continues: a
+// jump out of the region, the statement which ends it, or a statement that
+// deoptimized. A statement deoptimizes before it stores anything, on int
+// overflow or on a division by zero or by -1, so the interpreter re-executes
+// it with the exact runtime semantics (and errors).
+static constexpr std::size_t kJitDefaultThreshold = CAOCO_JIT_FORCE ? 1 : 100;
+static constexpr std::size_t kJitMaxDeopts = 64;
+static constexpr std::size_t kJitMaxGuardFailures = 64;
+
+struct JitOptions {
+  bool enabled{CAOCO_JIT_SUPPORTED == 1};
+  // Loop back edges to a line, or calls of a method, before it is compiled.
+  std::size_t threshold{kJitDefaultThreshold};
+};
+
+// Where the interpreter continues after running a region.
+struct JitExit {
+  std::size_t next;    // Line index.
+  bool deopt;          // The statement at next failed in native code.
+  std::size_t scopes;  // Scopes entered by the region and not yet exited.
+};
+
+//=-------------------------------------------------------------------------=//
+// JitCodeBuffer
+//---------------------------------------------------------------------------//
+// Executable copy of machine code, in its own mmap'ed pages.
+class JitCodeBuffer {
+  void* memory_{nullptr};
+  std::size_t size_{0};
+
+ public:
+  JitCodeBuffer() = default;
+  explicit JitCodeBuffer(const std::vector<std::uint8_t>& bytes) {
+#if CAOCO_JIT_SUPPORTED
+    void* memory = mmap(nullptr, bytes.size(), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return;
+    std::copy(bytes.begin(), bytes.end(), static_cast<std::uint8_t*>(memory));
+    if (mprotect(memory, bytes.size(), PROT_READ | PROT_EXEC) != 0) {
+      munmap(memory, bytes.size());
+      return;
+    }
+    memory_ = memory;
+    size_ = bytes.size();
+#endif
+  }
+  JitCodeBuffer(const JitCodeBuffer&) = delete;
+  JitCodeBuffer& operator=(const JitCodeBuffer&) = delete;
+  ~JitCodeBuffer() {
+#if CAOCO_JIT_SUPPORTED
+    if (memory_ != nullptr) munmap(memory_, size_);
+#endif
+  }
+
+  bool Valid() const { return memory_ != nullptr; }
+  std::size_t Size() const { return size_; }
+  const void* Data() const { return memory_; }
+};
+
+//=-------------------------------------------------------------------------=//
+// JitAssembler
+//---------------------------------------------------------------------------//
+// Emits the few x86-64 instructions used by the templates. Registers: rdi
+// holds the slot table, rax rcx rdx are scratch, r11 saves rsp at entry so
+// that an exit can drop the value stack.
+class JitAssembler {
+ public:
+  using Label = std::size_t;
+  enum class eCond : std::uint8_t {
+    kOverflow = 0x0,
+    kEqual = 0x4,
+    kNotEqual = 0x5,
+    kLess = 0xC,
+    kGreaterEqual = 0xD,
+    kLessEqual = 0xE,
+    kGreater = 0xF,
+  };
+
+ private:
+  std::vector<std::uint8_t> bytes_;
+  std::vector<std::optional<std::size_t>> labels_;
+  std::vector<std::pair<std::size_t, Label>> fixups_;  // rel32 offset, label.
+
+  void Byte(std::uint8_t byte) { bytes_.push_back(byte); }
+  void Bytes(std::initializer_list<std::uint8_t> bytes) {
+    bytes_.insert(bytes_.end(), bytes);
+  }
+  void Imm32(std::int32_t value) {
+    for (int i = 0; i < 4; i++) {
+      Byte(static_cast<std::uint8_t>(static_cast<std::uint32_t>(value) >>
+                                     (8 * i)));
+    }
+  }
+  void Rel32(Label label) {
+    fixups_.emplace_back(bytes_.size(), label);
+    Imm32(0);
+  }
+  static std::int32_t SlotOffset(std::size_t slot) {
+    return static_cast<std::int32_t>(slot * sizeof(void*));
+  }
+
+ public:
+  Label NewLabel() {
+    labels_.push_back(std::nullopt);
+    return labels_.size() - 1;
+  }
+  void Bind(Label label) { labels_[label] = bytes_.size(); }
+
+  // Value stack.
+  void PushRax() { Byte(0x50); }
+  void PopRax() { Byte(0x58); }
+  void PopRcx() { Byte(0x59); }
+
+  void Prologue() { Bytes({0x49, 0x89, 0xE3}); }  // mov r11, rsp
+  // mov rsp, r11; mov rax, exit; ret. See JitRegion::Run for the encoding
+  // of the exit.
+  void Exit(std::size_t next, bool deopt, std::size_t scopes) {
+    Bytes({0x4C, 0x89, 0xDC});
+    Bytes({0x48, 0xB8});
+    std::uint64_t exit = (next & 0xFFFFFFFFu) |
+                         (static_cast<std::uint64_t>(deopt) << 32) |
+                         (static_cast<std::uint64_t>(scopes & 0xFFFFu) << 40);
+    for (int i = 0; i < 8; i++) {
+      Byte(static_cast<std::uint8_t>(exit >> (8 * i)));
+    }
+    Byte(0xC3);
+  }
+
+  void MovEaxImm(std::int32_t value) {
+    Byte(0xB8);
+    Imm32(value);
+  }
+  // eax = *slots[slot], an int or a bool.
+  void LoadSlot(std::size_t slot, bool is_bool) {
+    Bytes({0x48, 0x8B, 0x87});  // mov rax, [rdi + disp32]
+    Imm32(SlotOffset(slot));
+    if (is_bool) {
+      Bytes({0x0F, 0xB6, 0x00});  // movzx eax, byte [rax]
+    } else {
+      Bytes({0x8B, 0x00});  // mov eax, [rax]
+    }
+  }
+  // *slots[slot] = eax, an int or a bool.
+  void StoreSlot(std::size_t slot, bool is_bool) {
+    Bytes({0x48, 0x8B, 0x97});  // mov rdx, [rdi + disp32]
+    Imm32(SlotOffset(slot));
+    if (is_bool) {
+      Bytes({0x88, 0x02});  // mov [rdx], al
+    } else {
+      Bytes({0x89, 0x02});  // mov [rdx], eax
+    }
+  }
+  // slots[slot] = value, a plain integer cell of the table.
+  void StoreCell(std::size_t slot, std::int32_t value) {
+    Bytes({0x48, 0xC7, 0x87});  // mov qword [rdi + disp32], imm32
+    Imm32(SlotOffset(slot));
+    Imm32(value);
+  }
+
+  void AddEaxEcx() { Bytes({0x01, 0xC8}); }
+  void SubEaxEcx() { Bytes({0x29, 0xC8}); }
+  void ImulEaxEcx() { Bytes({0x0F, 0xAF, 0xC1}); }
+  // edx:eax = sign extension of eax; eax, edx = eax / ecx, eax % ecx
+  void IdivEcx() { Bytes({0x99, 0xF7, 0xF9}); }
+  void MovEaxEdx() { Bytes({0x89, 0xD0}); }
+  void CmpEaxEcx() { Bytes({0x39, 0xC8}); }
+  void CmpEcxImm8(std::int8_t value) {
+    Bytes({0x83, 0xF9, static_cast<std::uint8_t>(value)});
+  }
+  void TestEaxEax() { Bytes({0x85, 0xC0}); }
+  void TestEcxEcx() { Bytes({0x85, 0xC9}); }
+  void XorEaxImm8(std::uint8_t value) { Bytes({0x83, 0xF0, value}); }
+  // eax = condition ? 1 : 0
+  void SetEax(eCond cond) {
+    Bytes({0x0F, static_cast<std::uint8_t>(0x90 | static_cast<int>(cond)),
+           0xC0});
+    Bytes({0x0F, 0xB6, 0xC0});  // movzx eax, al
+  }
+
+  void Jmp(Label label) {
+    Byte(0xE9);
+    Rel32(label);
+  }
+  void Jcc(eCond cond, Label label) {
+    Bytes({0x0F, static_cast<std::uint8_t>(0x80 | static_cast<int>(cond))});
+    Rel32(label);
+  }
+
+  // Machine code with every label resolved, empty if a label is unbound.
+  std::vector<std::uint8_t> Finish() {
+    for (const auto& [offset, label] : fixups_) {
+      if (!labels_[label].has_value()) return {};
+      auto rel = static_cast<std::int32_t>(*labels_[label]) -
+                 static_cast<std::int32_t>(offset + 4);
+      for (int i = 0; i < 4; i++) {
+        bytes_[offset + i] = static_cast<std::uint8_t>(
+            static_cast<std::uint32_t>(rel) >> (8 * i));
+      }
+    }
+    return bytes_;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// JitRegion
+//---------------------------------------------------------------------------//
+// Compiled region and its runtime statistics.
+class JitRegion {
+  using EntryT = std::uint64_t (*)(void**);
+
+  std::size_t start_;
+  std::vector<std::string> names_;  // Variable of each slot.
+  std::vector<int> types_;          // Compiled RtVal type of each slot.
+  std::size_t statements_;
+  JitCodeBuffer code_;
+  std::size_t entries_{0};
+  std::size_t deopts_{0};
+  std::size_t guard_failures_{0};
+
+ public:
+  JitRegion(std::size_t start, std::vector<std::string> names,
+            std::vector<int> types, std::size_t statements,
+            const std::vector<std::uint8_t>& bytes)
+      : start_(start),
+        names_(std::move(names)),
+        types_(std::move(types)),
+        statements_(statements),
+        code_(bytes) {}
+
+  std::size_t Start() const { return start_; }
+  std::size_t Statements() const { return statements_; }
+  std::size_t SlotCount() const { return names_.size(); }
+  const std::string& Name(std::size_t slot) const { return names_[slot]; }
+  int Type(std::size_t slot) const { return types_[slot]; }
+  std::size_t CodeSize() const { return code_.Size(); }
+
+  std::size_t Entries() const { return entries_; }
+  std::size_t Deopts() const { return deopts_; }
+  std::size_t GuardFailures() const { return guard_failures_; }
+  // A region which keeps failing is left to the interpreter.
+  bool Valid() const {
+    return code_.Valid() && deopts_ < kJitMaxDeopts &&
+           guard_failures_ < kJitMaxGuardFailures;
+  }
+  void GuardFailed() { guard_failures_++; }
+
+  // slots holds SlotCount() value addresses followed by the result cell,
+  // which receives the slot of the last variable defined, or -1.
+  JitExit Run(void** slots) {
+    entries_++;
+    auto entry = reinterpret_cast<EntryT>(const_cast<void*>(code_.Data()));
+    std::uint64_t exit = entry(slots);
+    JitExit result{static_cast<std::size_t>(exit & 0xFFFFFFFFu),
+                   ((exit >> 32) & 1) != 0,
+                   static_cast<std::size_t>((exit >> 40) & 0xFFFFu)};
+    if (result.deopt) deopts_++;
+    return result;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// JitCompiler
+//---------------------------------------------------------------------------//
+class JitCompiler {
+ public:
+  // RtVal type of a variable where the region is entered, -1 if not found.
+  using TypeOfT = std::function<int(const std::string&)>;
+
+ private:
+  using Asm = JitAssembler;
+  static constexpr int kNoType = -1;
+
+  const std::vector<const IrLine*>& code_;
+  TypeOfT type_of_;
+  Asm as_;
+  std::vector<std::string> names_;
+  std::vector<int> types_;
+  std::unordered_map<std::string, std::size_t> slots_;
+  std::map<std::size_t, Asm::Label> statements_;  // Start line to label.
+  std::map<std::size_t, std::size_t> depths_;     // Start line to scopes.
+  std::map<std::pair<std::size_t, std::size_t>, Asm::Label> exits_;
+
+  JitCompiler(const std::vector<const IrLine*>& code, TypeOfT type_of)
+      : code_(code), type_of_(std::move(type_of)) {}
+
+  static bool IsName(const IrLine& line, std::size_t arg) {
+    return arg < line.args.size() &&
+           std::holds_alternative<IrString>(line.args[arg]);
+  }
+
+  // Slot of a variable, added with its current type. nullopt if the
+  // variable is not an int or a bool.
+  std::optional<std::size_t> Slot(const std::string& name) {
+    if (auto found = slots_.find(name); found != slots_.end()) {
+      return found->second;
+    }
+    int type = type_of_(name);
+    if (type != RtVal::kInt && type != RtVal::kBool) return std::nullopt;
+    names_.push_back(name);
+    types_.push_back(type);
+    slots_[name] = names_.size() - 1;
+    return names_.size() - 1;
+  }
+
+  // Static type of the expression at index, kNoType if it can't be compiled.
+  int TypeOf(std::size_t index) {
+    if (index >= code_.size()) return kNoType;
+    const IrLine& line = *code_[index];
+    switch (line.op) {
+      case eIrOp::ALLOCATE_LITERAL:
+        if (line.args.size() != 1) return kNoType;
+        if (std::holds_alternative<IrInt>(line.args[0])) return RtVal::kInt;
+        if (std::holds_alternative<IrBool>(line.args[0])) return RtVal::kBool;
+        return kNoType;
+      case eIrOp::LOAD_VARIABLE: {
+        if (line.args.size() != 1 || !IsName(line, 0)) return kNoType;
+        auto slot = Slot(std::get<IrString>(line.args[0]));
+        return slot ? types_[*slot] : kNoType;
+      }
+      case eIrOp::UNARY_NOT:
+        if (line.OperandCount() != 1) return kNoType;
+        return TypeOf(line.OperandBegin(0)) == RtVal::kBool ? RtVal::kBool
+                                                            : kNoType;
+      default:
+        break;
+    }
+    if (!IrOpIsBinary(line.op) || line.OperandCount() != 2) return kNoType;
+    int lhs = TypeOf(line.OperandBegin(0));
+    int rhs = TypeOf(line.OperandBegin(1));
+    if (lhs == kNoType || lhs != rhs) return kNoType;
+    switch (line.op) {
+      case eIrOp::BINARY_ADD:
+      case eIrOp::BINARY_SUB:
+      case eIrOp::BINARY_MUL:
+      case eIrOp::BINARY_DIV:
+      case eIrOp::BINARY_MOD:
+        return lhs == RtVal::kInt ? RtVal::kInt : kNoType;
+      case eIrOp::BINARY_AND:
+      case eIrOp::BINARY_OR:
+        return lhs == RtVal::kBool ? RtVal::kBool : kNoType;
+      default:
+        return RtVal::kBool;  // Comparisons.
+    }
+  }
+
+  // depth is the scope depth before the statement, relative to the start.
+  bool IsSupported(std::size_t index, std::size_t depth) {
+    const IrLine& line = *code_[index];
+    switch (line.op) {
+      case eIrOp::ENTER_SCOPE:
+        return true;
+      case eIrOp::EXIT_SCOPE:
+        return depth > 0;
+      case eIrOp::DEFINE_VARIABLE: {
+        if (!IsName(line, 0) || line.OperandCount() != 1) return false;
+        auto slot = Slot(std::get<IrString>(line.args[0]));
+        return slot && TypeOf(line.OperandBegin(0)) == types_[*slot];
+      }
+      case eIrOp::JUMP:
+        return !line.args.empty() &&
+               std::holds_alternative<IrInt>(line.args[0]);
+      case eIrOp::JUMP_IF_FALSE:
+        return !line.args.empty() &&
+               std::holds_alternative<IrInt>(line.args[0]) &&
+               line.OperandCount() == 1 &&
+               TypeOf(line.OperandBegin(0)) == RtVal::kBool;
+      default:
+        return false;
+    }
+  }
+
+  // Label of a jump target: its statement in the region, else an exit.
+  // Jumps never cross a scope boundary, the target is at the same depth.
+  Asm::Label Target(IrInt target, std::size_t depth) {
+    auto next = static_cast<std::size_t>(std::max(target, 0));
+    if (auto found = statements_.find(next); found != statements_.end()) {
+      return found->second;
+    }
+    auto key = std::make_pair(next, depth);
+    if (auto found = exits_.find(key); found != exits_.end()) {
+      return found->second;
+    }
+    return exits_[key] = as_.NewLabel();
+  }
+
+  // Pushes the value of the expression at index.
+  void EmitExpr(std::size_t index, Asm::Label deopt) {
+    const IrLine& line = *code_[index];
+    switch (line.op) {
+      case eIrOp::ALLOCATE_LITERAL:
+        if (std::holds_alternative<IrInt>(line.args[0])) {
+          as_.MovEaxImm(std::get<IrInt>(line.args[0]));
+        } else {
+          as_.MovEaxImm(std::get<IrBool>(line.args[0]).value ? 1 : 0);
+        }
+        as_.PushRax();
+        return;
+      case eIrOp::LOAD_VARIABLE: {
+        auto slot = slots_.at(std::get<IrString>(line.args[0]));
+        as_.LoadSlot(slot, types_[slot] == RtVal::kBool);
+        as_.PushRax();
+        return;
+      }
+      case eIrOp::UNARY_NOT:
+        EmitExpr(line.OperandBegin(0), deopt);
+        as_.PopRax();
+        as_.XorEaxImm8(1);
+        as_.PushRax();
+        return;
+      case eIrOp::BINARY_AND:
+      case eIrOp::BINARY_OR: {
+        // The right operand only runs when the left one does not decide.
+        auto shortcut = as_.NewLabel();
+        auto done = as_.NewLabel();
+        EmitExpr(line.OperandBegin(0), deopt);
+        as_.PopRax();
+        as_.TestEaxEax();
+        as_.Jcc(line.op == eIrOp::BINARY_AND ? Asm::eCond::kEqual
+                                             : Asm::eCond::kNotEqual,
+                shortcut);
+        EmitExpr(line.OperandBegin(1), deopt);
+        as_.Jmp(done);
+        as_.Bind(shortcut);
+        as_.PushRax();
+        as_.Bind(done);
+        return;
+      }
+      default:
+        break;
+    }
+
+    EmitExpr(line.OperandBegin(0), deopt);
+    EmitExpr(line.OperandBegin(1), deopt);
+    as_.PopRcx();
+    as_.PopRax();
+    switch (line.op) {
+      case eIrOp::BINARY_ADD:
+        as_.AddEaxEcx();
+        as_.Jcc(Asm::eCond::kOverflow, deopt);
+        break;
+      case eIrOp::BINARY_SUB:
+        as_.SubEaxEcx();
+        as_.Jcc(Asm::eCond::kOverflow, deopt);
+        break;
+      case eIrOp::BINARY_MUL:
+        as_.ImulEaxEcx();
+        as_.Jcc(Asm::eCond::kOverflow, deopt);
+        break;
+      case eIrOp::BINARY_DIV:
+      case eIrOp::BINARY_MOD:
+        as_.TestEcxEcx();
+        as_.Jcc(Asm::eCond::kEqual, deopt);
+        as_.CmpEcxImm8(-1);
+        as_.Jcc(Asm::eCond::kEqual, deopt);
+        as_.IdivEcx();
+        if (line.op == eIrOp::BINARY_MOD) as_.MovEaxEdx();
+        break;
+      case eIrOp::BINARY_EQ:
+        as_.CmpEaxEcx();
+        as_.SetEax(Asm::eCond::kEqual);
+        break;
+      case eIrOp::BINARY_NE:
+        as_.CmpEaxEcx();
+        as_.SetEax(Asm::eCond::kNotEqual);
+        break;
+      case eIrOp::BINARY_LT:
+        as_.CmpEaxEcx();
+        as_.SetEax(Asm::eCond::kLess);
+        break;
+      case eIrOp::BINARY_GT:
+        as_.CmpEaxEcx();
+        as_.SetEax(Asm::eCond::kGreater);
+        break;
+      case eIrOp::BINARY_LE:
+        as_.CmpEaxEcx();
+        as_.SetEax(Asm::eCond::kLessEqual);
+        break;
+      case eIrOp::BINARY_GE:
+        as_.CmpEaxEcx();
+        as_.SetEax(Asm::eCond::kGreaterEqual);
+        break;
+      default:
+        break;
+    }
+    as_.PushRax();
+  }
+
+  void EmitStatement(std::size_t index, Asm::Label deopt) {
+    const IrLine& line = *code_[index];
+    switch (line.op) {
+      case eIrOp::DEFINE_VARIABLE: {
+        auto slot = slots_.at(std::get<IrString>(line.args[0]));
+        EmitExpr(line.OperandBegin(0), deopt);
+        as_.PopRax();
+        as_.StoreSlot(slot, types_[slot] == RtVal::kBool);
+        as_.StoreCell(names_.size(), static_cast<std::int32_t>(slot));
+      } break;
+      case eIrOp::JUMP:
+        as_.Jmp(Target(std::get<IrInt>(line.args[0]), depths_[index]));
+        break;
+      case eIrOp::JUMP_IF_FALSE:
+        EmitExpr(line.OperandBegin(0), deopt);
+        as_.PopRax();
+        as_.TestEaxEax();
+        as_.Jcc(Asm::eCond::kEqual,
+                Target(std::get<IrInt>(line.args[0]), depths_[index]));
+        break;
+      default:
+        break;
+    }
+  }
+
+ public:
+  // Compiles the region starting at the statement start. Returns null when
+  // it has no statement to compile or the platform has no JIT.
+  static std::unique_ptr<JitRegion> Compile(
+      const std::vector<const IrLine*>& code, std::size_t start,
+      TypeOfT type_of) {
+    if (!CAOCO_JIT_SUPPORTED || start >= code.size()) return nullptr;
+    JitCompiler compiler(code, std::move(type_of));
+    auto& as = compiler.as_;
+
+    std::vector<std::size_t> statements;
+    std::size_t end = start;
+    std::size_t depth = 0;
+    while (end < code.size() && compiler.IsSupported(end, depth)) {
+      statements.push_back(end);
+      compiler.statements_[end] = as.NewLabel();
+      compiler.depths_[end] = depth;
+      if (code[end]->op == eIrOp::ENTER_SCOPE) depth++;
+      if (code[end]->op == eIrOp::EXIT_SCOPE) depth--;
+      end = code[end]->ExtentEnd() + 1;
+    }
+    if (statements.empty()) return nullptr;
+
+    std::vector<Asm::Label> deopts;
+    as.Prologue();
+    for (auto statement : statements) {
+      deopts.push_back(as.NewLabel());
+      as.Bind(compiler.statements_[statement]);
+      compiler.EmitStatement(statement, deopts.back());
+    }
+    as.Jmp(compiler.Target(static_cast<IrInt>(end), depth));
+    for (std::size_t i = 0; i < statements.size(); i++) {
+      as.Bind(deopts[i]);
+      as.Exit(statements[i], true, compiler.depths_[statements[i]]);
+    }
+    for (const auto& [key, label] : compiler.exits_) {
+      as.Bind(label);
+      as.Exit(key.first, false, key.second);
+    }
+
+    auto bytes = as.Finish();
+    if (bytes.empty()) return nullptr;
+    auto region = std::make_unique<JitRegion>(
+        start, std::move(compiler.names_), std::move(compiler.types_),
+        statements.size(), bytes);
+    return region;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: jit_x86_64.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_JIT_X86_64_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -27,11 +27,11 @@
 
 class LarkParser {
   using InternalParseResult = PartialExpected<Ast, TkCursor>;
-  static constexpr inline InternalParseResult Success(TkCursor crs,
+  static inline InternalParseResult Success(TkCursor crs,
                                                       const Ast& nd) {
     return InternalParseResult::Success(crs, nd);
   }
-  static constexpr inline InternalParseResult Failure(TkCursor crs,
+  static inline InternalParseResult Failure(TkCursor crs,
                                                       const std::string& err) {
     return InternalParseResult::Failure(crs, err);
   }
@@ -528,6 +528,7 @@ class LarkParser {
               FirstOperatorSwitch();
               next_expected_head_token_ = eNextExpectedHeadToken::kOperator;
             }
+            return action_result;
           }
           // Binary Operator -> Check, next is Operative.
           else if (c.Operation() == eOperation::kBinary) {
@@ -539,6 +540,7 @@ class LarkParser {
             }
             FirstOperatorSwitch();
             next_expected_head_token_ = eNextExpectedHeadToken::kOperative;
+            return action_result;
           }
           // Prefix -> user Error, prefix following operand.
           else if (c.Operation() == eOperation::kPrefix) {
@@ -1062,7 +1064,7 @@ LarkParser::InternalParseResult LarkParser::ParseOperand(TkCursor c) {
     return Success(c.Next(), c.Get());
   else
     return Failure(c,
-                   xProgrammerLogicError(eAst::kValue, c.Iter(),
+                   xProgrammerLogicError(eAst::kValue, c,
                                          "Could not parse singular operand."));
 };
 
@@ -1075,8 +1077,8 @@ LarkParser::InternalParseResult LarkParser::ParseArguments(TkCursor c) {
 
     std::vector<TkScope> arg_scopes =
         TkScope::find_seperated_paren(c, eTk::kComma);
-    if (not arg_scopes.front()) {
-      return Failure(c, xMismatchedParentheses(c.Iter()));
+    if (not arg_scopes.back()) {  // An invalid scope ends the list.
+      return Failure(c, xMismatchedParentheses(c));
     } else {
       Ast arguments_node = eAst::kArguments;
       for (const TkScope& arg_scope : arg_scopes) {
@@ -1091,7 +1093,7 @@ LarkParser::InternalParseResult LarkParser::ParseArguments(TkCursor c) {
       return Success(c.Advance(arg_scopes.back().End()), arguments_node);
     }
   } else {
-    return Failure(c, xProgrammerLogicError(eAst::kExpression, c.Iter()));
+    return Failure(c, xProgrammerLogicError(eAst::kExpression, c));
   }
 }
 
@@ -1104,9 +1106,9 @@ LarkParser::InternalParseResult LarkParser::ParseIndexingArguments(TkCursor c) {
 
     std::vector<TkScope> arg_scopes =
         TkScope::find_seperated_bracket(c, eTk::kComma);
-    if (!arg_scopes.front().Valid()) {
+    if (!arg_scopes.back().Valid()) {
       return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                            c.Iter(),
+                            c,
                             "[LarkParser::ParseIndexingArguments] Mismatched "
                             "brackets in indexing call."));
     } else {
@@ -1126,7 +1128,7 @@ LarkParser::InternalParseResult LarkParser::ParseIndexingArguments(TkCursor c) {
     }
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(),
+                          Ast(c.Get()).Type(), c,
                           "[LarkParser::ParseIndexingArguments] Token on begin "
                           "cursor does not evaluate to an indexing argument "
                           "node."));
@@ -1142,9 +1144,9 @@ LarkParser::InternalParseResult LarkParser::ParseListingArguments(TkCursor c) {
 
     std::vector<TkScope> arg_scopes =
         TkScope::find_seperated_brace(c, eTk::kComma);
-    if (!arg_scopes.front().Valid()) {
+    if (!arg_scopes.back().Valid()) {
       return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                            c.Iter(),
+                            c,
                             "[LarkParser::ParseListingArguments] Mismatched "
                             "brackets in indexing call."));
     } else {
@@ -1164,7 +1166,7 @@ LarkParser::InternalParseResult LarkParser::ParseListingArguments(TkCursor c) {
     }
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(),
+                          Ast(c.Get()).Type(), c,
                           "[LarkParser::ParseListingArguments] Token on begin "
                           "cursor does not evaluate to an indexing argument "
                           "node."));
@@ -1185,7 +1187,7 @@ LarkParser::InternalParseResult LarkParser::ParsePrimaryStatement(TkCursor c) {
       if (!statement_result.Valid()) {
         return Failure(c,
                        compiler_error::parser::xProgrammerLogicError(
-                           Ast(c.Get()).Type(), c.Iter(),
+                           Ast(c.Get()).Type(), c,
                            "[LarkParser::ParsePrimaryStatement] Error parsing "
                            "primary statement.\n" +
                                statement_result.Error()));
@@ -1194,14 +1196,14 @@ LarkParser::InternalParseResult LarkParser::ParsePrimaryStatement(TkCursor c) {
                      statement_result.Extract());
     } else {
       return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                            c.Iter(),
+                            c,
                             "[LarkParser::ParsePrimaryStatement] Mismatched "
                             "parentheses in primary statement." +
                                 statement_scope.Error()));
     }
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(),
+                          Ast(c.Get()).Type(), c,
                           "[LarkParser::ParsePrimaryStatement] Token on begin "
                           "cursor does not evaluate to a primary statement "
                           "node."));
@@ -1217,7 +1219,7 @@ LarkParser::InternalParseResult LarkParser::ParseConditionalSubExpression(
           {paren_scope.ContainedBegin(), paren_scope.ContainedEnd()});
       if (!subexpr_result.Valid()) {
         return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                              Ast(c.Get()).Type(), c.Iter(),
+                              Ast(c.Get()).Type(), c,
                               "[ParseConditionalSubExpression] Error parsing "
                               "conditional subexpression.\n" +
                                   subexpr_result.Error()));
@@ -1227,11 +1229,11 @@ LarkParser::InternalParseResult LarkParser::ParseConditionalSubExpression(
       return Failure(
           c,
           compiler_error::parser::xUserSyntaxError(
-              c.Iter(), "Invalid begining of conditional primary expression."));
+              c, "Invalid begining of conditional primary expression."));
     }
   } else {
     return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                          c.Iter(),
+                          c,
                           "[ParseConditionalSubExpression] Mismatched "
                           "parentheses in conditional subexpression."));
   }
@@ -1248,7 +1250,7 @@ LarkParser::InternalParseResult LarkParser::ParsePrimaryPreIdentifier(
           {statement_scope.Begin(), statement_scope.ContainedEnd()});
       if (!statement_result.Valid()) {
         return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                              Ast(c.Get()).Type(), c.Iter(),
+                              Ast(c.Get()).Type(), c,
                               "[ParsePrimaryPreIdentifier] Error parsing "
                               "primary PreIdentifier.\n" +
                                   statement_result.Error()));
@@ -1257,7 +1259,7 @@ LarkParser::InternalParseResult LarkParser::ParsePrimaryPreIdentifier(
                      statement_result.Extract());
     } else {
       return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                            c.Iter(),
+                            c,
                             "[ParsePrimaryPreIdentifier] Mismatched "
                             "parentheses in primary PreIdentifier." +
                                 statement_scope.Error()));
@@ -1271,7 +1273,7 @@ LarkParser::InternalParseResult LarkParser::ParsePrimaryPreIdentifier(
 
     return Failure(
         c, compiler_error::parser::xProgrammerLogicError(
-               Ast(c.Get()).Type(), c.Iter(), "[ParsePrimaryPreIdentifier]"));
+               Ast(c.Get()).Type(), c, "[ParsePrimaryPreIdentifier]"));
   }
 }
 
@@ -1286,7 +1288,7 @@ LarkParser::InternalParseResult LarkParser::ParsePrimaryPostIdentifier(
           {statement_scope.Begin(), statement_scope.ContainedEnd()});
       if (!statement_result.Valid()) {
         return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                              Ast(c.Get()).Type(), c.Iter(),
+                              Ast(c.Get()).Type(), c,
                               "[ParsePrimaryPostIdentifier] Error parsing "
                               "primary PreIdentifier.\n" +
                                   statement_result.Error()));
@@ -1303,7 +1305,7 @@ LarkParser::InternalParseResult LarkParser::ParsePrimaryPostIdentifier(
                      statement_result.Extract());
     } else {
       return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                            c.Iter(),
+                            c,
                             "[ParsePrimaryPostIdentifier] Mismatched "
                             "parentheses in primary PreIdentifier." +
                                 statement_scope.Error()));
@@ -1315,7 +1317,7 @@ LarkParser::InternalParseResult LarkParser::ParsePrimaryPostIdentifier(
     }
 
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(),
+                          Ast(c.Get()).Type(), c,
                           "[ParsePrimaryPostIdentifier]expected colon"));
   }
 }
@@ -1330,7 +1332,7 @@ LarkParser::InternalParseResult LarkParser::ParseModifiers(TkCursor c) {
     return Success(c, modifiers_node);
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(),
+                          Ast(c.Get()).Type(), c,
                           "[LarkParser::ParseModifiers] Token on begin cursor "
                           "does not evaluate to a modifier node."));
   }
@@ -1350,7 +1352,7 @@ LarkParser::InternalParseResult LarkParser::ParseReturnStmt(TkCursor c) {
     InternalParseResult value_expr_result = ParsePrimaryStatement(c);
     if (!value_expr_result) {
       return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                            Ast(c.Get()).Type(), c.Iter(),
+                            Ast(c.Get()).Type(), c,
                             "[LarkParser::ParseReturnStmt] Error parsing "
                             "value expression.\n" +
                                 value_expr_result.Error()));
@@ -1413,12 +1415,12 @@ LarkParser::InternalParseResult LarkParser::ParsePragmaticStmt(TkCursor c) {
       case eTk::kUse:
       case eTk::kMain:
         return Failure(c, compiler_error::parser::xUserSyntaxError(
-                              c.Iter(),
+                              c,
                               "[LarkParser::ParseDeclaration] Declarative "
                               "Keyword cannot be modified."));
       default:
         return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                              Ast(c.Get()).Type(), c.Iter(),
+                              Ast(c.Get()).Type(), c,
                               "[LarkParser::ParseDeclaration] Declarative "
                               "Keyword not implemented in ParseDeclaration"));
     }
@@ -1480,12 +1482,12 @@ LarkParser::InternalParseResult LarkParser::ParseFunctionalStmt(TkCursor c) {
         return ParseClassDecl(c);
       case eTk::kUse:
         return Failure(c, compiler_error::parser::xUserSyntaxError(
-                              c.Iter(),
+                              c,
                               "[ParseFunctionalStmt] Declarative "
                               "Keyword cannot be modified."));
       default:
         return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                              Ast(c.Get()).Type(), c.Iter(),
+                              Ast(c.Get()).Type(), c,
                               "[ParseFunctionalStmt] Declarative "
                               "Keyword type not allowed in functional block."));
     }
@@ -1527,12 +1529,12 @@ LarkParser::InternalParseResult LarkParser::ParseConditionalStmt(TkCursor c) {
         return ParseClassDecl(c);
       case eTk::kUse:
         return Failure(c, compiler_error::parser::xUserSyntaxError(
-                              c.Iter(),
+                              c,
                               "[ParseConditionalStmt] Declarative "
                               "Keyword cannot be modified."));
       default:
         return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                              Ast(c.Get()).Type(), c.Iter(),
+                              Ast(c.Get()).Type(), c,
                               "[ParseConditionalStmt] Declarative "
                               "Keyword type not allowed in functional block."));
     }
@@ -1653,16 +1655,19 @@ LarkParser::InternalParseResult LarkParser::ParseForDecl(TkCursor c) {
 
   TkScope condition_scope = TkScope::find_paren(c);
   if (not condition_scope.Valid()) {
-    return Failure(c, xMismatchedParentheses(c.Iter()));
+    return Failure(c, xMismatchedParentheses(c));
   }
 
   std::vector<TkScope> condition_scopes =
       TkScope::find_seperated_paren(c, eTk::kSemicolon);
-  if (condition_scopes.size() > 3) {
+  if (not condition_scopes.back()) {
+    return Failure(c, xMismatchedParentheses(c));
+  }
+  if (condition_scopes.size() != 3) {
     return Failure(
         c, xInvalidForLoopConditionSyntax(
-               c.Iter(),
-               "For condition may have a maximum of 3 statements.Detected:" +
+               c,
+               "For condition must have 3 statements.Detected:" +
                    std::to_string(condition_scopes.size())));
   }
 
@@ -1803,7 +1808,7 @@ LarkParser::InternalParseResult LarkParser::ParseUsingDecl(TkCursor c) {
 
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(),
+                          Ast(c.Get()).Type(), c,
                           "[LarkParser::ParseUsingDecl] Token on begin cursor "
                           "does not evaluate to a use declaration node."));
   }
@@ -1878,7 +1883,7 @@ LarkParser::InternalParseResult LarkParser::ParseVariableDecl(TkCursor c) {
   } else {
     return Failure(c,
                    compiler_error::parser::xProgrammerLogicError(
-                       Ast(c.Get()).Type(), c.Iter(),
+                       Ast(c.Get()).Type(), c,
                        "[LarkParser::ParseVariableDecl] Token on begin cursor "
                        "does not evaluate to a variable declaration node."));
   }
@@ -1970,7 +1975,7 @@ LarkParser::InternalParseResult LarkParser::ParseMethodDecl(TkCursor c) {
 
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(),
+                          Ast(c.Get()).Type(), c,
                           "[LarkParser::ParseMethodDecl] Token on begin cursor "
                           "does not evaluate to a method declaration node."));
   }
@@ -2038,7 +2043,7 @@ LarkParser::InternalParseResult LarkParser::ParseClassDecl(TkCursor c) {
     }
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(), "[ParseClassDecl]"));
+                          Ast(c.Get()).Type(), c, "[ParseClassDecl]"));
   }
 }
 
@@ -2066,7 +2071,7 @@ LarkParser::InternalParseResult LarkParser::ParseImportDecl(TkCursor c) {
     }
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(), "[ParseImportDecl]"));
+                          Ast(c.Get()).Type(), c, "[ParseImportDecl]"));
   }
 }
 
@@ -2146,7 +2151,7 @@ LarkParser::InternalParseResult LarkParser::ParseLibDecl(TkCursor c) {
                           identifier_node, definition_node));
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(), "[ParseLibDecl]"));
+                          Ast(c.Get()).Type(), c, "[ParseLibDecl]"));
   }
 }
 
@@ -2164,7 +2169,7 @@ LarkParser::InternalParseResult LarkParser::ParseMainDecl(TkCursor c) {
     if (c.TypeIs(eTk::kCommercialAt)) {
       return Failure(
           c, compiler_error::parser::xUserSyntaxError(
-                 c.Iter(), "[ParseMainDecl] Named main not implemented."));
+                 c, "[ParseMainDecl] Named main not implemented."));
     } else {
       // This is an unnamed main.
       // Expecting a function signature followed by a colon and a definition.
@@ -2180,6 +2185,13 @@ LarkParser::InternalParseResult LarkParser::ParseMainDecl(TkCursor c) {
         }
         signature_node = signature_result.Extract();
         c.Advance(signature_result.Always().Iter());
+        // The signature ends before the colon of the definition.
+        if (c.TypeIsnt(eTk::kColon)) {
+          return Failure(c, compiler_error::parser::xExpectedToken(
+                                ToStr(eTk::kColon), c.Literal(),
+                                "[LarkParser::ParseMainDecl] Expected colon."));
+        }
+        c.Advance();
       }
 
       // Expecting a definition.
@@ -2205,7 +2217,7 @@ LarkParser::InternalParseResult LarkParser::ParseMainDecl(TkCursor c) {
 
   } else {
     return Failure(c, compiler_error::parser::xProgrammerLogicError(
-                          Ast(c.Get()).Type(), c.Iter(), "[ParseMainDecl]"));
+                          Ast(c.Get()).Type(), c, "[ParseMainDecl]"));
   }
 }
 
@@ -2226,9 +2238,9 @@ LarkParser::InternalParseResult LarkParser::ParseMethodParameters(TkCursor c) {
 
   std::vector<TkScope> arg_scopes =
       TkScope::find_seperated_paren(c, eTk::kComma);
-  if (!arg_scopes.front().Valid()) {
+  if (!arg_scopes.back().Valid()) {
     return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                          c.Iter(),
+                          c,
                           "[ParseMethodParameters] Mismatched "
                           "parentheses in method parameters."));
   }
@@ -2329,7 +2341,7 @@ LarkParser::InternalParseResult LarkParser::ParseMethodReturnParameters(
     method_return_type_node.PushBack(method_mods_result.Extract());
   }
 
-  // Expecting a primary expression ending in a colon.
+  // Expecting a primary expression ending in a colon or a semicolon.
   if (c.IsPrimaryExpressionOpening()) {
     auto ret_type_result = ParsePrimaryPostIdentifier(c);
     if (!ret_type_result) {
@@ -2337,6 +2349,8 @@ LarkParser::InternalParseResult LarkParser::ParseMethodReturnParameters(
     }
     c.Advance(ret_type_result.Always().Iter());
     method_return_type_node.PushBack(ret_type_result.Extract());
+    // The signature ends before the colon of the definition.
+    if (c.Peek(-1).TypeIs(eTk::kColon)) c.Advance(-1);
   } else {
     return Failure(c, compiler_error::parser::xExpectedToken(
                           "Primary Expression", c.Literal(),
@@ -2371,7 +2385,6 @@ LarkParser::LarkParser::InternalParseResult LarkParser::ParseMethodSignature(
   else if (c.TypeIs(eTk::kGreaterThan)) {
     c.Advance();
     if (c.TypeIs(eTk::kColon)) {  // Implicit any return void method.
-      c.Advance();
       return Success(
           c, xMakeSingleParamMethodSignatureAst(eAst::kAny, eAst::kMethodVoid));
     }
@@ -2414,7 +2427,6 @@ LarkParser::LarkParser::InternalParseResult LarkParser::ParseMethodSignature(
 
     // Expecting a colon or a greater than.
     if (c.TypeIs(eTk::kColon)) {
-      c.Advance();
       return Success(
           c, xMakeMethodSignatureAst(
                  Ast(eAst::kMethodReturnType, "", Ast(eAst::kMethodVoid)),
@@ -2423,7 +2435,6 @@ LarkParser::LarkParser::InternalParseResult LarkParser::ParseMethodSignature(
       c.Advance();
       // if the next token is a colon, then the return type is any.
       if (c.TypeIs(eTk::kColon)) {
-        c.Advance();
         return Success(c, xMakeMethodSignatureAst(
                               Ast(eAst::kMethodReturnType, "", Ast(eAst::kAny)),
                               method_params_result.Extract()));
@@ -2454,7 +2465,7 @@ LarkParser::LarkParser::InternalParseResult LarkParser::ParseMethodSignature(
   } else {
     return Failure(
         c, compiler_error::parser::xProgrammerLogicError(
-               Ast(c.Get()).Type(), c.Iter(),
+               Ast(c.Get()).Type(), c,
                "[ParseMethodSignature] Invalid token following method name."));
   }
 }
@@ -2464,7 +2475,7 @@ LarkParser::InternalParseResult LarkParser::ParseMethodDef(TkCursor c) {
   TkScope statement_scope = TkScope::find_brace(c);
   if (!statement_scope.Valid()) {
     return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                          c.Iter(), "[ParseLibDef] Mismatched braces."));
+                          c, "[ParseLibDef] Mismatched braces."));
   }
   c.Advance();  // advance past the opening brace.
   // Parse until end of scope.
@@ -2487,7 +2498,7 @@ LarkParser::InternalParseResult LarkParser::ParseMethodDef(TkCursor c) {
       c.Advance(primary_result.Always().Iter());
     } else {
       return Failure(c, compiler_error::parser::xUserSyntaxError(
-                            c.Iter(), "[Parsing Method Primary Statement]"));
+                            c, "[Parsing Method Primary Statement]"));
     }
   }
   c.Advance();  // advance to scope end.
@@ -2499,7 +2510,7 @@ LarkParser::InternalParseResult LarkParser::ParseMainDef(TkCursor c) {
   TkScope statement_scope = TkScope::find_brace(c);
   if (!statement_scope.Valid()) {
     return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                          c.Iter(), "[ParseLibDef] Mismatched braces."));
+                          c, "[ParseLibDef] Mismatched braces."));
   }
   c.Advance();  // advance past the opening brace.
   // Parse until end of scope.
@@ -2522,7 +2533,7 @@ LarkParser::InternalParseResult LarkParser::ParseMainDef(TkCursor c) {
       c.Advance(primary_result.Always().Iter());
     } else {
       return Failure(c, compiler_error::parser::xUserSyntaxError(
-                            c.Iter(), "[Parsing Method Primary Statement]"));
+                            c, "[Parsing Method Primary Statement]"));
     }
   }
   c.Advance();  // advance to scope end.
@@ -2536,7 +2547,7 @@ LarkParser::InternalParseResult LarkParser::ParseClassDef(TkCursor c) {
   TkScope statement_scope = TkScope::find_brace(c);
   if (!statement_scope.Valid()) {
     return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                          c.Iter(), "[ParseLibDef] Mismatched braces."));
+                          c, "[ParseLibDef] Mismatched braces."));
   }
   c.Advance();  // advance past the opening brace.
   // Parse until end of scope.
@@ -2551,7 +2562,7 @@ LarkParser::InternalParseResult LarkParser::ParseClassDef(TkCursor c) {
       c.Advance(decl_result.Always().Iter());
     } else {
       return Failure(c, compiler_error::parser::xUserSyntaxError(
-                            c.Iter(), "[Parsing Global Primary Statement]"));
+                            c, "[Parsing Global Primary Statement]"));
     }
   }
   c.Advance();  // advance to scope end.
@@ -2572,7 +2583,7 @@ LarkParser::InternalParseResult LarkParser::ParseLibDef(TkCursor c) {
   TkScope statement_scope = TkScope::find_brace(c);
   if (!statement_scope.Valid()) {
     return Failure(c, compiler_error::parser::xMismatchedParentheses(
-                          c.Iter(), "[ParseLibDef] Mismatched braces."));
+                          c, "[ParseLibDef] Mismatched braces."));
   }
   c.Advance();  // advance past the opening brace.
   // Parse until end of scope.
@@ -2587,7 +2598,7 @@ LarkParser::InternalParseResult LarkParser::ParseLibDef(TkCursor c) {
       c.Advance(decl_result.Always().Iter());
     } else {
       return Failure(c, compiler_error::parser::xUserSyntaxError(
-                            c.Iter(), "[Parsing Global Primary Statement]"));
+                            c, "[Parsing Global Primary Statement]"));
     }
   }
   c.Advance();  // advance to scope end.
@@ -2615,7 +2626,7 @@ LarkParser::InternalParseResult LarkParser::ParseProgram(TkCursor c) {
       c.Advance(decl_result.Always().Iter());
     } else {
       return Failure(c, compiler_error::parser::xUserSyntaxError(
-                            c.Iter(), "[Parsing Global Primary Statement]"));
+                            c, "[Parsing Global Primary Statement]"));
     }
   }
   return Success(c, program_node);
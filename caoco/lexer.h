@@ -165,6 +165,9 @@ constexpr Lexer::LexMethodResult Lexer::LexSolidus(CharVectorConstIter it) {
                                               // '///' closed by '///'
       Advance(it, 3);
       while (!FindForward(it, grammar::kBlockComment::value)) {
+        if (!NotAtEof(it)) {
+          return FailureResult(begin, "Unterminated block comment.");
+        }
         Advance(it);
       }
       Advance(it, 3);
@@ -200,6 +203,9 @@ constexpr Lexer::LexMethodResult Lexer::LexQuotation(CharVectorConstIter it) {
 
     while (
         !(Get(it) == kApostrophe::value && Peek(it, -1) != kBacklash::value)) {
+      if (!NotAtEof(it)) {
+        return FailureResult(begin, "Unterminated string literal.");
+      }
       Advance(it);
     }
     Advance(it);
@@ -324,7 +330,9 @@ constexpr Lexer::LexMethodResult Lexer::LexDirective(CharVectorConstIter it) {
         [&](const auto&... traits) -> void {
           [](...) {}((
               [&]<typename T>(const T& x) {
-                if (FindForward(beg, std::decay_t<T>::literal)) {
+                // The whole word, #if is not a prefix of #ifx.
+                constexpr auto literal = std::decay_t<T>::literal;
+                if (std::equal(beg, it, literal.begin(), literal.end())) {
                   temp_result = SuccessResult(std::decay_t<T>::type, beg, it);
                 }
               }(std::forward<decltype(traits)>(traits)),
@@ -351,7 +359,9 @@ constexpr Lexer::LexMethodResult Lexer::LexKeyword(CharVectorConstIter it) {
         [&](const auto&... traits) -> void {
           [](...) {}((
               [&]<typename T>(const T& x) {
-                if (FindForward(beg, std::decay_t<T>::literal)) {
+                // The whole word, def is not a prefix of defined.
+                constexpr auto literal = std::decay_t<T>::literal;
+                if (std::equal(beg, it, literal.begin(), literal.end())) {
                   temp_result = SuccessResult(std::decay_t<T>::type, beg, it);
                 }
               }(std::forward<decltype(traits)>(traits)),
@@ -0,0 +1,510 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: minitest
+// File: minibench.h
+//---------------------------------------------------------------------------//
+// Brief: Benchmarks for the minitest framework.
+// Sample Use:
+//       MINIBENCH(MyBench, MyBenchCase) {
+//         std::vector<int> input = MakeInput();  // Not timed.
+//         for (auto _ : state) {
+//           minitest::DoNotOptimize(Sum(input));
+//         }
+//         state.SetItemsProcessed(input.size());
+//       }
+//       END_MINIBENCH;
+//
+//       MINIBENCH_F(MyBench, MyFixtureCase, MyFixture) {
+//         for (auto _ : state) minitest::DoNotOptimize(Use(fixture_member));
+//       }
+//       END_MINIBENCH_F(MyFixtureCase);
+//
+//       FINISH_MINIBENCHES;  // Before FINISH_MINITESTS.
+//       int main() {
+//         bool benches = minitest::RunMinibenches();
+//         return MINITESTS_RESULT && benches ? 0 : 1;
+//       }
+//
+// Benchmarks register when defined, like tests, and RunMinibenches runs
+// those matching MINITEST_FILTER one at a time. The iterations of a
+// sample are calibrated to last bench_options.sample_time, a warm-up sample
+// is discarded, then the median and p99 of the samples are printed with the
+// throughput and heap allocations per iteration, which may be given a budget
+// with state.SetAllocationBudget. FINISH_MINIBENCHES writes the results as
+// JSON to the file in MINIBENCH_JSON, and compares them with the JSON
+// baseline in MINIBENCH_BASELINE: a median slower by more than
+// MINIBENCH_THRESHOLD (default 0.10) fails the run.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_MINITEST_MINIBENCH_H
+#define HEADER_GUARD_CAOCO_MINITEST_MINIBENCH_H
+// Includes:
+#include "allocation_counter.h"
+#include "import_stl.h"
+#include "minitest.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+//---------------------------------------------------------------------------//
+// namespace minitest
+//---------------------------------------------------------------------------//
+namespace minitest {
+
+inline const volatile void* bench_sink = nullptr;  // Of DoNotOptimize.
+
+// Makes the compiler assume the value is read, so computing it is kept.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "g"(&value) : "memory");
+#else
+  bench_sink = &value;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// Makes the compiler assume all memory is read and written.
+inline void ClobberMemory() {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : : "memory");
+#else
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+struct BenchOptions {
+  std::chrono::nanoseconds sample_time = std::chrono::milliseconds(2);
+  std::size_t samples = 21;
+  std::size_t warmup_samples = 1;
+  std::uint64_t max_iterations = 1000000000;
+};
+
+static inline BenchOptions bench_options;
+
+struct BenchResult {
+  std::string name;  // Name.Case
+  std::uint64_t iterations = 0;  // Per sample.
+  std::size_t samples = 0;
+  double median_ns = 0;  // Per iteration.
+  double p99_ns = 0;
+  double items_per_second = 0;
+  double allocations = 0;  // Per iteration.
+  double bytes = 0;
+};
+
+static inline std::vector<BenchResult> bench_results;
+
+// The state a benchmark body times by looping over it, the code before and
+// after the loop is not timed.
+class BenchState {
+  std::uint64_t iterations_;
+  std::uint64_t items_ = 1;
+  std::optional<double> allocation_budget_;
+  bool ran_ = false;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::nanoseconds elapsed_{0};
+  AllocationCount allocations_;
+
+  void Begin() {
+    ran_ = true;
+    allocations_ = AllocationCounter::Count();
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  void End() {
+    elapsed_ = std::chrono::steady_clock::now() - start_;
+    allocations_ = AllocationCounter::Count() - allocations_;
+  }
+
+ public:
+  // The value of `for (auto _ : state)`. Its destructor makes the loop
+  // variable non-trivial, so compilers do not warn that it is unused.
+  struct Value {
+    ~Value() {}
+  };
+
+  class Iterator {
+    BenchState* state_;
+    std::uint64_t left_;
+
+   public:
+    Iterator(BenchState* state, std::uint64_t left)
+        : state_(state), left_(left) {}
+    Value operator*() const { return {}; }
+    Iterator& operator++() {
+      left_--;
+      return *this;
+    }
+    bool operator!=(const Iterator&) {
+      if (left_ != 0) return true;
+      state_->End();
+      return false;
+    }
+  };
+
+  explicit BenchState(std::uint64_t iterations) : iterations_(iterations) {}
+
+  Iterator begin() {
+    Begin();
+    return Iterator(this, iterations_);
+  }
+  Iterator end() { return Iterator(this, 0); }
+
+  std::uint64_t Iterations() const { return iterations_; }
+  // The items each iteration processes, for the throughput. Default 1.
+  void SetItemsProcessed(std::uint64_t items) { items_ = items; }
+  std::uint64_t ItemsProcessed() const { return items_; }
+  // The most heap allocations an iteration may make on average, else the
+  // benchmark fails. Needs CAOCO_COUNT_ALLOCATIONS.
+  void SetAllocationBudget(double per_iteration) {
+    allocation_budget_ = per_iteration;
+  }
+  std::optional<double> AllocationBudget() const { return allocation_budget_; }
+  bool Ran() const { return ran_; }
+  std::chrono::nanoseconds Elapsed() const { return elapsed_; }
+  AllocationCount Allocations() const { return allocations_; }
+};
+
+// Calibrates, warms up and samples the body, prints and records the result.
+// Returns false when the body does not loop over its state.
+template <typename BodyT>
+static inline bool RunBenchmark(const char* name, const char* bench_case,
+                                BodyT&& body) {
+  const auto& options = bench_options;
+  std::string full_name = std::string(name) + "." + bench_case;
+  lambda xSample = [&body](std::uint64_t iterations) {
+    BenchState state(iterations);
+    body(state);
+    return state;
+  };
+
+  std::uint64_t iterations = 1;
+  for (;;) {
+    auto state = xSample(iterations);
+    if (!state.Ran()) {
+      AddFailedTestLog("[BENCHMARK FAILED]: the body must loop over state",
+                       name, bench_case);
+      return false;
+    }
+    auto elapsed = state.Elapsed().count();
+    if (elapsed >= options.sample_time.count() ||
+        iterations >= options.max_iterations) {
+      break;
+    }
+    // Aim past the sample time, growing at most tenfold per try.
+    auto aim = elapsed <= 0 ? iterations * 10
+                            : static_cast<std::uint64_t>(
+                                  1.2 * options.sample_time.count() *
+                                  iterations / elapsed);
+    iterations = std::min(
+        {std::max(aim, iterations + 1), iterations * 10,
+         options.max_iterations});
+  }
+  for (std::size_t i = 0; i < options.warmup_samples; i++) {
+    xSample(iterations);
+  }
+
+  std::vector<double> ns;
+  AllocationCount allocations;
+  std::uint64_t items = 1;
+  std::optional<double> budget;
+  for (std::size_t i = 0; i < std::max<std::size_t>(1, options.samples);
+       i++) {
+    auto state = xSample(iterations);
+    ns.push_back(static_cast<double>(state.Elapsed().count()) / iterations);
+    allocations.count += state.Allocations().count;
+    allocations.bytes += state.Allocations().bytes;
+    items = state.ItemsProcessed();
+    budget = state.AllocationBudget();
+  }
+  std::sort(ns.begin(), ns.end());
+  BenchResult result;
+  result.name = full_name;
+  result.iterations = iterations;
+  result.samples = ns.size();
+  result.median_ns = ns.size() % 2 == 1
+                         ? ns[ns.size() / 2]
+                         : (ns[ns.size() / 2 - 1] + ns[ns.size() / 2]) / 2;
+  auto p99_rank = static_cast<std::size_t>(std::ceil(0.99 * ns.size()));
+  result.p99_ns = ns[std::max<std::size_t>(1, p99_rank) - 1];
+  result.items_per_second =
+      result.median_ns > 0 ? items * 1e9 / result.median_ns : 0;
+  double total = static_cast<double>(iterations) * ns.size();
+  result.allocations = allocations.count / total;
+  result.bytes = allocations.bytes / total;
+
+  std::ostringstream line;
+  line << std::fixed << std::setprecision(1) << "[Minibench] " << result.name
+       << ": median "
+       << result.median_ns << " ns/op, p99 " << result.p99_ns << " ns/op, "
+       << result.items_per_second << " items/s, " << result.allocations
+       << " allocs/op (" << result.bytes << " bytes/op), " << result.samples
+       << " x " << result.iterations << " iterations";
+  std::cout << line.str() << std::endl;
+  bench_results.push_back(result);
+  if (budget && result.allocations > *budget) {
+    std::ostringstream log;
+    log << "[ALLOCATION BUDGET EXCEEDED]: " << result.allocations
+        << " allocations per iteration, budget " << *budget;
+    AddFailedTestLog(log.str(), name, bench_case);
+    return false;
+  }
+  return true;
+}
+
+// Sets up the fixture once for all the samples of its benchmark.
+template <typename FixtureBenchT>
+static inline bool RunFixtureBenchmark() {
+  FixtureBenchT fixture;
+  fixture.SetUp();
+  bool ran = RunBenchmark(
+      FixtureBenchT::kBenchName, FixtureBenchT::kBenchCase,
+      [&fixture](BenchState& state) { fixture.Body(state); });
+  fixture.TearDown();
+  return ran;
+}
+
+static inline void WriteBenchJson(std::ostream& os,
+                                  const std::vector<BenchResult>& results) {
+  auto precision = os.precision(12);
+  os << "{\"benchmarks\":[";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const auto& result = results[i];
+    os << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << result.name
+       << "\",\"iterations\":" << result.iterations
+       << ",\"samples\":" << result.samples
+       << ",\"median_ns\":" << result.median_ns
+       << ",\"p99_ns\":" << result.p99_ns
+       << ",\"items_per_second\":" << result.items_per_second
+       << ",\"allocations\":" << result.allocations
+       << ",\"bytes\":" << result.bytes << "}";
+  }
+  os << "\n]}\n";
+  os.precision(precision);
+}
+
+// The median of each benchmark of a JSON written by WriteBenchJson.
+static inline std::vector<std::pair<std::string, double>> ReadBenchBaseline(
+    std::string_view json) {
+  std::vector<std::pair<std::string, double>> medians;
+  constexpr std::string_view kName = "\"name\":\"";
+  constexpr std::string_view kMedian = "\"median_ns\":";
+  for (auto at = json.find(kName); at != json.npos;
+       at = json.find(kName, at)) {
+    at += kName.size();
+    auto name_end = json.find('"', at);
+    auto median = json.find(kMedian, at);
+    if (name_end == json.npos || median == json.npos) break;
+    medians.push_back({std::string(json.substr(at, name_end - at)),
+                       std::strtod(json.data() + median + kMedian.size(),
+                                   nullptr)});
+  }
+  return medians;
+}
+
+// A message for each result slower than its baseline by more than the
+// threshold, a fraction of the baseline.
+static inline std::vector<std::string> CompareBenchBaseline(
+    const std::vector<BenchResult>& results,
+    const std::vector<std::pair<std::string, double>>& baseline,
+    double threshold) {
+  std::vector<std::string> regressions;
+  for (const auto& result : results) {
+    auto base = std::find_if(baseline.begin(), baseline.end(),
+                             [&result](const auto& b) {
+                               return b.first == result.name;
+                             });
+    if (base == baseline.end() || base->second <= 0) continue;
+    double change = result.median_ns / base->second - 1;
+    if (change <= threshold) continue;
+    std::ostringstream message;
+    message << std::fixed << std::setprecision(1) << result.name
+            << ": median " << result.median_ns << " ns/op, baseline "
+            << base->second << " ns/op (+" << static_cast<int>(change * 100)
+            << "%)";
+    regressions.push_back(message.str());
+  }
+  return regressions;
+}
+
+// A registered benchmark, run by RunBenchmarks.
+struct BenchEntry {
+  std::string name;  // Name.Case
+  std::function<bool()> run;
+};
+
+static inline std::vector<BenchEntry>& BenchRegistry() {
+  static std::vector<BenchEntry> registry;
+  return registry;
+}
+
+template <typename BodyT>
+static inline bool RegisterBenchmark(const char* name, const char* bench_case,
+                                     BodyT body) {
+  BenchRegistry().push_back({std::string(name) + "." + bench_case,
+                             [name, bench_case, body] {
+                               return RunBenchmark(name, bench_case, body);
+                             }});
+  return true;
+}
+
+template <typename FixtureBenchT>
+static inline bool RegisterFixtureBenchmark() {
+  BenchRegistry().push_back({std::string(FixtureBenchT::kBenchName) + "." +
+                                 FixtureBenchT::kBenchCase,
+                             &RunFixtureBenchmark<FixtureBenchT>});
+  return true;
+}
+
+// Writes MINIBENCH_JSON and fails the run on regressions against
+// MINIBENCH_BASELINE.
+static inline bool FinishBenchmarks() {
+  if (const char* path = EnvironmentValue("MINIBENCH_JSON")) {
+    std::ofstream file(path);
+    WriteBenchJson(file, bench_results);
+  }
+  const char* baseline_path = EnvironmentValue("MINIBENCH_BASELINE");
+  if (baseline_path == nullptr) return true;
+  std::ifstream file(baseline_path);
+  if (!file) {
+    AddFailedTestLog("[BENCHMARK FAILED]: cannot open the baseline",
+                     "Minibench", baseline_path);
+    return false;
+  }
+  std::string json((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  const char* threshold = EnvironmentValue("MINIBENCH_THRESHOLD");
+  auto regressions =
+      CompareBenchBaseline(bench_results, ReadBenchBaseline(json),
+                           threshold ? std::strtod(threshold, nullptr) : 0.10);
+  for (const auto& regression : regressions) {
+    AddFailedTestLog("[BENCHMARK REGRESSED]: " + regression, "Minibench",
+                     "Baseline");
+  }
+  return regressions.empty();
+}
+
+// Runs the registered benchmarks matching the filter, one at a time, then
+// writes and compares their results. Returns false if any failed.
+static inline bool RunBenchmarks(const RunOptions& options) {
+  bool passed = true;
+  for (const auto& entry : BenchRegistry()) {
+    if (MatchesFilter(options.filter, entry.name)) {
+      passed = entry.run() && passed;
+    }
+  }
+  return FinishBenchmarks() && passed;
+}
+
+}  // namespace minitest
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+//=---------------------------------=//
+// Macro:{MINIBENCH}
+// Brief:{Defines and registers a benchmark. Always close with
+//        'END_MINIBENCH;'.}
+// Parameters:{
+//		1.BenchName : Name of the benchmark.
+//		2.BenchCaseName : Name of the case, must be unique per benchmark.
+// }
+// Detail:{
+// - The body loops over 'state', a minitest::BenchState, to be timed.
+// }
+//-----------------------------------//
+#define MINIBENCH(BenchName, BenchCaseName)                          \
+  namespace minitest_unit_bench {                                    \
+  namespace BenchName {                                              \
+  static const bool MINIBENCH_##BenchCaseName =                     \
+      minitest::RegisterBenchmark(                                   \
+      #BenchName, #BenchCaseName, [](minitest::BenchState& state) -> void {
+//-----------------------------------//
+//=---------------------------------=//
+
+//=---------------------------------=//
+// Macro:{END_MINIBENCH}
+// Brief:{Completes a benchmark defined with MINIBENCH.}
+//-----------------------------------//
+#define END_MINIBENCH \
+  });                 \
+  }                   \
+  }
+//-----------------------------------//
+//=---------------------------------=//
+
+//=---------------------------------=//
+// Macro:{MINIBENCH_F}
+// Brief:{Defines a benchmark on a fixture set up once for all its samples.
+//        Always close with 'END_MINIBENCH_F(BenchCaseName);'.
+// }
+// Parameters:{
+//		1.BenchName : Name of the benchmark.
+//		2.BenchCaseName : Name of the case, must be unique per benchmark.
+// 	  3.BenchFixtureClass : Name of the fixture class.
+//                          Must inherit from minitest::Fixture.
+// }
+//-----------------------------------//
+#define MINIBENCH_F(BenchName, BenchCaseName, BenchFixtureClass)  \
+  namespace minitest_unit_bench {                                 \
+  namespace BenchName {                                           \
+  struct MINIBENCH_FIXTURE_##BenchCaseName : BenchFixtureClass {  \
+    static constexpr const char* kBenchName = #BenchName;         \
+    static constexpr const char* kBenchCase = #BenchCaseName;     \
+    void Body(minitest::BenchState& state) {
+//-----------------------------------//
+//=---------------------------------=//
+
+//=---------------------------------=//
+// Macro:{END_MINIBENCH_F}
+// Brief:{Completes and registers a benchmark defined with MINIBENCH_F with the
+//        SAME BenchCaseName.
+// }
+//-----------------------------------//
+#define END_MINIBENCH_F(BenchCaseName)                                   \
+  }                                                                      \
+  }                                                                      \
+  ;                                                                      \
+  static const bool MINIBENCH_##BenchCaseName = minitest::               \
+      RegisterFixtureBenchmark<MINIBENCH_FIXTURE_##BenchCaseName>();     \
+  }                                                                      \
+  }
+//-----------------------------------//
+//=---------------------------------=//
+
+//=---------------------------------=//
+// Macro:{FINISH_MINIBENCHES}
+// Brief:{Defines minitest::RunMinibenches, which runs the benchmarks with
+//        the minitest::RunOptions of the environment, then writes and
+//        compares their results, see the top of this file. Returns true if
+//        all passed. Must be called after all benchmarks are defined and
+//        before FINISH_MINITESTS, call RunMinibenches before the tests.
+// }
+//-----------------------------------//
+#define FINISH_MINIBENCHES                                     \
+  namespace minitest {                                         \
+  static inline bool RunMinibenches() {                        \
+    return RunBenchmarks(RunOptions::FromEnvironment());       \
+  }                                                            \
+  }  // namespace minitest
+//-----------------------------------//
+//=---------------------------------=//
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: minitest
+// File: minibench.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_MINITEST_MINIBENCH_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -26,11 +26,11 @@
 //         EXPECT_NO_THROW([](){ throw std::runtime_error("error"); });
 //        }
 //       END_MINITEST;
-//       FINISH_MINITESTS; // returns a boolean true if all tests passed
-//                         // call this right before your main function
-//                         // Macro MINITESTS_RESULT will contain result.
+//       FINISH_MINITESTS; // call this right before your main function
+//       The tests register when defined and run in parallel from main, see
+//       minitest::RunOptions for the filter, jobs, repeat and shuffle.
 //       int main() {
-//         return MINITESTS_RESULT ? 0 : 1;
+//         return MINITESTS_RESULT ? 0 : 1;  // Runs the tests.
 //       }
 //---------------------------------------------------------------------------//
 #ifndef HEADER_GUARD_CAOCO_MINITEST_H
@@ -40,7 +40,17 @@
 #include <concepts>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <streambuf>
+#include <thread>
 //---------------------------------------------------------------------------//
 //=-------------------------------------------------------------------------=//
 
@@ -57,24 +67,40 @@ concept Streamable = requires(std::ostream os, std::decay_t<T> value) {
   { os << value } -> std::same_as<std::ostream&>;
 };
 
-template <auto TestName, auto TestCaseName, typename TestImpl>
+// A registered test case. Serial cases run alone, after the others: those
+// defined with MINITEST_SERIAL, and the cases named ...Benchmark which time
+// themselves.
+struct TestEntry {
+  const char* test_name;
+  const char* test_case_name;
+  void (*run)();
+  bool serial;
+};
+
+static inline std::vector<TestEntry>& Registry() {
+  static std::vector<TestEntry> registry;
+  return registry;
+}
+
+template <auto TestName, auto TestCaseName, typename TestImpl,
+          bool Serial = false>
 struct Test {
   static constexpr auto test_name = TestName();
   static constexpr auto test_case_name = TestCaseName();
   static inline const TestImpl test_impl{};
   bool is_test_passed = true;
-  static inline bool Run() {
-    std::cout << kDashedLine << "[Begin Mini Test] " << test_name << " [Case]"
-              << test_case_name << "\n"
-              << kDashedLine;
-    test_impl();
-    std::cout << kDashedLine << "[End Mini Test] " << test_name << " [Case]"
-              << test_case_name << "\n"
-              << kDashedLine;
+  static inline void Run() { test_impl(); }
+  static inline bool Register() {
+    std::string_view name = test_case_name;
+    Registry().push_back({test_name, test_case_name, &Run,
+                          Serial || name.ends_with("Benchmark")});
     return true;
   }
 };
 
+template <auto TestName, auto TestCaseName, typename TestImpl>
+using SerialTest = Test<TestName, TestCaseName, TestImpl, true>;
+
 // Base class for all fixtures.
 // Inherit from this class to create a fixture.
 // All members of your class should be public or protected
@@ -152,16 +178,249 @@ static inline bool ExpectNoThrow(auto&& f) {
 }
 
 static std::vector<std::string> failed_test_logs;
-static const char* last_failed_test_name = "";
-static const char* last_failed_test_case_name = "";
+static std::mutex failed_test_logs_mutex;
+static thread_local const char* last_failed_test_name = "";
+static thread_local const char* last_failed_test_case_name = "";
+// The failures of the test case running on this thread, if any.
+static thread_local std::vector<std::string>* running_test_failures = nullptr;
 
 static inline void AddFailedTestLog(const std::string& log, const char* test,
                                     const char* tcase) {
   std::string ss = "[FAILURE DETECTED] Test: " + std::string(test) +
                    " Case: " + std::string(tcase) + " On Check:" + log;
+  if (running_test_failures != nullptr) {
+    running_test_failures->push_back(ss);
+    return;
+  }
+  std::lock_guard lock(failed_test_logs_mutex);
   failed_test_logs.push_back(ss);
 }
 
+static inline const char* EnvironmentValue(const char* name) {
+#if defined(_MSC_VER)
+#pragma warning(suppress : 4996)
+#endif
+  return std::getenv(name);
+}
+
+// Options of RunTests, read from the environment by FINISH_MINITESTS:
+//   MINITEST_FILTER  Test.Case globs separated by ':', then optionally '-'
+//                    and the globs to exclude. eg. "TestLexer.*-*Benchmark"
+//                    Also selects the benchmarks, see minibench.h.
+//   MINITEST_JOBS    Threads running the cases, 0 for one per core.
+//   MINITEST_REPEAT  Runs of the whole suite.
+//   MINITEST_SHUFFLE Seed to shuffle the cases with, 0 for a random one.
+struct RunOptions {
+  std::string filter;
+  std::size_t jobs = 0;
+  std::size_t repeat = 1;
+  bool shuffle = false;
+  std::uint32_t seed = 0;
+
+  static RunOptions FromEnvironment() {
+    RunOptions options;
+    if (auto filter = EnvironmentValue("MINITEST_FILTER")) {
+      options.filter = filter;
+    }
+    if (auto jobs = EnvironmentValue("MINITEST_JOBS")) {
+      options.jobs = std::strtoul(jobs, nullptr, 10);
+    }
+    if (auto repeat = EnvironmentValue("MINITEST_REPEAT")) {
+      options.repeat = std::strtoul(repeat, nullptr, 10);
+    }
+    if (auto seed = EnvironmentValue("MINITEST_SHUFFLE")) {
+      options.shuffle = true;
+      options.seed =
+          static_cast<std::uint32_t>(std::strtoul(seed, nullptr, 10));
+    }
+    return options;
+  }
+};
+
+// Glob with '*' and '?'.
+static inline bool MatchesGlob(std::string_view glob, std::string_view text) {
+  if (glob.empty()) return text.empty();
+  if (glob.front() == '*') {
+    for (std::size_t skip = 0; skip <= text.size(); skip++) {
+      if (MatchesGlob(glob.substr(1), text.substr(skip))) return true;
+    }
+    return false;
+  }
+  return !text.empty() && (glob.front() == '?' || glob.front() == text.front())
+         && MatchesGlob(glob.substr(1), text.substr(1));
+}
+
+static inline bool MatchesFilter(std::string_view filter,
+                                 std::string_view name) {
+  auto xAny = [name](std::string_view globs) {
+    while (!globs.empty()) {
+      auto end = std::min(globs.find(':'), globs.size());
+      if (MatchesGlob(globs.substr(0, end), name)) return true;
+      globs.remove_prefix(std::min(end + 1, globs.size()));
+    }
+    return false;
+  };
+  auto minus = std::min(filter.find('-'), filter.size());
+  auto included = filter.substr(0, minus);
+  auto excluded = filter.substr(std::min(minus + 1, filter.size()));
+  return (included.empty() || xAny(included)) && !xAny(excluded);
+}
+
+// Routes the output of each thread running a test case to its buffer, and
+// the rest to the original buffer. Unbuffered itself so every write routes.
+class TestOutputRouter : public std::streambuf {
+  std::streambuf* original_;
+
+ public:
+  static inline thread_local std::string* capture = nullptr;
+
+  explicit TestOutputRouter(std::streambuf* original) : original_(original) {}
+
+ protected:
+  int_type overflow(int_type c) override {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+      return traits_type::not_eof(c);
+    }
+    if (capture != nullptr) {
+      capture->push_back(traits_type::to_char_type(c));
+      return c;
+    }
+    return original_->sputc(traits_type::to_char_type(c));
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    if (capture != nullptr) {
+      capture->append(s, static_cast<std::size_t>(n));
+      return n;
+    }
+    return original_->sputn(s, n);
+  }
+
+  int sync() override { return capture != nullptr ? 0 : original_->pubsync(); }
+};
+
+// Runs the registered test cases matching the filter on a pool of threads.
+// The output of each case is buffered and printed whole, in the order of
+// the run. Returns false if any case failed.
+static inline bool RunTests(const RunOptions& options) {
+  struct Run {
+    const TestEntry* entry;
+    std::string output{};
+    std::vector<std::string> failures{};
+    std::chrono::microseconds time{0};
+    bool done = false;
+  };
+  std::vector<const TestEntry*> selected;
+  for (const auto& entry : Registry()) {
+    if (MatchesFilter(options.filter, std::string(entry.test_name) + "." +
+                                          entry.test_case_name)) {
+      selected.push_back(&entry);
+    }
+  }
+  auto seed = options.seed != 0 ? options.seed : std::random_device{}();
+  std::mt19937 random(seed);
+  std::vector<Run> runs;
+  std::vector<Run> serial_runs;
+  for (std::size_t r = 0; r < std::max<std::size_t>(1, options.repeat); r++) {
+    auto order = selected;
+    if (options.shuffle) std::shuffle(order.begin(), order.end(), random);
+    for (auto* entry : order) {
+      (entry->serial ? serial_runs : runs).push_back({entry});
+    }
+  }
+  auto parallel = runs.size();  // The runs after are serial.
+  runs.insert(runs.end(), serial_runs.begin(), serial_runs.end());
+
+  auto jobs = options.jobs != 0
+                  ? options.jobs
+                  : std::max(1u, std::thread::hardware_concurrency());
+  std::mutex print_mutex;
+  std::size_t printed = 0;
+  auto xPrint = [&]() {
+    std::lock_guard lock(print_mutex);
+    for (; printed < runs.size() && runs[printed].done; printed++) {
+      auto& run = runs[printed];
+      std::cout << kDashedLine << "[Begin Mini Test] " << run.entry->test_name
+                << " [Case]" << run.entry->test_case_name << "\n"
+                << kDashedLine << run.output << kDashedLine
+                << "[End Mini Test] " << run.entry->test_name << " [Case]"
+                << run.entry->test_case_name << " ("
+                << run.time.count() / 1000 << " ms)\n"
+                << kDashedLine;
+      std::lock_guard logs_lock(failed_test_logs_mutex);
+      failed_test_logs.insert(failed_test_logs.end(), run.failures.begin(),
+                              run.failures.end());
+    }
+    std::cout.flush();
+  };
+  auto xRun = [&](Run& run) {
+    last_failed_test_name = run.entry->test_name;
+    last_failed_test_case_name = run.entry->test_case_name;
+    TestOutputRouter::capture = &run.output;
+    running_test_failures = &run.failures;
+    auto start = std::chrono::steady_clock::now();
+    try {
+      run.entry->run();
+    } catch (const std::exception& e) {
+      AddFailedTestLog(std::string("[EXCEPTION THROWN]: ") + e.what(),
+                       run.entry->test_name, run.entry->test_case_name);
+    } catch (...) {
+      AddFailedTestLog("[EXCEPTION THROWN]", run.entry->test_name,
+                       run.entry->test_case_name);
+    }
+    run.time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    running_test_failures = nullptr;
+    TestOutputRouter::capture = nullptr;
+    {
+      std::lock_guard lock(print_mutex);
+      run.done = true;
+    }
+    xPrint();
+  };
+
+  TestOutputRouter router(std::cout.rdbuf());
+  auto* original = std::cout.rdbuf(&router);
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<std::size_t> next = 0;
+  std::vector<std::thread> workers;
+  for (std::size_t t = 1; t < std::min(jobs, parallel); t++) {
+    workers.emplace_back([&] {
+      for (std::size_t i; (i = next++) < parallel;) xRun(runs[i]);
+    });
+  }
+  for (std::size_t i; (i = next++) < parallel;) xRun(runs[i]);
+  for (auto& worker : workers) worker.join();
+  for (std::size_t i = parallel; i < runs.size(); i++) xRun(runs[i]);
+  auto wall = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  std::cout.rdbuf(original);
+
+  std::vector<const Run*> slowest;
+  std::chrono::microseconds total{0};
+  for (const auto& run : runs) {
+    slowest.push_back(&run);
+    total += run.time;
+  }
+  std::sort(slowest.begin(), slowest.end(),
+            [](const Run* a, const Run* b) { return a->time > b->time; });
+  slowest.resize(std::min<std::size_t>(slowest.size(), 5));
+  std::cout << kDashedLine << "[Mini Test Summary] " << runs.size()
+            << " cases (" << parallel << " parallel) on " << jobs
+            << " threads in " << wall.count() << " ms, "
+            << total.count() / 1000 << " ms of tests";
+  if (options.shuffle) std::cout << ", shuffled with seed " << seed;
+  std::cout << "\n";
+  for (const auto* run : slowest) {
+    std::cout << "  " << run->time.count() / 1000 << " ms "
+              << run->entry->test_name << "." << run->entry->test_case_name
+              << "\n";
+  }
+  std::cout << kDashedLine;
+  return std::all_of(runs.begin(), runs.end(),
+                     [](const Run& run) { return run.failures.empty(); });
+}
+
 static inline bool PrintFailedTestLogs() {
   if (failed_test_logs.empty()) {
     std::cout << kDashedLine << "All tests passed.\n" << kDashedLine;
@@ -214,7 +473,7 @@ return minitest::Test < []() consteval -> const char* { return #TestName; },\
   }                  \
   )\
   >\
-  ::Run();           \
+  ::Register();      \
   }                  \
   ();                \
   }                  \
@@ -223,6 +482,26 @@ return minitest::Test < []() consteval -> const char* { return #TestName; },\
 //-----------------------------------//
 //=---------------------------------=//
 
+//=---------------------------------=//
+// Macro:{MINITEST_SERIAL}
+// Brief:{Defines a test case which runs alone, after the parallel ones.
+//        For cases using process wide state such as the working directory.
+//        Always close with 'END_MINITEST;'.
+// }
+//-----------------------------------//
+#define MINITEST_SERIAL(TestName, TestCaseName) \
+  namespace minitest_unit_test {                \
+  namespace TestName {                          \
+  bool MINITEST_TEST_##TestCaseName = []() -> bool {\
+return minitest::SerialTest <\
+       []() consteval -> const char* { return #TestName; },\
+       []() consteval -> const char* { return #TestCaseName; },\
+       decltype([]() -> void {\
+         minitest::last_failed_test_name = #TestName;\
+         minitest::last_failed_test_case_name = #TestCaseName;
+//-----------------------------------//
+//=---------------------------------=//
+
 //=---------------------------------=//
 // Macro:{MINITEST_F}
 // Brief:{Defines a fixture test case.
@@ -278,7 +557,7 @@ return minitest::Test < []() consteval -> const char* { return #TestName; },\
   MINITEST_FIXTURE_INSTANCE_##TestCaseName.RunFixture();                    \
   }                                                                         \
   )\
-  >::Run();                                                                 \
+  >::Register();                                                            \
   }                                                                         \
   ();                                                                       \
   }                                                                         \
@@ -289,20 +568,21 @@ return minitest::Test < []() consteval -> const char* { return #TestName; },\
 
 //=---------------------------------=//
 // Macro:{FINISH_MINITESTS}
-// Brief:{ Completes the test suite and prints the result.
-//        Must be called right before your main function.
-//        This store a boolean true result in MINITESTS_RESULT
-//        if all tests passed - else false.
+// Brief:{ Defines minitest::RunMinitests, which runs the registered tests
+//        and prints the result. Returns true if all tests passed.
+//        Must be called right before your main function, which calls
+//        RunMinitests or MINITESTS_RESULT.
 //
-//        This does not run the tests, it only prints the result.
+//        The tests run with the minitest::RunOptions of the environment.
 //        This must be called LAST, after all tests are defined.
 // }
 //-----------------------------------//
-#define FINISH_MINITESTS                     \
-  namespace minitest {                       \
-  static const bool minitest_result = []() { \
-    return minitest::PrintFailedTestLogs();  \
-  }();                                       \
+#define FINISH_MINITESTS                                                \
+  namespace minitest {                                                  \
+  static inline bool RunMinitests() {                                   \
+    bool passed = RunTests(RunOptions::FromEnvironment());              \
+    return PrintFailedTestLogs() && passed;                             \
+  }                                                                     \
   }  // namespace minitest
 //-----------------------------------//
 //=---------------------------------=//
@@ -311,10 +591,9 @@ return minitest::Test < []() consteval -> const char* { return #TestName; },\
 // Macro:{MINITESTS_RESULT}
 // Brief:{
 //        Only valid after calling FINISH_MINITESTS.
-//        This macro contains the result of the tests as a static const bool.
-//        It is set to true if all tests passed, else false.
+//        Runs the tests, true if all tests passed, else false.
 // }
-#define MINITESTS_RESULT minitest::minitest_result
+#define MINITESTS_RESULT minitest::RunMinitests()
 //-----------------------------------//
 //=---------------------------------=//
 
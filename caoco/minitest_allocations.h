@@ -0,0 +1,141 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: minitest
+// File: minitest_allocations.h
+//---------------------------------------------------------------------------//
+// Brief: Allocation budgets for the minitest framework.
+// Sample Use:
+//       MINITEST(MyTest, MyTestCase) {
+//         {
+//           EXPECT_MAX_ALLOCATIONS(10);  // Until the end of the scope.
+//           Lex(source);
+//         }
+//         auto parse = minitest::ExpectMaxAllocations(100, "parse");
+//         Parse(tokens);
+//         parse.Check();  // Or when destroyed.
+//       }
+//       END_MINITEST;
+//
+// The allocations of the calling thread are counted, a program opts in
+// with CAOCO_COUNT_ALLOCATIONS. Without it every budget holds.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_MINITEST_MINITEST_ALLOCATIONS_H
+#define HEADER_GUARD_CAOCO_MINITEST_MINITEST_ALLOCATIONS_H
+// Includes:
+#include "allocation_counter.h"
+#include "import_stl.h"
+#include "minitest.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+//---------------------------------------------------------------------------//
+// namespace minitest
+//---------------------------------------------------------------------------//
+namespace minitest {
+
+// Fails the running test case if the allocations since its construction
+// exceed the budget, when checked or destroyed. Checks once.
+class AllocationBudget {
+  AllocationScope scope_;
+  std::uint64_t max_count_;
+  std::uint64_t max_bytes_;
+  const char* what_;
+  std::source_location location_;
+  bool checked_ = false;
+
+ public:
+  AllocationBudget(std::uint64_t max_count, std::uint64_t max_bytes,
+                   const char* what, std::source_location location)
+      : max_count_(max_count),
+        max_bytes_(max_bytes),
+        what_(what),
+        location_(location) {}
+  AllocationBudget(const AllocationBudget&) = delete;
+  AllocationBudget& operator=(const AllocationBudget&) = delete;
+  ~AllocationBudget() { Check(); }
+
+  AllocationCount Count() const { return scope_.Count(); }
+
+  bool Check() {
+    if (checked_) return true;
+    checked_ = true;
+    auto count = scope_.Count();
+    if (count.count <= max_count_ && count.bytes <= max_bytes_) return true;
+    std::ostringstream log;
+    constexpr auto kUnbounded = std::numeric_limits<std::uint64_t>::max();
+    log << "[ALLOCATION BUDGET EXCEEDED]: " << what_ << ": " << count.count
+        << " allocations (" << count.bytes << " bytes), budget";
+    if (max_count_ != kUnbounded) log << " " << max_count_ << " allocations";
+    if (max_bytes_ != kUnbounded) log << " " << max_bytes_ << " bytes";
+    log << " at " << location_.file_name() << ":" << location_.line();
+    std::cout << "[FAIL] " << log.str() << std::endl;
+    AddFailedTestLog(log.str(), last_failed_test_name,
+                     last_failed_test_case_name);
+    return false;
+  }
+};
+
+[[nodiscard]] static inline AllocationBudget ExpectMaxAllocations(
+    std::uint64_t max_count, const char* what = "allocations",
+    std::source_location location = std::source_location::current()) {
+  return AllocationBudget(max_count,
+                          std::numeric_limits<std::uint64_t>::max(),
+                          what, location);
+}
+
+[[nodiscard]] static inline AllocationBudget ExpectMaxAllocatedBytes(
+    std::uint64_t max_bytes, const char* what = "allocated bytes",
+    std::source_location location = std::source_location::current()) {
+  return AllocationBudget(std::numeric_limits<std::uint64_t>::max(),
+                          max_bytes, what, location);
+}
+
+}  // namespace minitest
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+#define MINITEST_ALLOCATIONS_CONCAT_(a, b) a##b
+#define MINITEST_ALLOCATIONS_CONCAT(a, b) MINITEST_ALLOCATIONS_CONCAT_(a, b)
+
+//=---------------------------------=//
+// Macro:{EXPECT_MAX_ALLOCATIONS}
+// Brief:{Fails the test case if the rest of the enclosing scope allocates
+//        more than n times on the calling thread.}
+//-----------------------------------//
+#define EXPECT_MAX_ALLOCATIONS(n)                                          \
+  const auto MINITEST_ALLOCATIONS_CONCAT(minitest_allocations_, __LINE__) = \
+      minitest::ExpectMaxAllocations(n, "EXPECT_MAX_ALLOCATIONS(" #n ")")
+//-----------------------------------//
+//=---------------------------------=//
+
+//=---------------------------------=//
+// Macro:{EXPECT_MAX_ALLOCATED_BYTES}
+// Brief:{Fails the test case if the rest of the enclosing scope allocates
+//        more than n bytes on the calling thread.}
+//-----------------------------------//
+#define EXPECT_MAX_ALLOCATED_BYTES(n)                                      \
+  const auto MINITEST_ALLOCATIONS_CONCAT(minitest_allocations_, __LINE__) = \
+      minitest::ExpectMaxAllocatedBytes(n, "EXPECT_MAX_ALLOCATED_BYTES(" #n ")")
+//-----------------------------------//
+//=---------------------------------=//
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: minitest
+// File: minitest_allocations.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_MINITEST_MINITEST_ALLOCATIONS_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
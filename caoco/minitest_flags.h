@@ -19,9 +19,12 @@
 //---------------------------------------------------------------------------//
 //=-------------------------------------------------------------------------=//
 
-
-
-
+// Opt-in: the unit tests which build programs with the system compiler and
+// run them, see ut0_ir_transpiler.h and ut0_bench_corpus.h. They take
+// seconds, and skip when no compiler is found.
+#ifndef CAOCO_TEST_AOT
+#define CAOCO_TEST_AOT 0
+#endif
 
 //=-------------------------------------------------------------------------=//
 //---------------------------------------------------------------------------//
@@ -15,6 +15,10 @@
 #define HEADER_GUARD_CAOCO_MINITEST_MINITEST_UTIL_H
 // Includes:
 #include "cand_syntax.h"
+#include "ir_codegen.h"
+#include "ir_optimizer.h"
+#include "lark_parser.h"
+#include "lexer.h"
 #include "minitest_pch.h"
 //---------------------------------------------------------------------------//
 //=-------------------------------------------------------------------------=//
@@ -64,6 +68,153 @@ bool AstContains(const Ast& node, eAst type, const std::string& value) {
   return false;
 }
 
+// Lex, parse and generate the IR of a C& source string.
+IrCode IrTestGenerate(const std::string& source) {
+  auto tokens = Lexer::Lex(source);
+  if (!tokens.Valid()) {
+    std::cout << "Lexing Error:" << tokens.Error() << std::endl;
+    return IrCode{};
+  }
+  auto ast = LarkParser::Parse(tokens.Extract());
+  if (!ast.Valid()) {
+    std::cout << "Parsing Error:" << ast.Error() << std::endl;
+    return IrCode{};
+  }
+  IrGen gen;
+  return gen.GenerateIr(ast.Extract());
+}
+
+// Programs profiled to generate ir_fusion_table.h. Each one defines a
+// global named total.
+static const std::vector<std::string> kIrSuperinstructionCorpus = {
+    // Arithmetic loop.
+    "def @total: 0;"
+    "main: {"
+    "  def @i: 0;"
+    "  while(i < 2000){"
+    "    def @t: (i * 3 + 1) * (i * 3 + 1) - (i * 3 + 1) % 7;"
+    "    total = total + t % 1000;"
+    "    i++;"
+    "  };"
+    "};",
+    // Nested loops with a branch.
+    "def @total: 0;"
+    "main: {"
+    "  def @scale: 0;"
+    "  for(def @j: 0; j < 4; j++){ scale = scale + j; };"
+    "  for(def @i: 0; i < 300; i++){"
+    "    def @row: i * scale;"
+    "    def @k: 0;"
+    "    while(k < 10){"
+    "      def @cell: row + k * (scale + 1);"
+    "      if(cell % 2 == 0){ total = total + cell % 97; }"
+    "      else { total = total - 1; }"
+    "      k++;"
+    "    };"
+    "  };"
+    "};",
+    // String building and comparison.
+    "def @total: 0;"
+    "main: {"
+    "  for(def @n: 0; n < 200; n++){"
+    "    def @word: 'a';"
+    "    while(word != 'aaaaaaaaaaa'){ word = word + 'a'; total++; };"
+    "  };"
+    "};",
+    // Method calls on globals.
+    "def @total: 0; def @x: 0;"
+    "fn@step:{ total = total + x * 2; return total; };"
+    "main: { while(x < 1000){ step(); x++; }; };",
+    // Fibonacci, copies between variables.
+    "def @total: 0;"
+    "main: {"
+    "  for(def @r: 0; r < 50; r++){"
+    "    def @a: 0; def @b: 1;"
+    "    for(def @i: 0; i < 40; i++){ def @t: a + b; a = b; b = t; };"
+    "    total = total + b % 1000;"
+    "  };"
+    "};",
+};
+
+// Optimized code of a corpus program, as the interpreter runs it.
+IrCode IrSuperinstructionTestCode(const std::string& source) {
+  auto code = IrTestGenerate(source);
+  IrPassManager::StandardPipeline().Run(code);
+  return code;
+}
+
+// Count lines of the given op in the code.
+std::size_t IrTestCount(const IrCode& code, eIrOp op) {
+  return std::count_if(code.GetLines().begin(), code.GetLines().end(),
+                       [op](const IrLine& line) { return line.op == op; });
+}
+
+// Disassembly of code with the source line of each IR line, equal for two
+// codes which run and report errors alike.
+std::string IrTestDisassembly(const IrCode& code) {
+  std::ostringstream os;
+  code.PrintDisassembly(os);
+  for (const auto& line : code.GetLines()) os << line.source_line << " ";
+  return os.str();
+}
+
+// Writes the files of a program to a new directory.
+std::filesystem::path ModuleTestWrite(
+    const std::string& name,
+    const std::vector<std::pair<std::string, std::string>>& files) {
+  auto dir = std::filesystem::temp_directory_path() / "caoco_modules" / name;
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  for (const auto& [file, text] : files) {
+    std::ofstream(dir / (file + ".cand"), std::ios::binary) << text;
+  }
+  return dir;
+}
+
+static const std::vector<std::pair<std::string, std::string>>
+    kModuleTestShapes = {
+        {"util", "fn@twice(n):{ return n * 2; };\n"},
+        {"shapes",
+         "import util;\n"
+         "class @Square:{ def @side: 1;\n"
+         "  fn@area(s):{ side = s; return twice(side * side); }; };\n"},
+        {"main",
+         "import shapes;\n"
+         "import util;\n"
+         "def @total: 0;\n"
+         "main: { def @q: Square(); total = q.area(3) + twice(1); };\n"}};
+
+// Levels of modules named m<level>_<i>, each importing every module of the
+// level below, and a root module importing the top level.
+std::vector<std::pair<std::string, std::string>> ModuleTestLayers(int levels,
+                                                                  int width) {
+  std::vector<std::pair<std::string, std::string>> files;
+  std::string root = "def @total: 0;\nmain: {\n";
+  for (int level = 0; level < levels; level++) {
+    for (int i = 0; i < width; i++) {
+      auto name = "m" + std::to_string(level) + "_" + std::to_string(i);
+      std::string text;
+      for (int below = 0; level > 0 && below < width; below++) {
+        text += "import m" + std::to_string(level - 1) + "_" +
+                std::to_string(below) + ";\n";
+      }
+      for (int fn = 0; fn < 10; fn++) {
+        text += "fn@" + name + "_f" + std::to_string(fn) +
+                "(a, b):{ def @s: 0;\n"
+                "  for(def @i: 0; i < a; i++){ s = s + b * i; };\n"
+                "  return s; };\n";
+      }
+      files.push_back({name, text});
+      if (level == levels - 1) {
+        root = "import " + name + ";\n" + root;
+        root += "  total = total + " + name + "_f0(2, 3);\n";
+      }
+    }
+  }
+  files.push_back({"root", root + "};\n"});
+  return files;
+}
+
 void PrintAst(const Ast& node, std::size_t depth = 0 ){
 
 
@@ -0,0 +1,420 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: module_cache.h
+//---------------------------------------------------------------------------//
+// Brief: Content addressed disk cache of compiled modules.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_MODULE_CACHE_H
+#define HEADER_GUARD_CAOCO_COMPILER_MODULE_CACHE_H
+// Includes:
+#include "candc_module.h"
+#include "import_stl.h"
+#include "ir_codegen.h"
+#include "sema.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+// First line of every entry and part of every key. Change it with anything
+// which changes the IR generated for a source: the lexer, the preprocessor,
+// the parser, the semantic analysis or the IR generator.
+static constexpr std::string_view kModuleCacheVersion = "caoco-cache 3";
+static constexpr std::string_view kModuleCacheExtension = ".entry";
+static constexpr std::string_view kModuleCacheImportsExtension = ".imports";
+static constexpr std::uintmax_t kModuleCacheDefaultCapacity = 64ull << 20;
+
+struct ModuleCacheEntry {
+  IrCode code;
+  std::vector<SemaExport> exports;
+  std::chrono::microseconds build_time{0};  // Saved by each hit.
+  std::string key{};  // ModuleCacheKey::text, set by ModuleCache::Store.
+};
+
+// The address of an entry names its file and its slot in memory. The text
+// is what the address was hashed from, with the source reduced to its size
+// and a second hash independent of the address. Entries keep the text and
+// a lookup whose text differs misses, so two keys whose addresses collide
+// never read each other's entry.
+struct ModuleCacheKey {
+  std::uint64_t address = 0;
+  std::string text;
+};
+
+//=-------------------------------------------------------------------------=//
+// ModuleCache
+//---------------------------------------------------------------------------//
+// A directory of entries named by the address of their key, a hash of
+// everything the entry depends on: the version, the source, how it was
+// compiled and the export hashes of its imports. Each entry keeps the text
+// of its key, see ModuleCacheKey. Editing a method body keeps the exports of its
+// module, so the modules importing it still hit. The names a source imports
+// are kept next to the entries, keyed by the source only.
+// Entries are written to a temporary file and renamed, so a reader sees a
+// whole entry or none, from any thread or process. A hit touches the entry,
+// and once the entries exceed the capacity the least recently used go.
+// A long running process can keep the entries it uses in memory as well,
+// up to a second capacity, to skip reading and decoding them.
+class ModuleCache {
+  // An entry or the imports of a source, sized as on disk.
+  struct MemoryEntry {
+    std::shared_ptr<const ModuleCacheEntry> entry;
+    std::shared_ptr<const std::vector<std::string>> imports;
+    std::uintmax_t size = 0;
+    std::string key{};  // ModuleCacheKey::text.
+    std::list<std::uint64_t>::iterator use{};
+  };
+
+  std::filesystem::path dir_;
+  std::uintmax_t capacity_;
+  std::mutex mutex_;  // Guards size_ and eviction.
+  std::uintmax_t size_ = 0;
+  std::uintmax_t memory_capacity_;
+  std::mutex memory_mutex_;  // Guards the members below.
+  std::uintmax_t memory_size_ = 0;
+  std::unordered_map<std::uint64_t, MemoryEntry> memory_;
+  std::list<std::uint64_t> memory_use_;  // Most recently used first.
+  std::atomic<std::size_t> hits_ = 0;
+  std::atomic<std::size_t> misses_ = 0;
+  std::atomic<std::int64_t> saved_us_ = 0;
+  std::atomic<std::size_t> temp_count_ = 0;
+
+  std::filesystem::path PathOf(
+      std::uint64_t key,
+      std::string_view extension = kModuleCacheExtension) const {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key
+         << extension;
+    return dir_ / name.str();
+  }
+
+  // Second hash of a source, a multiply and xorshift unrelated to the
+  // FNV-1a of CandcChecksum.
+  static std::uint64_t SourceHash(std::string_view source) {
+    std::uint64_t hash = 0x9E3779B97F4A7C15ull ^ source.size();
+    for (unsigned char c : source) {
+      hash = (hash ^ c) * 0xFF51AFD7ED558CCDull;
+      hash ^= hash >> 29;
+    }
+    return hash;
+  }
+
+  // A key of header, one line, followed by the source.
+  static ModuleCacheKey MakeKey(std::string header, std::string_view source) {
+    ModuleCacheKey key;
+    key.address = CandcChecksum(header + "\n" + std::string(source));
+    key.text = std::move(header) + " source " + std::to_string(source.size()) +
+               " " + std::to_string(SourceHash(source));
+    return key;
+  }
+
+  static ModuleCacheKey ImportsKey(std::string_view source) {
+    return MakeKey(std::string(kModuleCacheVersion) + " imports", source);
+  }
+
+  // Replaces the file at path, see the class comment.
+  void Write(const std::filesystem::path& path, const std::string& text) {
+    auto temp = path;
+    temp += ".tmp" + std::to_string(::getpid()) + "_" +
+            std::to_string(temp_count_++);
+    {
+      std::ofstream file(temp, std::ios::binary);
+      file.write(text.data(), static_cast<std::streamsize>(text.size()));
+      if (!file) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+      std::filesystem::remove(temp, ec);
+      return;
+    }
+    std::lock_guard lock(mutex_);
+    size_ += text.size();
+    if (size_ > capacity_) Evict();
+  }
+
+  // Sum of the entries on disk, to pick up other processes.
+  std::uintmax_t Scan(std::vector<std::filesystem::path>* entries) const {
+    std::uintmax_t size = 0;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(dir_, ec), end;
+         !ec && it != end; it.increment(ec)) {
+      auto extension = it->path().extension();
+      if (extension != kModuleCacheExtension &&
+          extension != kModuleCacheImportsExtension) {
+        continue;
+      }
+      size += it->file_size(ec);
+      if (entries != nullptr) entries->push_back(it->path());
+    }
+    return size;
+  }
+
+  void Evict() {
+    std::vector<std::filesystem::path> entries;
+    size_ = Scan(&entries);
+    if (size_ <= capacity_) return;
+    std::error_code ec;
+    std::vector<std::pair<std::filesystem::file_time_type,
+                          std::filesystem::path>>
+        by_use;
+    for (auto& path : entries) {
+      by_use.push_back({std::filesystem::last_write_time(path, ec), path});
+    }
+    std::sort(by_use.begin(), by_use.end());
+    for (const auto& [time, path] : by_use) {
+      if (size_ <= capacity_) break;
+      auto size = std::filesystem::file_size(path, ec);
+      if (!ec && std::filesystem::remove(path, ec)) size_ -= size;
+    }
+  }
+
+  void Remember(const ModuleCacheKey& key, MemoryEntry remembered) {
+    if (remembered.size > memory_capacity_) return;
+    remembered.key = key.text;
+    std::lock_guard lock(memory_mutex_);
+    Forget(key.address);
+    memory_use_.push_front(key.address);
+    remembered.use = memory_use_.begin();
+    memory_size_ += remembered.size;
+    memory_.emplace(key.address, std::move(remembered));
+    while (memory_size_ > memory_capacity_) Forget(memory_use_.back());
+  }
+
+  void Forget(std::uint64_t key) {
+    auto it = memory_.find(key);
+    if (it == memory_.end()) return;
+    memory_size_ -= it->second.size;
+    memory_use_.erase(it->second.use);
+    memory_.erase(it);
+  }
+
+  // Marks a remembered entry used, null when it is not in memory.
+  template <typename T>
+  std::shared_ptr<const T> Recall(
+      const ModuleCacheKey& key,
+      std::shared_ptr<const T> MemoryEntry::*member) {
+    std::lock_guard lock(memory_mutex_);
+    auto it = memory_.find(key.address);
+    if (it == memory_.end() || it->second.*member == nullptr ||
+        it->second.key != key.text) {
+      return nullptr;
+    }
+    memory_use_.splice(memory_use_.begin(), memory_use_, it->second.use);
+    return it->second.*member;
+  }
+
+  static std::string Serialize(const ModuleCacheEntry& entry) {
+    std::ostringstream os;
+    os << kModuleCacheVersion << "\n"
+       << entry.key << "\n"
+       << entry.build_time.count() << "\n"
+       << entry.exports.size() << "\n";
+    for (const auto& exported : entry.exports) {
+      os << exported.name << " " << static_cast<int>(exported.category) << " "
+         << exported.arity << " " << exported.member << "\n";
+    }
+    auto code = CandcWriter::Write(entry.code);
+    os.write(code.data(), static_cast<std::streamsize>(code.size()));
+    return os.str();
+  }
+
+  static std::optional<ModuleCacheEntry> Deserialize(const std::string& text) {
+    std::istringstream is(text);
+    std::string version;
+    std::int64_t build_us = 0;
+    std::size_t count = 0;
+    ModuleCacheEntry entry;
+    if (!std::getline(is, version) || version != kModuleCacheVersion ||
+        !std::getline(is, entry.key) || !(is >> build_us >> count)) {
+      return std::nullopt;
+    }
+    entry.build_time = std::chrono::microseconds(build_us);
+    for (std::size_t i = 0; i < count; i++) {
+      SemaExport exported;
+      int category = 0;
+      if (!(is >> exported.name >> category >> exported.arity >>
+            exported.member)) {
+        return std::nullopt;
+      }
+      exported.category = static_cast<eIdentityCategory>(category);
+      entry.exports.push_back(std::move(exported));
+    }
+    is.get();  // The newline ending the exports.
+    // Copied so the module header is aligned.
+    auto offset = static_cast<std::size_t>(is.tellg());
+    if (offset > text.size()) return std::nullopt;
+    std::vector<char> bytes(text.begin() + offset, text.end());
+    auto module = CandcModule::View(bytes);
+    if (!module) return std::nullopt;
+    entry.code = module.Value().ToIrCode();
+    return entry;
+  }
+
+ public:
+  explicit ModuleCache(std::filesystem::path dir,
+                       std::uintmax_t capacity = kModuleCacheDefaultCapacity,
+                       std::uintmax_t memory_capacity = 0)
+      : dir_(std::move(dir)),
+        capacity_(capacity),
+        memory_capacity_(memory_capacity) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    size_ = Scan(nullptr);
+  }
+
+  // Hash of the exports of a module, which its importers depend on.
+  static std::uint64_t InterfaceHash(const std::vector<SemaExport>& exports) {
+    std::string text;
+    for (const auto& exported : exports) {
+      text += exported.name + " " +
+              std::to_string(static_cast<int>(exported.category)) + " " +
+              std::to_string(exported.arity) + " " +
+              std::to_string(exported.member) + "\n";
+    }
+    return CandcChecksum(text);
+  }
+
+  // The flags are the options which change the entry.
+  static ModuleCacheKey Key(std::string_view source, std::uint32_t flags,
+                            const std::vector<std::uint64_t>& interfaces) {
+    std::string header(kModuleCacheVersion);
+    header += " candc " + std::to_string(kCandcVersion) + " flags " +
+              std::to_string(flags) + " imports";
+    for (auto hash : interfaces) header += " " + std::to_string(hash);
+    return MakeKey(std::move(header), source);
+  }
+
+  // A miss unless an entry was stored with the same key text.
+  std::optional<ModuleCacheEntry> Find(const ModuleCacheKey& key) {
+    auto start = std::chrono::steady_clock::now();
+    std::optional<ModuleCacheEntry> entry;
+    if (auto remembered = Recall(key, &MemoryEntry::entry)) {
+      entry = *remembered;
+    } else {
+      auto path = PathOf(key.address);
+      std::ifstream file(path, std::ios::binary);
+      std::string text;
+      if (file) {
+        text.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+        entry = Deserialize(text);
+      }
+      if (!entry || entry->key != key.text) {
+        misses_++;
+        return std::nullopt;
+      }
+      std::error_code ec;
+      std::filesystem::last_write_time(
+          path, std::filesystem::file_time_type::clock::now(), ec);
+      if (memory_capacity_ > 0) {
+        Remember(key, {std::make_shared<const ModuleCacheEntry>(*entry),
+                       nullptr, text.size()});
+      }
+    }
+    auto load = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    hits_++;
+    saved_us_ += std::max<std::int64_t>(0, (entry->build_time - load).count());
+    return entry;
+  }
+
+  void Store(const ModuleCacheKey& key, ModuleCacheEntry entry) {
+    entry.key = key.text;
+    auto text = Serialize(entry);
+    if (memory_capacity_ > 0) {
+      Remember(key, {std::make_shared<const ModuleCacheEntry>(std::move(entry)),
+                     nullptr, text.size()});
+    }
+    Write(PathOf(key.address), text);
+  }
+
+  // Names a source imports, so a build which hits needs no lexing.
+  std::optional<std::vector<std::string>> FindImports(
+      std::string_view source) {
+    auto key = ImportsKey(source);
+    if (auto remembered = Recall(key, &MemoryEntry::imports)) {
+      return *remembered;
+    }
+    std::ifstream file(PathOf(key.address, kModuleCacheImportsExtension));
+    std::string version;
+    std::string text;
+    if (!std::getline(file, version) || version != kModuleCacheVersion ||
+        !std::getline(file, text) || text != key.text) {
+      return std::nullopt;
+    }
+    std::vector<std::string> names;
+    std::uintmax_t size = version.size() + text.size() + 2;
+    for (std::string name; std::getline(file, name);) {
+      size += name.size() + 1;
+      names.push_back(name);
+    }
+    if (memory_capacity_ > 0) {
+      Remember(key, {nullptr,
+                     std::make_shared<const std::vector<std::string>>(names),
+                     size});
+    }
+    return names;
+  }
+
+  void StoreImports(std::string_view source,
+                    const std::vector<std::string>& names) {
+    auto key = ImportsKey(source);
+    std::string text(kModuleCacheVersion);
+    text += "\n" + key.text + "\n";
+    for (const auto& name : names) text += name + "\n";
+    if (memory_capacity_ > 0) {
+      Remember(key, {nullptr,
+                     std::make_shared<const std::vector<std::string>>(names),
+                     text.size()});
+    }
+    Write(PathOf(key.address, kModuleCacheImportsExtension), text);
+  }
+
+  void Clear() {
+    {
+      std::lock_guard lock(memory_mutex_);
+      memory_.clear();
+      memory_use_.clear();
+      memory_size_ = 0;
+    }
+    std::lock_guard lock(mutex_);
+    std::vector<std::filesystem::path> entries;
+    Scan(&entries);
+    std::error_code ec;
+    for (const auto& path : entries) std::filesystem::remove(path, ec);
+    size_ = 0;
+  }
+
+  std::size_t Hits() const { return hits_; }
+  std::size_t Misses() const { return misses_; }
+  // Build time of the hits, less the time to load them.
+  std::chrono::microseconds TimeSaved() const {
+    return std::chrono::microseconds(saved_us_.load());
+  }
+  std::uintmax_t SizeOnDisk() const { return Scan(nullptr); }
+  std::uintmax_t SizeInMemory() {
+    std::lock_guard lock(memory_mutex_);
+    return memory_size_;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: module_cache.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_MODULE_CACHE_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
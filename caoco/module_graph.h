@@ -0,0 +1,412 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: module_graph.h
+//---------------------------------------------------------------------------//
+// Brief: Resolves the imports of a program and compiles its modules.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_MODULE_GRAPH_H
+#define HEADER_GUARD_CAOCO_COMPILER_MODULE_GRAPH_H
+// Includes:
+#include "compilation_session.h"
+#include "expected.h"
+#include "import_stl.h"
+#include "ir_codegen.h"
+#include "ir_optimizer.h"
+#include "lexer.h"
+#include "module_cache.h"
+#include "phase_timer.h"
+#include "system_io.h"
+#include "work_stealing_pool.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+// Error codes, followed by the module or the cycle.
+static constexpr std::string_view kModuleErrorCannotResolve =
+    "Cannot resolve import: ";
+static constexpr std::string_view kModuleErrorCycle = "Import cycle: ";
+
+// `import name;` is the file name.cand next to the importing file.
+static constexpr std::string_view kModuleSourceExtension = ".cand";
+
+//=-------------------------------------------------------------------------=//
+// ModuleGraph
+//---------------------------------------------------------------------------//
+// The modules of a program and their imports, which form a DAG:
+// 1. Load reads the root file, then the files it imports, a wave of newly
+//    found files at a time in parallel. A file is lexed to find its imports
+//    unless the cache has them. A cycle fails the load.
+// 2. Build compiles a module in the wave after the last of its imports, the
+//    modules of a wave in parallel. It is parsed once, by its own session,
+//    checked against the exports of its imports, and its IR is generated
+//    without its main unless it is the root. With a cache, a module whose
+//    source and imported exports did not change is loaded instead.
+// 3. Link appends the IR of every module, imports first, and optimizes the
+//    whole program.
+class ModuleGraph {
+ public:
+  struct Module {
+    std::string name;
+    std::filesystem::path path;
+    std::vector<std::size_t> imports;  // Indices of the imported modules.
+    std::size_t level = 0;             // 1 + the highest of its imports.
+    CompilationSession session;
+    std::string source{};
+    std::vector<std::string> import_names{};
+    TkVector tokens{};  // Until it is parsed, empty if its imports were cached.
+    IrCode code{};
+    std::vector<SemaExport> exports{};
+    std::uint64_t interface = 0;  // Hash of the exports.
+    bool cached = false;          // Loaded from the cache.
+    std::string error{};
+    std::chrono::microseconds time{0};  // To read and build it.
+  };
+
+ private:
+  CompilationOptions options_;
+  std::size_t threads_;
+  ModuleCache* cache_;
+  std::deque<Module> modules_;  // The root first, stable for the tasks.
+  std::chrono::microseconds wall_time_{0};
+
+  static std::chrono::microseconds Since(
+      std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+  }
+
+  // Reads a module and finds its imports, in the cache or by lexing it.
+  void ReadModule(Module& module) {
+    auto start = std::chrono::steady_clock::now();
+    try {
+      CAOCO_PHASE("read");
+      auto text = LoadFileToVec(module.path.string());
+      module.source.assign(text.begin(), text.end());
+    } catch (const std::runtime_error& e) {
+      module.error = e.what();
+      return;
+    }
+    if (cache_ != nullptr) {
+      if (auto names = cache_->FindImports(module.source)) {
+        module.import_names = std::move(*names);
+        module.time += Since(start);
+        return;
+      }
+    }
+    {
+      CAOCO_PHASE("lex");
+      auto tokens = Lexer::Lex(module.source);
+      if (!tokens) {
+        module.error = tokens.Error();
+        return;
+      }
+      module.tokens = tokens.Extract();
+    }
+    module.import_names = ImportNames(module.tokens);
+    if (cache_ != nullptr) {
+      cache_->StoreImports(module.source, module.import_names);
+    }
+    module.time += Since(start);
+  }
+
+  // Names of the imports of a module, `import` and an identifier.
+  static std::vector<std::string> ImportNames(const TkVector& tokens) {
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i + 1 < tokens.size(); i++) {
+      if (tokens[i].TypeIs(eTk::kImport) &&
+          tokens[i + 1].TypeIs(eTk::kIdentifier)) {
+        names.push_back(tokens[i + 1].Literal());
+      }
+    }
+    return names;
+  }
+
+  void BuildModule(Module& module) {
+    auto start = std::chrono::steady_clock::now();
+    bool root = &module == &modules_.front();
+    ModuleCacheKey key;
+    // The key does not cover included files.
+    bool cacheable =
+        cache_ != nullptr &&
+        module.source.find(grammar::directives::kInclude::value) ==
+            std::string::npos;
+    if (cacheable) {
+      std::vector<std::uint64_t> interfaces;
+      for (auto imported : module.imports) {
+        interfaces.push_back(modules_[imported].interface);
+      }
+      std::uint32_t flags = (options_.check ? 1 : 0) | (root ? 2 : 0);
+      key = ModuleCache::Key(module.source, flags, interfaces);
+      if (auto entry = cache_->Find(key)) {
+        module.code = std::move(entry->code);
+        module.exports = std::move(entry->exports);
+        module.interface = ModuleCache::InterfaceHash(module.exports);
+        module.cached = true;
+        module.time += Since(start);
+        return;
+      }
+    }
+    if (module.tokens.empty()) {
+      CAOCO_PHASE("lex");
+      auto tokens = Lexer::Lex(module.source);
+      if (!tokens) {
+        module.error = " " + tokens.Error();
+        return;
+      }
+      module.tokens = tokens.Extract();
+    }
+    auto ast = module.session.Parse(std::move(module.tokens), module.path);
+    if (!ast) {
+      module.error = " " + ast.Error();
+      return;
+    }
+    for (auto imported : module.imports) {
+      module.session.Import(modules_[imported].exports);
+    }
+    if (options_.check) {
+      module.session.Check();
+      const auto& diagnostics = module.session.Diagnostics();
+      if (!diagnostics.empty()) {
+        module.error = std::to_string(diagnostics.front().line) + ": " +
+                       diagnostics.front().message;
+        return;
+      }
+    }
+    auto code = module.session.Generate(root);
+    if (!code) {
+      module.error = " " + code.Error();
+      return;
+    }
+    module.code = code.Extract();
+    module.exports = SemanticAnalyzer::Exports(module.session.Tree());
+    module.interface = ModuleCache::InterfaceHash(module.exports);
+    module.time += Since(start);
+    if (cacheable) {
+      cache_->Store(key, {module.code, module.exports, Since(start)});
+    }
+  }
+
+  Expected<std::size_t> Resolve(const Module& importer,
+                                const std::string& name) {
+    auto path = (importer.path.parent_path() /
+                 (name + std::string(kModuleSourceExtension)))
+                    .lexically_normal();
+    for (std::size_t i = 0; i < modules_.size(); i++) {
+      if (modules_[i].path == path) return Expected<std::size_t>::Success(i);
+    }
+    if (!std::filesystem::exists(path)) {
+      return Expected<std::size_t>::Failure(
+          importer.path.string() + ": " +
+          std::string(kModuleErrorCannotResolve) + name);
+    }
+    modules_.push_back({name, path, {}, 0, CompilationSession(options_)});
+    return Expected<std::size_t>::Success(modules_.size() - 1);
+  }
+
+  // Returns the cycle through an import, empty if there is none.
+  std::vector<std::size_t> FindCycle() const {
+    enum class eMark { kNew, kOpen, kDone };
+    std::vector<eMark> marks(modules_.size(), eMark::kNew);
+    std::vector<std::size_t> stack;
+    std::vector<std::size_t> cycle;
+    std::function<bool(std::size_t)> xVisit = [&](std::size_t i) {
+      marks[i] = eMark::kOpen;
+      stack.push_back(i);
+      for (auto imported : modules_[i].imports) {
+        if (marks[imported] == eMark::kOpen) {
+          auto first = std::find(stack.begin(), stack.end(), imported);
+          cycle.assign(first, stack.end());
+          cycle.push_back(imported);
+          return true;
+        }
+        if (marks[imported] == eMark::kNew && xVisit(imported)) return true;
+      }
+      stack.pop_back();
+      marks[i] = eMark::kDone;
+      return false;
+    };
+    for (std::size_t i = 0; i < modules_.size(); i++) {
+      if (marks[i] == eMark::kNew && xVisit(i)) break;
+    }
+    return cycle;
+  }
+
+  // The level of a module once those of its imports are known.
+  std::size_t AssignLevels() {
+    std::size_t levels = 0;
+    std::function<std::size_t(std::size_t)> xLevel = [&](std::size_t i) {
+      auto& module = modules_[i];
+      if (module.level != 0) return module.level;
+      std::size_t level = 1;
+      for (auto imported : module.imports) {
+        level = std::max(level, xLevel(imported) + 1);
+      }
+      module.level = level;
+      levels = std::max(levels, level);
+      return level;
+    };
+    for (std::size_t i = 0; i < modules_.size(); i++) xLevel(i);
+    return levels;
+  }
+
+ public:
+  // 0 threads uses one per hardware thread. The cache is optional.
+  explicit ModuleGraph(CompilationOptions options = {},
+                       std::size_t threads = 0, ModuleCache* cache = nullptr)
+      : options_(options), threads_(threads), cache_(cache) {}
+
+  const std::deque<Module>& Modules() const { return modules_; }
+  const Module& Root() const { return modules_.front(); }
+
+  // Reads a file and every file it imports.
+  BoolError Load(const std::filesystem::path& root) {
+    modules_.clear();
+    modules_.push_back({root.stem().string(), root.lexically_normal(), {}, 0,
+                        CompilationSession(options_)});
+    WorkStealingPool pool(threads_);
+    std::size_t begin = 0;
+    while (begin < modules_.size()) {
+      std::size_t end = modules_.size();
+      std::vector<WorkStealingPool::Task> wave;
+      for (std::size_t i = begin; i < end; i++) {
+        wave.push_back([this, i] { ReadModule(modules_[i]); });
+      }
+      pool.Run(std::move(wave));
+      for (std::size_t i = begin; i < end; i++) {
+        if (!modules_[i].error.empty()) {
+          return modules_[i].path.string() + ": " + modules_[i].error;
+        }
+        for (const auto& name : modules_[i].import_names) {
+          auto imported = Resolve(modules_[i], name);
+          if (!imported) return imported.Error();
+          modules_[i].imports.push_back(imported.Value());
+        }
+      }
+      begin = end;
+    }
+    auto cycle = FindCycle();
+    if (!cycle.empty()) {
+      std::string names;
+      for (auto i : cycle) {
+        names += (names.empty() ? "" : " -> ") + modules_[i].name;
+      }
+      return std::string(kModuleErrorCycle) + names;
+    }
+    return BoolError();
+  }
+
+  // Checks the loaded modules and collects their exports.
+  BoolError Build() {
+    auto start = std::chrono::steady_clock::now();
+    auto levels = AssignLevels();
+    WorkStealingPool pool(threads_);
+    for (std::size_t level = 1; level <= levels; level++) {
+      std::vector<WorkStealingPool::Task> wave;
+      for (auto& module : modules_) {
+        if (module.level != level) continue;
+        wave.push_back([this, &module] { BuildModule(module); });
+      }
+      pool.Run(std::move(wave));
+      for (const auto& module : modules_) {
+        if (module.level == level && !module.error.empty()) {
+          return module.path.string() + ":" + module.error;
+        }
+      }
+    }
+    wall_time_ = Since(start);
+    return BoolError();
+  }
+
+  // The IR of the program, the main of the root runs.
+  Expected<IrCode> Link() const {
+    std::vector<const Module*> order;
+    for (const auto& module : modules_) order.push_back(&module);
+    std::stable_sort(order.begin(), order.end(),
+                     [](const Module* a, const Module* b) {
+                       return a->level < b->level;
+                     });
+    IrCode code;
+    {
+      CAOCO_PHASE("link");
+      code.AddLine(0, eIrOp::ENTER_PROGRAM_DEFINITION, kIrOpNullArguments);
+      for (const auto* module : order) code.Append(module->code);
+    }
+    if (options_.optimize) {
+      CAOCO_PHASE("optimize");
+      auto optimized = IrPassManager::StandardPipeline().Run(code);
+      if (!optimized) return Expected<IrCode>::Failure(optimized.Error());
+    }
+    return Expected<IrCode>::Success(std::move(code));
+  }
+
+  // The chain of imports from the root with the longest total time, which
+  // bounds the build with any number of threads. Root first.
+  std::vector<std::size_t> CriticalPath() const {
+    std::vector<std::optional<std::chrono::microseconds>> longest(
+        modules_.size());
+    std::vector<std::size_t> next(modules_.size(), modules_.size());
+    std::function<std::chrono::microseconds(std::size_t)> xLongest =
+        [&](std::size_t i) {
+          if (longest[i]) return *longest[i];
+          std::chrono::microseconds below{0};
+          for (auto imported : modules_[i].imports) {
+            auto time = xLongest(imported);
+            if (next[i] == modules_.size() || time > below) {
+              below = time;
+              next[i] = imported;
+            }
+          }
+          longest[i] = modules_[i].time + below;
+          return *longest[i];
+        };
+    std::vector<std::size_t> path;
+    if (modules_.empty()) return path;
+    xLongest(0);
+    for (std::size_t i = 0; i < modules_.size(); i = next[i]) {
+      path.push_back(i);
+    }
+    return path;
+  }
+
+  // The time of each module, the critical path and the use of the cache.
+  void PrintReport(std::ostream& os) const {
+    os << "Modules: " << modules_.size() << ", build: " << wall_time_.count()
+       << "us\n";
+    for (const auto& module : modules_) {
+      os << "  " << module.name << ": " << module.time.count() << "us, level "
+         << module.level << (module.cached ? ", cached" : "") << "\n";
+    }
+    std::chrono::microseconds total{0};
+    std::string names;
+    for (auto i : CriticalPath()) {
+      total += modules_[i].time;
+      names += (names.empty() ? "" : " -> ") + modules_[i].name;
+    }
+    os << "Critical path: " << names << " (" << total.count() << "us)\n";
+    if (cache_ != nullptr) {
+      os << "Cache: " << cache_->Hits() << " hits, " << cache_->Misses()
+         << " misses, saved " << cache_->TimeSaved().count() << "us\n";
+    }
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: module_graph.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_MODULE_GRAPH_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
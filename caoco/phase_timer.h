@@ -0,0 +1,299 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: castd
+// File: phase_timer.h
+//---------------------------------------------------------------------------//
+// Brief: Time, memory and allocations of each phase of a compilation.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_CASTD_PHASE_TIMER_H
+#define HEADER_GUARD_CAOCO_CASTD_PHASE_TIMER_H
+// Includes:
+#include "allocation_counter.h"
+#include "import_stl.h"
+
+#if defined(__unix__)
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+// CAOCO_PHASE compiles to nothing when 0.
+#ifndef CAOCO_PHASE_TIMING
+#define CAOCO_PHASE_TIMING 1
+#endif
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+struct PhaseRecord {
+  std::string_view name;
+  std::size_t thread = 0;  // In the order the threads first record.
+  std::chrono::microseconds start{0};  // Since the timer started.
+  std::chrono::microseconds wall{0};
+  std::chrono::microseconds cpu{0};  // Of the thread.
+  std::int64_t peak_rss_kb = 0;  // Growth of the peak of the process.
+  AllocationCount allocations;
+};
+
+//=-------------------------------------------------------------------------=//
+// PhaseTimer
+//---------------------------------------------------------------------------//
+// Records the phases run while it is started by the thread which started it,
+// and by the threads which adopt it, see Adopt. So each request of a
+// concurrent server records into its own timer. A thread starts one timer at
+// a time, starting a second one records nothing. A phase is a scope marked
+// with CAOCO_PHASE("name"), which costs a load of the active timer of the
+// thread when none is.
+class PhaseTimer {
+  // Shared by the timer and its open scopes, so a scope ending after the
+  // timer is destroyed records nothing rather than into freed memory.
+  struct Recorder {
+    std::chrono::steady_clock::time_point origin;
+    std::atomic<bool> recording = false;
+    std::mutex mutex;  // Guards the members below.
+    std::vector<PhaseRecord> records;
+    std::vector<std::thread::id> threads;
+
+    void Record(PhaseRecord record, std::thread::id thread) {
+      std::lock_guard lock(mutex);
+      auto known = std::find(threads.begin(), threads.end(), thread);
+      record.thread = known - threads.begin();
+      if (known == threads.end()) threads.push_back(thread);
+      records.push_back(record);
+    }
+  };
+
+ public:
+  using Handle = std::shared_ptr<Recorder>;
+
+ private:
+  static inline thread_local Handle active_;
+  Handle recorder_ = std::make_shared<Recorder>();
+
+  static std::chrono::microseconds ThreadCpuTime() {
+#if defined(__unix__)
+    timespec time{};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return std::chrono::microseconds(time.tv_sec * 1000000 +
+                                     time.tv_nsec / 1000);
+#else
+    return std::chrono::microseconds(std::clock() * 1000000 /
+                                     CLOCKS_PER_SEC);
+#endif
+  }
+
+  static std::int64_t PeakRssKb() {
+#if defined(__unix__)
+    rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return 0;
+#endif
+  }
+
+  static std::string Escape(std::string_view text) {
+    std::string escaped;
+    for (char c : text) {
+      if (c == '"' || c == '\\') escaped += '\\';
+      escaped += c;
+    }
+    return escaped;
+  }
+
+ public:
+  class Scope {
+    Handle recorder_;
+    PhaseRecord record_;
+    std::chrono::steady_clock::time_point start_;
+
+   public:
+    explicit Scope(std::string_view name) {
+      if (active_ == nullptr || !active_->recording) return;
+      recorder_ = active_;
+      record_.name = name;
+      record_.cpu = ThreadCpuTime();
+      record_.peak_rss_kb = PeakRssKb();
+      record_.allocations = AllocationCounter::Count();
+      start_ = std::chrono::steady_clock::now();
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope() {
+      if (recorder_ == nullptr || !recorder_->recording) return;
+      auto end = std::chrono::steady_clock::now();
+      record_.start = std::chrono::duration_cast<std::chrono::microseconds>(
+          start_ - recorder_->origin);
+      record_.wall =
+          std::chrono::duration_cast<std::chrono::microseconds>(end - start_);
+      record_.cpu = ThreadCpuTime() - record_.cpu;
+      record_.peak_rss_kb = PeakRssKb() - record_.peak_rss_kb;
+      record_.allocations = AllocationCounter::Count() - record_.allocations;
+      recorder_->Record(record_, std::this_thread::get_id());
+    }
+  };
+
+  // Records the phases of this thread into the timer active on the thread
+  // which handed out the handle, until it goes out of scope. Threads running
+  // the tasks of another thread adopt its timer, see WorkStealingPool.
+  class Adopt {
+    Handle previous_;
+
+   public:
+    explicit Adopt(Handle active) : previous_(std::move(active_)) {
+      active_ = std::move(active);
+    }
+    Adopt(const Adopt&) = delete;
+    Adopt& operator=(const Adopt&) = delete;
+    ~Adopt() { active_ = std::move(previous_); }
+  };
+
+  // The timer recording the phases of this thread, null if none.
+  static Handle Active() {
+    return active_ != nullptr && active_->recording ? active_ : nullptr;
+  }
+
+  PhaseTimer() = default;
+  PhaseTimer(const PhaseTimer&) = delete;
+  PhaseTimer& operator=(const PhaseTimer&) = delete;
+  ~PhaseTimer() { Stop(); }
+
+  // False when this thread is recording into another timer.
+  bool Start() {
+    if (Active() != nullptr) return false;
+    recorder_->origin = std::chrono::steady_clock::now();
+    recorder_->recording = true;
+    active_ = recorder_;
+    return true;
+  }
+
+  // The phases ending after are not recorded, on any thread.
+  void Stop() {
+    recorder_->recording = false;
+    if (active_ == recorder_) active_ = nullptr;
+  }
+
+  // In the order the phases ended.
+  std::vector<PhaseRecord> Records() {
+    std::lock_guard lock(recorder_->mutex);
+    return recorder_->records;
+  }
+
+  // A line per phase name in the order they first ran, the sums of their
+  // runs, and the total of the phases which did not run inside another.
+  void PrintReport(std::ostream& os) {
+    auto records = Records();
+    std::vector<PhaseRecord> phases;
+    std::vector<std::size_t> calls;
+    for (const auto& record : records) {
+      auto phase = std::find_if(
+          phases.begin(), phases.end(),
+          [&record](const PhaseRecord& p) { return p.name == record.name; });
+      if (phase == phases.end()) {
+        phases.push_back(record);
+        calls.push_back(1);
+        continue;
+      }
+      phase->start = std::min(phase->start, record.start);
+      phase->wall += record.wall;
+      phase->cpu += record.cpu;
+      phase->peak_rss_kb += record.peak_rss_kb;
+      phase->allocations.count += record.allocations.count;
+      phase->allocations.bytes += record.allocations.bytes;
+      calls[phase - phases.begin()]++;
+    }
+    std::vector<std::size_t> order(phases.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+      return phases[a].start < phases[b].start;
+    });
+    lambda xLine = [&os](std::string_view name, auto calls, auto wall,
+                         auto cpu, auto rss, auto count, auto bytes) {
+      os << std::left << std::setw(12) << name << std::right << std::setw(7)
+         << calls << std::setw(12) << wall << std::setw(12) << cpu
+         << std::setw(9) << rss << std::setw(10) << count << std::setw(12)
+         << bytes << "\n";
+    };
+    xLine("Phase", "Calls", "Wall(us)", "CPU(us)", "RSS(KB)", "Allocs",
+          "Bytes");
+    for (auto i : order) {
+      const auto& phase = phases[i];
+      xLine(phase.name, calls[i], phase.wall.count(), phase.cpu.count(),
+            phase.peak_rss_kb, phase.allocations.count,
+            phase.allocations.bytes);
+    }
+    PhaseRecord total;
+    for (const auto& record : records) {
+      bool nested = std::any_of(
+          records.begin(), records.end(), [&record](const PhaseRecord& r) {
+            return &r != &record && r.thread == record.thread &&
+                   r.start <= record.start &&
+                   record.start + record.wall <= r.start + r.wall &&
+                   r.wall > record.wall;
+          });
+      if (nested) continue;
+      total.wall += record.wall;
+      total.cpu += record.cpu;
+      total.peak_rss_kb += record.peak_rss_kb;
+      total.allocations.count += record.allocations.count;
+      total.allocations.bytes += record.allocations.bytes;
+    }
+    xLine("Total", records.size(), total.wall.count(), total.cpu.count(),
+          total.peak_rss_kb, total.allocations.count,
+          total.allocations.bytes);
+    if (!AllocationCounter::kEnabled) {
+      os << "Allocations are not counted in this build.\n";
+    }
+  }
+
+  // Chrome trace_event JSON, opened by chrome://tracing and Perfetto.
+  void WriteTrace(std::ostream& os) {
+    auto records = Records();
+    os << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < records.size(); i++) {
+      const auto& record = records[i];
+      os << (i == 0 ? "\n" : ",\n") << "{\"name\":\""
+         << Escape(record.name) << "\",\"cat\":\"compile\",\"ph\":\"X\","
+         << "\"ts\":" << record.start.count()
+         << ",\"dur\":" << record.wall.count()
+         << ",\"pid\":1,\"tid\":" << record.thread + 1
+         << ",\"args\":{\"cpu_us\":" << record.cpu.count()
+         << ",\"peak_rss_kb\":" << record.peak_rss_kb
+         << ",\"allocations\":" << record.allocations.count
+         << ",\"bytes\":" << record.allocations.bytes << "}}";
+    }
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  }
+};
+
+#define CAOCO_PHASE_CONCAT_(a, b) a##b
+#define CAOCO_PHASE_CONCAT(a, b) CAOCO_PHASE_CONCAT_(a, b)
+#if CAOCO_PHASE_TIMING
+// Records the rest of the enclosing scope as a phase, the name must
+// outlive the timer.
+#define CAOCO_PHASE(name) \
+  PhaseTimer::Scope CAOCO_PHASE_CONCAT(caoco_phase_, __LINE__)(name)
+#else
+#define CAOCO_PHASE(name) static_cast<void>(0)
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: castd
+// File: phase_timer.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_CASTD_PHASE_TIMER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
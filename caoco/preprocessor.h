@@ -0,0 +1,649 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: preprocessor.h
+//---------------------------------------------------------------------------//
+// Brief: Token level preprocessor run between the lexer and the parser.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_PREPROCESSOR_H
+#define HEADER_GUARD_CAOCO_COMPILER_PREPROCESSOR_H
+// Includes:
+#include "expected.h"
+#include "import_stl.h"
+#include "lexer.h"
+#include "system_io.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+static constexpr std::string_view kPpErrorUnterminated =
+    "Unterminated directive: ";
+static constexpr std::string_view kPpErrorStray = "Unexpected directive: ";
+static constexpr std::string_view kPpErrorIncludeSyntax =
+    "#include expects a string path and ';'.";
+static constexpr std::string_view kPpErrorCannotInclude = "Cannot include: ";
+static constexpr std::string_view kPpErrorIncludeCycle = "Include cycle: ";
+static constexpr std::string_view kPpErrorMacroSyntax =
+    "#macro expects a name and an optional parameter list.";
+static constexpr std::string_view kPpErrorMacroBody =
+    "A macro body cannot contain directives.";
+static constexpr std::string_view kPpErrorMacroArguments =
+    "Wrong number of macro arguments: ";
+static constexpr std::string_view kPpErrorCondition = "Invalid #if condition.";
+static constexpr std::string_view kPpPredefinedPath = "<predefined>";
+static constexpr std::size_t kPpMaxIncludeDepth = 64;
+
+// Tokens after preprocessing. A token keeps the line and column it was
+// lexed at, in the file at its index of paths. A macro body keeps the
+// position of its definition, an argument the position of the call.
+struct PpOutput {
+  TkVector tokens;
+  std::vector<std::uint32_t> files;
+  std::vector<std::filesystem::path> paths;  // The source first.
+};
+
+//=-------------------------------------------------------------------------=//
+// Preprocessor
+//---------------------------------------------------------------------------//
+// Acts on the directives of a lexed source:
+//   #include 'path';                    Splices the tokens of a file, the
+//                                        path relative to the includer.
+//   #macro NAME body #endmacro          Replaces NAME by the body tokens.
+//   #macro NAME(a, b) body #endmacro    Replaces NAME(x, y), a ( after the
+//                                        name always starts the parameters.
+//   #if(cond) .. #elif(cond) .. #else .. #endif
+//     Keeps the first branch with a non zero condition. A condition is an
+//     integer expression of literals, macros and defined(NAME), an unknown
+//     name is 0.
+// Macros expand on tokens, nothing is lexed twice. The arguments expand
+// before they are substituted, the result expands again without the macro
+// itself, so a macro never recurses.
+// The tokens of an included file are cached for the life of the
+// preprocessor, keyed by path and modification time. A file wrapped in
+// #if(!defined(G)) .. #endif is guarded by G, and is skipped without
+// splicing it once G is defined.
+class Preprocessor {
+  struct Macro {
+    bool function_like = false;
+    std::vector<std::string> params;
+    TkVector body;
+    std::uint32_t file = 0;
+  };
+
+  struct CachedFile {
+    std::filesystem::file_time_type time;
+    std::shared_ptr<const TkVector> tokens;
+    std::optional<std::string> guard;
+  };
+
+  std::unordered_map<std::string, Macro> predefined_;
+  std::unordered_map<std::string, Macro> macros_;  // Of the current run.
+  std::unordered_map<std::string, CachedFile> files_;
+  std::vector<std::filesystem::path> paths_;  // Of the current run.
+  std::vector<std::filesystem::path> including_;
+  std::vector<const std::string*> disabled_;  // Macros being expanded.
+  std::size_t cache_hits_ = 0;
+  std::size_t cache_misses_ = 0;
+  std::size_t guard_skips_ = 0;
+
+  static bool IsDirective(const Tk& tk) {
+    return tk.Type() >= eTk::kDirInclude && tk.Type() <= eTk::kDirEndif;
+  }
+
+  std::string Where(std::uint32_t file, const Tk& at) const {
+    std::string where = paths_[file].string();
+    if (!where.empty()) where += ":";
+    return where + std::to_string(at.Line()) + ": ";
+  }
+
+  static void Emit(PpOutput& out, const Tk& tk, std::uint32_t file) {
+    out.tokens.push_back(tk);
+    out.files.push_back(file);
+  }
+
+  // Index of the parenthesis closing the one at open.
+  static std::optional<std::size_t> CloseParen(std::span<const Tk> tokens,
+                                               std::size_t open) {
+    if (open >= tokens.size() || !tokens[open].TypeIs(eTk::kOpenParen)) {
+      return std::nullopt;
+    }
+    std::size_t depth = 0;
+    for (std::size_t i = open; i < tokens.size(); i++) {
+      if (tokens[i].TypeIs(eTk::kOpenParen)) depth++;
+      if (tokens[i].TypeIs(eTk::kCloseParen) && --depth == 0) return i;
+    }
+    return std::nullopt;
+  }
+
+  // Whole file #if(!defined(G)) .. #endif, without #elif or #else.
+  static std::optional<std::string> FindGuard(const TkVector& tokens) {
+    static constexpr std::array<eTk, 8> kPattern = {
+        eTk::kDirIf,      eTk::kOpenParen,  eTk::kNegation,
+        eTk::kIdentifier, eTk::kOpenParen,  eTk::kIdentifier,
+        eTk::kCloseParen, eTk::kCloseParen};
+    if (tokens.size() <= kPattern.size() ||
+        !tokens.back().TypeIs(eTk::kDirEndif) ||
+        tokens[3].Literal() != "defined") {
+      return std::nullopt;
+    }
+    for (std::size_t i = 0; i < kPattern.size(); i++) {
+      if (!tokens[i].TypeIs(kPattern[i])) return std::nullopt;
+    }
+    std::size_t depth = 0;
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+      if (tokens[i].TypeIs(eTk::kDirIf)) depth++;
+      if (depth == 1 && (tokens[i].TypeIs(eTk::kDirElif) ||
+                         tokens[i].TypeIs(eTk::kDirElse))) {
+        return std::nullopt;
+      }
+      if (tokens[i].TypeIs(eTk::kDirEndif) && --depth == 0 &&
+          i + 1 != tokens.size()) {
+        return std::nullopt;
+      }
+    }
+    return tokens[5].Literal();
+  }
+
+  // Expands the macros of tokens without directives into out. The files
+  // of the tokens, or all in file when empty.
+  BoolError Expand(std::span<const Tk> tokens,
+                   std::span<const std::uint32_t> files, std::uint32_t file,
+                   PpOutput& out) {
+    lambda xFileOf = [&](std::size_t i) {
+      return files.empty() ? file : files[i];
+    };
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+      const Tk& tk = tokens[i];
+      auto found = tk.TypeIs(eTk::kIdentifier) ? macros_.find(tk.Literal())
+                                               : macros_.end();
+      if (found == macros_.end() ||
+          std::find(disabled_.begin(), disabled_.end(), &found->first) !=
+              disabled_.end()) {
+        Emit(out, tk, xFileOf(i));
+        continue;
+      }
+      const Macro& macro = found->second;
+      std::vector<PpOutput> args;
+      if (macro.function_like) {
+        auto close = CloseParen(tokens, i + 1);
+        if (!close) {
+          if (i + 1 < tokens.size() &&
+              tokens[i + 1].TypeIs(eTk::kOpenParen)) {
+            return Where(xFileOf(i), tk) +
+                   std::string(kPpErrorUnterminated) + tk.Literal();
+          }
+          Emit(out, tk, xFileOf(i));  // The name alone is not a call.
+          continue;
+        }
+        std::size_t depth = 0;
+        std::size_t start = i + 2;
+        for (std::size_t j = i + 1; j <= *close; j++) {
+          if (tokens[j].TypeIs(eTk::kOpenParen)) depth++;
+          if (tokens[j].TypeIs(eTk::kCloseParen)) depth--;
+          bool split = depth == 1 && tokens[j].TypeIs(eTk::kComma);
+          if (!split && j != *close) continue;
+          if (j == *close && start == j && macro.params.empty()) break;
+          args.emplace_back();
+          auto expanded = Expand(
+              tokens.subspan(start, j - start),
+              files.empty() ? files : files.subspan(start, j - start), file,
+              args.back());
+          if (!expanded) return expanded;
+          start = j + 1;
+        }
+        if (args.size() != macro.params.size()) {
+          return Where(xFileOf(i), tk) +
+                 std::string(kPpErrorMacroArguments) + tk.Literal();
+        }
+        i = *close;
+      }
+      PpOutput body;
+      for (const auto& body_tk : macro.body) {
+        auto param =
+            body_tk.TypeIs(eTk::kIdentifier)
+                ? std::find(macro.params.begin(), macro.params.end(),
+                            body_tk.Literal())
+                : macro.params.end();
+        if (param == macro.params.end()) {
+          Emit(body, body_tk, macro.file);
+          continue;
+        }
+        const auto& arg = args[param - macro.params.begin()];
+        body.tokens.insert(body.tokens.end(), arg.tokens.begin(),
+                           arg.tokens.end());
+        body.files.insert(body.files.end(), arg.files.begin(),
+                          arg.files.end());
+      }
+      disabled_.push_back(&found->first);
+      auto expanded = Expand(body.tokens, body.files, file, out);
+      disabled_.pop_back();
+      if (!expanded) return expanded;
+    }
+    return BoolError();
+  }
+
+  // Recursive descent over the expanded tokens of a condition.
+  struct Condition {
+    const TkVector& tokens;
+    std::size_t at = 0;
+    bool valid = true;
+
+    bool Accept(eTk type) {
+      if (at < tokens.size() && tokens[at].TypeIs(type)) {
+        at++;
+        return true;
+      }
+      return false;
+    }
+
+    std::int64_t Or() {
+      auto value = And();
+      while (Accept(eTk::kLogicalOr)) value = (And() != 0) || value != 0;
+      return value;
+    }
+
+    std::int64_t And() {
+      auto value = Equality();
+      while (Accept(eTk::kLogicalAnd)) {
+        value = (Equality() != 0) && value != 0;
+      }
+      return value;
+    }
+
+    std::int64_t Equality() {
+      auto value = Relational();
+      while (true) {
+        if (Accept(eTk::kEqual)) {
+          value = value == Relational();
+        } else if (Accept(eTk::kNotEqual)) {
+          value = value != Relational();
+        } else {
+          return value;
+        }
+      }
+    }
+
+    std::int64_t Relational() {
+      auto value = Additive();
+      while (true) {
+        if (Accept(eTk::kLessThan)) {
+          value = value < Additive();
+        } else if (Accept(eTk::kGreaterThan)) {
+          value = value > Additive();
+        } else if (Accept(eTk::kLessThanOrEqual)) {
+          value = value <= Additive();
+        } else if (Accept(eTk::kGreaterThanOrEqual)) {
+          value = value >= Additive();
+        } else {
+          return value;
+        }
+      }
+    }
+
+    std::int64_t Additive() {
+      auto value = Multiplicative();
+      while (true) {
+        if (Accept(eTk::kAddition)) {
+          value += Multiplicative();
+        } else if (Accept(eTk::kSubtraction)) {
+          value -= Multiplicative();
+        } else {
+          return value;
+        }
+      }
+    }
+
+    std::int64_t Multiplicative() {
+      auto value = Unary();
+      while (true) {
+        bool divide = Accept(eTk::kDivision);
+        if (!divide && !Accept(eTk::kRemainder)) {
+          if (!Accept(eTk::kMultiplication)) return value;
+          value *= Unary();
+          continue;
+        }
+        auto divisor = Unary();
+        if (divisor == 0) {
+          valid = false;
+          return 0;
+        }
+        value = divide ? value / divisor : value % divisor;
+      }
+    }
+
+    std::int64_t Unary() {
+      if (Accept(eTk::kNegation)) return Unary() == 0;
+      if (Accept(eTk::kSubtraction)) return -Unary();
+      return Primary();
+    }
+
+    std::int64_t Primary() {
+      if (Accept(eTk::kOpenParen)) {
+        auto value = Or();
+        if (!Accept(eTk::kCloseParen)) valid = false;
+        return value;
+      }
+      if (at >= tokens.size()) {
+        valid = false;
+        return 0;
+      }
+      const Tk& tk = tokens[at++];
+      switch (tk.Type()) {
+        case eTk::kNumberLiteral:
+          return std::strtoll(tk.Literal().c_str(), nullptr, 10);
+        case eTk::kTrueLiteral:
+          return 1;
+        case eTk::kFalseLiteral:
+        case eTk::kIdentifier:
+          return 0;
+        default:
+          valid = false;
+          return 0;
+      }
+    }
+  };
+
+  Expected<bool> Evaluate(std::span<const Tk> condition, std::uint32_t file,
+                          const Tk& at) {
+    TkVector defined;
+    for (std::size_t i = 0; i < condition.size(); i++) {
+      if (i + 3 < condition.size() &&
+          condition[i].TypeAndLitIs(eTk::kIdentifier, "defined") &&
+          condition[i + 1].TypeIs(eTk::kOpenParen) &&
+          condition[i + 2].TypeIs(eTk::kIdentifier) &&
+          condition[i + 3].TypeIs(eTk::kCloseParen)) {
+        defined.push_back(Tk(eTk::kNumberLiteral,
+                             macros_.contains(condition[i + 2].Literal())
+                                 ? "1"
+                                 : "0",
+                             condition[i].Line(), condition[i].Col()));
+        i += 3;
+      } else {
+        defined.push_back(condition[i]);
+      }
+    }
+    PpOutput expanded;
+    auto result = Expand(defined, {}, file, expanded);
+    if (!result) return Expected<bool>::Failure(result.Error());
+    Condition parser{expanded.tokens};
+    auto value = parser.Or();
+    if (!parser.valid || parser.at != expanded.tokens.size()) {
+      return Expected<bool>::Failure(Where(file, at) +
+                                     std::string(kPpErrorCondition));
+    }
+    return Expected<bool>::Success(value != 0);
+  }
+
+  // Reads and lexes a file unless the cache holds its current tokens.
+  Expected<const CachedFile*> Load(const std::filesystem::path& path) {
+    using Result = Expected<const CachedFile*>;
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec) return Result::Failure(std::string(kPpErrorCannotInclude));
+    auto& cached = files_[path.string()];
+    if (cached.tokens != nullptr && cached.time == time) {
+      cache_hits_++;
+      return Result::Success(&cached);
+    }
+    cache_misses_++;
+    std::string source;
+    try {
+      auto text = LoadFileToVec(path.string());
+      source.assign(text.begin(), text.end());
+    } catch (const std::runtime_error&) {
+      files_.erase(path.string());
+      return Result::Failure(std::string(kPpErrorCannotInclude));
+    }
+    auto tokens = Lexer::Lex(source);
+    if (!tokens) {
+      files_.erase(path.string());
+      return Result::Failure(tokens.Error());
+    }
+    auto spliced = tokens.Extract();
+    // A file read from disk ends in a null, which lexes to the end token.
+    while (!spliced.empty() && spliced.back().TypeIs(eTk::kEof)) {
+      spliced.pop_back();
+    }
+    cached.time = time;
+    cached.tokens = std::make_shared<const TkVector>(std::move(spliced));
+    cached.guard = FindGuard(*cached.tokens);
+    return Result::Success(&cached);
+  }
+
+  BoolError Include(const std::filesystem::path& path, const Tk& at,
+                    std::uint32_t from, PpOutput& out) {
+    auto loaded = Load(path);
+    if (!loaded) {
+      return Where(from, at) + loaded.Error() +
+             (loaded.Error() == kPpErrorCannotInclude ? path.string() : "");
+    }
+    const CachedFile& cached = *loaded.Value();
+    if (cached.guard && macros_.contains(*cached.guard)) {
+      guard_skips_++;
+      return BoolError();
+    }
+    if (std::find(including_.begin(), including_.end(), path) !=
+            including_.end() ||
+        including_.size() >= kPpMaxIncludeDepth) {
+      std::string cycle;
+      for (const auto& included : including_) {
+        cycle += included.string() + " -> ";
+      }
+      return Where(from, at) + std::string(kPpErrorIncludeCycle) +
+             cycle + path.string();
+    }
+    auto known = std::find(paths_.begin(), paths_.end(), path);
+    auto file = static_cast<std::uint32_t>(known - paths_.begin());
+    if (known == paths_.end()) paths_.push_back(path);
+    auto tokens = cached.tokens;  // Kept if the file is reloaded inside.
+    including_.push_back(path);
+    auto processed = Process(*tokens, file, out);
+    including_.pop_back();
+    return processed;
+  }
+
+  BoolError Define(std::span<const Tk> tokens, std::size_t& i,
+                   std::uint32_t file) {
+    const Tk& at = tokens[i];
+    if (i + 1 >= tokens.size() || !tokens[i + 1].TypeIs(eTk::kIdentifier)) {
+      return Where(file, at) + std::string(kPpErrorMacroSyntax);
+    }
+    Macro macro;
+    macro.file = file;
+    std::size_t body = i + 2;
+    if (auto close = CloseParen(tokens, i + 2)) {
+      macro.function_like = true;
+      for (std::size_t j = i + 3; j < *close; j++) {
+        bool name = (j - i) % 2 == 1;
+        if (!tokens[j].TypeIs(name ? eTk::kIdentifier : eTk::kComma) ||
+            (!name && j + 1 == *close)) {
+          return Where(file, at) + std::string(kPpErrorMacroSyntax);
+        }
+        if (name) macro.params.push_back(tokens[j].Literal());
+      }
+      body = *close + 1;
+    } else if (body < tokens.size() && tokens[body].TypeIs(eTk::kOpenParen)) {
+      return Where(file, at) + std::string(kPpErrorMacroSyntax);
+    }
+    std::size_t end = body;
+    while (end < tokens.size() && !IsDirective(tokens[end])) end++;
+    if (end == tokens.size()) {
+      return Where(file, at) + std::string(kPpErrorUnterminated) +
+             at.Literal();
+    }
+    if (!tokens[end].TypeIs(eTk::kDirEndmacro)) {
+      return Where(file, tokens[end]) + std::string(kPpErrorMacroBody);
+    }
+    macro.body.assign(tokens.begin() + body, tokens.begin() + end);
+    macros_[tokens[i + 1].Literal()] = std::move(macro);
+    i = end + 1;
+    return BoolError();
+  }
+
+  // Keeps the first branch of an #if chain whose condition holds.
+  BoolError Conditional(std::span<const Tk> tokens, std::size_t& i,
+                        std::uint32_t file, PpOutput& out) {
+    struct Branch {
+      std::size_t at;  // The directive.
+      std::size_t body;
+      std::size_t end = 0;
+    };
+    std::vector<Branch> branches;
+    const Tk& start = tokens[i];
+    std::size_t j = i;
+    std::size_t depth = 0;
+    while (true) {
+      const Tk& tk = tokens[j];
+      if (!tk.TypeIs(eTk::kDirElse)) {
+        auto close = CloseParen(tokens, j + 1);
+        if (!close) {
+          return Where(file, tk) + std::string(kPpErrorCondition);
+        }
+        branches.push_back({j, *close + 1});
+      } else {
+        branches.push_back({j, j + 1});
+      }
+      for (j = branches.back().body; j < tokens.size(); j++) {
+        if (tokens[j].TypeIs(eTk::kDirIf)) depth++;
+        if (depth > 0) {
+          if (tokens[j].TypeIs(eTk::kDirEndif)) depth--;
+          continue;
+        }
+        if (tokens[j].TypeIs(eTk::kDirElif) ||
+            tokens[j].TypeIs(eTk::kDirElse) ||
+            tokens[j].TypeIs(eTk::kDirEndif)) {
+          break;
+        }
+      }
+      if (j == tokens.size()) {
+        return Where(file, start) + std::string(kPpErrorUnterminated) +
+               start.Literal();
+      }
+      branches.back().end = j;
+      if (tokens[j].TypeIs(eTk::kDirEndif)) break;
+      if (tokens[branches.back().at].TypeIs(eTk::kDirElse)) {
+        return Where(file, tokens[j]) + std::string(kPpErrorStray) +
+               tokens[j].Literal();
+      }
+    }
+    i = j + 1;
+    for (const auto& branch : branches) {
+      const Tk& at = tokens[branch.at];
+      if (!at.TypeIs(eTk::kDirElse)) {
+        auto holds = Evaluate(
+            tokens.subspan(branch.at + 2, branch.body - branch.at - 3), file,
+            at);
+        if (!holds) return holds.Error();
+        if (!holds.Value()) continue;
+      }
+      return Process(tokens.subspan(branch.body, branch.end - branch.body),
+                     file, out);
+    }
+    return BoolError();
+  }
+
+  BoolError Process(std::span<const Tk> tokens, std::uint32_t file,
+                    PpOutput& out) {
+    std::size_t i = 0;
+    while (i < tokens.size()) {
+      const Tk& tk = tokens[i];
+      BoolError done;
+      switch (tk.Type()) {
+        case eTk::kDirInclude: {
+          if (i + 2 >= tokens.size() ||
+              !tokens[i + 1].TypeIs(eTk::kStringLiteral) ||
+              !tokens[i + 2].TypeIs(eTk::kSemicolon)) {
+            return Where(file, tk) + std::string(kPpErrorIncludeSyntax);
+          }
+          const auto& literal = tokens[i + 1].Literal();
+          std::filesystem::path path(literal.substr(1, literal.size() - 2));
+          if (path.is_relative()) {
+            path = paths_[file].parent_path() / path;
+          }
+          done = Include(path.lexically_normal(), tk, file, out);
+          i += 3;
+          break;
+        }
+        case eTk::kDirMacro:
+          done = Define(tokens, i, file);
+          break;
+        case eTk::kDirIf:
+          done = Conditional(tokens, i, file, out);
+          break;
+        case eTk::kDirElif:
+        case eTk::kDirElse:
+        case eTk::kDirEndif:
+        case eTk::kDirEndmacro:
+          return Where(file, tk) + std::string(kPpErrorStray) +
+                 tk.Literal();
+        default: {
+          std::size_t end = i;
+          while (end < tokens.size() && !IsDirective(tokens[end])) end++;
+          done = Expand(tokens.subspan(i, end - i), {}, file, out);
+          i = end;
+        }
+      }
+      if (!done) return done;
+    }
+    return BoolError();
+  }
+
+ public:
+  // Whether the tokens need preprocessing at all.
+  static bool HasDirectives(const TkVector& tokens) {
+    return std::any_of(tokens.begin(), tokens.end(), IsDirective);
+  }
+
+  // A macro defined before every run, as if the source began with
+  // #macro name value #endmacro.
+  BoolError Define(const std::string& name, const std::string& value = "1") {
+    auto tokens = Lexer::Lex(value);
+    if (!tokens) return tokens.Error();
+    predefined_[name] = {false, {}, tokens.Extract(), 1};
+    return BoolError();
+  }
+
+  // Preprocesses the tokens of a source, includes relative to its file.
+  Expected<PpOutput> Run(const TkVector& tokens,
+                         const std::filesystem::path& file = {}) {
+    PpOutput out;
+    paths_ = {file.lexically_normal()};
+    if (!predefined_.empty()) paths_.push_back(kPpPredefinedPath);
+    out.tokens.reserve(tokens.size());
+    out.files.reserve(tokens.size());
+    macros_ = predefined_;
+    including_ = {paths_.front()};
+    auto processed = Process(tokens, 0, out);
+    including_.clear();
+    macros_.clear();
+    out.paths = std::move(paths_);
+    if (!processed) return Expected<PpOutput>::Failure(processed.Error());
+    return Expected<PpOutput>::Success(std::move(out));
+  }
+
+  // Includes read from the cache, and read from disk.
+  std::size_t CacheHits() const { return cache_hits_; }
+  std::size_t CacheMisses() const { return cache_misses_; }
+  // Includes of guarded files skipped.
+  std::size_t GuardSkips() const { return guard_skips_; }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: preprocessor.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_PREPROCESSOR_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,449 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: sema.h
+//---------------------------------------------------------------------------//
+// Brief: Parallel name resolution and checking of a program.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_SEMA_H
+#define HEADER_GUARD_CAOCO_COMPILER_SEMA_H
+// Includes:
+#include "ast.h"
+#include "import_stl.h"
+#include "symbol_table.h"
+#include "work_stealing_pool.h"
+
+// Error codes, followed by the name.
+static constexpr std::string_view kSemaErrorUndeclaredName =
+    "Undeclared name: ";
+static constexpr std::string_view kSemaErrorRedeclaration =
+    "Redeclaration of variable: ";
+static constexpr std::string_view kSemaErrorArgumentCount =
+    "Wrong number of arguments in call to: ";
+static constexpr std::string_view kSemaErrorUnknownMember =
+    "No class declares the method: ";
+
+// Methods of the evaluator which need no declaration.
+static constexpr std::array<std::string_view, 3> kSemaBuiltins = {
+    "cout", "print", "cin"};
+
+struct SemaDiagnostic {
+  std::size_t line;  // Source line, 0 if unknown.
+  std::string message;
+  bool operator==(const SemaDiagnostic&) const = default;
+};
+
+// A declaration of a module, visible to the modules which import it.
+struct SemaExport {
+  std::string name;
+  eIdentityCategory category;
+  std::size_t arity;  // Of a method.
+  bool member;        // A method of a class.
+};
+
+struct SemaResult {
+  CeIdentityTable identities;  // Scope 0 is the program, then one per class.
+  CeScopeParents parents{};
+  std::vector<SemaDiagnostic> diagnostics{};  // In source order.
+  bool Valid() const { return diagnostics.empty(); }
+};
+
+//=-------------------------------------------------------------------------=//
+// SemanticAnalyzer
+//---------------------------------------------------------------------------//
+// Runs in two phases over the declarations of a program:
+// 1. Each top level declaration collects the names it declares, in parallel.
+//    The names are then added to one identity table in source order, which
+//    is read only from then on.
+// 2. Each body is resolved against the table on a work stealing pool: a
+//    method, the members of a class, a global initializer or main.
+// A name is resolved in the scopes of its body, then the members of its
+// class, then the program. Declarations of the program and of a class are
+// visible everywhere in them, the runtime declares them before main runs.
+// Each body reports to its own list, the lists are joined in source order
+// so the diagnostics do not depend on the number of threads.
+class SemanticAnalyzer {
+  struct Declaration {
+    std::string name;
+    eIdentityCategory category;
+    CeScopeIndex scope;
+    std::size_t line;
+    std::size_t arity;  // Of a method.
+  };
+  struct Body {
+    const Ast* ast;
+    CeScopeIndex scope;  // Of the class, or the program.
+    std::vector<std::string> params;
+  };
+  using Diagnostics = std::vector<SemaDiagnostic>;
+
+  SemaResult result_;
+  std::vector<std::vector<Declaration>> declarations_;  // By top level node.
+  std::vector<Body> bodies_;
+  std::vector<std::optional<std::size_t>> arities_;  // By handle, if unique.
+  std::unordered_set<std::string> member_methods_;   // Of any class.
+
+  static std::vector<std::string> Params(const Ast& method) {
+    std::vector<std::string> params;
+    const Ast& signature = method[2];
+    if (!signature.Empty()) {
+      for (const auto& parameter : signature[0].Children()) {
+        if (parameter.Size() == 3) params.push_back(parameter[2].Literal());
+      }
+    }
+    return params;
+  }
+
+  // Phase 1. Scope of the class at top level position, see Analyze.
+  static std::vector<Declaration> Collect(const Ast& ast,
+                                          CeScopeIndex class_scope) {
+    std::vector<Declaration> declared;
+    lambda xDeclare = [&](const Ast& decl, CeScopeIndex scope) {
+      if (decl.TypeIs(eAst::kVariableDeclaration) && decl.Size() >= 3) {
+        declared.push_back({decl[2].Literal(), eIdentityCategory::kVariable,
+                            scope, decl.Line(), 0});
+      } else if (decl.TypeIs(eAst::kMethodDeclaration) && decl.Size() >= 3) {
+        declared.push_back({decl[1].Literal(), eIdentityCategory::kMethod,
+                            scope, decl.Line(), Params(decl).size()});
+      }
+    };
+    if (ast.TypeIs(eAst::kClassDeclaration) && ast.Size() >= 2) {
+      declared.push_back({ast[1].Literal(), eIdentityCategory::kObject, 0,
+                          ast.Line(), 0});
+      if (ast.Size() == 3) {
+        for (const auto& member : ast[2].Children()) {
+          xDeclare(member, class_scope);
+        }
+      }
+    } else {
+      xDeclare(ast, 0);
+    }
+    return declared;
+  }
+
+  void Merge(const std::vector<const Ast*>& nodes,
+             const std::vector<SemaExport>& imports) {
+    auto& table = result_.identities;
+    // Imports come first, a module may redefine an imported method.
+    for (const auto& imported : imports) {
+      if (imported.member) {
+        member_methods_.insert(imported.name);
+        continue;
+      }
+      auto handle = table.Add(imported.name, imported.category, 0);
+      if (!handle.has_value()) {
+        if (imported.category == eIdentityCategory::kMethod) {
+          auto symbol = *table.Symbols().Find(imported.name);
+          arities_[*table.Find(symbol, imported.category, 0)].reset();
+        }
+        continue;
+      }
+      if (arities_.size() <= *handle) arities_.resize(*handle + 1);
+      if (imported.category == eIdentityCategory::kMethod) {
+        arities_[*handle] = imported.arity;
+      }
+    }
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+      for (const auto& decl : declarations_[i]) {
+        auto handle = table.Add(decl.name, decl.category, decl.scope);
+        if (!handle.has_value()) {
+          // The runtime redefines methods and classes, not variables.
+          if (decl.category == eIdentityCategory::kVariable) {
+            result_.diagnostics.push_back(
+                {decl.line,
+                 std::string(kSemaErrorRedeclaration) + decl.name});
+          } else if (decl.category == eIdentityCategory::kMethod) {
+            auto symbol = *table.Symbols().Find(decl.name);
+            arities_[*table.Find(symbol, decl.category, decl.scope)].reset();
+          }
+          continue;
+        }
+        if (arities_.size() <= *handle) arities_.resize(*handle + 1);
+        if (decl.category == eIdentityCategory::kMethod) {
+          arities_[*handle] = decl.arity;
+          if (decl.scope != 0) member_methods_.insert(decl.name);
+        }
+      }
+      // Bodies in source order.
+      const Ast& ast = *nodes[i];
+      if (ast.TypeIs(eAst::kClassDeclaration)) {
+        if (ast.Size() != 3) continue;
+        for (const auto& member : ast[2].Children()) {
+          if (member.TypeIs(eAst::kMethodDeclaration)) {
+            bodies_.push_back({&member, i + 1, Params(member)});
+          } else {
+            bodies_.push_back({&member, i + 1, {}});
+          }
+        }
+      } else if (ast.TypeIs(eAst::kMethodDeclaration)) {
+        bodies_.push_back({&ast, 0, Params(ast)});
+      } else {
+        bodies_.push_back({&ast, 0, {}});
+      }
+    }
+  }
+
+  // Phase 2. Resolves one body, reads the table only.
+  class Resolver {
+    const SemanticAnalyzer& sema_;
+    CeScopeIndex scope_;
+    std::vector<std::vector<std::string_view>> locals_;  // Innermost last.
+    Diagnostics& out_;
+
+    std::optional<CeHandle> Find(const std::string& name,
+                                 eIdentityCategory category) const {
+      const auto& table = sema_.result_.identities;
+      auto symbol = table.Symbols().Find(name);
+      if (!symbol.has_value()) return std::nullopt;
+      return table.Resolve(*symbol, category, scope_, sema_.result_.parents);
+    }
+
+    bool IsLocal(std::string_view name) const {
+      for (const auto& scope : locals_) {
+        if (std::find(scope.begin(), scope.end(), name) != scope.end()) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void Report(const Ast& ast, std::string_view error,
+                const std::string& name) {
+      out_.push_back({ast.Line(), std::string(error) + name});
+    }
+
+    void Declare(const Ast& decl, const std::string& name) {
+      auto& scope = locals_.back();
+      if (std::find(scope.begin(), scope.end(), name) != scope.end()) {
+        Report(decl, kSemaErrorRedeclaration, name);
+        return;
+      }
+      scope.push_back(name);
+    }
+
+    void ResolveName(const Ast& ast) {
+      const auto& name = ast.Literal();
+      if (IsLocal(name) || Find(name, eIdentityCategory::kVariable) ||
+          Find(name, eIdentityCategory::kMethod) ||
+          Find(name, eIdentityCategory::kObject)) {
+        return;
+      }
+      Report(ast, kSemaErrorUndeclaredName, name);
+    }
+
+    // Format: [FunctionCall] -> [Identifier | Period[object, member]],
+    //                           [Arguments] -> [Expr]...
+    void ResolveCall(const Ast& ast) {
+      const Ast& callee = ast[0];
+      std::size_t args = ast.Size() > 1 ? ast[1].Size() : 0;
+      if (ast.Size() > 1) ResolveExpr(ast[1]);
+      if (callee.TypeIs(eAst::kPeriod) && callee.Size() == 2) {
+        ResolveExpr(callee[0]);
+        if (!sema_.member_methods_.contains(callee[1].Literal())) {
+          Report(callee, kSemaErrorUnknownMember, callee[1].Literal());
+        }
+        return;
+      }
+      if (!callee.TypeIs(eAst::kIdentifier)) {
+        ResolveExpr(callee);
+        return;
+      }
+      const auto& name = callee.Literal();
+      if (auto method = Find(name, eIdentityCategory::kMethod)) {
+        auto arity = sema_.arities_[*method];
+        if (arity.has_value() && *arity != args) {
+          Report(callee, kSemaErrorArgumentCount, name);
+        }
+      } else if (Find(name, eIdentityCategory::kObject)) {
+        if (args != 0) Report(callee, kSemaErrorArgumentCount, name);
+      } else if (std::find(kSemaBuiltins.begin(), kSemaBuiltins.end(),
+                           name) == kSemaBuiltins.end()) {
+        Report(callee, kSemaErrorUndeclaredName, name);
+      }
+    }
+
+    void ResolveExpr(const Ast& ast) {
+      if (ast.TypeIs(eAst::kIdentifier)) {
+        ResolveName(ast);
+      } else if (ast.TypeIs(eAst::kFunctionCall) && !ast.Empty()) {
+        ResolveCall(ast);
+      } else if (ast.TypeIs(eAst::kPeriod) && ast.Size() == 2) {
+        ResolveExpr(ast[0]);  // The member depends on the object.
+      } else {
+        for (const auto& child : ast.Children()) ResolveExpr(child);
+      }
+    }
+
+    // Statements after a return are unreached, the parser also leaves a copy
+    // of the returned expression there.
+    void ResolveStatements(const Ast& ast) {
+      for (const auto& statement : ast.Children()) {
+        ResolveStatement(statement);
+        if (statement.TypeIs(eAst::kReturn)) break;
+      }
+    }
+
+    void ResolveBlock(const Ast& ast) {
+      locals_.emplace_back();
+      ResolveStatements(ast);
+      locals_.pop_back();
+    }
+
+    void ResolveStatement(const Ast& ast) {
+      switch (ast.Type()) {
+        case eAst::kVariableDeclaration:
+          if (ast.Size() == 4) ResolveExpr(ast[3]);
+          if (ast.Size() >= 3) Declare(ast, ast[2].Literal());
+          break;
+        case eAst::kWhile:
+          ResolveExpr(ast[0]);
+          ResolveBlock(ast[1]);
+          break;
+        case eAst::kFor:
+          locals_.emplace_back();
+          ResolveStatement(ast[0]);
+          ResolveExpr(ast[1]);
+          ResolveBlock(ast[3]);
+          ResolveStatement(ast[2]);
+          locals_.pop_back();
+          break;
+        case eAst::kIfStatement:
+          for (const auto& branch : ast.Children()) {
+            if (branch.TypeIs(eAst::kElse)) {
+              ResolveBlock(branch[0]);
+            } else {
+              ResolveExpr(branch[0]);
+              ResolveBlock(branch[1]);
+            }
+          }
+          break;
+        default:
+          // Assignments, returns and expression statements.
+          ResolveExpr(ast);
+          break;
+      }
+    }
+
+   public:
+    Resolver(const SemanticAnalyzer& sema, const Body& body, Diagnostics& out)
+        : sema_(sema), scope_(body.scope), out_(out) {
+      // Parameters share the scope of the statements of the body.
+      locals_.emplace_back();
+      for (const auto& param : body.params) locals_.back().push_back(param);
+    }
+
+    void Run(const Ast& ast) {
+      switch (ast.Type()) {
+        case eAst::kMethodDeclaration:
+          if (ast.Size() == 4) ResolveStatements(ast[3]);
+          break;
+        case eAst::kVariableDeclaration:
+          // Its own name is in the table.
+          if (ast.Size() == 4) ResolveExpr(ast[3]);
+          break;
+        case eAst::kMainDeclaration:
+          if (ast.Size() == 2) ResolveBlock(ast[1]);
+          break;
+        default:
+          break;
+      }
+    }
+  };
+
+  SemanticAnalyzer() = default;
+  explicit SemanticAnalyzer(CeSymbolInterner& symbols)
+      : result_{CeIdentityTable(symbols)} {}
+
+  SemaResult Run(const Ast& program, std::size_t threads,
+                 const std::vector<SemaExport>& imports) {
+    WorkStealingPool pool(threads);
+    std::vector<const Ast*> nodes;
+    if (program.TypeIs(eAst::kProgram)) {
+      for (const auto& node : program.Children()) nodes.push_back(&node);
+    }
+    // The class at top level position i has scope i + 1.
+    result_.parents.assign(nodes.size() + 1, 0);
+
+    declarations_.resize(nodes.size());
+    std::vector<WorkStealingPool::Task> collect;
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+      collect.push_back([this, &nodes, i] {
+        declarations_[i] = Collect(*nodes[i], i + 1);
+      });
+    }
+    pool.Run(std::move(collect));
+    Merge(nodes, imports);
+
+    std::vector<Diagnostics> reports(bodies_.size());
+    std::vector<WorkStealingPool::Task> resolve;
+    for (std::size_t i = 0; i < bodies_.size(); i++) {
+      resolve.push_back([this, &reports, i] {
+        const auto& body = bodies_[i];
+        Resolver(*this, body, reports[i]).Run(*body.ast);
+      });
+    }
+    pool.Run(std::move(resolve));
+
+    // Bodies in source order, then by line: a class body may come after
+    // main, but a line holds at most one top level declaration.
+    for (auto& report : reports) {
+      for (auto& diagnostic : report) {
+        result_.diagnostics.push_back(std::move(diagnostic));
+      }
+    }
+    std::stable_sort(
+        result_.diagnostics.begin(), result_.diagnostics.end(),
+        [](const auto& a, const auto& b) { return a.line < b.line; });
+    return std::move(result_);
+  }
+
+ public:
+  // Resolves the names of a program with the given number of threads, 0 for
+  // one per hardware thread.
+  static SemaResult Analyze(const Ast& program, std::size_t threads = 0) {
+    return SemanticAnalyzer().Run(program, threads, {});
+  }
+
+  // As above, interning the names in the given table. The imports are the
+  // exports of other modules.
+  static SemaResult Analyze(const Ast& program, CeSymbolInterner& symbols,
+                            std::size_t threads = 0,
+                            const std::vector<SemaExport>& imports = {}) {
+    return SemanticAnalyzer(symbols).Run(program, threads, imports);
+  }
+
+  // The declarations of a program, without resolving its bodies.
+  static std::vector<SemaExport> Exports(const Ast& program) {
+    std::vector<SemaExport> exports;
+    for (const auto& node : program.Children()) {
+      for (auto& decl : Collect(node, 1)) {
+        bool member = decl.scope != 0;
+        if (member && decl.category != eIdentityCategory::kMethod) continue;
+        exports.push_back(
+            {std::move(decl.name), decl.category, decl.arity, member});
+      }
+    }
+    return exports;
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: sema.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_SEMA_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
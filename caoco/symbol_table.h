@@ -0,0 +1,440 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: cand_lang
+// File: symbol_table.h
+//---------------------------------------------------------------------------//
+// Brief: Hashed identity and type tables keyed on interned symbols.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_CAND_LANG_SYMBOL_TABLE_H
+#define HEADER_GUARD_CAOCO_CAND_LANG_SYMBOL_TABLE_H
+// Includes:
+#include "import_stl.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+using CeScopeIndex = std::size_t;
+using CeTypeIndex = std::size_t;
+using CeSymbolId = std::uint32_t;  // Interned name, see CeSymbolInterner.
+using CeHandle = std::uint32_t;    // Entry of a table, stable until removed.
+
+// Mixes the bits of a key so that nearby ids spread over the slots.
+constexpr std::uint64_t CeHashMix(std::uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+//=-------------------------------------------------------------------------=//
+// CeProbeTable
+//---------------------------------------------------------------------------//
+// Open addressing map of keys to handles with linear probing. The slots hold
+// the keys, so a lookup compares keys without touching the entries. Removed
+// keys leave a tombstone until the next rehash.
+template <class Key, class Hash>
+class CeProbeTable {
+  static constexpr CeHandle kEmpty = std::numeric_limits<CeHandle>::max();
+  static constexpr CeHandle kTombstone = kEmpty - 1;
+  static constexpr std::size_t kMinCapacity = 16;
+  struct Slot {
+    Key key{};
+    CeHandle handle{kEmpty};
+  };
+  std::vector<Slot> slots_;
+  std::size_t size_{0};
+  std::size_t used_{0};  // Live slots and tombstones.
+
+  std::size_t Mask() const { return slots_.size() - 1; }
+
+  // Slot of the key, or the first free slot of its probe sequence.
+  std::size_t Probe(const Key& key) const {
+    std::size_t free = slots_.size();
+    for (std::size_t i = Hash{}(key) & Mask();; i = (i + 1) & Mask()) {
+      const Slot& slot = slots_[i];
+      if (slot.handle == kEmpty) return free == slots_.size() ? i : free;
+      if (slot.handle == kTombstone) {
+        if (free == slots_.size()) free = i;
+      } else if (slot.key == key) {
+        return i;
+      }
+    }
+  }
+
+  void Rehash(std::size_t capacity) {
+    auto old = std::move(slots_);
+    slots_.assign(capacity, Slot{});
+    used_ = size_;
+    for (const auto& slot : old) {
+      if (slot.handle == kEmpty || slot.handle == kTombstone) continue;
+      slots_[Probe(slot.key)] = slot;
+    }
+  }
+
+ public:
+  std::optional<CeHandle> Find(const Key& key) const {
+    if (slots_.empty()) return std::nullopt;
+    const Slot& slot = slots_[Probe(key)];
+    if (slot.handle == kEmpty || slot.handle == kTombstone) return std::nullopt;
+    return slot.handle;
+  }
+
+  // Returns false if the key is already present.
+  bool Insert(const Key& key, CeHandle handle) {
+    // At most half of the slots are used, probe sequences stay short.
+    if ((used_ + 1) * 2 > slots_.size()) {
+      Rehash(std::max(kMinCapacity, std::bit_ceil((size_ + 1) * 2)));
+    }
+    Slot& slot = slots_[Probe(key)];
+    if (slot.handle != kEmpty && slot.handle != kTombstone) return false;
+    if (slot.handle == kEmpty) used_++;
+    slot = Slot{key, handle};
+    size_++;
+    return true;
+  }
+
+  std::optional<CeHandle> Erase(const Key& key) {
+    if (slots_.empty()) return std::nullopt;
+    Slot& slot = slots_[Probe(key)];
+    if (slot.handle == kEmpty || slot.handle == kTombstone) return std::nullopt;
+    auto handle = slot.handle;
+    slot.handle = kTombstone;
+    size_--;
+    return handle;
+  }
+
+  void Clear() {
+    slots_.clear();
+    size_ = 0;
+    used_ = 0;
+  }
+
+  std::size_t Size() const { return size_; }
+};
+
+//=-------------------------------------------------------------------------=//
+// CeSymbolInterner
+//---------------------------------------------------------------------------//
+// Maps each distinct name to a dense id. Names are hashed once, when they
+// are interned, the tables then compare ids.
+class CeSymbolInterner {
+  struct NameHash {
+    std::size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
+  std::deque<std::string> names_;  // Stable, the keys view them.
+  CeProbeTable<std::string_view, NameHash> ids_;
+
+ public:
+  CeSymbolInterner() = default;
+  // A copy would view the names of the original. Moving keeps the strings
+  // in place, so the keys stay valid.
+  CeSymbolInterner(const CeSymbolInterner&) = delete;
+  CeSymbolInterner& operator=(const CeSymbolInterner&) = delete;
+  CeSymbolInterner(CeSymbolInterner&&) = default;
+  CeSymbolInterner& operator=(CeSymbolInterner&&) = default;
+
+  CeSymbolId Intern(std::string_view name) {
+    if (auto id = ids_.Find(name)) return *id;
+    auto id = static_cast<CeSymbolId>(names_.size());
+    names_.emplace_back(name);
+    ids_.Insert(names_.back(), id);
+    return id;
+  }
+
+  std::optional<CeSymbolId> Find(std::string_view name) const {
+    return ids_.Find(name);
+  }
+
+  const std::string& Name(CeSymbolId id) const { return names_.at(id); }
+
+  std::size_t Size() const { return names_.size(); }
+};
+
+//=-------------------------------------------------------------------------=//
+// CeHandleTable
+//---------------------------------------------------------------------------//
+// Base of the tables. Entries live in a deque so references and handles stay
+// valid while the table grows. Handles of removed entries are reused.
+template <class Entry, class Key, class Hash>
+class CeHandleTable {
+ protected:
+  std::unique_ptr<CeSymbolInterner> owned_symbols_;
+  CeSymbolInterner* symbols_;
+  CeProbeTable<Key, Hash> index_;
+  std::deque<Entry> entries_;
+  std::vector<CeHandle> free_;
+
+  CeHandleTable()
+      : owned_symbols_(std::make_unique<CeSymbolInterner>()),
+        symbols_(owned_symbols_.get()) {}
+  explicit CeHandleTable(CeSymbolInterner& symbols) : symbols_(&symbols) {}
+
+  std::optional<CeHandle> Emplace(const Key& key, Entry entry) {
+    auto handle = free_.empty() ? static_cast<CeHandle>(entries_.size())
+                                : free_.back();
+    if (!index_.Insert(key, handle)) return std::nullopt;
+    if (free_.empty()) {
+      entries_.push_back(std::move(entry));
+    } else {
+      free_.pop_back();
+      entries_[handle] = std::move(entry);
+    }
+    return handle;
+  }
+
+  void Erase(const Key& key) {
+    if (auto handle = index_.Erase(key)) free_.push_back(*handle);
+  }
+
+ public:
+  CeSymbolInterner& Symbols() { return *symbols_; }
+  const CeSymbolInterner& Symbols() const { return *symbols_; }
+  const Entry& At(CeHandle handle) const { return entries_.at(handle); }
+  std::size_t Size() const { return index_.Size(); }
+  bool IsEmpty() const { return index_.Size() == 0; }
+  void Clear() {
+    index_.Clear();
+    entries_.clear();
+    free_.clear();
+  }
+};
+
+// Parent of each scope by index. The root scope is its own parent.
+using CeScopeParents = std::vector<CeScopeIndex>;
+
+//=-------------------------------------------------------------------------=//
+// CeIdentityTable
+//---------------------------------------------------------------------------//
+enum class eIdentityCategory : std::uint8_t {
+  kUnknown,
+  kVariable,
+  kMethod,
+  kObject,
+  kNamespace,
+  kLibrary,
+  kMain,
+};
+
+struct CeIdentity {
+  std::string_view name;  // Owned by the interner.
+  eIdentityCategory category;
+  CeScopeIndex scope_index;
+  CeSymbolId symbol;
+};
+
+// Packed so that a slot of the probe table takes 16 bytes.
+struct CeIdentityKey {
+  CeSymbolId symbol{0};
+  std::uint32_t scope{0};
+  eIdentityCategory category{eIdentityCategory::kUnknown};
+  bool operator==(const CeIdentityKey&) const = default;
+
+  CeIdentityKey() = default;
+  CeIdentityKey(CeSymbolId symbol, eIdentityCategory category,
+                CeScopeIndex scope)
+      : symbol(symbol),
+        scope(static_cast<std::uint32_t>(scope)),
+        category(category) {}
+};
+
+struct CeIdentityKeyHash {
+  std::size_t operator()(const CeIdentityKey& key) const {
+    return CeHashMix((std::uint64_t{key.symbol} << 32) ^
+                     (std::uint64_t{key.scope} << 4) ^
+                     static_cast<std::uint64_t>(key.category));
+  }
+};
+
+class CeIdentityTable
+    : public CeHandleTable<CeIdentity, CeIdentityKey, CeIdentityKeyHash> {
+  using OptIdentityConstRef =
+      std::optional<std::reference_wrapper<const CeIdentity>>;
+
+  std::optional<CeIdentityKey> KeyOf(const std::string& name,
+                                     eIdentityCategory category,
+                                     CeScopeIndex scope) const {
+    auto symbol = symbols_->Find(name);
+    if (!symbol.has_value()) return std::nullopt;
+    return CeIdentityKey{*symbol, category, scope};
+  }
+
+ public:
+  CeIdentityTable() = default;
+  explicit CeIdentityTable(CeSymbolInterner& symbols)
+      : CeHandleTable(symbols) {}
+
+  // One probe, the name is already interned.
+  std::optional<CeHandle> Find(CeSymbolId symbol, eIdentityCategory category,
+                               CeScopeIndex scope) const {
+    return index_.Find(CeIdentityKey{symbol, category, scope});
+  }
+
+  // Innermost declaration visible from scope, one probe per scope.
+  std::optional<CeHandle> Resolve(CeSymbolId symbol,
+                                  eIdentityCategory category,
+                                  CeScopeIndex scope,
+                                  const CeScopeParents& parents) const {
+    for (;;) {
+      if (auto found = Find(symbol, category, scope)) return found;
+      if (scope >= parents.size() || parents[scope] == scope) {
+        return std::nullopt;
+      }
+      scope = parents[scope];
+    }
+  }
+
+  bool Contains(const std::string& name, eIdentityCategory category,
+                CeScopeIndex scope) const {
+    return Get(name, category, scope).has_value();
+  }
+
+  OptIdentityConstRef Get(const std::string& name, eIdentityCategory category,
+                          CeScopeIndex scope) const {
+    auto key = KeyOf(name, category, scope);
+    if (!key.has_value()) return std::nullopt;
+    auto handle = index_.Find(*key);
+    if (!handle.has_value()) return std::nullopt;
+    return std::cref(entries_[*handle]);
+  }
+
+  // Returns nullopt if the identity already exists.
+  std::optional<CeHandle> Add(const std::string& name,
+                              eIdentityCategory category, CeScopeIndex scope) {
+    auto symbol = symbols_->Intern(name);
+    return Emplace(
+        CeIdentityKey{symbol, category, scope},
+        CeIdentity{symbols_->Name(symbol), category, scope, symbol});
+  }
+
+  void Remove(const std::string& name, eIdentityCategory category,
+              CeScopeIndex scope) {
+    if (auto key = KeyOf(name, category, scope)) Erase(*key);
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+// CeTypeTable
+//---------------------------------------------------------------------------//
+struct CeTypeDescriptor {
+  std::string_view name;  // Owned by the interner.
+  CeScopeIndex scope_index;
+  CeTypeIndex type_index;
+  CeSymbolId symbol;
+};
+
+struct CeTypeKey {
+  CeSymbolId symbol{0};
+  std::uint32_t scope{0};
+  bool operator==(const CeTypeKey&) const = default;
+
+  CeTypeKey() = default;
+  CeTypeKey(CeSymbolId symbol, CeScopeIndex scope)
+      : symbol(symbol), scope(static_cast<std::uint32_t>(scope)) {}
+};
+
+struct CeTypeKeyHash {
+  std::size_t operator()(const CeTypeKey& key) const {
+    return CeHashMix((std::uint64_t{key.symbol} << 32) ^
+                     std::uint64_t{key.scope});
+  }
+};
+
+class CeTypeTable
+    : public CeHandleTable<CeTypeDescriptor, CeTypeKey, CeTypeKeyHash> {
+  using OptTypeDescConstRef =
+      std::optional<std::reference_wrapper<const CeTypeDescriptor>>;
+
+  std::optional<CeHandle> FindName(const std::string& name,
+                                   CeScopeIndex scope) const {
+    auto symbol = symbols_->Find(name);
+    if (!symbol.has_value()) return std::nullopt;
+    return index_.Find(CeTypeKey{*symbol, scope});
+  }
+
+ public:
+  CeTypeTable() = default;
+  explicit CeTypeTable(CeSymbolInterner& symbols) : CeHandleTable(symbols) {}
+
+  std::optional<CeHandle> Find(CeSymbolId symbol, CeScopeIndex scope) const {
+    return index_.Find(CeTypeKey{symbol, scope});
+  }
+
+  // Innermost type visible from scope, one probe per scope.
+  std::optional<CeHandle> Resolve(CeSymbolId symbol, CeScopeIndex scope,
+                                  const CeScopeParents& parents) const {
+    for (;;) {
+      if (auto found = Find(symbol, scope)) return found;
+      if (scope >= parents.size() || parents[scope] == scope) {
+        return std::nullopt;
+      }
+      scope = parents[scope];
+    }
+  }
+
+  bool Contains(const std::string& name, CeScopeIndex scope) const {
+    return FindName(name, scope).has_value();
+  }
+
+  OptTypeDescConstRef Get(const std::string& name, CeScopeIndex scope) const {
+    auto handle = FindName(name, scope);
+    if (!handle.has_value()) return std::nullopt;
+    return std::cref(entries_[*handle]);
+  }
+
+  // Returns nullopt if the name is already a type of the scope.
+  std::optional<CeHandle> Add(const std::string& name, CeScopeIndex scope,
+                              CeTypeIndex type_index) {
+    auto symbol = symbols_->Intern(name);
+    return Emplace(CeTypeKey{symbol, scope},
+                   CeTypeDescriptor{symbols_->Name(symbol), scope, type_index,
+                                    symbol});
+  }
+
+  // Changes the type of an existing name in place, its handle is kept.
+  OptTypeDescConstRef Replace(const std::string& name, CeScopeIndex scope,
+                              CeTypeIndex type_index) {
+    auto handle = FindName(name, scope);
+    if (!handle.has_value()) return std::nullopt;
+    entries_[*handle].type_index = type_index;
+    return std::cref(entries_[*handle]);
+  }
+
+  // Declares alias_name in alias_scope with the type of name in scope.
+  OptTypeDescConstRef Alias(const std::string& name, CeScopeIndex scope,
+                            const std::string& alias_name,
+                            CeScopeIndex alias_scope) {
+    auto found = FindName(name, scope);
+    if (!found.has_value()) return std::nullopt;
+    auto alias = Add(alias_name, alias_scope, entries_[*found].type_index);
+    if (!alias.has_value()) return std::nullopt;
+    return std::cref(entries_[*alias]);
+  }
+
+  void Remove(const std::string& name, CeScopeIndex scope) {
+    auto symbol = symbols_->Find(name);
+    if (symbol.has_value()) Erase(CeTypeKey{*symbol, scope});
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: cand_lang
+// File: symbol_table.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_CAND_LANG_SYMBOL_TABLE_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
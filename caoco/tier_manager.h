@@ -0,0 +1,168 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: tier_manager.h
+//---------------------------------------------------------------------------//
+// Brief: Hotness counters and tier transitions of the evaluator.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_COMPILER_TIER_MANAGER_H
+#define HEADER_GUARD_CAOCO_COMPILER_TIER_MANAGER_H
+// Includes:
+#include "import_stl.h"
+#include "ir_codegen.h"
+#include "jit_x86_64.h"
+
+//=-------------------------------------------------------------------------=//
+// Overview
+//---------------------------------------------------------------------------//
+// A unit is a method or class body, entered by a call, or a loop, entered
+// by its back edge. Code starts in the interpreter tier, dispatching one IR
+// line at a time. A unit whose calls or back edges reach the bytecode
+// threshold is promoted to the bytecode tier: the superinstructions of its
+// lines are selected. At the JIT threshold it is compiled, see
+// jit_x86_64.h. Code which runs once is never promoted.
+// A loop promoted at its back edge continues in the new tier from its next
+// iteration, its scopes and variables stay as they are (on-stack
+// replacement). A JIT region that deoptimizes too often falls back to the
+// tier below.
+enum class eTier { kInterpreter, kBytecode, kJit };
+
+constexpr std::string_view ToStr(eTier tier) {
+  switch (tier) {
+    case eTier::kInterpreter:
+      return "interpreter";
+    case eTier::kBytecode:
+      return "bytecode";
+    default:
+      return "jit";
+  }
+}
+
+static constexpr std::size_t kTierDefaultBytecodeThreshold =
+    CAOCO_JIT_FORCE ? 1 : 2;
+
+struct TierOptions {
+  // Off: every line starts in the bytecode tier.
+  bool enabled{true};
+  // Calls of a unit, or back edges of a loop, before it is promoted to the
+  // bytecode tier. The JIT threshold is JitOptions::threshold.
+  std::size_t bytecode_threshold{kTierDefaultBytecodeThreshold};
+};
+
+struct TierTransition {
+  std::size_t unit;         // First line of the unit.
+  std::size_t source_line;  // Of the first line, 0 if unknown.
+  eTier from;
+  eTier to;
+  std::size_t count;  // Calls or back edges of the unit so far.
+  bool osr;           // Promoted at a back edge, while the loop runs.
+};
+
+class TierManager {
+  struct Unit {
+    std::size_t end{0};  // One past the last line.
+    std::size_t count{0};
+    eTier tier{eTier::kInterpreter};
+    eTier base{eTier::kInterpreter};  // Tier of its lines outside the JIT.
+  };
+  const std::vector<const IrLine*>* code_{nullptr};
+  std::vector<Unit> units_;  // Line index to the unit starting there.
+  std::vector<TierTransition> transitions_;
+
+  void Record(std::size_t unit, eTier to, bool osr) {
+    auto& state = units_[unit];
+    transitions_.push_back({unit, (*code_)[unit]->source_line, state.tier, to,
+                            state.count, osr});
+    state.tier = to;
+  }
+
+ public:
+  // Finds the units of the code, all in the given tier.
+  void Reset(const std::vector<const IrLine*>& code, eTier tier) {
+    code_ = &code;
+    units_.assign(code.size(), Unit{0, 0, tier, tier});
+    transitions_.clear();
+    lambda xExtend = [&](std::size_t unit, std::size_t end) {
+      if (unit < units_.size()) {
+        end = std::min(end, code.size());
+        units_[unit].end = std::max(units_[unit].end, end);
+      }
+    };
+    for (std::size_t i = 0; i < code.size(); i++) {
+      const auto& line = *code[i];
+      if ((line.op == eIrOp::DECLARE_METHOD ||
+           line.op == eIrOp::DECLARE_OBJECT) &&
+          line.args.size() > 1 &&
+          std::holds_alternative<IrInt>(line.args[1])) {
+        auto end = std::get<IrInt>(line.args[1]);
+        if (end > 0) xExtend(i + 1, static_cast<std::size_t>(end));
+      } else if (line.op == eIrOp::JUMP && !line.args.empty() &&
+                 std::holds_alternative<IrInt>(line.args[0])) {
+        auto target = std::get<IrInt>(line.args[0]);
+        if (target >= 0 && static_cast<std::size_t>(target) <= i) {
+          xExtend(static_cast<std::size_t>(target), i + 1);
+        }
+      }
+    }
+  }
+
+  // Counts a call of, or a back edge to, the unit. Returns the new count.
+  std::size_t Count(std::size_t unit) { return ++units_[unit].count; }
+
+  eTier Tier(std::size_t unit) const { return units_[unit].tier; }
+
+  // Lines [unit, End(unit)) of the unit.
+  std::size_t End(std::size_t unit) const {
+    return units_[unit].end != 0 ? units_[unit].end
+                                 : (*code_)[unit]->ExtentEnd() + 1;
+  }
+
+  // Moves the unit up to a tier. Compiled code keeps running while the
+  // lines below it are promoted to bytecode.
+  void Promote(std::size_t unit, eTier to, bool osr) {
+    auto& state = units_[unit];
+    if (to != eTier::kJit) state.base = to;
+    if (state.tier < to) Record(unit, to, osr);
+  }
+
+  // Moves a compiled unit back to the tier of its lines.
+  void Deoptimize(std::size_t unit) {
+    if (units_[unit].tier == eTier::kJit) {
+      Record(unit, units_[unit].base, false);
+    }
+  }
+
+  const std::vector<TierTransition>& Transitions() const {
+    return transitions_;
+  }
+
+  void PrintTransitions(std::ostream& os = std::cout) const {
+    for (const auto& t : transitions_) {
+      os << "[Tier] line " << t.unit << " (source line " << t.source_line
+         << "): " << ToStr(t.from) << " -> " << ToStr(t.to) << " after "
+         << t.count << (t.osr ? " back edges, on-stack" : " entries")
+         << std::endl;
+    }
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: compiler
+// File: tier_manager.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_COMPILER_TIER_MANAGER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -219,6 +219,8 @@ constexpr eAst kTkTypeToAstNodeType(eTk t) {
       return eAst::kElse;
     case eTk::kDirElif:
       return eAst::kElif;
+    case eTk::kDirEndif:
+      return eAst::kEndif;
     case eTk::kUse:
       return eAst::kUse;
     case eTk::kClass:
@@ -678,6 +680,8 @@ constexpr std::string_view kTkTypeLiteral(eTk t) {
       return "#else";
     case eTk::kDirElif:
       return "#elif";
+    case eTk::kDirEndif:
+      return "#endif";
     case eTk::kUse:
       return "use";
     case eTk::kClass:
@@ -913,6 +917,7 @@ using AllDirectivesTupleT = std::tuple<TkTrait<eTk::kDirInclude>,
                                        TkTrait<eTk::kDirEndmacro>,
                                        TkTrait<eTk::kDirIf>,
                                        TkTrait<eTk::kDirElse>,
-                                       TkTrait<eTk::kDirElif>>;
+                                       TkTrait<eTk::kDirElif>,
+                                       TkTrait<eTk::kDirEndif>>;
 constexpr AllDirectivesTupleT kAllDirectivesTuple = AllDirectivesTupleT{};
 };  // namespace tk_traits
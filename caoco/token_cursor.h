@@ -18,6 +18,7 @@
 #define HEADER_GUARD_CAOCO_COMMON_TOKEN_CURSOR_H
 // Includes:
 #include "cand_syntax.h"
+#include "expected.h"
 #include "import_stl.h"
 //---------------------------------------------------------------------------//
 //=-------------------------------------------------------------------------=//
@@ -96,7 +97,7 @@ class TkCursor {
   }
 
   // returns the token at the cursor + n.
-  constexpr const Tk& Peek(int n = 0) const { return Next(n).Get(); }
+  const Tk& Peek(int n = 0) const { return Next(n).Get(); }
 
   // True there is a match in the iterator's range.
   // Starting from and including the current token.
@@ -489,6 +489,8 @@ class TkScope {
       }
       std::advance(i, 1);
     }
+    scopes.push_back(TkScope{false, end, end});  // Not closed before end
+    return scopes;
   }
   static std::vector<TkScope> find_seperated_paren(TkCursor crsr,
                                                    eTk separator) {
@@ -533,6 +535,8 @@ class TkScope {
       }
       std::advance(i, 1);
     }
+    scopes.push_back(TkScope{false, end, end});  // Not closed before end
+    return scopes;
   }
   static std::vector<TkScope> find_seperated_brace(TkCursor crsr,
                                                    eTk separator) {
@@ -577,6 +581,8 @@ class TkScope {
       }
       std::advance(i, 1);
     }
+    scopes.push_back(TkScope{false, end, end});  // Not closed before end
+    return scopes;
   }
   static std::vector<TkScope> find_seperated_bracket(TkCursor crsr,
                                                      eTk separator) {
@@ -764,7 +770,8 @@ class TkScope {
         // currrent_scope_type = eTk::kOpenBracket;
         scope_type_history.push(eTk::kOpenBracket);
       } else if (it->Type() == eTk::kCloseBracket) {
-        if (scope_type_history.top() != eTk::kOpenBracket) {
+        if (scope_type_history.empty() ||
+            scope_type_history.top() != eTk::kOpenBracket) {
           // Has to be a close or error
           if (it->Type() == close) {
             last_closed = it;
@@ -781,7 +788,8 @@ class TkScope {
         // currrent_scope_type = eTk::kOpenBrace;
         scope_type_history.push(eTk::kOpenBrace);
       } else if (it->Type() == eTk::kCloseBrace) {
-        if (scope_type_history.top() != eTk::kOpenBrace) {
+        if (scope_type_history.empty() ||
+            scope_type_history.top() != eTk::kOpenBrace) {
           // Has to be a close or error
           if (it->Type() == close) {
             last_closed = it;
@@ -893,7 +901,8 @@ class TkScope {
         // currrent_scope_type = eTk::kOpenBracket;
         scope_type_history.push(eTk::kOpenBracket);
       } else if (it->Type() == eTk::kCloseBracket) {
-        if (scope_type_history.top() != eTk::kOpenBracket) {
+        if (scope_type_history.empty() ||
+            scope_type_history.top() != eTk::kOpenBracket) {
           // Has to be a close or error
           if (std::any_of(close.begin(), close.end(),
                           [it](eTk tk) { return it->Type() == tk; })) {
@@ -911,7 +920,8 @@ class TkScope {
         // currrent_scope_type = eTk::kOpenBrace;
         scope_type_history.push(eTk::kOpenBrace);
       } else if (it->Type() == eTk::kCloseBrace) {
-        if (scope_type_history.top() != eTk::kOpenBrace) {
+        if (scope_type_history.empty() ||
+            scope_type_history.top() != eTk::kOpenBrace) {
           // Has to be a close or error
           if (std::any_of(close.begin(), close.end(),
                           [it](eTk tk) { return it->Type() == tk; })) {
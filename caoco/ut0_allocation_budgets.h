@@ -0,0 +1,190 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_allocation_budgets.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_ALLOCATION_BUDGETS_H
+#define HEADER_GUARD_CAOCO_UT0_ALLOCATION_BUDGETS_H
+// Includes:
+#include "evaluator.h"
+#include "ir_optimizer.h"
+#include "jit_x86_64.h"
+#include "lark_parser.h"
+#include "lexer.h"
+#include "minibench.h"
+#include "minitest_allocations.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_ALLOCATION_BUDGETS true
+
+#if CAOCO_TEST_ALLOCATION_BUDGETS
+// The budgets need the counter, built with -DCAOCO_COUNT_ALLOCATIONS=1.
+#if CAOCO_COUNT_ALLOCATIONS
+#define CAOCO_TEST_ALLOCATION_BUDGETS_Guards 1
+#define CAOCO_TEST_ALLOCATION_BUDGETS_Pipeline 1
+#endif
+#define CAOCO_TEST_ALLOCATION_BUDGETS_Benchmark 1
+#endif
+
+// The allocations of each phase of the pipeline.
+struct AllocationBudgetPhases {
+  std::uint64_t lex = 0;
+  std::uint64_t parse = 0;
+  std::uint64_t irgen = 0;
+  std::uint64_t optimize = 0;
+  std::uint64_t evaluate = 0;
+};
+
+// Runs a program through the pipeline, checking each phase against the
+// budget. Returns the allocations of the phases.
+AllocationBudgetPhases AllocationBudgetRun(
+    const std::string& source, const AllocationBudgetPhases& budget) {
+  AllocationBudgetPhases used;
+  auto lex = minitest::ExpectMaxAllocations(budget.lex, "lex");
+  auto tokens = Lexer::Lex(source);
+  used.lex = lex.Count().count;
+  lex.Check();
+  auto parse = minitest::ExpectMaxAllocations(budget.parse, "parse");
+  auto ast = LarkParser::Parse(tokens.Extract());
+  used.parse = parse.Count().count;
+  parse.Check();
+  auto irgen = minitest::ExpectMaxAllocations(budget.irgen, "irgen");
+  IrGen gen;
+  auto code = gen.GenerateIr(ast.Extract());
+  used.irgen = irgen.Count().count;
+  irgen.Check();
+  auto optimize = minitest::ExpectMaxAllocations(budget.optimize, "optimize");
+  IrPassManager::StandardPipeline().Run(code);
+  used.optimize = optimize.Count().count;
+  optimize.Check();
+  auto evaluate = minitest::ExpectMaxAllocations(budget.evaluate, "evaluate");
+  Environment env;
+  Evaluator{env}.Evaluate(code);
+  used.evaluate = evaluate.Count().count;
+  evaluate.Check();
+  return used;
+}
+
+#if CAOCO_TEST_ALLOCATION_BUDGETS_Guards
+MINITEST(TestAllocationBudgets, TestCaseGuards) {
+  {
+    EXPECT_MAX_ALLOCATIONS(0);
+    std::array<int, 64> numbers{};
+    minitest::DoNotOptimize(numbers);
+  }
+  {
+    EXPECT_MAX_ALLOCATIONS(2);
+    EXPECT_MAX_ALLOCATED_BYTES(16);
+    auto first = std::make_unique<std::int64_t>(1);
+    auto second = std::make_unique<std::int64_t>(2);
+  }
+
+  // Exceeded budgets fail the test case once, the failures are dropped here.
+  auto& failures = *minitest::running_test_failures;
+  auto failed = failures.size();
+  auto count = minitest::ExpectMaxAllocations(1, "count");
+  auto bytes = minitest::ExpectMaxAllocatedBytes(8, "bytes");
+  std::vector<std::int64_t> three{1, 2, 3};
+  auto extra = std::make_unique<int>(4);
+  EXPECT_EQ(count.Count().count, 2);
+  EXPECT_EQ(count.Count().bytes, 3 * sizeof(std::int64_t) + sizeof(int));
+  EXPECT_FALSE(count.Check());
+  EXPECT_FALSE(bytes.Check());
+  EXPECT_TRUE(count.Check());  // Checked already.
+  ASSERT_EQ(failures.size(), failed + 2);
+  EXPECT_TRUE(failures[failed].find("count: 2 allocations") !=
+              std::string::npos);
+  EXPECT_TRUE(failures[failed].find("budget 1 allocations at ") !=
+              std::string::npos);
+  EXPECT_TRUE(failures[failed + 1].find("budget 8 bytes at ") !=
+              std::string::npos);
+  failures.resize(failed);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_ALLOCATION_BUDGETS_Pipeline
+// A build with CAOCO_JIT_FORCE compiles every region, allocating their code
+// and slot tables, and has its own evaluate budgets.
+static constexpr bool kAllocationBudgetJitForced = kJitDefaultThreshold == 1;
+
+// The budgets are the counts when written plus about a tenth. Evaluating
+// the loops must not allocate per iteration: 2000 and 3000 of them here.
+MINITEST(TestAllocationBudgets, TestCasePipeline) {
+  auto arithmetic = AllocationBudgetRun(
+      kIrSuperinstructionCorpus[0],
+      {.lex = 22, .parse = 1750, .irgen = 265, .optimize = 4050,
+       .evaluate = 125});
+  EXPECT_TRUE(arithmetic.evaluate > 0);
+  AllocationBudgetRun(kIrSuperinstructionCorpus[1],
+                      {.lex = 22, .parse = 3400, .irgen = 485,
+                       .optimize = 5300,
+                       .evaluate = kAllocationBudgetJitForced ? 340u : 200u});
+  AllocationBudgetRun(kIrSuperinstructionCorpus[4],
+                      {.lex = 22, .parse = 2050, .irgen = 290,
+                       .optimize = 4650,
+                       .evaluate = kAllocationBudgetJitForced ? 260u : 180u});
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_ALLOCATION_BUDGETS_Benchmark
+// The allocations of each phase over the corpus, and the cost of a counted
+// allocation.
+MINITEST(TestAllocationBudgets, TestCaseBenchmark) {
+  constexpr auto kUnbounded = std::numeric_limits<std::uint64_t>::max();
+  AllocationBudgetPhases total;
+  for (const auto& source : kIrSuperinstructionCorpus) {
+    auto used = AllocationBudgetRun(source, {kUnbounded, kUnbounded,
+                                             kUnbounded, kUnbounded,
+                                             kUnbounded});
+    total.lex += used.lex;
+    total.parse += used.parse;
+    total.irgen += used.irgen;
+    total.optimize += used.optimize;
+    total.evaluate += used.evaluate;
+  }
+  constexpr int kAllocations = 1000000;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kAllocations; i++) {
+    auto value = std::make_unique<int>(i);
+    minitest::DoNotOptimize(value);
+  }
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+  std::cout << "[Allocation Budget Benchmark] corpus allocations: lex: "
+            << total.lex << ", parse: " << total.parse
+            << ", irgen: " << total.irgen
+            << ", optimize: " << total.optimize
+            << ", evaluate: " << total.evaluate << ", new/delete: "
+            << ns / kAllocations << "ns"
+            << (AllocationCounter::kEnabled ? " counted" : " not counted")
+            << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_allocation_budgets.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_ALLOCATION_BUDGETS_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
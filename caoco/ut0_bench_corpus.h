@@ -0,0 +1,241 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_bench_corpus.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_BENCH_CORPUS_H
+#define HEADER_GUARD_CAOCO_UT0_BENCH_CORPUS_H
+// Includes:
+#include "bench_corpus.h"
+#include "cand_driver.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_BENCH_CORPUS true
+
+#if CAOCO_TEST_BENCH_CORPUS
+#define CAOCO_TEST_BENCH_CORPUS_Load 1
+#define CAOCO_TEST_BENCH_CORPUS_Engines 1
+#define CAOCO_TEST_BENCH_CORPUS_Golden 1
+#define CAOCO_TEST_BENCH_CORPUS_Driver 1
+#define CAOCO_TEST_BENCH_CORPUS_IntOverflow 1
+// Compiled programs are built with the system compiler and run by a POSIX
+// shell, see CAOCO_TEST_AOT.
+#if defined(__unix__) && CAOCO_TEST_AOT
+#define CAOCO_TEST_BENCH_CORPUS_Aot 1
+#endif
+#endif
+
+// Ints wrap around in every engine. The first lines fold under -O, the loop
+// is compiled by the JIT, which leaves each overflow to the interpreter.
+static const BenchProgram kBenchTestIntOverflow = {
+    "int_overflow",
+    "def @max: 2147483647; def @min: 0 - 2147483647 - 1; def @d: 0 - 1;"
+    "def @sum: 0; def @diff: 0; def @prod: 0; def @quo: 0; def @rem: 1;"
+    "main: {"
+    "  cout(2147483647 + 1);"
+    "  cout(0 - 2147483647 - 2);"
+    "  cout(65536 * 65536 + 3);"
+    "  cout((0 - 2147483647 - 1) / (0 - 1));"
+    "  cout((0 - 2147483647 - 1) % (0 - 1));"
+    "  for(def @i: 0; i < 200; i++){"
+    "    sum = max + i; diff = min - i; prod = max * (i + 2);"
+    "    quo = min / d; rem = min % d;"
+    "  };"
+    "  cout(sum); cout(diff); cout(prod); cout(quo); cout(rem);"
+    "};",
+    "-2147483648\n2147483647\n3\n-2147483648\n0\n"
+    "-2147483450\n2147483449\n2147483447\n-2147483648\n0\n"};
+
+// A corpus of one program in the temp directory.
+std::filesystem::path BenchTestCorpus(const std::string& name,
+                                      const std::string& source,
+                                      const std::string& golden) {
+  auto dir = std::filesystem::temp_directory_path() / ("caoco-bench-" + name);
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  std::ofstream(dir / (name + ".cand")) << source;
+  std::ofstream(dir / (name + ".out")) << golden;
+  return dir;
+}
+
+#if CAOCO_TEST_BENCH_CORPUS_Load
+MINITEST(TestBenchCorpus, TestCaseLoad) {
+  auto programs = BenchCorpus::Load("benchmarks");
+  ASSERT_TRUE(programs.Valid());
+  std::vector<std::string> names;
+  for (const auto& program : programs.Value()) {
+    EXPECT_FALSE(program.source.empty());
+    EXPECT_FALSE(program.golden.empty());
+    names.push_back(program.name);
+  }
+  EXPECT_EQ(names,
+            (std::vector<std::string>{"class_hierarchy", "elif_chain", "fib",
+                                      "method_dispatch", "numeric_loops",
+                                      "string_building"}));
+  EXPECT_FALSE(BenchCorpus::Load("no_such_benchmarks").Valid());
+
+  auto dir = BenchTestCorpus("nogolden", "main: {};", "");
+  std::filesystem::remove(dir / "nogolden.out");
+  auto missing = BenchCorpus::Load(dir);
+  ASSERT_FALSE(missing.Valid());
+  EXPECT_TRUE(missing.Error().starts_with(kBenchErrorNoGolden));
+  std::filesystem::remove_all(dir);
+
+  EXPECT_TRUE(BenchCorpus::FindEngine("aot").Valid());
+  EXPECT_FALSE(BenchCorpus::FindEngine("tree").Valid());
+  EXPECT_EQ(BenchCorpus::Engines().front(), eBenchEngine::kInterpreter);
+  EXPECT_EQ(BenchCorpus::Engines(true).back(), eBenchEngine::kAot);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_BENCH_CORPUS_Engines
+// Every engine prints the golden output of every program, and the later
+// tiers dispatch less.
+MINITEST(TestBenchCorpus, TestCaseEngines) {
+  auto programs = BenchCorpus::Load("benchmarks");
+  ASSERT_TRUE(programs.Valid());
+  BenchCorpus corpus({.repeats = 1});
+  EXPECT_TRUE(corpus.RunAll(programs.Value(), BenchCorpus::Engines()));
+  const auto& runs = corpus.Runs();
+  ASSERT_EQ(runs.size(),
+            programs.Value().size() * BenchCorpus::Engines().size());
+  for (const auto& run : runs) {
+    EXPECT_EQ(run.error, "");
+    EXPECT_EQ(run.times.size(), 1);
+    EXPECT_TRUE(run.dispatches > 0);
+  }
+  for (std::size_t i = 0; i + 1 < runs.size(); i++) {
+    if (runs[i].engine == eBenchEngine::kInterpreter) {
+      EXPECT_TRUE(runs[i + 1].dispatches < runs[i].dispatches);
+    }
+  }
+  corpus.PrintReport(std::cout);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_BENCH_CORPUS_Golden
+MINITEST(TestBenchCorpus, TestCaseGolden) {
+  BenchCorpus corpus({.repeats = 3});
+  auto passed = corpus.Run(
+      {"count", "main: { for(def @i: 0; i < 3; i++){ cout(i); }; };",
+       "0\n1\n2\n"},
+      eBenchEngine::kBytecode);
+  EXPECT_TRUE(passed.Passed());
+  EXPECT_EQ(passed.Name(), "count.bytecode");
+  EXPECT_EQ(passed.times.size(), 3);
+  EXPECT_TRUE(passed.Fastest() <= passed.Median());
+
+  // Stops at the first run with another output.
+  auto wrong = corpus.Run({"count", "main: { cout(1); };", "2\n"},
+                          eBenchEngine::kInterpreter);
+  EXPECT_EQ(wrong.error, kBenchErrorWrongOutput);
+  EXPECT_EQ(wrong.times.size(), 1);
+
+  auto failed =
+      corpus.Run({"count", "main: {", ""}, eBenchEngine::kOptimized);
+  EXPECT_FALSE(failed.Passed());
+  EXPECT_TRUE(failed.times.empty());
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_BENCH_CORPUS_Driver
+// The JSON reads as a minibench baseline.
+MINITEST(TestBenchCorpus, TestCaseDriver) {
+  auto dir = BenchTestCorpus("loop",
+                             "def @t: 0; main: { while(t < 1000){ t++; };"
+                             " cout(t); };",
+                             "1000\n");
+  auto json = dir / "bench.json";
+  std::istringstream in;
+  std::ostringstream out;
+  std::ostringstream err;
+  EXPECT_EQ(CandDriver::Main({"bench", dir.string(), "--engines",
+                              "interpreter,optimized", "--repeats", "2",
+                              "--json", json.string()},
+                             in, out, err),
+            0);
+  EXPECT_EQ(err.str(), "");
+  EXPECT_TRUE(out.str().starts_with("[Bench loop.interpreter] median: "));
+  std::ifstream file(json);
+  std::string text((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  auto medians = minitest::ReadBenchBaseline(text);
+  ASSERT_EQ(medians.size(), 2);
+  EXPECT_EQ(medians[0].first, "loop.interpreter");
+  EXPECT_EQ(medians[1].first, "loop.optimized");
+  EXPECT_TRUE(medians[0].second > 0);
+
+  std::ofstream(dir / "loop.out") << "999\n";
+  EXPECT_EQ(CandDriver::Main({"bench", dir.string(), "--engines", "bytecode"},
+                             in, out, err),
+            1);
+  EXPECT_EQ(CandDriver::Main({"bench", dir.string(), "--engines", "tree"}, in,
+                             out, err),
+            2);
+  EXPECT_EQ(CandDriver::Main({"bench", dir.string(), "--repeats"}, in, out,
+                             err),
+            2);
+  std::filesystem::remove_all(dir);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_BENCH_CORPUS_IntOverflow
+MINITEST(TestBenchCorpus, TestCaseIntOverflow) {
+  BenchCorpus corpus({.repeats = 1});
+  for (auto engine : BenchCorpus::Engines()) {
+    auto run = corpus.Run(kBenchTestIntOverflow, engine);
+    EXPECT_EQ(run.Name() + ": " + run.error, run.Name() + ": ");
+  }
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_BENCH_CORPUS_Aot
+MINITEST(TestBenchCorpus, TestCaseAot) {
+  if (!IrTranspiler::CompilerFound()) {
+    std::cout << "[Bench aot] No system compiler, skipped." << std::endl;
+    return;
+  }
+  auto programs = BenchCorpus::Load("benchmarks");
+  ASSERT_TRUE(programs.Valid());
+  auto fib = std::find_if(programs.Value().begin(), programs.Value().end(),
+                          [](const auto& p) { return p.name == "fib"; });
+  ASSERT_TRUE(fib != programs.Value().end());
+  BenchCorpus corpus({.repeats = 2});
+  auto run = corpus.Run(*fib, eBenchEngine::kAot);
+  EXPECT_EQ(run.error, "");
+  EXPECT_EQ(run.times.size(), 2);
+  EXPECT_EQ(run.dispatches, 0);
+  auto overflow = corpus.Run(kBenchTestIntOverflow, eBenchEngine::kAot);
+  EXPECT_EQ(overflow.error, "");
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_bench_corpus.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_BENCH_CORPUS_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,227 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_candc_module.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_CANDC_MODULE_H
+#define HEADER_GUARD_CAOCO_UT0_CANDC_MODULE_H
+// Includes:
+#include "cand_driver.h"
+#include "candc_module.h"
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_CANDC_MODULE true
+
+#if CAOCO_TEST_CANDC_MODULE
+#define CAOCO_TEST_CANDC_MODULE_RoundTrip 1
+#define CAOCO_TEST_CANDC_MODULE_Validation 1
+#define CAOCO_TEST_CANDC_MODULE_Driver 1
+#define CAOCO_TEST_CANDC_MODULE_ColdStart 1
+#endif
+
+#if CAOCO_TEST_CANDC_MODULE_RoundTrip
+MINITEST(TestCandcModule, TestCaseRoundTrip) {
+  auto code = IrTestGenerate(
+      "def @a: 1.5;\n"
+      "fn@f:{\n"
+      "  return 'x';\n"
+      "};\n"
+      "class @C:{ def @m: true; };\n"
+      "main: {\n"
+      "  cout(f());\n"
+      "  cout(f());\n"
+      "};\n");
+  auto bytes = CandcWriter::Write(code);
+  auto module = CandcModule::View(bytes);
+  ASSERT_TRUE(module.Valid());
+  const auto& view = module.Value();
+  ASSERT_EQ(view.Size(), code.Size());
+  EXPECT_EQ(IrTestDisassembly(view.ToIrCode()), IrTestDisassembly(code));
+
+  // Every line has the line of its statement, operands included.
+  std::size_t i = 0;
+  for (const auto& line : code.GetLines()) {
+    if (line.op != eIrOp::ENTER_PROGRAM_DEFINITION) {
+      EXPECT_TRUE(line.source_line != 0);
+    }
+    EXPECT_EQ(view.SourceLine(i++), line.source_line);
+  }
+  for (const auto& line : code.GetLines()) {
+    // The implicit return of a method has the line of the method.
+    if (line.op == eIrOp::RETURN && !line.args.empty()) {
+      EXPECT_EQ(line.source_line, 3);
+    }
+    if (line.op == eIrOp::CALL) EXPECT_TRUE(line.source_line >= 7);
+  }
+
+  // Declarations of the program, strings are pooled once.
+  std::set<std::pair<std::string, eCandcSymbol>> symbols;
+  for (const auto& symbol : view.Symbols()) {
+    symbols.insert({std::string(view.String(symbol.name)), symbol.kind});
+  }
+  EXPECT_TRUE(symbols.contains({"a", eCandcSymbol::kVariable}));
+  EXPECT_TRUE(symbols.contains({"f", eCandcSymbol::kMethod}));
+  EXPECT_TRUE(symbols.contains({"C", eCandcSymbol::kClass}));
+
+  // Optimized programs run the same from their module.
+  for (const auto& source : kIrSuperinstructionCorpus) {
+    auto optimized = IrSuperinstructionTestCode(source);
+    auto round_trip = CandcModule::View(CandcWriter::Write(optimized))
+                          .Extract()
+                          .ToIrCode();
+    EXPECT_EQ(IrTestDisassembly(round_trip), IrTestDisassembly(optimized));
+  }
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_CANDC_MODULE_Validation
+MINITEST(TestCandcModule, TestCaseValidation) {
+  auto bytes = CandcWriter::Write(IrTestGenerate("main: { cout('hi'); };"));
+  lambda xError = [](const std::vector<char>& modified) {
+    auto module = CandcModule::View(modified);
+    return module ? std::string() : module.Error();
+  };
+  EXPECT_EQ(xError(bytes), "");
+
+  auto corrupted = bytes;
+  corrupted.back() ^= 1;
+  EXPECT_EQ(xError(corrupted), kCandcErrorChecksum);
+
+  auto version = bytes;
+  version[offsetof(CandcHeader, version)]++;
+  EXPECT_EQ(xError(version), kCandcErrorVersion);
+
+  auto magic = bytes;
+  magic[0] = 'X';
+  EXPECT_EQ(xError(magic), kCandcErrorBadMagic);
+
+  EXPECT_EQ(xError({bytes.begin(), bytes.end() - 8}), kCandcErrorTruncated);
+  EXPECT_EQ(xError({bytes.begin(), bytes.begin() + 10}), kCandcErrorTruncated);
+
+  // An out of bounds record is rejected even with a matching checksum.
+  auto malformed = bytes;
+  CandcHeader header;
+  std::memcpy(&header, malformed.data(), sizeof(header));
+  header.lines.count += 1000;
+  std::memcpy(malformed.data(), &header, sizeof(header));
+  EXPECT_EQ(xError(malformed), kCandcErrorMalformed);
+
+  EXPECT_EQ(CandcModule::Load("ut0_missing.candc").Error(),
+            kCandcErrorCannotOpen);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_CANDC_MODULE_Driver
+MINITEST(TestCandcModule, TestCaseDriver) {
+  auto dir = std::filesystem::temp_directory_path() / "caoco_candc";
+  std::filesystem::create_directories(dir);
+  auto module = (dir / "animal_sounds1.candc").string();
+  lambda xRun = [](std::vector<std::string> args, const std::string& input,
+                   std::string& out) {
+    std::istringstream in(input);
+    std::ostringstream os;
+    std::ostringstream err;
+    int status = CandDriver::Main(args, in, os, err);
+    out = os.str() + err.str();
+    return status;
+  };
+  std::string input = "husky\npoodle\ncat\nnone\n";
+  std::string from_source;
+  std::string from_module;
+  std::string compiled;
+  EXPECT_EQ(xRun({"run", "animal_sounds1.cand"}, input, from_source), 0);
+  EXPECT_EQ(
+      xRun({"compile", "animal_sounds1.cand", "-o", module, "-O"}, "", compiled),
+      0);
+  EXPECT_EQ(compiled, "");
+  EXPECT_EQ(xRun({"run", module}, input, from_module), 0);
+  EXPECT_FALSE(from_source.empty());
+  EXPECT_EQ(from_module, from_source);
+  EXPECT_EQ(CandcModule::Load(module).Value().Flags(), kCandcFlagOptimized);
+
+  std::string usage;
+  EXPECT_EQ(xRun({"compile"}, "", usage), 2);
+  EXPECT_EQ(usage, kCandDriverUsage);
+  std::string missing;
+  EXPECT_EQ(xRun({"run", (dir / "missing.candc").string()}, "", missing), 1);
+  EXPECT_EQ(missing, std::string(kCandcErrorCannotOpen) + "\n");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_CANDC_MODULE_ColdStart
+// Time from a file on disk to IR ready to evaluate: lexing, parsing, IR
+// generation and optimization of the source, or mapping, validating and
+// materializing its module.
+MINITEST_SERIAL(TestCandcModule, TestCaseColdStart) {
+  auto dir = std::filesystem::temp_directory_path() / "caoco_candc";
+  std::filesystem::create_directories(dir);
+  std::vector<std::pair<std::string, std::string>> sources;
+  for (const auto& file : {"variable_decl.cand", "animal_sounds1.cand"}) {
+    auto text = LoadFileToVec(file);
+    sources.push_back({std::filesystem::path(file).stem().string(),
+                       std::string(text.begin(), text.end())});
+  }
+  for (std::size_t i = 0; i < kIrSuperinstructionCorpus.size(); i++) {
+    sources.push_back(
+        {"corpus" + std::to_string(i), kIrSuperinstructionCorpus[i]});
+  }
+  constexpr int kRuns = 20;
+  for (const auto& [name, text] : sources) {
+    auto source = dir / (name + ".cand");
+    auto module = dir / (name + ".candc");
+    std::ofstream(source, std::ios::binary) << text;
+    auto code = CandDriver::CompileFile(source, true);
+    ASSERT_TRUE(code.Valid());
+    ASSERT_TRUE(CandcWriter::Save(code.Value(), module, kCandcFlagOptimized));
+
+    lambda xTime = [&](auto load) {
+      auto start = std::chrono::steady_clock::now();
+      for (int run = 0; run < kRuns; run++) {
+        auto loaded = load();
+        EXPECT_EQ(loaded.Size(), code.Value().Size());
+      }
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now() - start)
+                 .count() /
+             kRuns;
+    };
+    auto source_us = xTime(
+        [&] { return CandDriver::CompileFile(source, true).Extract(); });
+    auto module_us = xTime(
+        [&] { return CandcModule::Load(module).Extract().ToIrCode(); });
+    std::cout << "[CANDC Benchmark] " << name << ": source: " << source_us
+              << "us, module: " << module_us << "us ("
+              << std::filesystem::file_size(module) << " bytes)" << std::endl;
+  }
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_candc_module.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_CANDC_MODULE_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,118 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_compilation_session.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_COMPILATION_SESSION_H
+#define HEADER_GUARD_CAOCO_UT0_COMPILATION_SESSION_H
+// Includes:
+#include "compilation_session.h"
+#include "evaluator.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_COMPILATION_SESSION true
+
+#if CAOCO_TEST_COMPILATION_SESSION
+#define CAOCO_TEST_COMPILATION_SESSION_Diagnostics 1
+#define CAOCO_TEST_COMPILATION_SESSION_Concurrency 1
+#define CAOCO_TEST_COMPILATION_SESSION_Benchmark 1
+#endif
+
+// The corpus, each source repeated.
+std::vector<std::string> SessionTestSources(std::size_t copies) {
+  std::vector<std::string> sources;
+  for (std::size_t i = 0; i < copies; i++) {
+    for (const auto& source : kIrSuperinstructionCorpus) {
+      sources.push_back(source);
+    }
+  }
+  return sources;
+}
+
+#if CAOCO_TEST_COMPILATION_SESSION_Diagnostics
+MINITEST(TestCompilationSession, TestCaseDiagnostics) {
+  // A name error stops a checked compilation only, the names are interned
+  // in the session.
+  CompilationSession session({.check = true});
+  std::string source = "def @y: 1; main: { y = missing; };";
+  EXPECT_EQ(session.Compile(source).Error(), "Undeclared name: missing");
+  EXPECT_EQ(session.Diagnostics().size(), 1);
+  EXPECT_TRUE(session.Symbols().Find("y").has_value());
+  EXPECT_TRUE(CompilationSession().Compile(source).Valid());
+
+  // The session is reused, the diagnostics are of the last source.
+  EXPECT_TRUE(session.Compile("def @y: 1; main: { y = 2; };").Valid());
+  EXPECT_TRUE(session.Diagnostics().empty());
+  EXPECT_EQ(session.Symbols().Size(), 1);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_COMPILATION_SESSION_Concurrency
+// Sessions on many threads give the code of one session compiling alone.
+// Build with -fsanitize=thread to check the stages for data races.
+MINITEST(TestCompilationSession, TestCaseConcurrency) {
+  auto sources = SessionTestSources(8);
+  CompilationOptions options{.optimize = true, .check = true};
+  auto parallel = CompilationSession::CompileAll(sources, options, 8);
+  ASSERT_EQ(parallel.size(), sources.size());
+  for (std::size_t i = 0; i < sources.size(); i++) {
+    auto serial = CompilationSession(options).Compile(sources[i]);
+    ASSERT_TRUE(serial.Valid());
+    ASSERT_TRUE(parallel[i].Valid());
+    EXPECT_EQ(IrTestDisassembly(parallel[i].Value()),
+              IrTestDisassembly(serial.Value()));
+  }
+
+  // Compiled concurrently, the programs still run.
+  Environment env;
+  Evaluator{env}.Evaluate(parallel.front().Value());
+  EXPECT_TRUE(env.LookupVariable("total") != nullptr);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_COMPILATION_SESSION_Benchmark
+MINITEST(TestCompilationSession, TestCaseBenchmark) {
+  auto sources = SessionTestSources(20);
+  lambda xTime = [&](std::size_t threads) {
+    auto start = std::chrono::steady_clock::now();
+    auto results =
+        CompilationSession::CompileAll(sources, {.optimize = true}, threads);
+    for (const auto& result : results) EXPECT_TRUE(result.Valid());
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  auto serial_us = xTime(1);
+  auto parallel_us = xTime(4);
+  std::cout << "[Compilation Session Benchmark] sources: " << sources.size()
+            << ", 1 thread: " << serial_us << "us, 4 threads: " << parallel_us
+            << "us" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_compilation_session.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_COMPILATION_SESSION_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,276 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_compiler_daemon.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_COMPILER_DAEMON_H
+#define HEADER_GUARD_CAOCO_UT0_COMPILER_DAEMON_H
+// Includes:
+#include "cand_driver.h"
+#include "compiler_daemon.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_COMPILER_DAEMON true
+
+#if CAOCO_TEST_COMPILER_DAEMON
+#define CAOCO_TEST_COMPILER_DAEMON_Requests 1
+#define CAOCO_TEST_COMPILER_DAEMON_AbsoluteArgs 1
+#define CAOCO_TEST_COMPILER_DAEMON_Limits 1
+#define CAOCO_TEST_COMPILER_DAEMON_Clients 1
+#define CAOCO_TEST_COMPILER_DAEMON_Benchmark 1
+#endif
+
+// A daemon serving the driver commands on a thread of the test.
+struct DaemonTestServer {
+  std::filesystem::path socket;
+  CompilerDaemon daemon;
+  std::thread thread;
+
+  explicit DaemonTestServer(
+      const std::string& name,
+      EvaluatorLimits limits = kCandDriverDaemonRunLimits)
+      : socket(std::filesystem::temp_directory_path() /
+               ("caoco_" + name + ".sock")),
+        daemon(socket,
+               std::filesystem::temp_directory_path() / "caoco_daemon" / name,
+               CandDriver::DaemonHandler(limits)) {
+    daemon.Cache().Clear();
+    EXPECT_TRUE(daemon.Listen().Valid());
+    thread = std::thread([this] { daemon.Serve(); });
+  }
+
+  ~DaemonTestServer() {
+    CompilerDaemon::Request(socket, {std::string(kDaemonStopCommand)});
+    thread.join();
+  }
+};
+
+#if CAOCO_TEST_COMPILER_DAEMON_Requests
+MINITEST_SERIAL(TestCompilerDaemon, TestCaseRequests) {
+  auto files = kModuleTestShapes;
+  files.back().second =
+      "import shapes;\nimport util;\n"
+      "main: { def @q: Square(); cout(q.area(3) + twice(1)); };\n";
+  auto dir = ModuleTestWrite("daemon", files);
+  auto main = (dir / "main.cand").string();
+  DaemonTestServer server("requests");
+
+  auto ran = CompilerDaemon::Request(server.socket, {"run", main});
+  ASSERT_TRUE(ran.Valid());
+  EXPECT_EQ(ran.Value().exit_code, 0);
+  EXPECT_EQ(ran.Value().out, "20\n");
+  auto checked = CompilerDaemon::Request(server.socket, {"check", main});
+  EXPECT_TRUE(checked.Valid() && checked.Value().exit_code == 0);
+  auto wrong = CompilerDaemon::Request(server.socket, {"link", main});
+  EXPECT_TRUE(wrong.Valid() && wrong.Value().exit_code == 2);
+  EXPECT_EQ(wrong.Value().err, kCandDriverUsage);
+
+  // The client makes paths absolute for the daemon.
+  auto cwd = std::filesystem::current_path();
+  std::filesystem::current_path(dir);
+  std::istringstream in;
+  std::ostringstream out;
+  std::ostringstream err;
+  EXPECT_EQ(CandDriver::Main({"client", server.socket.string(), "compile",
+                              "main.cand", "-o", "client.candc"},
+                             in, out, err),
+            0);
+  std::filesystem::current_path(cwd);
+  EXPECT_TRUE(std::filesystem::exists(dir / "client.candc"));
+
+  // Concurrent clients share the modules in memory.
+  auto hits = server.daemon.Cache().Hits();
+  std::atomic<int> wrong_output = 0;
+  std::vector<std::thread> clients;
+  for (int t = 0; t < 8; t++) {
+    clients.emplace_back([&] {
+      for (int i = 0; i < 5; i++) {
+        auto reply = CompilerDaemon::Request(server.socket, {"run", main});
+        if (!reply || reply.Value().out != "20\n") wrong_output++;
+      }
+    });
+  }
+  for (auto& client : clients) client.join();
+  EXPECT_EQ(wrong_output.load(), 0);
+  EXPECT_EQ(server.daemon.Cache().Hits() - hits, 40 * files.size());
+  EXPECT_TRUE(server.daemon.Cache().SizeInMemory() > 0);
+
+  EXPECT_FALSE(CompilerDaemon::Request(
+                   std::filesystem::temp_directory_path() / "caoco_none.sock",
+                   {"run", main})
+                   .Valid());
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_COMPILER_DAEMON_AbsoluteArgs
+// Only the paths of the driver commands are made absolute, not their
+// names, targets, flags nor the values of other flags.
+MINITEST(TestCompilerDaemon, TestCaseAbsoluteArgs) {
+  auto cwd = std::filesystem::current_path();
+  lambda xAbs = [&cwd](const std::string& path) {
+    return (cwd / path).lexically_normal().string();
+  };
+  lambda xArgs = [](const std::vector<std::string>& args) {
+    return CompilerDaemon::AbsoluteArgs(args, CandDriver::CommandPaths());
+  };
+  EXPECT_EQ(xArgs({"compile", "-O", "main.cand", "-o", "out.candc",
+                   "--trace", "t.json"}),
+            (std::vector<std::string>{"compile", "-O", xAbs("main.cand"), "-o",
+                                      xAbs("out.candc"), "--trace",
+                                      xAbs("t.json")}));
+  EXPECT_EQ(xArgs({"fuzz", "parse", "corpus", "--runs", "10",
+                   "--regressions", "slow"}),
+            (std::vector<std::string>{"fuzz", "parse", xAbs("corpus"),
+                                      "--runs", "10", "--regressions",
+                                      xAbs("slow")}));
+  EXPECT_EQ(xArgs({"bench", "benchmarks", "--engines", "jit", "--repeats",
+                   "3", "--json", "b.json"}),
+            (std::vector<std::string>{"bench", xAbs("benchmarks"), "--engines",
+                                      "jit", "--repeats", "3", "--json",
+                                      xAbs("b.json")}));
+  EXPECT_EQ(xArgs({"link", "main.cand"}),
+            (std::vector<std::string>{"link", "main.cand"}));
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_COMPILER_DAEMON_Limits && CAOCO_DAEMON_SOCKETS
+// The socket is private to its owner, a request claiming more than the
+// bounds is dropped unanswered, and a program which never ends fails.
+MINITEST_SERIAL(TestCompilerDaemon, TestCaseLimits) {
+  DaemonTestServer server("limits", {.dispatches = 100000, .frames = 0});
+  auto permissions = std::filesystem::status(server.socket).permissions();
+  EXPECT_TRUE((permissions & std::filesystem::perms::all) ==
+              (std::filesystem::perms::owner_read |
+               std::filesystem::perms::owner_write));
+
+  lambda xSend = [&server](std::vector<std::uint32_t> words) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, server.socket.c_str());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    EXPECT_EQ(::connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                        sizeof(address)),
+              0);
+    EXPECT_EQ(::send(fd, words.data(), words.size() * sizeof(std::uint32_t),
+                     MSG_NOSIGNAL),
+              static_cast<ssize_t>(words.size() * sizeof(std::uint32_t)));
+    char byte = 0;
+    auto received = ::recv(fd, &byte, 1, 0);
+    ::close(fd);
+    return received;
+  };
+  EXPECT_EQ(xSend({kDaemonMaxArgs + 1}), 0);
+  EXPECT_EQ(xSend({1, kDaemonMaxStringSize + 1}), 0);
+  EXPECT_EQ(xSend({1, 0, 0}), 1);  // An empty command, replied to.
+
+  auto dir = ModuleTestWrite("daemon_limits",
+                             {{"main", "main: { while(true){}; };\n"}});
+  auto ran = CompilerDaemon::Request(server.socket,
+                                     {"run", (dir / "main.cand").string()});
+  ASSERT_TRUE(ran.Valid());
+  EXPECT_EQ(ran.Value().exit_code, 1);
+  EXPECT_EQ(ran.Value().err, std::string(kEvaluatorErrorDispatchLimit) + "\n");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_COMPILER_DAEMON_Clients && CAOCO_DAEMON_SOCKETS
+// Clients past the maximum wait for a reply to another, then are served.
+MINITEST_SERIAL(TestCompilerDaemon, TestCaseClients) {
+  auto socket = std::filesystem::temp_directory_path() / "caoco_clients.sock";
+  std::atomic<int> serving = 0;
+  std::atomic<int> most = 0;
+  auto cache_dir =
+      std::filesystem::temp_directory_path() / "caoco_daemon" / "clients";
+  CompilerDaemon daemon(
+      socket, cache_dir,
+      [&](const std::vector<std::string>&, std::istream&, std::ostream& out,
+          std::ostream&, ModuleCache&) {
+        int now = ++serving;
+        int seen = most.load();
+        while (now > seen && !most.compare_exchange_weak(seen, now)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        serving--;
+        out << "done";
+        return 0;
+      },
+      kDaemonMemoryCapacity, 2);
+  ASSERT_TRUE(daemon.Listen().Valid());
+  std::thread thread([&daemon] { daemon.Serve(); });
+  std::atomic<int> replied = 0;
+  std::vector<std::thread> clients;
+  for (int t = 0; t < 8; t++) {
+    clients.emplace_back([&] {
+      auto reply = CompilerDaemon::Request(socket, {"run"});
+      if (reply && reply.Value().out == "done") replied++;
+    });
+  }
+  for (auto& client : clients) client.join();
+  CompilerDaemon::Request(socket, {std::string(kDaemonStopCommand)});
+  thread.join();
+  EXPECT_EQ(replied.load(), 8);
+  EXPECT_EQ(most.load(), 2);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_COMPILER_DAEMON_Benchmark
+// Latency of compiling 4 levels of 4 modules: a cold driver, as a new
+// process would run it, against requests to a warm daemon.
+MINITEST(TestCompilerDaemon, TestCaseBenchmark) {
+  constexpr int kRequests = 10;
+  auto dir = ModuleTestWrite("daemon_benchmark", ModuleTestLayers(4, 4));
+  std::vector<std::string> args = {"compile", (dir / "root.cand").string()};
+  lambda xTime = [](auto&& request) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRequests; i++) request();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count() /
+           kRequests;
+  };
+  auto cold_us = xTime([&] {
+    std::istringstream in;
+    std::ostringstream out;
+    EXPECT_EQ(CandDriver::Main(args, in, out, out), 0);
+  });
+  DaemonTestServer server("benchmark");
+  EXPECT_EQ(CompilerDaemon::Request(server.socket, args).Value().exit_code,
+            0);
+  auto warm_us = xTime([&] {
+    EXPECT_EQ(CompilerDaemon::Request(server.socket, args).Value().exit_code,
+              0);
+  });
+  std::cout << "[Compiler Daemon Benchmark] cold driver: " << cold_us
+            << "us, warm daemon: " << warm_us << "us per request, in memory: "
+            << server.daemon.Cache().SizeInMemory() << " bytes" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_compiler_daemon.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_COMPILER_DAEMON_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,197 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_fuzz_targets.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_FUZZ_TARGETS_H
+#define HEADER_GUARD_CAOCO_UT0_FUZZ_TARGETS_H
+// Includes:
+#include "cand_driver.h"
+#include "evaluator.h"
+#include "fuzz_targets.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_FUZZ_TARGETS true
+
+#if CAOCO_TEST_FUZZ_TARGETS
+#define CAOCO_TEST_FUZZ_TARGETS_Seeds 1
+#define CAOCO_TEST_FUZZ_TARGETS_Growth 1
+#define CAOCO_TEST_FUZZ_TARGETS_Superlinear 1
+#define CAOCO_TEST_FUZZ_TARGETS_EvaluatorLimits 1
+#define CAOCO_TEST_FUZZ_TARGETS_Benchmark 1
+#endif
+
+// Stand-ins for a target whose time is linear or quadratic in its input.
+void FuzzTestLinearTarget(std::string_view input) {
+  std::size_t sum = 0;
+  for (int pass = 0; pass < 64; pass++) {
+    for (char c : input) sum += static_cast<unsigned char>(c);
+  }
+  minitest::DoNotOptimize(sum);
+}
+
+void FuzzTestQuadraticTarget(std::string_view input) {
+  std::size_t sum = 0;
+  for (std::size_t i = 0; i < input.size(); i++) {
+    for (std::size_t j = i; j < input.size(); j++) {
+      sum += static_cast<unsigned char>(input[j]);
+    }
+  }
+  minitest::DoNotOptimize(sum);
+}
+
+#if CAOCO_TEST_FUZZ_TARGETS_Seeds
+// Every target takes every seed and regression case, and inputs which fail
+// to lex or parse.
+MINITEST(TestFuzzTargets, TestCaseSeeds) {
+  auto seeds = FuzzRunner::LoadCorpus("fuzz_corpus");
+  ASSERT_TRUE(seeds.Valid());
+  EXPECT_TRUE(seeds.Value().size() >= 10);
+  // Inputs the runner found superlinear, such as deeply nested parentheses.
+  auto regressions = FuzzRunner::LoadCorpus("perf_regressions");
+  ASSERT_TRUE(regressions.Valid());
+  EXPECT_TRUE(!regressions.Value().empty());
+  EXPECT_FALSE(FuzzRunner::LoadCorpus("no_such_fuzz_corpus").Valid());
+  EXPECT_TRUE(FuzzTargets::Find("lexer") == nullptr);
+  for (std::string_view name : {"lex", "parse", "irgen", "evaluate"}) {
+    const FuzzTarget* target = FuzzTargets::Find(name);
+    ASSERT_TRUE(target != nullptr);
+    EXPECT_EQ(target->name, name);
+    for (const auto& seed : seeds.Value()) {
+      EXPECT_NO_THROW([&]() { target->run(seed); });
+    }
+    for (const auto& regression : regressions.Value()) {
+      EXPECT_NO_THROW([&]() { target->run(regression); });
+    }
+    for (std::string_view bad : {"", "\xff\xfe", "def @a: ((1;", "main: {",
+                                 "fn@f(a):{ return f(a); }; main:{ f(1); };",
+                                 "main: { while(1){}; };"}) {
+      EXPECT_NO_THROW([&]() { target->run(bad); });
+    }
+  }
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_FUZZ_TARGETS_Growth
+MINITEST(TestFuzzTargets, TestCaseGrowth) {
+  EXPECT_EQ(FuzzGrowth::Repeat("ab;", 3), "ab;ab;ab;");
+  EXPECT_EQ(FuzzGrowth::Repeat("ab;", 0), "");
+  EXPECT_EQ(FuzzGrowth::Nest("def @a: (1 + (2));", 3).value_or(""),
+            "def @a: (((1 + (2))));");
+  EXPECT_EQ(FuzzGrowth::Nest("main: {f[0];};", 2).value_or(""),
+            "main: {{f[0];}};");
+  EXPECT_FALSE(FuzzGrowth::Nest("def @a: 1;", 4).has_value());
+  EXPECT_FALSE(FuzzGrowth::Nest("def @a: (1;", 4).has_value());
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_FUZZ_TARGETS_Superlinear
+MINITEST(TestFuzzTargets, TestCaseSuperlinear) {
+  auto dir = std::filesystem::temp_directory_path() / "caoco-fuzz-test";
+  std::filesystem::remove_all(dir);
+  std::string input = "def @a: (1 + 2);";
+
+  FuzzTarget linear{"linear", &FuzzTestLinearTarget};
+  FuzzRunner linear_runner(linear, {.regressions = dir});
+  EXPECT_FALSE(linear_runner.Probe(input).has_value());
+
+  FuzzTarget quadratic{"quadratic", &FuzzTestQuadraticTarget};
+  FuzzRunner quadratic_runner(quadratic, {.runs = 50, .regressions = dir});
+  auto slow = quadratic_runner.Probe(input);
+  ASSERT_TRUE(slow.has_value());
+  EXPECT_EQ(slow->growth, "repeat");
+  EXPECT_EQ(slow->input.size(), input.size() * 64 * 8);  // Of 1024 bytes.
+  EXPECT_TRUE(slow->ratio > 3.0);
+
+  // Seeds are always probed.
+  const auto& stats = quadratic_runner.Fuzz({input});
+  EXPECT_EQ(stats.execs, 51);
+  EXPECT_TRUE(stats.ExecsPerSecond() > 0);
+  ASSERT_TRUE(!stats.slow.empty());
+  ASSERT_TRUE(stats.slow.front().path.has_value());
+  EXPECT_TRUE(std::filesystem::exists(*stats.slow.front().path));
+  EXPECT_TRUE(stats.slow.front().path->filename().string().starts_with(
+      "quadratic-repeat-"));
+  std::filesystem::remove_all(dir);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_FUZZ_TARGETS_EvaluatorLimits
+MINITEST(TestFuzzTargets, TestCaseEvaluatorLimits) {
+  auto run = [](const std::string& source, EvaluatorLimits limits) {
+    Environment env;
+    std::istringstream in;
+    std::ostringstream out;
+    try {
+      Evaluator{env, in, out}
+          .EnableJit(false)
+          .SetLimits(limits)
+          .Evaluate(IrTestGenerate(source));
+    } catch (const std::runtime_error& e) {
+      return std::string(e.what());
+    }
+    return std::string();
+  };
+  EXPECT_EQ(run("main: { while(true){}; };", {.dispatches = 1000}),
+            kEvaluatorErrorDispatchLimit);
+  // Calls f depth + 1 times.
+  auto calls = [](int depth) {
+    return "def @total: 0;"
+           "fn@f(a):{ if(a == 0){ return 0; }; return 1 + f(a - 1); };"
+           "main: { total = f(" +
+           std::to_string(depth) + "); };";
+  };
+  EXPECT_EQ(run(calls(15), {.dispatches = 100000, .frames = 16}), "");
+  EXPECT_EQ(run(calls(16), {.frames = 16}), kEvaluatorErrorFrameLimit);
+  EXPECT_EQ(run(calls(100), {}), "");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_FUZZ_TARGETS_Benchmark
+// The throughput of each target on mutations of the seeds, through the
+// driver command.
+MINITEST(TestFuzzTargets, TestCaseBenchmark) {
+  for (std::string target : {"lex", "parse", "irgen", "evaluate"}) {
+    std::istringstream in;
+    std::ostringstream out;
+    std::ostringstream err;
+    int exit_code = CandDriver::Main(
+        {"fuzz", target, "fuzz_corpus", "--runs", "2000"}, in, out, err);
+    EXPECT_EQ(err.str(), "");
+    auto report = out.str();
+    EXPECT_TRUE(report.find("[Fuzz " + target + "] execs: ") !=
+                std::string::npos);
+    std::cout << report;
+    if (exit_code != 0) std::cout << "Found superlinear inputs." << std::endl;
+  }
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_fuzz_targets.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_FUZZ_TARGETS_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,203 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_control_flow.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_IR_CONTROL_FLOW_H
+#define HEADER_GUARD_CAOCO_UT0_IR_CONTROL_FLOW_H
+// Includes:
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "ir_optimizer.h"
+#include "system_io.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_IR_CONTROL_FLOW true
+
+#if CAOCO_TEST_IR_CONTROL_FLOW
+#define CAOCO_TEST_IR_CONTROL_FLOW_Loops 1
+#define CAOCO_TEST_IR_CONTROL_FLOW_Branches 1
+#define CAOCO_TEST_IR_CONTROL_FLOW_Methods 1
+#define CAOCO_TEST_IR_CONTROL_FLOW_AnimalSounds 1
+#define CAOCO_TEST_IR_CONTROL_FLOW_Benchmark 1
+#endif
+
+#if CAOCO_TEST_IR_CONTROL_FLOW_Loops
+MINITEST(TestIrControlFlow, TestCaseLoops) {
+  auto code = IrTestGenerate(
+      "def @sum: 0; def @evens: 0;"
+      "main: {"
+      "  def @i: 0;"
+      "  while(i < 10){ sum += i; i++; };"
+      "  for(def @j: 0; j < 6; j++){ if(j % 2 == 0){ evens++; } };"
+      "};");
+  EXPECT_FALSE(code.isAborted());
+  EXPECT_TRUE(IrVerifier::Verify(code).Valid());
+  EXPECT_EQ(IrTestCount(code, eIrOp::JUMP_IF_FALSE), 3);
+  EXPECT_EQ(IrTestCount(code, eIrOp::ENTER_SCOPE),
+            IrTestCount(code, eIrOp::EXIT_SCOPE));
+
+  Environment env;
+  Evaluator{env}.Evaluate(code);
+  EXPECT_EQ(env.LookupVariable("sum")->GetInt(), 45);
+  EXPECT_EQ(env.LookupVariable("evens")->GetInt(), 3);
+  // Scopes of main and the loops are gone after evaluation.
+  EXPECT_TRUE(env.subenvs.empty());
+
+  // Jump targets must be the start of a statement, not an operand.
+  auto broken = code;
+  for (auto& line : broken.GetLines()) {
+    if (line.op == eIrOp::JUMP_IF_FALSE) {
+      line.args[0] = static_cast<IrInt>(line.index) + 1;
+      break;
+    }
+  }
+  EXPECT_FALSE(IrVerifier::Verify(broken).Valid());
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_CONTROL_FLOW_Branches
+MINITEST(TestIrControlFlow, TestCaseBranches) {
+  auto code = IrTestGenerate(
+      "def @x: 7; def @a: 0; def @b: 0; def @c: 0;"
+      "main: {"
+      "  if(x > 10){ a = 1; } elif(x > 5){ a = 2; } else { a = 3; }"
+      "  if(x == 1){ b = 1; } elif(!(x == 7)){ b = 2; } else { b = 3; }"
+      "  if((x > 1) && (x < 3)){ c = 1; }"
+      "  c = c + 10;"
+      "};");
+  EXPECT_TRUE(IrVerifier::Verify(code).Valid());
+  Environment env;
+  Evaluator{env}.Evaluate(code);
+  EXPECT_EQ(env.LookupVariable("a")->GetInt(), 2);
+  EXPECT_EQ(env.LookupVariable("b")->GetInt(), 3);
+  EXPECT_EQ(env.LookupVariable("c")->GetInt(), 10);
+
+  // Conditions must be bools.
+  auto not_bool = IrTestGenerate("main: { if(1){ 2; } };");
+  Environment not_bool_env;
+  EXPECT_ANY_THROW(
+      [&]() { Evaluator{not_bool_env}.Evaluate(not_bool); });
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_CONTROL_FLOW_Methods
+MINITEST(TestIrControlFlow, TestCaseMethodsAndObjects) {
+  auto code = IrTestGenerate(
+      "def @count: 0;"
+      "fn@bump:{ count += 1; return count; };"
+      "class @Counter:{ def @n: 5; fn@next:{ n = n + 1; return n; }; };"
+      "main: {"
+      "  bump(); bump();"
+      "  def @c: Counter(); c.next();"
+      "  def @other: Counter();"
+      "  count = count + c.next() * 10 + other.next();"
+      "  return;"
+      "  count = 0;"
+      "};");
+  EXPECT_FALSE(code.isAborted());
+  EXPECT_TRUE(IrVerifier::Verify(code).Valid());
+  Environment env;
+  Evaluator{env}.Evaluate(code);
+  EXPECT_EQ(env.LookupVariable("count")->GetInt(), 2 + 70 + 6);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_CONTROL_FLOW_AnimalSounds
+// The example program runs with scripted input, with and without the
+// standard optimization pipeline.
+MINITEST(TestIrControlFlow, TestCaseAnimalSounds) {
+  auto source = LoadFileToVec("animal_sounds1.cand");
+  auto code = IrTestGenerate(std::string(source.begin(), source.end()));
+  EXPECT_FALSE(code.isAborted());
+  auto optimized = code;
+  auto optimize_result = IrPassManager::StandardPipeline().Run(optimized);
+  EXPECT_TRUE(optimize_result.Valid());
+  if (!optimize_result) std::cout << optimize_result.Error() << std::endl;
+
+  const std::string prompt =
+      "What animal sound do you want to hear? Say none if you are done.\n";
+  const std::string expected =
+      "Welcome to the animal sound generator!\n" + prompt + "Howl!\n" +
+      prompt + "Yip!\n" + prompt + "I dont know that animal.\n" + prompt +
+      "Goodbye!\n";
+  for (const IrCode* ir : {&code, &optimized}) {
+    std::istringstream in("husky\npoodle\ncat\nnone\n");
+    std::ostringstream out;
+    Environment env;
+    Evaluator{env, in, out}.Evaluate(*ir);
+    EXPECT_EQ(out.str(), expected);
+  }
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_CONTROL_FLOW_Benchmark
+// Runtime of a loop with loop invariant literals and repeated expressions,
+// with and without the standard pipeline.
+MINITEST(TestIrControlFlow, TestCaseBenchmark) {
+  auto code = IrTestGenerate(
+      "def @total: 0;"
+      "main: {"
+      "  def @i: 0;"
+      "  while(i < 2000){"
+      "    def @k: 3 * 4 + 1;"
+      "    def @step: k;"
+      "    def @t: (i * step + 1) * (i * step + 1) - (i * step + 1) % 7;"
+      "    total = total + t % 1000;"
+      "    i++;"
+      "  };"
+      "};");
+  auto optimized = code;
+  auto manager = IrPassManager::StandardPipeline();
+  EXPECT_TRUE(manager.Run(optimized).Valid());
+
+  lambda xTimeEvaluation = [&](const IrCode& ir, int& total) {
+    auto start = std::chrono::steady_clock::now();
+    Environment env;
+    Evaluator{env}.Evaluate(ir);
+    total = env.LookupVariable("total")->GetInt();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  int unoptimized_total = 0;
+  int optimized_total = 0;
+  auto unoptimized_us = xTimeEvaluation(code, unoptimized_total);
+  auto optimized_us = xTimeEvaluation(optimized, optimized_total);
+
+  EXPECT_EQ(unoptimized_total, optimized_total);
+  EXPECT_TRUE(optimized.Size() < code.Size());
+  std::cout << "[IR Control Flow Benchmark] lines: " << code.Size() << " -> "
+            << optimized.Size() << ", evaluation: " << unoptimized_us
+            << "us -> " << optimized_us << "us" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_control_flow.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_IR_CONTROL_FLOW_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,156 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_escape.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_IR_ESCAPE_H
+#define HEADER_GUARD_CAOCO_UT0_IR_ESCAPE_H
+// Includes:
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "ir_escape.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_IR_ESCAPE true
+
+#if CAOCO_TEST_IR_ESCAPE
+#define CAOCO_TEST_IR_ESCAPE_Analysis 1
+#define CAOCO_TEST_IR_ESCAPE_Evaluation 1
+#define CAOCO_TEST_IR_ESCAPE_Benchmark 1
+#endif
+
+// Classes of the allocations of a program which do not escape, in order.
+std::string IrEscapeTestLocals(const std::string& source) {
+  auto code = IrTestGenerate(source);
+  std::vector<const IrLine*> index;
+  for (const auto& line : code.GetLines()) index.push_back(&line);
+  auto local = IrEscapeAnalysis::Run(index);
+  std::string result;
+  for (std::size_t i = 0; i < index.size(); i++) {
+    if (local[i]) result += std::get<IrString>(index[i]->args[0]) + " ";
+  }
+  return result;
+}
+
+#if CAOCO_TEST_IR_ESCAPE_Analysis
+MINITEST(TestIrEscape, TestCaseAnalysis) {
+  // dog is only a receiver. pet is passed, kept and returned.
+  EXPECT_EQ(IrEscapeTestLocals("class @Poodle:{"
+                               "  fn@makeSound:{ return 'Yip'; }; };"
+                               "def @kept: 0;"
+                               "fn@keep(p):{ kept = p; return p; };"
+                               "fn@make:{ def @pet: Poodle(); return pet; };"
+                               "main: {"
+                               "  def @dog: Poodle(); cout(dog.makeSound());"
+                               "  dog = Poodle();"
+                               "  def @pet: Poodle(); keep(pet);"
+                               "};"),
+            "Poodle Poodle ");
+
+  // Calls which are not allocations, and allocations which are not stored.
+  EXPECT_EQ(IrEscapeTestLocals("class @A:{ fn@get:{ return 1; }; };"
+                               "fn@f:{ return 2; };"
+                               "main: { def @x: f(); def @y: A().get(); };"),
+            "");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_ESCAPE_Evaluation
+MINITEST(TestIrEscape, TestCaseEvaluation) {
+  // Instances of a loop reuse one instance. The members of each are
+  // initialized again, and an instance still referred to is not reused.
+  auto code = IrTestGenerate(
+      "def @total: 0; def @keep: 0;"
+      "class @Counter:{ def @n: 1; fn@bump:{ n = n + 1; return n; }; };"
+      "fn@deep(k):{"
+      "  def @c: Counter(); c.bump();"
+      "  if(k > 0){ deep(k - 1); };"
+      "  total = total + c.bump();"
+      "  return 0;"
+      "};"
+      "main: {"
+      "  for(def @i: 0; i < 50; i++){"
+      "    def @c: Counter(); total = total + c.bump() + c.bump();"
+      "  };"
+      "  deep(3);"
+      "  keep = Counter();"
+      "};");
+  ASSERT_FALSE(code.isAborted());
+  Environment env;
+  Evaluator local{env};
+  local.Evaluate(code);
+  Environment heap_env;
+  Evaluator heap{heap_env};
+  heap.EnableEscapeAnalysis(false).Evaluate(code);
+  EXPECT_EQ(env.LookupVariable("total")->GetInt(), 50 * 5 + 4 * 3);
+  EXPECT_EQ(env.LookupVariable("total")->GetInt(),
+            heap_env.LookupVariable("total")->GetInt());
+  EXPECT_EQ(heap.ObjectAllocations(), 55);
+  // One for the loop, one for each nested frame of deep, and keep.
+  EXPECT_EQ(local.ObjectAllocations(), 6);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_ESCAPE_Benchmark
+// Short lived instances constructed in a loop, with and without reuse.
+MINITEST(TestIrEscape, TestCaseBenchmark) {
+  auto code = IrTestGenerate(
+      "def @total: 0;"
+      "class @Vec:{ def @x: 3; def @y: 4; def @name: 'vec';"
+      "  fn@len:{ return x + y; }; };"
+      "main: {"
+      "  for(def @i: 0; i < 5000; i++){"
+      "    def @v: Vec(); total = total + v.len();"
+      "  };"
+      "};");
+  lambda xTime = [&](bool escape, int& total, std::size_t& allocations) {
+    auto start = std::chrono::steady_clock::now();
+    Environment env;
+    Evaluator evaluator{env};
+    evaluator.EnableEscapeAnalysis(escape).Evaluate(code);
+    total = env.LookupVariable("total")->GetInt();
+    allocations = evaluator.ObjectAllocations();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  int heap_total = 0;
+  int local_total = 0;
+  std::size_t heap_allocations = 0;
+  std::size_t local_allocations = 0;
+  auto heap_us = xTime(false, heap_total, heap_allocations);
+  auto local_us = xTime(true, local_total, local_allocations);
+  EXPECT_EQ(local_total, heap_total);
+  EXPECT_EQ(local_allocations, 1);
+  std::cout << "[IR Escape Benchmark] allocations: " << heap_allocations
+            << " -> " << local_allocations << ", evaluation: " << heap_us
+            << "us -> " << local_us << "us" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_escape.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_IR_ESCAPE_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,197 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_inliner.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_IR_INLINER_H
+#define HEADER_GUARD_CAOCO_UT0_IR_INLINER_H
+// Includes:
+#include "evaluator.h"
+#include "ir_cfg.h"
+#include "ir_codegen.h"
+#include "ir_inliner.h"
+#include "ir_optimizer.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_IR_INLINER true
+
+#if CAOCO_TEST_IR_INLINER
+#define CAOCO_TEST_IR_INLINER_Devirtualization 1
+#define CAOCO_TEST_IR_INLINER_Functions 1
+#define CAOCO_TEST_IR_INLINER_Benchmark 1
+#endif
+
+// Inlines the code in place. Returns the number of inlined call sites.
+std::size_t IrInlinerTestRun(IrCode& code) {
+  auto cfg = IrCfg::Decode(code);
+  auto inlined = IrInliner::Run(cfg);
+  code = cfg.Encode();
+  return inlined;
+}
+
+std::size_t IrInlinerTestCalls(const IrCode& code) {
+  return IrTestCount(code, eIrOp::CALL) + IrTestCount(code, eIrOp::CALL_MEMBER);
+}
+
+#if CAOCO_TEST_IR_INLINER_Devirtualization
+MINITEST(TestIrInliner, TestCaseDevirtualization) {
+  auto code = IrTestGenerate(
+      "def @out: '';"
+      "class @Husky:{ def @sound: 'Woof'; def @mood: 'calm';"
+      "  fn@makeSound:{ return sound; };"
+      "  fn@getMood:{ return mood; };"
+      "  fn@bark:{ cout(sound); return 1; }; };"
+      "class @Poodle:{ fn@makeSound:{ return 'Yip'; }; };"
+      "main: {"
+      "  def @dog: Husky();"
+      "  def @pet: Husky(); pet = Poodle();"
+      "  def @mood: 'angry';"
+      "  out = dog.makeSound() + pet.makeSound() + dog.getMood();"
+      "  dog.bark();"
+      "};");
+  ASSERT_FALSE(code.isAborted());
+  Environment expected_env;
+  std::ostringstream sink;
+  Evaluator{expected_env, std::cin, sink}.Evaluate(code);
+
+  // Only dog is known to be a Husky. bark has side effects, and mood is
+  // written outside of the class.
+  auto calls = IrInlinerTestCalls(code);
+  EXPECT_EQ(IrInlinerTestRun(code), 1);
+  EXPECT_TRUE(IrVerifier::Verify(code).Valid());
+  EXPECT_EQ(IrInlinerTestCalls(code), calls - 1);
+  Environment env;
+  Evaluator{env, std::cin, sink}.Evaluate(code);
+  EXPECT_EQ(*env.LookupVariable("out")->GetString(),
+            *expected_env.LookupVariable("out")->GetString());
+  EXPECT_EQ(*env.LookupVariable("out")->GetString(), "WoofYipcalm");
+
+  // The standard pipeline folds an accessor of a constant to its literal.
+  auto folded = IrTestGenerate(
+      "def @out: '';"
+      "class @Husky:{ fn@makeSound:{ return 'Woof'; }; };"
+      "main: { def @dog: Husky(); out = dog.makeSound(); };");
+  EXPECT_TRUE(IrPassManager::StandardPipeline().Run(folded).Valid());
+  EXPECT_EQ(IrTestCount(folded, eIrOp::CALL_MEMBER), 0);
+  Environment folded_env;
+  Evaluator{folded_env}.Evaluate(folded);
+  EXPECT_EQ(*folded_env.LookupVariable("out")->GetString(), "Woof");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_INLINER_Functions
+MINITEST(TestIrInliner, TestCaseFunctions) {
+  auto code = IrTestGenerate(
+      "def @x: 0; def @y: 0; def @z: 0;"
+      "fn@sq(n):{ return n * n; };"
+      "fn@seven:{ return 7; };"
+      "fn@noisy(n):{ cout(n); return n; };"
+      "fn@sum(a, b):{ return a + b; };"
+      "fn@far(n):{ return n * n * n * n * n; };"
+      "main: {"
+      "  x = sq(3) + seven();"
+      "  y = sum(x, sq(2));"
+      "  z = sq(noisy(2)) + far(2);"
+      "};");
+  ASSERT_FALSE(code.isAborted());
+  Environment expected_env;
+  std::ostringstream expected_out;
+  Evaluator{expected_env, std::cin, expected_out}.Evaluate(code);
+
+  // sq(3), seven(), sq(2) then sum(). Impure arguments and bodies over the
+  // budget stay calls.
+  EXPECT_EQ(IrInlinerTestRun(code), 4);
+  EXPECT_EQ(IrTestCount(code, eIrOp::CALL), 4);
+  Environment env;
+  std::ostringstream out;
+  Evaluator{env, std::cin, out}.Evaluate(code);
+  for (const auto* name : {"x", "y", "z"}) {
+    EXPECT_EQ(env.LookupVariable(name)->GetInt(),
+              expected_env.LookupVariable(name)->GetInt());
+  }
+  EXPECT_EQ(out.str(), expected_out.str());
+
+  // Calls before the declaration, calls a member may resolve and calls
+  // with the wrong arity are left to fail or resolve at runtime.
+  auto kept = IrTestGenerate(
+      "def @early: later(); fn@later:{ return 1; };"
+      "fn@one:{ return 1; }; fn@two(n):{ return 2; };"
+      "class @C:{ fn@one:{ return 3; }; fn@get:{ return one(); }; };"
+      "main: { early = one() + two(); };");
+  ASSERT_FALSE(kept.isAborted());
+  EXPECT_EQ(IrInlinerTestRun(kept), 0);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_INLINER_Benchmark
+// Accessors and small helpers called in a loop, optimized with and without
+// the inline pass.
+MINITEST(TestIrInliner, TestCaseBenchmark) {
+  auto code = IrTestGenerate(
+      "def @total: 0;"
+      "class @Point:{ def @x: 3; def @y: 4;"
+      "  fn@getX:{ return x; }; fn@getY:{ return y; };"
+      "  fn@dot(a, b):{ return a * x + b * y; }; };"
+      "fn@twice(n):{ return n * 2; };"
+      "main: {"
+      "  def @p: Point(); def @i: 0;"
+      "  while(i < 2000){"
+      "    total = total + p.getX() * p.getY() + twice(i) + p.dot(i, 1);"
+      "    i++;"
+      "  };"
+      "};");
+  auto plain = code;
+  auto without = IrPassManager::StandardPipeline();
+  without.Disable("inline");
+  EXPECT_TRUE(without.Run(plain).Valid());
+  auto inlined = code;
+  EXPECT_TRUE(IrPassManager::StandardPipeline().Run(inlined).Valid());
+
+  lambda xTimeEvaluation = [&](const IrCode& ir, int& total) {
+    auto start = std::chrono::steady_clock::now();
+    Environment env;
+    Evaluator{env}.Evaluate(ir);
+    total = env.LookupVariable("total")->GetInt();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  int plain_total = 0;
+  int inlined_total = 0;
+  auto plain_us = xTimeEvaluation(plain, plain_total);
+  auto inlined_us = xTimeEvaluation(inlined, inlined_total);
+  EXPECT_EQ(inlined_total, plain_total);
+  EXPECT_EQ(IrInlinerTestCalls(inlined), 1);  // The constructor.
+  std::cout << "[IR Inliner Benchmark] calls: " << IrInlinerTestCalls(plain)
+            << " -> " << IrInlinerTestCalls(inlined)
+            << ", evaluation: " << plain_us << "us -> " << inlined_us << "us"
+            << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_inliner.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_IR_INLINER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,229 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_optimizer.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_IR_OPTIMIZER_H
+#define HEADER_GUARD_CAOCO_UT0_IR_OPTIMIZER_H
+// Includes:
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "ir_optimizer.h"
+#include "lark_parser.h"
+#include "lexer.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_IR_OPTIMIZER true
+
+#if CAOCO_TEST_IR_OPTIMIZER
+#define CAOCO_TEST_IR_OPTIMIZER_Verifier 1
+#define CAOCO_TEST_IR_OPTIMIZER_Passes 1
+#define CAOCO_TEST_IR_OPTIMIZER_PassManager 1
+#define CAOCO_TEST_IR_OPTIMIZER_Benchmark 1
+#endif
+
+#if CAOCO_TEST_IR_OPTIMIZER_Verifier
+MINITEST(TestIrOptimizer, TestCaseVerifier) {
+  auto code = IrTestGenerate("def @a: 1 + 2; def @b: a * (a - 3);");
+  auto verified = IrVerifier::Verify(code);
+  EXPECT_TRUE(verified.Valid());
+  if (!verified) std::cout << verified.Error() << std::endl;
+
+  // Operand range which does not match the extent of its expression.
+  auto broken = code;
+  std::next(broken.GetLines().begin(), 1)->args[3] = 2;
+  EXPECT_FALSE(IrVerifier::Verify(broken).Valid());
+
+  // Line indices must match their position.
+  broken = code;
+  broken.GetLines().back().index = 42;
+  EXPECT_FALSE(IrVerifier::Verify(broken).Valid());
+
+  // Operands must be expressions.
+  broken = code;
+  std::next(broken.GetLines().begin(), 2)->op = eIrOp::DEFINE_VARIABLE;
+  EXPECT_FALSE(IrVerifier::Verify(broken).Valid());
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_OPTIMIZER_Passes
+MINITEST(TestIrOptimizer, TestCaseLiteralFolding) {
+  auto code = IrTestGenerate("def @a: 1 + 2 * 3; def @b: 7 / 0;");
+  EXPECT_TRUE(IrLiteralFoldingPass{}.Run(code));
+  EXPECT_TRUE(IrVerifier::Verify(code).Valid());
+  // 7 / 0 is left for the runtime to report.
+  EXPECT_EQ(IrTestCount(code, eIrOp::BINARY_MUL), 0);
+  EXPECT_EQ(IrTestCount(code, eIrOp::BINARY_DIV), 1);
+  EXPECT_EQ(std::get<IrInt>(std::next(code.GetLines().begin(), 2)->args[0]),
+            7);
+}
+END_MINITEST;
+
+MINITEST(TestIrOptimizer, TestCaseCopyPropagation) {
+  auto code = IrTestGenerate(
+      "def @a: 2; def @b: a; def @c: b * 3; def @d: 'x'; def @e: d + d;");
+  EXPECT_TRUE(IrCopyPropagationPass{}.Run(code));
+  EXPECT_TRUE(IrLiteralFoldingPass{}.Run(code));
+  EXPECT_EQ(IrTestCount(code, eIrOp::LOAD_VARIABLE), 0);
+
+  Environment env;
+  Evaluator{env}.Evaluate(code);
+  EXPECT_EQ(env.LookupVariable("c")->GetInt(), 6);
+  EXPECT_EQ(*env.LookupVariable("e")->GetString(), "xx");
+}
+END_MINITEST;
+
+MINITEST(TestIrOptimizer, TestCaseLocalCse) {
+  auto code = IrTestGenerate(
+      "def @x; def @y; def @c: (x + y) * (x + y); def @d: x + y; def @e: "
+      "c - 1; def @f: c - 1;");
+  EXPECT_TRUE(IrLocalCsePass{}.Run(code));
+  EXPECT_TRUE(IrVerifier::Verify(code).Valid());
+  // x + y is computed once into a temporary, c - 1 is reused from e.
+  EXPECT_EQ(IrTestCount(code, eIrOp::BINARY_ADD), 1);
+  EXPECT_EQ(IrTestCount(code, eIrOp::BINARY_SUB), 1);
+  EXPECT_EQ(IrTestCount(code, eIrOp::DECLARE_VARIABLE), 7);
+}
+END_MINITEST;
+
+MINITEST(TestIrOptimizer, TestCaseDeadCodeElimination) {
+  IrCode code;
+  code.AddLine(0, eIrOp::ENTER_PROGRAM_DEFINITION, kIrOpNullArguments);
+  code.AddLine(1, eIrOp::DECLARE_VARIABLE, {kIrTypeConstraintAny, "a", 2, 2});
+  code.AddLine(2, eIrOp::ALLOCATE_LITERAL, {1});
+  code.AddLine(3, eIrOp::DEFINE_VARIABLE, {"a", 4, 4});  // Dead store.
+  code.AddLine(4, eIrOp::ALLOCATE_LITERAL, {2});
+  code.AddLine(5, eIrOp::DEFINE_VARIABLE, {"a", 6, 6});
+  code.AddLine(6, eIrOp::ALLOCATE_LITERAL, {3});
+  code.AddLine(7, eIrOp::ALLOCATE_LITERAL, {4});  // Unused expression.
+  code.AddLine(8, eIrOp::DECLARE_VARIABLE,        // Unused temporary.
+               {kIrTypeConstraintAny, "%t", 9, 9});
+  code.AddLine(9, eIrOp::LOAD_VARIABLE, {"a"});
+  EXPECT_TRUE(IrVerifier::Verify(code).Valid());
+  EXPECT_TRUE(IrDeadCodeEliminationPass{}.Run(code));
+  EXPECT_TRUE(IrVerifier::Verify(code).Valid());
+  EXPECT_EQ(code.Size(), 5);
+
+  Environment env;
+  Evaluator{env}.Evaluate(code);
+  EXPECT_EQ(env.LookupVariable("a")->GetInt(), 3);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_OPTIMIZER_PassManager
+MINITEST(TestIrOptimizer, TestCasePassManager) {
+  const std::string source = "def @a: 2; def @b: a * 3; def @c: a * 3 + b;";
+  auto manager = IrPassManager::StandardPipeline();
+  EXPECT_FALSE(manager.Disable("no-such-pass"));
+
+  // All passes disabled leaves the code untouched.
+  for (const auto& timing : manager.Timings()) {
+    EXPECT_TRUE(manager.Disable(timing.name));
+  }
+  auto code = IrTestGenerate(source);
+  auto unoptimized_size = code.Size();
+  EXPECT_TRUE(manager.Run(code).Valid());
+  EXPECT_EQ(code.Size(), unoptimized_size);
+
+  manager.Enable("copy-propagation");
+  manager.Enable("literal-folding");
+  EXPECT_TRUE(manager.Run(code).Valid());
+  EXPECT_TRUE(manager.IsEnabled("literal-folding"));
+  EXPECT_FALSE(manager.IsEnabled("local-cse"));
+  EXPECT_EQ(code.Size(), 7);  // Program entry and 3 literal declarations.
+  for (const auto& timing : manager.Timings()) {
+    EXPECT_EQ(timing.runs > 0, timing.enabled);
+  }
+  manager.PrintTimings();
+
+  Environment env;
+  Evaluator{env}.Evaluate(code);
+  EXPECT_EQ(env.LookupVariable("c")->GetInt(), 12);
+
+  // Aborted code is not optimized.
+  auto aborted = IrTestGenerate("def @a: 1; def @b: a.x;");
+  EXPECT_TRUE(aborted.isAborted());
+  auto aborted_size = aborted.Size();
+  EXPECT_TRUE(manager.Run(aborted).Valid());
+  EXPECT_EQ(aborted.Size(), aborted_size);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_OPTIMIZER_Benchmark
+// Runtime of an arithmetic heavy script with and without the standard
+// pipeline. The script has literal chains, copies and repeated expressions.
+MINITEST(TestIrOptimizer, TestCaseBenchmark) {
+  std::string source = "def @seed: 3;";
+  for (int i = 0; i < 200; i++) {
+    auto n = std::to_string(i);
+    source += "def @k" + n + ": seed * 4 + " + n + ";";
+    source += "def @c" + n + ": k" + n + ";";
+    source += "def @v" + n + ": (c" + n + " * 2 + 1) * (c" + n +
+              " * 2 + 1) - (c" + n + " * 2 + 1) % 7;";
+  }
+  auto code = IrTestGenerate(source);
+  auto optimized = code;
+  auto manager = IrPassManager::StandardPipeline();
+  auto optimize_result = manager.Run(optimized);
+  EXPECT_TRUE(optimize_result.Valid());
+  if (!optimize_result) std::cout << optimize_result.Error() << std::endl;
+
+  constexpr int kRuns = 20;
+  lambda xTimeEvaluation = [&](const IrCode& ir, std::vector<int>& results) {
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < kRuns; run++) {
+      Environment env;
+      Evaluator{env}.Evaluate(ir);
+      if (run + 1 == kRuns) {
+        for (int i = 0; i < 200; i++) {
+          results.push_back(
+              env.LookupVariable("v" + std::to_string(i))->GetInt());
+        }
+      }
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count() /
+           kRuns;
+  };
+  std::vector<int> unoptimized_results;
+  std::vector<int> optimized_results;
+  auto unoptimized_us = xTimeEvaluation(code, unoptimized_results);
+  auto optimized_us = xTimeEvaluation(optimized, optimized_results);
+
+  EXPECT_TRUE(unoptimized_results == optimized_results);
+  EXPECT_TRUE(optimized.Size() < code.Size());
+  std::cout << "[IR Optimizer Benchmark] lines: " << code.Size() << " -> "
+            << optimized.Size() << ", evaluation: " << unoptimized_us
+            << "us -> " << optimized_us << "us" << std::endl;
+  manager.PrintTimings();
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_optimizer.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_IR_OPTIMIZER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,251 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_ssa.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_IR_SSA_H
+#define HEADER_GUARD_CAOCO_UT0_IR_SSA_H
+// Includes:
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "ir_optimizer.h"
+#include "ir_ssa.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_IR_SSA true
+
+#if CAOCO_TEST_IR_SSA
+#define CAOCO_TEST_IR_SSA_Construction 1
+#define CAOCO_TEST_IR_SSA_Sccp 1
+#define CAOCO_TEST_IR_SSA_Licm 1
+#define CAOCO_TEST_IR_SSA_Benchmark 1
+#endif
+
+// First live instruction of the function with the given op.
+std::optional<SsaId> SsaTestFind(const SsaFunction& fn, eSsaOp op) {
+  for (auto block : fn.layout) {
+    for (auto id : fn.blocks[block].insts) {
+      if (fn.insts[id].op == op) return id;
+    }
+  }
+  return std::nullopt;
+}
+
+#if CAOCO_TEST_IR_SSA_Construction
+MINITEST(TestIrSsa, TestCaseConstruction) {
+  auto code = IrTestGenerate(
+      "def @sum: 0;"
+      "main: { def @i: 0; while(i < 10){ sum += i; i++; }; };");
+  auto module = SsaBuilder::Build(code);
+  EXPECT_TRUE(module.supported);
+  ASSERT_EQ(module.functions.size(), 1);
+  const auto& fn = module.functions[0];
+
+  // i is promoted with a phi at the loop header, sum stays in memory.
+  EXPECT_FALSE(SsaTestFind(fn, eSsaOp::kVarLoad).has_value());
+  EXPECT_FALSE(SsaTestFind(fn, eSsaOp::kVarStore).has_value());
+  EXPECT_TRUE(SsaTestFind(fn, eSsaOp::kStore).has_value());
+  auto phi = SsaTestFind(fn, eSsaOp::kPhi);
+  auto store = SsaTestFind(fn, eSsaOp::kStore);
+  ASSERT_TRUE(phi.has_value() && store.has_value());
+  auto header = fn.insts[*phi].block;
+  auto body = fn.insts[*store].block;
+  EXPECT_EQ(fn.insts[*phi].operands.size(), 2);
+
+  SsaDominatorTree dom(fn);
+  EXPECT_TRUE(dom.Dominates(0, header));
+  EXPECT_TRUE(dom.Dominates(header, body));
+  EXPECT_FALSE(dom.Dominates(body, header));
+
+  SsaUses uses(fn);
+  EXPECT_TRUE(std::any_of(
+      uses.Users(*phi).begin(), uses.Users(*phi).end(), [&](SsaId user) {
+        return fn.insts[user].op == eSsaOp::kBinary &&
+               fn.insts[user].ir_op == eIrOp::BINARY_LT;
+      }));
+
+  SsaLiveness liveness(fn);
+  EXPECT_FALSE(liveness.IsLiveIn(*phi, header));
+  EXPECT_TRUE(liveness.IsLiveOut(*phi, header));
+  EXPECT_TRUE(liveness.IsLiveIn(*phi, body));
+
+  // Lowered without optimizations, the program still runs.
+  auto lowered = SsaLowering::Lower(module);
+  EXPECT_TRUE(IrVerifier::Verify(lowered).Valid());
+  Environment env;
+  Evaluator{env}.Evaluate(lowered);
+  EXPECT_EQ(env.LookupVariable("sum")->GetInt(), 45);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_SSA_Sccp
+MINITEST(TestIrSsa, TestCaseSccpAndGvn) {
+  auto code = IrTestGenerate(
+      "def @r: 0; def @q: 0;"
+      "fn@seed:{ return 3; };"
+      "main: {"
+      "  def @x: 4; def @y: x * 2;"
+      "  if(y > 5){ r = y + 1; } else { r = 0; }"
+      "  def @s: seed();"
+      "  q = s * 7 + s * 7;"
+      "};");
+  auto optimized = SsaOptimizer::Optimize(code);
+  ASSERT_TRUE(optimized.has_value());
+  EXPECT_TRUE(IrVerifier::Verify(*optimized).Valid());
+  // The branch is decided at compile time, s * 7 is computed once.
+  EXPECT_EQ(IrTestCount(*optimized, eIrOp::JUMP_IF_FALSE), 0);
+  EXPECT_EQ(IrTestCount(*optimized, eIrOp::BINARY_MUL), 1);
+
+  Environment env;
+  Evaluator{env}.Evaluate(*optimized);
+  EXPECT_EQ(env.LookupVariable("r")->GetInt(), 9);
+  EXPECT_EQ(env.LookupVariable("q")->GetInt(), 42);
+
+  // The rhs of && only runs when the lhs is true.
+  auto guarded = IrTestGenerate(
+      "def @d: 0; def @r: 0;"
+      "main: { def @n: 10; if((d != 0) && (n / d > 1)){ r = 1; } };");
+  auto guarded_optimized = SsaOptimizer::Optimize(guarded);
+  ASSERT_TRUE(guarded_optimized.has_value());
+  Environment guarded_env;
+  EXPECT_NO_THROW(
+      [&]() { Evaluator{guarded_env}.Evaluate(*guarded_optimized); });
+  EXPECT_EQ(guarded_env.LookupVariable("r")->GetInt(), 0);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_SSA_Licm
+MINITEST(TestIrSsa, TestCaseLicm) {
+  auto code = IrTestGenerate(
+      "def @r: 0;"
+      "main: {"
+      "  def @s: 0;"
+      "  for(def @j: 0; j < 3; j++){ s = s + j; };"
+      "  def @z: 0;"
+      "  def @i: 0;"
+      "  while(i < 50){ r = r + s * 7; i++; };"
+      "  while(i < 0){ r = 1 / z; };"
+      "};");
+  auto module = SsaBuilder::Build(code);
+  auto& fn = module.functions[0];
+  SsaOptimizer::Optimize(fn);
+
+  // s * 7 can't throw, s is an int, so it leaves the loop. 1 / z divides
+  // by zero and must stay in a loop which never runs.
+  fn.RebuildPredecessors();
+  SsaDominatorTree dom(fn);
+  auto loops = SsaLoops::Find(fn, dom);
+  EXPECT_EQ(loops.size(), 3);
+  lambda xInLoop = [&](SsaId id) {
+    return std::any_of(loops.begin(), loops.end(), [&](const SsaLoop& loop) {
+      return loop.body[fn.insts[id].block];
+    });
+  };
+  std::size_t multiplications = 0;
+  std::size_t divisions = 0;
+  for (auto block : fn.layout) {
+    for (auto id : fn.blocks[block].insts) {
+      const auto& inst = fn.insts[id];
+      if (inst.op != eSsaOp::kBinary) continue;
+      if (inst.ir_op == eIrOp::BINARY_MUL) {
+        multiplications++;
+        EXPECT_FALSE(xInLoop(id));
+      } else if (inst.ir_op == eIrOp::BINARY_DIV) {
+        divisions++;
+        EXPECT_TRUE(xInLoop(id));
+      }
+    }
+  }
+  EXPECT_EQ(multiplications, 1);
+  EXPECT_EQ(divisions, 1);
+
+  auto lowered = SsaLowering::Lower(module);
+  EXPECT_TRUE(IrVerifier::Verify(lowered).Valid());
+  Environment env;
+  EXPECT_NO_THROW([&]() { Evaluator{env}.Evaluate(lowered); });
+  EXPECT_EQ(env.LookupVariable("r")->GetInt(), 50 * 21);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_SSA_Benchmark
+// Runtime of a loop heavy script with the block local passes only, and with
+// the ssa pass added.
+MINITEST(TestIrSsa, TestCaseBenchmark) {
+  auto code = IrTestGenerate(
+      "def @total: 0;"
+      "main: {"
+      "  def @scale: 0;"
+      "  for(def @j: 0; j < 4; j++){ scale = scale + j; };"
+      "  for(def @i: 0; i < 300; i++){"
+      "    def @row: i * scale;"
+      "    def @k: 0;"
+      "    while(k < 10){"
+      "      def @cell: row + k * (scale + 1);"
+      "      if(cell % 2 == 0){ total = total + cell % 97; }"
+      "      else { total = total - 1; }"
+      "      k++;"
+      "    };"
+      "  };"
+      "};");
+  auto local = code;
+  auto local_manager = IrPassManager::StandardPipeline();
+  local_manager.Disable("ssa");
+  EXPECT_TRUE(local_manager.Run(local).Valid());
+  auto optimized = code;
+  EXPECT_TRUE(IrPassManager::StandardPipeline().Run(optimized).Valid());
+
+  lambda xTimeEvaluation = [&](const IrCode& ir, int& total) {
+    auto start = std::chrono::steady_clock::now();
+    Environment env;
+    Evaluator{env}.Evaluate(ir);
+    total = env.LookupVariable("total")->GetInt();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  int unoptimized_total = 0;
+  int local_total = 0;
+  int optimized_total = 0;
+  auto unoptimized_us = xTimeEvaluation(code, unoptimized_total);
+  auto local_us = xTimeEvaluation(local, local_total);
+  auto optimized_us = xTimeEvaluation(optimized, optimized_total);
+
+  EXPECT_EQ(unoptimized_total, local_total);
+  EXPECT_EQ(unoptimized_total, optimized_total);
+  // Promoted locals leave the scopes with nothing to hold.
+  EXPECT_EQ(IrTestCount(optimized, eIrOp::ENTER_SCOPE), 0);
+  std::cout << "[IR SSA Benchmark] lines: " << code.Size() << " -> "
+            << local.Size() << " (local) -> " << optimized.Size()
+            << " (ssa), evaluation: " << unoptimized_us << "us -> "
+            << local_us << "us (local) -> " << optimized_us << "us (ssa)"
+            << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_ssa.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_IR_SSA_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,198 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_superinstructions.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_IR_SUPERINSTRUCTIONS_H
+#define HEADER_GUARD_CAOCO_UT0_IR_SUPERINSTRUCTIONS_H
+// Includes:
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "ir_fusion_table.h"
+#include "ir_optimizer.h"
+#include "ir_superinstructions.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_IR_SUPERINSTRUCTIONS true
+
+#if CAOCO_TEST_IR_SUPERINSTRUCTIONS
+#define CAOCO_TEST_IR_SUPERINSTRUCTIONS_Profiler 1
+#define CAOCO_TEST_IR_SUPERINSTRUCTIONS_Evaluation 1
+#define CAOCO_TEST_IR_SUPERINSTRUCTIONS_FusionTable 1
+#define CAOCO_TEST_IR_SUPERINSTRUCTIONS_Benchmark 1
+#endif
+
+#if CAOCO_TEST_IR_SUPERINSTRUCTIONS_Profiler
+MINITEST(TestIrSuperinstructions, TestCaseProfiler) {
+  auto code = IrTestGenerate(
+      "def @total: 0;"
+      "main: { def @i: 0; while(i < 10){ total = total + 2; i++; }; };");
+
+  // Static profile: every line once.
+  IrNgramProfiler static_profile;
+  static_profile.Add(code);
+  EXPECT_EQ(static_profile.Dispatches(), code.Size());
+  IrNgramProfiler::Ngram add_const = {
+      eIrOp::DEFINE_VARIABLE, eIrOp::BINARY_ADD, eIrOp::LOAD_VARIABLE,
+      eIrOp::ALLOCATE_LITERAL};
+  EXPECT_EQ(static_profile.Count(add_const), 2);  // total + 2 and i++
+
+  // Dynamic profile: weighted by the dispatches of each line.
+  Environment env;
+  Evaluator evaluator{env};
+  evaluator.EnableProfiling(true).Evaluate(code);
+  const auto& counts = evaluator.LineCounts();
+  ASSERT_EQ(counts.size(), code.Size());
+  std::size_t counted = 0;
+  for (auto count : counts) counted += count;
+  EXPECT_EQ(counted, evaluator.Dispatches());
+  IrNgramProfiler profile;
+  profile.Add(code, counts);
+  EXPECT_EQ(profile.Dispatches(), evaluator.Dispatches());
+  EXPECT_EQ(profile.Count(add_const), 20);
+  auto top = profile.Top(1);
+  ASSERT_EQ(top.size(), 1);
+  EXPECT_TRUE(top[0].second >= profile.Count(add_const));
+
+  // Both statements fuse to DEFINE_BINARY_VAR_LIT, the loop condition to
+  // BRANCH_BINARY_VAR_LIT, 3 dispatches saved by each.
+  auto table = profile.Table();
+  lambda xSaved = [&](eIrFusedOp op) -> std::size_t {
+    for (const auto& entry : table) {
+      if (entry.op == op) return entry.saved_dispatches;
+    }
+    return 0;
+  };
+  EXPECT_EQ(xSaved(eIrFusedOp::kDefineBinaryVarLit), 20 * 3);
+  EXPECT_EQ(xSaved(eIrFusedOp::kBranchBinaryVarLit), 11 * 3);
+  // Operands of a fused tree are not counted on their own.
+  EXPECT_EQ(xSaved(eIrFusedOp::kBinaryVarLit), 0);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_SUPERINSTRUCTIONS_Evaluation
+MINITEST(TestIrSuperinstructions, TestCaseFusedEvaluation) {
+  // Same results with and without superinstructions, fewer dispatches.
+  for (const auto& source : kIrSuperinstructionCorpus) {
+    for (const auto& code :
+         {IrTestGenerate(source), IrSuperinstructionTestCode(source)}) {
+      Environment plain_env;
+      Evaluator plain{plain_env};
+      plain.EnableFusion(false).EnableJit(false).Evaluate(code);
+      Environment fused_env;
+      Evaluator fused{fused_env};
+      fused.EnableJit(false).Evaluate(code);
+      EXPECT_EQ(plain_env.LookupVariable("total")->GetInt(),
+                fused_env.LookupVariable("total")->GetInt());
+      EXPECT_TRUE(fused.Dispatches() < plain.Dispatches());
+    }
+  }
+
+  // Errors of the fused handlers match the plain ones. Without tiers the
+  // code runs fused from its first line.
+  lambda xError = [](const std::string& source, bool fusion) {
+    auto code = IrTestGenerate(source);
+    Environment env;
+    try {
+      Evaluator{env}
+          .EnableFusion(fusion)
+          .SetTierOptions(TierOptions{false})
+          .Evaluate(code);
+    } catch (const std::runtime_error& e) {
+      return std::string(e.what());
+    }
+    return std::string();
+  };
+  for (const auto& source :
+       {"def @a: 0; def @b: 7 / a;", "def @a: 1; main: { while(a){ a = 0; }; };",
+        "def @a: 'x'; def @b: a - 1;", "def @a: b + 1;"}) {
+    auto expected = xError(source, false);
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(xError(source, true), expected);
+  }
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_SUPERINSTRUCTIONS_FusionTable
+// The checked in table must enable the superinstructions the corpus uses.
+// On failure, replace kIrFusionTable with the printed table.
+MINITEST(TestIrSuperinstructions, TestCaseFusionTable) {
+  IrNgramProfiler profile;
+  for (const auto& source : kIrSuperinstructionCorpus) {
+    auto code = IrSuperinstructionTestCode(source);
+    Environment env;
+    Evaluator evaluator{env};
+    evaluator.EnableProfiling(true).Evaluate(code);
+    profile.Add(code, evaluator.LineCounts());
+  }
+  std::set<eIrFusedOp> generated;
+  for (const auto& entry : profile.Table()) generated.insert(entry.op);
+  std::set<eIrFusedOp> checked_in;
+  for (const auto& entry : kIrFusionTable) checked_in.insert(entry.op);
+  EXPECT_TRUE(generated == checked_in);
+  if (generated != checked_in) {
+    std::cout << "[IR Fusion Table] out of date, regenerated:" << std::endl;
+    profile.EmitTable();
+    profile.PrintTop(10);
+  }
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_SUPERINSTRUCTIONS_Benchmark
+// Dispatches and runtime of the optimized corpus with and without
+// superinstructions.
+MINITEST(TestIrSuperinstructions, TestCaseBenchmark) {
+  std::size_t plain_dispatches = 0;
+  std::size_t fused_dispatches = 0;
+  long long plain_us = 0;
+  long long fused_us = 0;
+  for (const auto& source : kIrSuperinstructionCorpus) {
+    auto code = IrSuperinstructionTestCode(source);
+    lambda xTimeEvaluation = [&](bool fusion, std::size_t& dispatches) {
+      auto start = std::chrono::steady_clock::now();
+      Environment env;
+      Evaluator evaluator{env};
+      evaluator.EnableFusion(fusion).EnableJit(false).Evaluate(code);
+      dispatches += evaluator.Dispatches();
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now() - start)
+          .count();
+    };
+    plain_us += xTimeEvaluation(false, plain_dispatches);
+    fused_us += xTimeEvaluation(true, fused_dispatches);
+  }
+  EXPECT_TRUE(fused_dispatches < plain_dispatches);
+  std::cout << "[IR Superinstructions Benchmark] dispatches: "
+            << plain_dispatches << " -> " << fused_dispatches
+            << ", evaluation: " << plain_us << "us -> " << fused_us << "us"
+            << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_superinstructions.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_IR_SUPERINSTRUCTIONS_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,229 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_transpiler.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_IR_TRANSPILER_H
+#define HEADER_GUARD_CAOCO_UT0_IR_TRANSPILER_H
+// Includes:
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "ir_transpiler.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_IR_TRANSPILER true
+
+#if CAOCO_TEST_IR_TRANSPILER
+#define CAOCO_TEST_IR_TRANSPILER_Transpile 1
+// Compiled programs are built with the system compiler and run by a POSIX
+// shell, see CAOCO_TEST_AOT.
+#if defined(__unix__) && CAOCO_TEST_AOT
+#define CAOCO_TEST_IR_TRANSPILER_CompiledSamples 1
+#endif
+#endif
+
+struct AotTestSample {
+  std::string name;
+  IrCode code;
+  std::string input;
+};
+
+// Output and error message of a run, and its duration.
+struct AotTestRun {
+  std::string out;
+  std::string error;
+  long long us{0};
+};
+
+AotTestRun AotTestInterpret(const IrCode& code, const std::string& input) {
+  AotTestRun run;
+  std::istringstream in(input);
+  std::ostringstream out;
+  Environment env;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    Evaluator{env, in, out}.Evaluate(code);
+  } catch (const std::runtime_error& e) {
+    run.error = e.what();
+  }
+  run.us = std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count();
+  run.out = out.str();
+  return run;
+}
+
+// Builds the programs into one executable in the temp directory, see
+// IrTranspiler::BuildBundle. Returns the executable, empty if the build
+// failed.
+std::string AotTestBuild(const std::vector<const IrCode*>& codes,
+                         const std::string& name) {
+  auto dir = std::filesystem::temp_directory_path() / "caoco_aot";
+  std::filesystem::create_directories(dir);
+  auto exe = dir / name;
+  if (IrTranspiler::BuildBundle(codes, exe,
+                                std::filesystem::current_path().string(),
+                                "c++ -std=c++20 -O2 -w") != 0) {
+    return "";
+  }
+  return exe.string();
+}
+
+// Runs a program of a compiled bundle. The error is empty if the program
+// succeeded.
+AotTestRun AotTestRunCompiled(const std::string& exe, std::size_t index,
+                              const std::string& input) {
+  AotTestRun run;
+  if (exe.empty()) {
+    run.error = "Build failed.";
+    return run;
+  }
+  auto path = [&](const char* extension) {
+    return exe + "." + std::to_string(index) + extension;
+  };
+  std::ofstream(path(".in")) << input;
+  auto command = "\"" + exe + "\" " + std::to_string(index) + " < \"" +
+                 path(".in") + "\" > \"" + path(".out") + "\" 2> \"" +
+                 path(".err") + "\"";
+  auto start = std::chrono::steady_clock::now();
+  int status = std::system(command.c_str());
+  run.us = std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count();
+  lambda xRead = [](const std::string& file) {
+    std::ifstream stream(file);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+  };
+  run.out = xRead(path(".out"));
+  if (status != 0) {
+    run.error = xRead(path(".err"));
+    if (run.error.ends_with('\n')) run.error.pop_back();
+  }
+  return run;
+}
+
+#if CAOCO_TEST_IR_TRANSPILER_Transpile
+MINITEST(TestIrTranspiler, TestCaseTranspile) {
+  auto code = IrTestGenerate(
+      "def @total: 0;"
+      "class @Counter:{ def @count: 0; fn@next:{ count = count + 1; "
+      "return count; }; };"
+      "fn@twice:{ return total * 2; };"
+      "main: {"
+      "  def @c: Counter();"
+      "  while(total < 10){ def @i: c.next(); total = total + i; };"
+      "  cout(twice());"
+      "};");
+  auto source = IrTranspiler::Transpile(code);
+
+  // One function per body, the program and each method and class.
+  std::size_t functions = 0;
+  for (auto at = source.find("\nstatic RtVal Body"); at != std::string::npos;
+       at = source.find("\nstatic RtVal Body", at + 1)) {
+    functions++;
+  }
+  EXPECT_EQ(functions, 2 * 4);  // Declared, then defined.
+  EXPECT_TRUE(source.find("static AotGlobal g0{std::string(\"total\", 5)};") !=
+              std::string::npos);
+  // Locals of the program are C++ locals, members are looked up by name.
+  EXPECT_TRUE(source.find("RtVal l0;  // c") != std::string::npos);
+  EXPECT_TRUE(source.find("AotLookup(call.self, std::string(\"count\", 5)") !=
+              std::string::npos);
+  // The loop is a conditional goto and a goto back to the condition.
+  EXPECT_TRUE(source.find("if (!AotCondition(AotLhs{g0.Get()}.Lt(") !=
+              std::string::npos);
+  EXPECT_TRUE(source.find("int main() {\n  return AotMain(&Body0);\n}") !=
+              std::string::npos);
+
+  // A bundle runs the program of the index it is given.
+  auto bundle = IrTranspiler::TranspileBundle({&code, &code});
+  EXPECT_TRUE(bundle.find("namespace p1 {") != std::string::npos);
+  EXPECT_TRUE(bundle.find("      aot_body_at = &p1::BodyAt;\n"
+                          "      return p1::Main();\n") != std::string::npos);
+  EXPECT_EQ(bundle.find("int main() {"), std::string::npos);
+
+  // An aborted program fails with its error.
+  IrCode aborted;
+  aborted.AddLine(0, eIrOp::ABORT_AND_ERROR, {IrString("Aborted.")});
+  EXPECT_TRUE(IrTranspiler::Transpile(aborted).find("AotThrow(std::string("
+                                                    "\"Aborted.\", 8))") !=
+              std::string::npos);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_TRANSPILER_CompiledSamples
+// Sample programs interpreted and compiled print the same output and fail
+// with the same error. Prints the runtime of each, compiled runs include
+// starting the process.
+MINITEST_SERIAL(TestIrTranspiler, TestCaseCompiledSamples) {
+  if (!IrTranspiler::CompilerFound()) {
+    std::cout << "[AOT Benchmark] No system compiler, skipped." << std::endl;
+    return;
+  }
+  std::vector<AotTestSample> samples;
+  for (const auto& [file, input] :
+       {std::pair{"hello_world.cand", ""}, {"variable_decl.cand", ""},
+        {"animal_sounds1.cand", "husky\npoodle\ncat\nnone\n"}}) {
+    auto text = LoadFileToVec(file);
+    samples.push_back(
+        {file, IrTestGenerate(std::string(text.begin(), text.end())), input});
+  }
+  // The corpus prints its total, interpreted with the default optimizations.
+  for (std::size_t i = 0; i < kIrSuperinstructionCorpus.size(); i++) {
+    auto source = kIrSuperinstructionCorpus[i];
+    source.insert(source.rfind("};"), "cout(total);");
+    samples.push_back({"corpus" + std::to_string(i),
+                       IrSuperinstructionTestCode(source), ""});
+  }
+  for (const auto& [name, source] :
+       {std::pair{"division", "def @a: 0; main: { cout('x'); cout(1 / a); };"},
+        {"not_found", "main: { cout('y'); missing(); };"},
+        {"types", "def @a: 1; fn@f:{ return a + 'b'; }; main: { f(); };"}}) {
+    samples.push_back({name, IrTestGenerate(source), ""});
+  }
+
+  // One build for every sample, each run by its index.
+  std::vector<const IrCode*> codes;
+  for (const auto& sample : samples) codes.push_back(&sample.code);
+  auto exe = AotTestBuild(codes, "ut0_samples");
+  EXPECT_FALSE(exe.empty());
+  for (std::size_t i = 0; i < samples.size(); i++) {
+    const auto& sample = samples[i];
+    auto interpreted = AotTestInterpret(sample.code, sample.input);
+    auto compiled = AotTestRunCompiled(exe, i, sample.input);
+    EXPECT_EQ(compiled.out, interpreted.out);
+    EXPECT_EQ(compiled.error, interpreted.error);
+    std::cout << "[AOT Benchmark] " << sample.name
+              << ": interpreted: " << interpreted.us
+              << "us, compiled: " << compiled.us << "us" << std::endl;
+  }
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_transpiler.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_IR_TRANSPILER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
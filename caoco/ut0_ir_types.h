@@ -0,0 +1,161 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_types.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_IR_TYPES_H
+#define HEADER_GUARD_CAOCO_UT0_IR_TYPES_H
+// Includes:
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "ir_types.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_IR_TYPES true
+
+#if CAOCO_TEST_IR_TYPES
+#define CAOCO_TEST_IR_TYPES_Inference 1
+#define CAOCO_TEST_IR_TYPES_Evaluation 1
+#define CAOCO_TEST_IR_TYPES_Benchmark 1
+#endif
+
+// Types of the binary lines of a program, in order.
+std::string IrTypesTestBinaries(const std::string& source) {
+  auto code = IrTestGenerate(source);
+  std::vector<const IrLine*> index;
+  for (const auto& line : code.GetLines()) index.push_back(&line);
+  auto types = IrTypeInference::Infer(index);
+  std::string result;
+  for (std::size_t i = 0; i < index.size(); i++) {
+    if (IrOpIsBinary(index[i]->op)) {
+      result += std::string(ToStr(types[i])) + " ";
+    }
+  }
+  return result;
+}
+
+#if CAOCO_TEST_IR_TYPES_Inference
+MINITEST(TestIrTypes, TestCaseInference) {
+  // Locals of main keep their type through the loop, m joins int and string.
+  EXPECT_EQ(IrTypesTestBinaries("main: {"
+                                "  def @i: 0; def @d: 1.5; def @m: 0;"
+                                "  while(i < 10){"
+                                "    d = d * 0.5;"
+                                "    i++;"
+                                "    if(i == 3){ m = 'x'; };"
+                                "  };"
+                                "  def @e: i + m;"
+                                "};"),
+            "bool double int bool any ");
+
+  // Globals and parameters may hold anything, locals of methods may not. The
+  // last three are the copy of the returned expression, which is unreached.
+  EXPECT_EQ(IrTypesTestBinaries("def @g: 1;"
+                                "fn@f(n):{ def @k: 2; return k * n + k * 3; };"
+                                "main: { def @x: g + 1; };"),
+            "any any int any any any any ");
+
+  // A local is typed until its scope exits, the global it shadows is not.
+  EXPECT_EQ(IrTypesTestBinaries("def @x: 'g';"
+                                "main: {"
+                                "  if(true){ def @x: 1; x = x + 1; };"
+                                "  def @y: x + 'h';"
+                                "};"),
+            "int any ");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_TYPES_Evaluation
+MINITEST(TestIrTypes, TestCaseEvaluation) {
+  for (const auto& source : kIrSuperinstructionCorpus) {
+    auto code = IrTestGenerate(source);
+    Environment typed_env;
+    Evaluator{typed_env}.Evaluate(code);
+    Environment boxed_env;
+    Evaluator{boxed_env}.EnableTypeInference(false).Evaluate(code);
+    EXPECT_EQ(typed_env.LookupVariable("total")->GetInt(),
+              boxed_env.LookupVariable("total")->GetInt());
+  }
+
+  // Doubles and comparisons, and errors on operands which are not proven.
+  auto code = IrTestGenerate(
+      "def @r: 0.0; def @ok: false;"
+      "main: { def @a: 2.5; def @n: 3; r = a * a - a; ok = n * 2 >= 6; };");
+  Environment env;
+  Evaluator{env}.Evaluate(code);
+  EXPECT_EQ(env.LookupVariable("r")->GetDouble(), 3.75);
+  EXPECT_TRUE(env.LookupVariable("ok")->GetBool());
+  lambda xError = [](bool typed) {
+    Environment env;
+    try {
+      Evaluator{env}.EnableTypeInference(typed).Evaluate(
+          IrTestGenerate("main: { def @a: 1; def @b: 'x'; def @c: a + b; };"));
+    } catch (const std::runtime_error& e) {
+      return std::string(e.what());
+    }
+    return std::string();
+  };
+  EXPECT_FALSE(xError(true).empty());
+  EXPECT_EQ(xError(true), xError(false));
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_IR_TYPES_Benchmark
+// Integer and double arithmetic on locals, with and without the tag checks.
+// The JIT is off, it would compile the loop.
+MINITEST(TestIrTypes, TestCaseBenchmark) {
+  auto code = IrTestGenerate(
+      "def @total: 0;"
+      "main: {"
+      "  def @acc: 0; def @x: 0.0;"
+      "  for(def @i: 0; i < 20000; i++){"
+      "    acc = acc + i * 3 - (i + 1) * 2;"
+      "    x = x * 0.5 + 1.0;"
+      "  };"
+      "  total = acc;"
+      "};");
+  lambda xTime = [&](bool typed, int& total) {
+    auto start = std::chrono::steady_clock::now();
+    Environment env;
+    Evaluator{env}.EnableJit(false).EnableTypeInference(typed).Evaluate(code);
+    total = env.LookupVariable("total")->GetInt();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  int boxed_total = 0;
+  int typed_total = 0;
+  auto boxed_us = xTime(false, boxed_total);
+  auto typed_us = xTime(true, typed_total);
+  EXPECT_EQ(typed_total, boxed_total);
+  std::cout << "[IR Types Benchmark] evaluation: tag checked: " << boxed_us
+            << "us, typed: " << typed_us << "us" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_ir_types.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_IR_TYPES_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
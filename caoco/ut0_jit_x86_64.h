@@ -0,0 +1,204 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_jit_x86_64.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_JIT_X86_64_H
+#define HEADER_GUARD_CAOCO_UT0_JIT_X86_64_H
+// Includes:
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "ir_optimizer.h"
+#include "jit_x86_64.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+// Native code only runs on x86-64 Linux.
+#define CAOCO_TEST_JIT_X86_64 CAOCO_JIT_SUPPORTED
+
+#if CAOCO_TEST_JIT_X86_64
+#define CAOCO_TEST_JIT_X86_64_Regions 1
+#define CAOCO_TEST_JIT_X86_64_Deopt 1
+#define CAOCO_TEST_JIT_X86_64_Forced 1
+#define CAOCO_TEST_JIT_X86_64_Benchmark 1
+#endif
+
+// Evaluates code with the JIT forced on, or off. Returns the error message,
+// empty if the evaluation succeeded.
+std::string JitTestEvaluate(const IrCode& code, bool jit, Environment& env,
+                            std::vector<const JitRegion*>* regions = nullptr) {
+  Evaluator evaluator{env};
+  evaluator.SetJitOptions(JitOptions{jit, 1});
+  std::string error;
+  try {
+    evaluator.Evaluate(code);
+  } catch (const std::runtime_error& e) {
+    error = e.what();
+  }
+  if (regions != nullptr) *regions = evaluator.JitRegions();
+  return error;
+}
+
+#if CAOCO_TEST_JIT_X86_64_Regions
+MINITEST(TestJitX86_64, TestCaseRegions) {
+  auto code = IrTestGenerate(
+      "def @total: 0; def @even: false; def @calls: 0;"
+      "fn@count:{ calls = calls + 1; return calls; };"
+      "main: {"
+      "  def @i: 0;"
+      "  while(i < 100){"
+      "    total = total + i * 3 - i / 2 % 5;"
+      "    even = (i % 2 == 0) && !(i > 90);"
+      "    i++;"
+      "  };"
+      "  count(); count(); count();"
+      "};");
+  Environment plain_env;
+  EXPECT_TRUE(JitTestEvaluate(code, false, plain_env).empty());
+  Environment jit_env;
+  std::vector<const JitRegion*> regions;
+  EXPECT_TRUE(JitTestEvaluate(code, true, jit_env, &regions).empty());
+
+  // The whole loop is one region, entered once. The method body is a
+  // region up to its RETURN.
+  ASSERT_EQ(regions.size(), 2);
+  std::size_t loop_entries = 0;
+  std::size_t method_entries = 0;
+  for (auto region : regions) {
+    EXPECT_TRUE(region->CodeSize() > 0);
+    EXPECT_EQ(region->Deopts(), 0);
+    if (region->Statements() == 1) {
+      method_entries = region->Entries();
+    } else {
+      loop_entries = region->Entries();
+    }
+  }
+  EXPECT_EQ(loop_entries, 1);
+  EXPECT_EQ(method_entries, 3);
+
+  for (const auto& name : {"total", "calls"}) {
+    EXPECT_EQ(jit_env.LookupVariable(name)->GetInt(),
+              plain_env.LookupVariable(name)->GetInt());
+  }
+  EXPECT_EQ(jit_env.LookupVariable("even")->GetBool(),
+            plain_env.LookupVariable("even")->GetBool());
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_JIT_X86_64_Deopt
+MINITEST(TestJitX86_64, TestCaseDeoptimization) {
+  // Overflow leaves native code, the interpreter computes the statement.
+  auto overflow = IrTestGenerate(
+      "def @x: 1; def @n: 0;"
+      "main: { while(n < 40){ x = x * 3; n++; }; };");
+  Environment plain_env;
+  JitTestEvaluate(overflow, false, plain_env);
+  Environment jit_env;
+  std::vector<const JitRegion*> regions;
+  JitTestEvaluate(overflow, true, jit_env, &regions);
+  EXPECT_EQ(jit_env.LookupVariable("x")->GetInt(),
+            plain_env.LookupVariable("x")->GetInt());
+  ASSERT_EQ(regions.size(), 1);
+  EXPECT_TRUE(regions[0]->Deopts() > 0);
+
+  // Runtime errors are reported by the interpreter.
+  auto division = IrTestGenerate(
+      "def @x: 10; def @d: 3;"
+      "main: { while(x > 0){ x = x / d; d = d - 1; }; };");
+  Environment plain_division_env;
+  auto expected = JitTestEvaluate(division, false, plain_division_env);
+  EXPECT_FALSE(expected.empty());
+  Environment jit_division_env;
+  EXPECT_EQ(JitTestEvaluate(division, true, jit_division_env), expected);
+
+  // A variable which changes type fails the guard of the method region.
+  auto retyped = IrTestGenerate(
+      "def @w: 0;"
+      "fn@f:{ w = w + 1; return w; };"
+      "main: { f(); w = true; f(); };");
+  Environment plain_retyped_env;
+  expected = JitTestEvaluate(retyped, false, plain_retyped_env);
+  Environment jit_retyped_env;
+  std::vector<const JitRegion*> retyped_regions;
+  EXPECT_EQ(JitTestEvaluate(retyped, true, jit_retyped_env, &retyped_regions),
+            expected);
+  ASSERT_EQ(retyped_regions.size(), 1);
+  EXPECT_EQ(retyped_regions[0]->GuardFailures(), 1);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_JIT_X86_64_Forced
+// The corpus gives the same results with every region compiled, before and
+// after optimization.
+MINITEST(TestJitX86_64, TestCaseForcedJit) {
+  for (const auto& source : kIrSuperinstructionCorpus) {
+    for (const auto& code :
+         {IrTestGenerate(source), IrSuperinstructionTestCode(source)}) {
+      Environment plain_env;
+      Environment jit_env;
+      std::vector<const JitRegion*> regions;
+      EXPECT_EQ(JitTestEvaluate(code, false, plain_env),
+                JitTestEvaluate(code, true, jit_env, &regions));
+      EXPECT_EQ(jit_env.LookupVariable("total")->GetInt(),
+                plain_env.LookupVariable("total")->GetInt());
+      EXPECT_FALSE(regions.empty());
+    }
+  }
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_JIT_X86_64_Benchmark
+// Runtime of the optimized corpus interpreted and with the default JIT
+// threshold.
+MINITEST(TestJitX86_64, TestCaseBenchmark) {
+  long long plain_us = 0;
+  long long jit_us = 0;
+  std::size_t regions = 0;
+  for (const auto& source : kIrSuperinstructionCorpus) {
+    auto code = IrSuperinstructionTestCode(source);
+    lambda xTimeEvaluation = [&](bool jit) {
+      auto start = std::chrono::steady_clock::now();
+      Environment env;
+      Evaluator evaluator{env};
+      evaluator.EnableJit(jit).Evaluate(code);
+      if (jit) regions += evaluator.JitRegions().size();
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now() - start)
+          .count();
+    };
+    plain_us += xTimeEvaluation(false);
+    jit_us += xTimeEvaluation(true);
+  }
+  EXPECT_TRUE(regions > 0);
+  std::cout << "[JIT Benchmark] regions: " << regions
+            << ", evaluation: " << plain_us << "us -> " << jit_us << "us"
+            << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_jit_x86_64.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_JIT_X86_64_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
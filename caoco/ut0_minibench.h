@@ -0,0 +1,169 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_minibench.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_MINIBENCH_H
+#define HEADER_GUARD_CAOCO_UT0_MINIBENCH_H
+// Includes:
+#include "evaluator.h"
+#include "lexer.h"
+#include "minibench.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_MINIBENCH true
+
+#if CAOCO_TEST_MINIBENCH
+#define CAOCO_TEST_MINIBENCH_Statistics 1
+#define CAOCO_TEST_MINIBENCH_Baseline 1
+#define CAOCO_TEST_MINIBENCH_Lexer 1
+#define CAOCO_TEST_MINIBENCH_Evaluate 1
+#endif
+
+#if CAOCO_TEST_MINIBENCH_Statistics
+MINITEST_SERIAL(TestMinibench, TestCaseStatistics) {
+  auto options = minitest::bench_options;
+  minitest::bench_options.sample_time = std::chrono::microseconds(200);
+  minitest::bench_options.samples = 5;
+  auto results = minitest::bench_results.size();
+
+  std::vector<int> input(100, 1);
+  EXPECT_TRUE(minitest::RunBenchmark(
+      "Probe", "Sum", [&input](minitest::BenchState& state) {
+        for (auto _ : state) {
+          minitest::DoNotOptimize(
+              std::accumulate(input.begin(), input.end(), 0));
+        }
+        state.SetItemsProcessed(input.size());
+      }));
+  ASSERT_EQ(minitest::bench_results.size(), results + 1);
+  auto sum = minitest::bench_results.back();
+  EXPECT_EQ(sum.name, "Probe.Sum");
+  EXPECT_EQ(sum.samples, 5);
+  EXPECT_TRUE(sum.iterations > 1);
+  EXPECT_TRUE(sum.median_ns > 0 && sum.median_ns <= sum.p99_ns);
+  EXPECT_TRUE(sum.items_per_second > 1e9 / sum.median_ns);
+  EXPECT_EQ(sum.allocations, 0.0);
+
+  // Setup before the loop is neither timed nor counted.
+  EXPECT_TRUE(minitest::RunBenchmark(
+      "Probe", "Allocate", [](minitest::BenchState& state) {
+        std::vector<int> setup(1000);
+        for (auto _ : state) {
+          auto value = std::make_unique<std::int64_t>(1);
+          minitest::DoNotOptimize(value);
+        }
+      }));
+  if (AllocationCounter::kEnabled) {
+    EXPECT_EQ(minitest::bench_results.back().allocations, 1.0);
+    EXPECT_EQ(minitest::bench_results.back().bytes, 8.0);
+  }
+
+  // A body which does not loop fails, the failure is dropped here.
+  auto& failures = *minitest::running_test_failures;
+  auto failed = failures.size();
+  EXPECT_FALSE(minitest::RunBenchmark("Probe", "NoLoop",
+                                      [](minitest::BenchState&) {}));
+  EXPECT_EQ(failures.size(), failed + 1);
+  failures.resize(failed);
+
+  minitest::bench_results.resize(results);
+  minitest::bench_options = options;
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_MINIBENCH_Baseline
+MINITEST(TestMinibench, TestCaseBaseline) {
+  std::vector<minitest::BenchResult> results(3);
+  results[0].name = "A.Slower";
+  results[0].median_ns = 150;
+  results[1].name = "A.Noise";
+  results[1].median_ns = 105;
+  results[2].name = "A.New";
+  results[2].median_ns = 1000;
+  std::ostringstream json;
+  minitest::WriteBenchJson(json, results);
+  EXPECT_TRUE(json.str().starts_with("{\"benchmarks\":[\n{\"name\":"));
+
+  auto read = minitest::ReadBenchBaseline(json.str());
+  ASSERT_EQ(read.size(), 3);
+  EXPECT_EQ(read[1].first, "A.Noise");
+  EXPECT_EQ(read[1].second, 105.0);
+
+  auto baseline = minitest::ReadBenchBaseline(
+      "{\"benchmarks\":[\n"
+      "{\"name\":\"A.Slower\",\"iterations\":10,\"median_ns\":100},\n"
+      "{\"name\":\"A.Noise\",\"iterations\":10,\"median_ns\":100},\n"
+      "{\"name\":\"A.Removed\",\"iterations\":10,\"median_ns\":1}\n]}\n");
+  auto regressions = minitest::CompareBenchBaseline(results, baseline, 0.10);
+  ASSERT_EQ(regressions.size(), 1);
+  EXPECT_TRUE(regressions.front().starts_with("A.Slower: median 150"));
+  EXPECT_TRUE(regressions.front().ends_with("(+50%)"));
+  EXPECT_TRUE(minitest::CompareBenchBaseline(results, baseline, 0.6).empty());
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_MINIBENCH_Lexer
+// Lexes the modules of a layered program per iteration.
+MINIBENCH(BenchLexer, BenchCaseModules) {
+  std::string source;
+  for (const auto& [name, text] : ModuleTestLayers(3, 3)) source += text;
+  for (auto _ : state) {
+    auto tokens = Lexer::Lex(source);
+    minitest::DoNotOptimize(tokens);
+  }
+  state.SetItemsProcessed(source.size());
+  state.SetAllocationBudget(40);
+}
+END_MINIBENCH;
+#endif
+
+#if CAOCO_TEST_MINIBENCH_Evaluate
+// The optimized superinstruction corpus, generated once.
+struct MinibenchCorpusFixture : minitest::Fixture {
+  std::vector<IrCode> programs;
+  void SetUp() override {
+    for (const auto& source : kIrSuperinstructionCorpus) {
+      programs.push_back(IrSuperinstructionTestCode(source));
+    }
+  }
+};
+
+MINIBENCH_F(BenchEvaluator, BenchCaseCorpus, MinibenchCorpusFixture) {
+  for (auto _ : state) {
+    for (const auto& code : programs) {
+      Environment env;
+      Evaluator{env}.Evaluate(code);
+      minitest::DoNotOptimize(env);
+    }
+  }
+  state.SetItemsProcessed(programs.size());
+}
+END_MINIBENCH_F(BenchCaseCorpus);
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_minibench.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_MINIBENCH_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
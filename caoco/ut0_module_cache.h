@@ -0,0 +1,188 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_module_cache.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_MODULE_CACHE_H
+#define HEADER_GUARD_CAOCO_UT0_MODULE_CACHE_H
+// Includes:
+#include "evaluator.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+#include "module_cache.h"
+#include "module_graph.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_MODULE_CACHE true
+
+#if CAOCO_TEST_MODULE_CACHE
+#define CAOCO_TEST_MODULE_CACHE_Entries 1
+#define CAOCO_TEST_MODULE_CACHE_Incremental 1
+#define CAOCO_TEST_MODULE_CACHE_Benchmark 1
+#endif
+
+std::filesystem::path ModuleCacheTestDir(const std::string& name) {
+  auto dir = std::filesystem::temp_directory_path() / "caoco_cache" / name;
+  std::filesystem::remove_all(dir);
+  return dir;
+}
+
+#if CAOCO_TEST_MODULE_CACHE_Entries
+MINITEST(TestModuleCache, TestCaseEntries) {
+  ModuleCache cache(ModuleCacheTestDir("entries"));
+  auto code = IrTestGenerate("def @x: 1; fn@f(a):{ return a + x; };");
+  std::vector<SemaExport> exports = {
+      {"x", eIdentityCategory::kVariable, 0, false},
+      {"f", eIdentityCategory::kMethod, 1, false}};
+  auto key = ModuleCache::Key("source", 0, {});
+  EXPECT_NE(key.address, ModuleCache::Key("source", 1, {}).address);
+  EXPECT_NE(key.address, ModuleCache::Key("source", 0, {1}).address);
+  EXPECT_FALSE(cache.Find(key).has_value());
+  cache.Store(key, {code, exports, std::chrono::microseconds(100)});
+  auto entry = cache.Find(key);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->code.Size(), code.Size());
+  EXPECT_TRUE(entry->exports.size() == 2 && entry->exports[1].arity == 1);
+  EXPECT_EQ(ModuleCache::InterfaceHash(entry->exports),
+            ModuleCache::InterfaceHash(exports));
+  EXPECT_EQ(cache.Hits(), 1);
+  EXPECT_EQ(cache.Misses(), 1);
+
+  // A key whose address collides with a stored one misses, on disk and in
+  // memory.
+  ModuleCacheKey collision{key.address, ModuleCache::Key("other", 0, {}).text};
+  EXPECT_FALSE(cache.Find(collision).has_value());
+  ModuleCache remembering(ModuleCacheTestDir("collision"),
+                          kModuleCacheDefaultCapacity, 1 << 20);
+  remembering.Store(key, {code, exports, {}});
+  EXPECT_FALSE(remembering.Find(collision).has_value());
+  EXPECT_TRUE(remembering.Find(key).has_value());
+
+  // The least recently used entries go once the capacity is exceeded.
+  auto size = cache.SizeOnDisk();
+  lambda xKey = [](std::uint64_t i) {
+    return ModuleCache::Key(std::to_string(i), 0, {});
+  };
+  ModuleCache small(ModuleCacheTestDir("eviction"), size * 3);
+  for (std::uint64_t i = 0; i < 6; i++) {
+    small.Store(xKey(i), {code, exports, {}});
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_TRUE(small.Find(xKey(0)).has_value());  // Kept in use.
+  }
+  EXPECT_TRUE(small.SizeOnDisk() <= size * 3);
+  EXPECT_FALSE(small.Find(xKey(1)).has_value());
+  EXPECT_TRUE(small.Find(xKey(5)).has_value());
+
+  // Threads storing and finding the same keys see whole entries.
+  ModuleCache shared(ModuleCacheTestDir("threads"), size * 4);
+  std::atomic<int> torn = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t] {
+      for (std::uint64_t i = 0; i < 40; i++) {
+        shared.Store(xKey((i + t) % 8), {code, exports, {}});
+        auto found = shared.Find(xKey(i % 8));
+        if (found && found->code.Size() != code.Size()) torn++;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_TRUE(shared.SizeOnDisk() <= size * 4);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_MODULE_CACHE_Incremental
+MINITEST(TestModuleCache, TestCaseIncremental) {
+  ModuleCache cache(ModuleCacheTestDir("incremental"));
+  auto files = kModuleTestShapes;
+  lambda xBuild = [&](int& total) {
+    auto dir = ModuleTestWrite("incremental", files);
+    ModuleGraph graph({.optimize = true, .check = true}, 4, &cache);
+    EXPECT_TRUE(graph.Load(dir / "main.cand").Valid());
+    EXPECT_TRUE(graph.Build().Valid());
+    auto code = graph.Link();
+    EXPECT_TRUE(code.Valid());
+    Environment env;
+    Evaluator{env}.Evaluate(code.Value());
+    total = env.LookupVariable("total")->GetInt();
+    std::string cached;
+    for (const auto& module : graph.Modules()) {
+      if (module.cached) cached += module.name + " ";
+    }
+    return cached;
+  };
+  int total = 0;
+  EXPECT_EQ(xBuild(total), "");
+  EXPECT_EQ(total, 20);
+  EXPECT_EQ(xBuild(total), "main shapes util ");
+  EXPECT_EQ(total, 20);
+
+  // A new body keeps the exports of util, its importers are reused.
+  files[0].second = "fn@twice(n):{ return n * 3; };\n";
+  EXPECT_EQ(xBuild(total), "main shapes ");
+  EXPECT_EQ(total, 30);
+
+  // A new export changes them.
+  files[0].second += "fn@thrice(n):{ return n * 3; };\n";
+  EXPECT_EQ(xBuild(total), "");
+  EXPECT_EQ(total, 30);
+  EXPECT_EQ(cache.Hits(), 5);
+  EXPECT_EQ(cache.Misses(), 7);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_MODULE_CACHE_Benchmark
+// A cold build fills the cache, a warm build loads every module, and a
+// build after editing one body of the lowest level recompiles one module.
+MINITEST(TestModuleCache, TestCaseBenchmark) {
+  ModuleCache cache(ModuleCacheTestDir("benchmark"));
+  auto files = ModuleTestLayers(4, 4);
+  lambda xTime = [&]() {
+    auto dir = ModuleTestWrite("cache_benchmark", files);
+    auto start = std::chrono::steady_clock::now();
+    ModuleGraph graph({.check = true}, 1, &cache);
+    EXPECT_TRUE(graph.Load(dir / "root.cand").Valid());
+    EXPECT_TRUE(graph.Build().Valid());
+    EXPECT_TRUE(graph.Link().Valid());
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  auto cold_us = xTime();
+  auto warm_us = xTime();
+  files[0].second.replace(files[0].second.find("b * i"), 5, "b + i");
+  auto edited_us = xTime();
+  auto builds = cache.Hits() + cache.Misses();
+  std::cout << "[Module Cache Benchmark] modules: " << files.size()
+            << ", cold: " << cold_us << "us, warm: " << warm_us
+            << "us, body edited: " << edited_us << "us, hit rate: "
+            << cache.Hits() * 100 / builds << "%, saved: "
+            << cache.TimeSaved().count() << "us" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_module_cache.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_MODULE_CACHE_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,143 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_module_graph.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_MODULE_GRAPH_H
+#define HEADER_GUARD_CAOCO_UT0_MODULE_GRAPH_H
+// Includes:
+#include "cand_driver.h"
+#include "evaluator.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+#include "module_graph.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_MODULE_GRAPH true
+
+#if CAOCO_TEST_MODULE_GRAPH
+#define CAOCO_TEST_MODULE_GRAPH_Imports 1
+#define CAOCO_TEST_MODULE_GRAPH_Driver 1
+#define CAOCO_TEST_MODULE_GRAPH_Benchmark 1
+#endif
+
+#if CAOCO_TEST_MODULE_GRAPH_Imports
+MINITEST(TestModuleGraph, TestCaseImports) {
+  auto dir = ModuleTestWrite("shapes", kModuleTestShapes);
+  ModuleGraph graph({.check = true}, 4);
+  ASSERT_TRUE(graph.Load(dir / "main.cand").Valid());
+  ASSERT_TRUE(graph.Build().Valid());
+  std::string levels;
+  for (const auto& module : graph.Modules()) {
+    levels += module.name + ":" + std::to_string(module.level) + " ";
+  }
+  EXPECT_EQ(levels, "main:3 shapes:2 util:1 ");
+  EXPECT_TRUE((graph.CriticalPath() == std::vector<std::size_t>{0, 1, 2}));
+  auto code = graph.Link();
+  ASSERT_TRUE(code.Valid());
+  Environment env;
+  Evaluator{env}.Evaluate(code.Value());
+  EXPECT_EQ(env.LookupVariable("total")->GetInt(), 20);
+
+  // Names of a module which is not imported are not visible.
+  dir = ModuleTestWrite(
+      "unimported", {{"util", "fn@twice(n):{ return n * 2; };\n"},
+                     {"a", "import util;\nfn@f:{ return twice(1); };\n"},
+                     {"main", "import a;\nmain: { f(); twice(2); };\n"}});
+  ASSERT_TRUE(graph.Load(dir / "main.cand").Valid());
+  EXPECT_EQ(graph.Build().Error(), (dir / "main.cand").string() +
+                                       ":2: Undeclared name: twice");
+
+  // Cycles and missing files fail the load.
+  dir = ModuleTestWrite("cycle", {{"a", "import b;\n"},
+                                       {"b", "import c;\n"},
+                                       {"c", "import a;\n"}});
+  EXPECT_EQ(graph.Load(dir / "a.cand").Error(),
+            "Import cycle: a -> b -> c -> a");
+  dir = ModuleTestWrite("missing", {{"a", "import b;\n"}});
+  EXPECT_EQ(graph.Load(dir / "a.cand").Error(),
+            (dir / "a.cand").string() + ": Cannot resolve import: b");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_MODULE_GRAPH_Driver
+MINITEST(TestModuleGraph, TestCaseDriver) {
+  auto dir = ModuleTestWrite("driver", kModuleTestShapes);
+  auto main = (dir / "main.cand").string();
+  auto module = (dir / "main.candc").string();
+  lambda xRun = [](std::vector<std::string> args, std::string& out) {
+    std::istringstream in;
+    std::ostringstream os;
+    std::ostringstream err;
+    int status = CandDriver::Main(args, in, os, err);
+    out = os.str() + err.str();
+    return status;
+  };
+  std::string report;
+  EXPECT_EQ(xRun({"compile", main, "--report"}, report), 0);
+  EXPECT_TRUE(report.starts_with("Modules: 3, build: "));
+  EXPECT_TRUE(report.find("Critical path: main -> shapes -> util (") !=
+              std::string::npos);
+  std::string ran;
+  EXPECT_EQ(xRun({"run", module}, ran), 0);
+  std::string checked;
+  EXPECT_EQ(xRun({"check", main}, checked), 0);
+  EXPECT_EQ(checked, "");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_MODULE_GRAPH_Benchmark
+// 4 levels of 4 modules, each importing every module of the level below.
+MINITEST(TestModuleGraph, TestCaseBenchmark) {
+  constexpr int kLevels = 4;
+  auto dir = ModuleTestWrite("benchmark", ModuleTestLayers(kLevels, 4));
+
+  lambda xTime = [&](ModuleGraph& graph) {
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(graph.Load(dir / "root.cand").Valid());
+    EXPECT_TRUE(graph.Build().Valid());
+    EXPECT_TRUE(graph.Link().Valid());
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  ModuleGraph serial({.check = true}, 1);
+  ModuleGraph parallel({.check = true}, 4);
+  auto serial_us = xTime(serial);
+  auto parallel_us = xTime(parallel);
+  std::chrono::microseconds critical{0};
+  for (auto i : parallel.CriticalPath()) {
+    critical += parallel.Modules()[i].time;
+  }
+  EXPECT_EQ(parallel.CriticalPath().size(), kLevels + 1);
+  std::cout << "[Module Graph Benchmark] modules: "
+            << parallel.Modules().size() << ", 1 thread: " << serial_us
+            << "us, 4 threads: " << parallel_us
+            << "us, critical path: " << critical.count() << "us" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_module_graph.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_MODULE_GRAPH_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
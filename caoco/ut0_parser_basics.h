@@ -579,7 +579,7 @@ END_MINITEST;
     } else {                                                             \
       auto source = expected_source.Extract();                           \
       auto parse_result =                                                \
-          LarkParser::##parsefunc({source.cbegin(), source.cend()});     \
+          LarkParser::parsefunc({source.cbegin(), source.cend()});     \
       std::cout << "[Testing Parsing Method]" << #casename << std::endl; \
       EXPECT_TRUE(parse_result.Valid());                                 \
       if (!parse_result.Valid()) {                                       \
@@ -0,0 +1,230 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_phase_timer.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_PHASE_TIMER_H
+#define HEADER_GUARD_CAOCO_UT0_PHASE_TIMER_H
+// Includes:
+#include "allocation_counter.h"
+#include "cand_driver.h"
+#include "compilation_session.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+#include "phase_timer.h"
+#include "work_stealing_pool.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_PHASE_TIMER true
+
+#if CAOCO_TEST_PHASE_TIMER
+#define CAOCO_TEST_PHASE_TIMER_Report 1
+#define CAOCO_TEST_PHASE_TIMER_Threads 1
+#define CAOCO_TEST_PHASE_TIMER_Driver 1
+#define CAOCO_TEST_PHASE_TIMER_Benchmark 1
+#endif
+
+static const std::string kPhaseTimerTestSource =
+    "def @total: 0;\n"
+    "fn@sum(n):{ def @s: 0; for(def @i: 0; i < n; i++){ s = s + i; };\n"
+    "  return s; };\n"
+    "main: { total = sum(10); };\n";
+
+// Allocated by the aligned overloads of operator new.
+struct alignas(64) PhaseTimerTestLine {
+  char bytes[64];
+};
+
+#if CAOCO_TEST_PHASE_TIMER_Report
+MINITEST_SERIAL(TestPhaseTimer, TestCaseReport) {
+  auto before = AllocationCounter::Count();
+  std::vector<int> numbers(100);
+  auto allocated = AllocationCounter::Count() - before;
+  if (AllocationCounter::kEnabled) {
+    EXPECT_EQ(allocated.count, 1);
+    EXPECT_EQ(allocated.bytes, 100 * sizeof(int));
+  }
+  // The aligned and nothrow overloads count, and free what they allocate.
+  before = AllocationCounter::Count();
+  using Line = PhaseTimerTestLine;
+  auto line = std::make_unique<Line>();
+  auto lines = std::unique_ptr<Line[]>(new (std::nothrow) Line[3]);
+  auto ints = std::unique_ptr<int[]>(new (std::nothrow) int[3]);
+  allocated = AllocationCounter::Count() - before;
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(line.get()) % alignof(Line), 0);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(lines.get()) % alignof(Line), 0);
+  if (AllocationCounter::kEnabled) EXPECT_EQ(allocated.count, 3);
+
+  PhaseTimer timer;
+  PhaseTimer other;
+  EXPECT_TRUE(timer.Start());
+  EXPECT_FALSE(other.Start());
+  auto code =
+      CompilationSession({.optimize = true, .check = true})
+          .Compile(kPhaseTimerTestSource);
+  EXPECT_TRUE(code.Valid());
+  std::thread([] { CAOCO_PHASE("unadopted"); }).join();  // Not recorded.
+  std::thread([active = PhaseTimer::Active()] {
+    PhaseTimer::Adopt adopt(active);
+    CAOCO_PHASE("worker");
+  }).join();
+  timer.Stop();
+  CompilationSession().Compile(kPhaseTimerTestSource);  // Not recorded.
+
+  auto records = timer.Records();
+  std::string names;
+  for (const auto& record : records) names += std::string(record.name) + " ";
+  EXPECT_EQ(names, "lex parse sema irgen optimize worker ");
+  EXPECT_EQ(records.back().thread, 1);
+  if (AllocationCounter::kEnabled) {
+    EXPECT_TRUE(records.front().allocations.count > 0);
+  }
+
+  std::ostringstream report;
+  timer.PrintReport(report);
+  EXPECT_TRUE(report.str().starts_with("Phase"));
+  EXPECT_TRUE(report.str().find("\nirgen ") != std::string::npos);
+  EXPECT_TRUE(report.str().find("\nTotal ") != std::string::npos);
+  std::ostringstream trace;
+  timer.WriteTrace(trace);
+  EXPECT_TRUE(
+      trace.str().starts_with("{\"traceEvents\":[\n{\"name\":\"lex\""));
+  EXPECT_TRUE(trace.str().find("\"ph\":\"X\"") != std::string::npos);
+  EXPECT_TRUE(trace.str().ends_with("],\"displayTimeUnit\":\"ms\"}\n"));
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_PHASE_TIMER_Threads
+// Timers started on two threads record their own phases, and a phase ending
+// after its timer is destroyed records nothing.
+MINITEST_SERIAL(TestPhaseTimer, TestCaseThreads) {
+  PhaseTimer timer;
+  EXPECT_TRUE(timer.Start());
+  std::vector<PhaseRecord> other_records;
+  std::thread([&other_records] {
+    PhaseTimer other;
+    EXPECT_TRUE(other.Start());
+    { CAOCO_PHASE("other"); }
+    other.Stop();
+    other_records = other.Records();
+  }).join();
+  { CAOCO_PHASE("mine"); }
+  WorkStealingPool(2).Run({[] { CAOCO_PHASE("task"); },
+                           [] { CAOCO_PHASE("task"); }});
+  timer.Stop();
+  ASSERT_EQ(other_records.size(), 1);
+  EXPECT_EQ(other_records.front().name, "other");
+  auto records = timer.Records();
+  ASSERT_EQ(records.size(), 3);
+  EXPECT_EQ(records.front().name, "mine");
+  EXPECT_EQ(records.back().name, "task");
+
+  std::optional<PhaseTimer::Scope> open;
+  {
+    PhaseTimer brief;
+    EXPECT_TRUE(brief.Start());
+    open.emplace("open");
+  }
+  open.reset();
+  EXPECT_TRUE(PhaseTimer::Active() == nullptr);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_PHASE_TIMER_Driver
+MINITEST_SERIAL(TestPhaseTimer, TestCaseDriver) {
+  auto dir = ModuleTestWrite("phase_timer", kModuleTestShapes);
+  auto trace = dir / "trace.json";
+  std::istringstream in;
+  std::ostringstream out;
+  std::ostringstream err;
+  EXPECT_EQ(CandDriver::Main({"run", (dir / "main.cand").string(),
+                              "--time-passes", "--trace", trace.string()},
+                             in, out, err),
+            0);
+  EXPECT_TRUE(err.str().starts_with("Phase"));
+  for (auto phase : {"\nread ", "\nlex ", "\nparse ", "\nirgen ", "\nlink ",
+                     "\nevaluate "}) {
+    EXPECT_TRUE(err.str().find(phase) != std::string::npos);
+  }
+  std::ifstream file(trace);
+  std::string json((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  EXPECT_TRUE(json.find("\"name\":\"evaluate\"") != std::string::npos);
+
+  // Flags with a value keep it when the command runs timed.
+  auto module = dir / "timed.candc";
+  auto cache = dir / "cache";
+  err.str("");
+  EXPECT_EQ(CandDriver::Main({"compile", (dir / "main.cand").string(), "-o",
+                              module.string(), "--cache", cache.string(),
+                              "--time-passes"},
+                             in, out, err),
+            0);
+  EXPECT_TRUE(err.str().starts_with("Phase"));
+  EXPECT_TRUE(std::filesystem::exists(module));
+  EXPECT_TRUE(std::filesystem::is_directory(cache));
+  EXPECT_EQ(CandDriver::Main({"run", module.string(), "--cache",
+                              cache.string(), "--trace", trace.string()},
+                             in, out, err),
+            0);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_PHASE_TIMER_Benchmark
+// Compiles with no timer started, then with one recording every phase.
+MINITEST(TestPhaseTimer, TestCaseBenchmark) {
+  constexpr int kCompiles = 100;
+  lambda xTime = [&]() {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kCompiles; i++) {
+      CompilationSession({.optimize = true}).Compile(kPhaseTimerTestSource);
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  xTime();  // Warms the caches.
+  auto untimed_us = xTime();
+  PhaseTimer timer;
+  timer.Start();
+  auto timed_us = xTime();
+  timer.Stop();
+  AllocationCount allocations;
+  for (const auto& record : timer.Records()) {
+    allocations.count += record.allocations.count;
+    allocations.bytes += record.allocations.bytes;
+  }
+  std::cout << "[Phase Timer Benchmark] compiles: " << kCompiles
+            << ", untimed: " << untimed_us << "us, timed: " << timed_us
+            << "us, phases: " << timer.Records().size()
+            << ", allocations per compile: "
+            << allocations.count / kCompiles << " ("
+            << allocations.bytes / kCompiles << " bytes)" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_phase_timer.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_PHASE_TIMER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,233 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_preprocessor.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_PREPROCESSOR_H
+#define HEADER_GUARD_CAOCO_UT0_PREPROCESSOR_H
+// Includes:
+#include "compilation_session.h"
+#include "evaluator.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+#include "preprocessor.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_PREPROCESSOR true
+
+#if CAOCO_TEST_PREPROCESSOR
+#define CAOCO_TEST_PREPROCESSOR_Macros 1
+#define CAOCO_TEST_PREPROCESSOR_Includes 1
+#define CAOCO_TEST_PREPROCESSOR_Benchmark 1
+#endif
+
+// The literals of the preprocessed tokens, separated by spaces.
+Expected<std::string> PreprocessorTestRun(
+    Preprocessor& preprocessor, const std::string& source,
+    const std::filesystem::path& file = {}) {
+  auto preprocessed = preprocessor.Run(Lexer::Lex(source).Extract(), file);
+  if (!preprocessed) {
+    return Expected<std::string>::Failure(preprocessed.Error());
+  }
+  std::string literals;
+  for (const auto& tk : preprocessed.Value().tokens) {
+    literals += (literals.empty() ? "" : " ") + tk.Literal();
+  }
+  return Expected<std::string>::Success(literals);
+}
+
+#if CAOCO_TEST_PREPROCESSOR_Macros
+MINITEST(TestPreprocessor, TestCaseMacros) {
+  Preprocessor pp;
+  lambda xRun = [&pp](const std::string& source) {
+    auto literals = PreprocessorTestRun(pp, source);
+    return literals ? literals.Value() : "error: " + literals.Error();
+  };
+  EXPECT_EQ(xRun("#macro TWO 2 #endmacro x = TWO;"), "x = 2 ;");
+  EXPECT_EQ(xRun("#macro SQ(a) a * a #endmacro SQ(SQ(3));"),
+            "3 * 3 * 3 * 3 ;");
+  EXPECT_EQ(xRun("#macro ADD(a, b) (a + b) #endmacro ADD(f(1, 2), 3);"),
+            "( f ( 1 , 2 ) + 3 ) ;");
+  // A macro does not expand inside itself, a function macro needs a call.
+  EXPECT_EQ(xRun("#macro X X + 1 #endmacro X;"), "X + 1 ;");
+  EXPECT_EQ(xRun("#macro F() 1 #endmacro F + F();"), "F + 1 ;");
+  EXPECT_TRUE(xRun("#macro F(a) a #endmacro F(1, 2);").find(
+                  kPpErrorMacroArguments) != std::string::npos);
+  EXPECT_TRUE(xRun("#macro F a #if(1) #endif #endmacro")
+                  .find(kPpErrorMacroBody) != std::string::npos);
+
+  EXPECT_EQ(xRun("#macro N 3 #endmacro"
+                 "#if(N > 4) a #elif(N == 3 && defined(N)) b #else c #endif"),
+            "b");
+  EXPECT_EQ(xRun("#if(0) #if(1) a #endif #elif(UNKNOWN) b #else "
+                 "#if(!defined(N)) c #endif #endif"),
+            "c");
+  EXPECT_TRUE(xRun("#if(1) a").find(kPpErrorUnterminated) !=
+              std::string::npos);
+  EXPECT_TRUE(xRun("#if(1 +) a #endif").find(kPpErrorCondition) !=
+              std::string::npos);
+  EXPECT_TRUE(xRun("#if(1) #else #elif(1) #endif").find(kPpErrorStray) !=
+              std::string::npos);
+  EXPECT_TRUE(xRun("#endif").find(kPpErrorStray) != std::string::npos);
+
+  // The tokens keep their positions, the body of a macro its definition.
+  auto preprocessed = pp.Run(
+      Lexer::Lex("#macro ONE\n1 #endmacro\n\ndef @x: ONE;").Extract());
+  ASSERT_TRUE(preprocessed.Valid());
+  EXPECT_EQ(preprocessed.Value().tokens.front().Line(), 4);
+  EXPECT_EQ(preprocessed.Value().tokens[4].Line(), 2);
+
+  // Predefined macros, and a program through a compilation session.
+  CompilationSession session;
+  session.Directives().Define("DEBUG");
+  auto code = session.Compile(
+      "#macro SQ(a) ((a) * (a)) #endmacro\n"
+      "def @x: 0;\n"
+      "main: {\n"
+      "#if(defined(DEBUG))\n"
+      "  x = SQ(1 + 2);\n"
+      "#else\n"
+      "  x = 1;\n"
+      "#endif\n"
+      "};\n");
+  ASSERT_TRUE(code.Valid());
+  Environment env;
+  Evaluator{env}.Evaluate(code.Value());
+  EXPECT_EQ(env.LookupVariable("x")->GetInt(), 9);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_PREPROCESSOR_Includes
+MINITEST(TestPreprocessor, TestCaseIncludes) {
+  auto dir = ModuleTestWrite(
+      "preprocessor",
+      {{"config",
+        "#if(!defined(CONFIG)) #macro CONFIG #endmacro\n"
+        "#macro SIZE 4 #endmacro\n#endif\n"},
+       {"shapes",
+        "#include 'config.cand';\nfn@area(s):{ return s * SIZE; };\n"},
+       {"cycle", "#include 'main.cand';\n"},
+       {"main",
+        "#include 'config.cand';\n#include 'shapes.cand';\n"
+        "def @x: area(SIZE);\n"}});
+  auto main = dir / "main.cand";
+  auto source = LoadFileToVec(main.string());
+  Preprocessor pp;
+  auto first = pp.Run(Lexer::Lex(std::string(source.begin(), source.end()))
+                          .Extract(),
+                      main);
+  ASSERT_TRUE(first.Valid());
+  EXPECT_EQ(pp.CacheMisses(), 2);
+  EXPECT_EQ(pp.CacheHits(), 1);  // The include of config in shapes.
+  EXPECT_EQ(pp.GuardSkips(), 1);
+  // The tokens keep their files.
+  const auto& out = first.Value();
+  EXPECT_EQ(out.paths.size(), 3);
+  EXPECT_EQ(out.paths[out.files.front()].filename(), "shapes.cand");
+  EXPECT_EQ(out.paths[out.files.back()].filename(), "main.cand");
+
+  // Unchanged files come from the cache, a changed file is read again.
+  auto second = pp.Run(
+      Lexer::Lex(std::string(source.begin(), source.end())).Extract(), main);
+  ASSERT_TRUE(second.Valid());
+  EXPECT_EQ(pp.CacheHits(), 4);
+  EXPECT_EQ(second.Value().tokens.size(), out.tokens.size());
+  std::ofstream(dir / "config.cand") << "#macro SIZE 5 #endmacro\n";
+  std::filesystem::last_write_time(
+      dir / "config.cand",
+      std::filesystem::last_write_time(dir / "config.cand") +
+          std::chrono::seconds(1));
+  auto edited = PreprocessorTestRun(pp, "#include 'config.cand'; SIZE",
+                                    dir / "source.cand");
+  EXPECT_TRUE(edited.Valid() && edited.Value() == "5");
+  EXPECT_EQ(pp.CacheMisses(), 3);
+
+  EXPECT_TRUE(PreprocessorTestRun(pp, "#include 'cycle.cand';", main)
+                  .Error()
+                  .find(kPpErrorIncludeCycle) != std::string::npos);
+  EXPECT_TRUE(PreprocessorTestRun(pp, "#include 'none.cand';", main)
+                  .Error()
+                  .find(kPpErrorCannotInclude) != std::string::npos);
+  EXPECT_TRUE(PreprocessorTestRun(pp, "#include config;", main)
+                  .Error()
+                  .find(kPpErrorIncludeSyntax) != std::string::npos);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_PREPROCESSOR_Benchmark
+// 50 guarded headers, each including the 5 before it and defining 20
+// macros, included by one source: a cold preprocessor lexes every header,
+// a warm one splices the cached tokens.
+MINITEST(TestPreprocessor, TestCaseBenchmark) {
+  constexpr int kHeaders = 50;
+  std::vector<std::pair<std::string, std::string>> files;
+  std::string main;
+  for (int h = 0; h < kHeaders; h++) {
+    auto name = "h" + std::to_string(h);
+    std::string text = "#if(!defined(" + name + "_GUARD))\n#macro " + name +
+                       "_GUARD #endmacro\n";
+    for (int below = std::max(0, h - 5); below < h; below++) {
+      text += "#include 'h" + std::to_string(below) + ".cand';\n";
+    }
+    for (int m = 0; m < 20; m++) {
+      auto macro = name + "_M" + std::to_string(m);
+      text += "#macro " + macro + "(a, b) (a * " + std::to_string(m) +
+              " + b) #endmacro\n";
+      text += "def @" + macro + "_v: " + macro + "(1, 2);\n";
+    }
+    files.push_back({name, text + "#endif\n"});
+    main += "#include '" + name + ".cand';\n";
+  }
+  files.push_back({"main", main});
+  auto dir = ModuleTestWrite("preprocessor_benchmark", files);
+  auto tokens = Lexer::Lex(main).Extract();
+
+  Preprocessor pp;
+  std::size_t output = 0;
+  lambda xTime = [&]() {
+    auto start = std::chrono::steady_clock::now();
+    auto preprocessed = pp.Run(tokens, dir / "main.cand");
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    EXPECT_TRUE(preprocessed.Valid());
+    output = preprocessed.Value().tokens.size();
+    return us;
+  };
+  auto cold_us = xTime();
+  auto warm_us = xTime();
+  EXPECT_EQ(pp.CacheMisses(), kHeaders);
+  std::cout << "[Preprocessor Benchmark] headers: " << kHeaders
+            << ", includes: " << pp.CacheHits() + pp.CacheMisses()
+            << ", guard skips: " << pp.GuardSkips()
+            << ", output tokens: " << output << ", cold: " << cold_us
+            << "us, warm: " << warm_us << "us ("
+            << output * 1000 / std::max<std::int64_t>(1, warm_us)
+            << " tokens/ms)" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_preprocessor.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_PREPROCESSOR_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
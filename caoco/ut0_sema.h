@@ -0,0 +1,172 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_sema.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_SEMA_H
+#define HEADER_GUARD_CAOCO_UT0_SEMA_H
+// Includes:
+#include "cand_driver.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+#include "sema.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_SEMA true
+
+#if CAOCO_TEST_SEMA
+#define CAOCO_TEST_SEMA_Resolution 1
+#define CAOCO_TEST_SEMA_Determinism 1
+#define CAOCO_TEST_SEMA_Benchmark 1
+#endif
+
+// Diagnostics of a program, one per line.
+std::string SemaTestCheck(const std::string& source) {
+  auto diagnostics = CandDriver::Check(source);
+  if (!diagnostics) return diagnostics.Error();
+  std::string result;
+  for (const auto& diagnostic : diagnostics.Value()) {
+    result += std::to_string(diagnostic.line) + ": " + diagnostic.message;
+    result += "\n";
+  }
+  return result;
+}
+
+// Classes, functions and a main which calls each of them.
+std::string SemaTestProgram(std::size_t classes) {
+  std::string source = "def @total: 0;\n";
+  for (std::size_t i = 0; i < classes; i++) {
+    auto n = std::to_string(i);
+    source += "class @C" + n + ":{ def @v: " + n + ";\n" +
+              "  fn@get:{ return v; };\n" +
+              "  fn@add(a, b):{ def @s: a + b; return s + v; };\n" +
+              "  fn@loop(k):{ def @acc: 0;\n" +
+              "    for(def @i: 0; i < k; i++){\n" +
+              "      acc = acc + add(i, get()); };\n" +
+              "    return acc; }; };\n" +
+              "fn@f" + n + "(x):{ def @o: C" + n + "(); return o.loop(x); };\n";
+  }
+  source += "main: {\n";
+  for (std::size_t i = 0; i < classes; i++) {
+    source += "  total = total + f" + std::to_string(i) + "(2);\n";
+  }
+  return source + "};\n";
+}
+
+#if CAOCO_TEST_SEMA_Resolution
+MINITEST(TestSema, TestCaseResolution) {
+  EXPECT_EQ(SemaTestCheck(SemaTestProgram(3)), "");
+  EXPECT_EQ(SemaTestCheck("def @out: 0;\n"
+                          "class @Dog:{ def @name: 'rex';\n"
+                          "  fn@bark:{ cout(name + sound); return 1; }; };\n"
+                          "fn@twice(n):{ return n * 2; };\n"
+                          "main: {\n"
+                          "  def @d: Dog();\n"
+                          "  d.bark(); d.fly();\n"
+                          "  out = twice(1, 2) + Dog(1).bark();\n"
+                          "  if(true){ def @x: 1; }; out = x;\n"
+                          "  def @d: 2;\n"
+                          "  missing(out);\n"
+                          "};\n"
+                          "def @out: 1;\n"),
+            "3: Undeclared name: sound\n"
+            "7: No class declares the method: fly\n"
+            "8: Wrong number of arguments in call to: twice\n"
+            "8: Wrong number of arguments in call to: Dog\n"
+            "9: Undeclared name: x\n"
+            "10: Redeclaration of variable: d\n"
+            "11: Undeclared name: missing\n"
+            "13: Redeclaration of variable: out\n");
+
+  // Names the runtime resolves: members from their methods, globals declared
+  // after their use, parameters, loop variables and builtins.
+  EXPECT_EQ(SemaTestCheck("fn@early:{ return late + helper(); };\n"
+                          "def @late: 1;\n"
+                          "fn@helper:{ def @s: cin(); print(s); return 0; };\n"
+                          "class @A:{ def @n: 0; fn@inc(by):{ n = n + by; "
+                          "return inc2(); }; fn@inc2:{ return n; }; };\n"
+                          "main: { for(def @i: 0; i < 3; i++){ late++; }; "
+                          "def @a: A(); a.inc(1); };\n"),
+            "");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_SEMA_Determinism
+MINITEST(TestSema, TestCaseDeterminism) {
+  // Errors in many bodies come out in source order with any thread count.
+  std::string source;
+  for (int i = 0; i < 200; i++) {
+    source += "fn@f" + std::to_string(i) + ":{ return g" +
+              std::to_string(i) + "; };\n";
+  }
+  source += "main: { def @x: 0; def @x: 1; };\n";
+  auto tokens = Lexer::Lex(source);
+  ASSERT_TRUE(tokens.Valid());
+  auto ast = LarkParser::Parse(tokens.Extract());
+  ASSERT_TRUE(ast.Valid());
+  auto serial = SemanticAnalyzer::Analyze(ast.Value(), 1);
+  ASSERT_EQ(serial.diagnostics.size(), 201);
+  for (std::size_t i = 0; i < 200; i++) {
+    EXPECT_EQ(serial.diagnostics[i].message, "Undeclared name: g" +
+                                                 std::to_string(i));
+  }
+  for (std::size_t threads : {2, 3, 8}) {
+    EXPECT_TRUE(SemanticAnalyzer::Analyze(ast.Value(), threads).diagnostics ==
+                serial.diagnostics);
+  }
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_SEMA_Benchmark
+// A program with thousands of classes and methods, resolved by one thread
+// and by four, after a warm up run.
+MINITEST(TestSema, TestCaseBenchmark) {
+  auto tokens = Lexer::Lex(SemaTestProgram(1000));
+  ASSERT_TRUE(tokens.Valid());
+  auto ast = LarkParser::Parse(tokens.Extract());
+  ASSERT_TRUE(ast.Valid());
+  lambda xTime = [&](std::size_t threads, std::size_t& identities) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = SemanticAnalyzer::Analyze(ast.Value(), threads);
+    EXPECT_TRUE(result.Valid());
+    identities = result.identities.Size();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  std::size_t identities = 0;
+  xTime(1, identities);
+  auto serial_us = xTime(1, identities);
+  std::size_t threads = 4;
+  auto parallel_us = xTime(threads, identities);
+  EXPECT_EQ(identities, 1 + 1000 * 6);
+  std::cout << "[Sema Benchmark] identities: " << identities
+            << ", 1 thread: " << serial_us << "us, " << threads
+            << " threads: " << parallel_us << "us" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_sema.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_SEMA_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
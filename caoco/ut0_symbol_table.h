@@ -0,0 +1,209 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_symbol_table.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_SYMBOL_TABLE_H
+#define HEADER_GUARD_CAOCO_UT0_SYMBOL_TABLE_H
+// Includes:
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+#include "symbol_table.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_SYMBOL_TABLE true
+
+#if CAOCO_TEST_SYMBOL_TABLE
+#define CAOCO_TEST_SYMBOL_TABLE_Identities 1
+#define CAOCO_TEST_SYMBOL_TABLE_Types 1
+#define CAOCO_TEST_SYMBOL_TABLE_Benchmark 1
+#endif
+
+#if CAOCO_TEST_SYMBOL_TABLE_Identities
+MINITEST(TestSymbolTable, TestCaseIdentities) {
+  using enum eIdentityCategory;
+  CeIdentityTable table;
+  EXPECT_TRUE(table.IsEmpty());
+  auto x = table.Add("x", kVariable, 0);
+  ASSERT_TRUE(x.has_value());
+  EXPECT_FALSE(table.Add("x", kVariable, 0).has_value());
+  EXPECT_TRUE(table.Add("x", kMethod, 0).has_value());
+  EXPECT_TRUE(table.Add("x", kVariable, 2).has_value());
+  EXPECT_TRUE(table.Contains("x", kVariable, 0));
+  EXPECT_FALSE(table.Contains("y", kVariable, 0));
+  EXPECT_FALSE(table.Contains("x", kObject, 0));
+  EXPECT_EQ(table.Get("x", kVariable, 2)->get().scope_index, 2);
+
+  // Handles and references stay valid while the table grows.
+  const CeIdentity& first = table.At(*x);
+  for (int i = 0; i < 1000; i++) {
+    table.Add("name" + std::to_string(i), kVariable, i % 7);
+  }
+  EXPECT_EQ(&first, &table.At(*x));
+  EXPECT_EQ(first.name, "x");
+  EXPECT_EQ(table.Size(), 1003);
+
+  // Scopes 0 <- 1 <- 2 and 0 <- 3. The innermost declaration is found.
+  CeScopeParents parents{0, 0, 1, 0};
+  auto symbol = *table.Symbols().Find("x");
+  EXPECT_EQ(table.Resolve(symbol, kVariable, 2, parents),
+            table.Find(symbol, kVariable, 2));
+  EXPECT_EQ(table.Resolve(symbol, kVariable, 1, parents), x);
+  EXPECT_EQ(table.Resolve(symbol, kVariable, 3, parents), x);
+  EXPECT_FALSE(table.Resolve(symbol, kObject, 3, parents).has_value());
+
+  // Removed names are not found, probes skip their tombstones.
+  table.Remove("x", kVariable, 0);
+  EXPECT_FALSE(table.Contains("x", kVariable, 0));
+  EXPECT_TRUE(table.Contains("x", kMethod, 0));
+  EXPECT_TRUE(table.Contains("name999", kVariable, 999 % 7));
+  EXPECT_FALSE(table.Resolve(symbol, kVariable, 3, parents).has_value());
+  EXPECT_TRUE(table.Add("x", kVariable, 0).has_value());
+  table.Clear();
+  EXPECT_TRUE(table.IsEmpty());
+  EXPECT_FALSE(table.Contains("x", kMethod, 0));
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_SYMBOL_TABLE_Types
+MINITEST(TestSymbolTable, TestCaseTypes) {
+  // Tables sharing an interner agree on the ids.
+  CeSymbolInterner symbols;
+  CeIdentityTable identities(symbols);
+  CeTypeTable types(symbols);
+  identities.Add("Int", eIdentityCategory::kObject, 0);
+  auto handle = types.Add("Int", 0, 1);
+  ASSERT_TRUE(handle.has_value());
+  EXPECT_EQ(types.At(*handle).symbol,
+            identities.Get("Int", eIdentityCategory::kObject, 0)->get().symbol);
+  EXPECT_EQ(symbols.Size(), 1);
+
+  EXPECT_FALSE(types.Add("Int", 0, 2).has_value());
+  EXPECT_EQ(types.Replace("Int", 0, 3)->get().type_index, 3);
+  EXPECT_EQ(types.At(*handle).type_index, 3);
+  EXPECT_FALSE(types.Replace("Real", 0, 3).has_value());
+  EXPECT_EQ(types.Alias("Int", 0, "Number", 1)->get().type_index, 3);
+  EXPECT_FALSE(types.Alias("Int", 0, "Number", 1).has_value());
+  EXPECT_FALSE(types.Alias("Real", 0, "Float", 1).has_value());
+  EXPECT_EQ(*types.Resolve(*symbols.Find("Int"), 1, {0, 0}), *handle);
+  types.Remove("Int", 0);
+  EXPECT_FALSE(types.Contains("Int", 0));
+  EXPECT_TRUE(types.Contains("Number", 1));
+
+  // The keys view the names, so an interner moves but does not copy.
+  static_assert(!std::is_copy_constructible_v<CeSymbolInterner>);
+  static_assert(!std::is_copy_assignable_v<CeSymbolInterner>);
+  CeSymbolInterner moved(std::move(symbols));
+  for (int i = 0; i < 100; i++) moved.Intern("name" + std::to_string(i));
+  EXPECT_EQ(moved.Find("Int"), std::optional<CeSymbolId>(0));
+  EXPECT_EQ(moved.Name(*moved.Find("name99")), "name99");
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_SYMBOL_TABLE_Benchmark
+// 10^5 identifiers over a tree of nested scopes. Each lookup walks the scope
+// chain, the baseline is the ordered set the tables used before.
+MINITEST(TestSymbolTable, TestCaseBenchmark) {
+  using enum eIdentityCategory;
+  constexpr std::size_t kScopes = 2000;
+  constexpr std::size_t kNamesPerScope = 50;
+  CeScopeParents parents(kScopes);
+  for (std::size_t scope = 0; scope < kScopes; scope++) {
+    parents[scope] = scope / 2;
+  }
+  // Nested scopes reuse names, there are 10^4 distinct ones.
+  lambda xName = [](std::size_t scope, std::size_t i) {
+    return "v" + std::to_string((scope * kNamesPerScope + i * 7) % 10007);
+  };
+  // Names declared 0 to 3 scopes up.
+  std::vector<std::pair<std::string, CeScopeIndex>> lookups;
+  for (std::size_t scope = 0; scope < kScopes; scope++) {
+    for (std::size_t i = 0; i < kNamesPerScope; i++) {
+      lookups.emplace_back(xName(scope >> (i % 4), i), scope);
+    }
+  }
+
+  using SetKey = std::tuple<std::string, eIdentityCategory, CeScopeIndex>;
+  std::set<SetKey> set;
+  CeIdentityTable table;
+  lambda xTime = [](auto&& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  auto set_add_us = xTime([&] {
+    for (std::size_t scope = 0; scope < kScopes; scope++) {
+      for (std::size_t i = 0; i < kNamesPerScope; i++) {
+        SetKey key{xName(scope, i), kVariable, scope};
+        if (set.insert(key).second) set.find(key);
+      }
+    }
+  });
+  auto table_add_us = xTime([&] {
+    for (std::size_t scope = 0; scope < kScopes; scope++) {
+      for (std::size_t i = 0; i < kNamesPerScope; i++) {
+        table.Add(xName(scope, i), kVariable, scope);
+      }
+    }
+  });
+  std::size_t set_found = 0;
+  auto set_lookup_us = xTime([&] {
+    for (const auto& [name, from] : lookups) {
+      for (CeScopeIndex scope = from;; scope = parents[scope]) {
+        SetKey key{name, kVariable, scope};
+        if (set.contains(key)) {
+          set_found += std::get<2>(*set.find(key)) <= from;
+          break;
+        }
+        if (parents[scope] == scope) break;
+      }
+    }
+  });
+  std::size_t table_found = 0;
+  auto table_lookup_us = xTime([&] {
+    for (const auto& [name, from] : lookups) {
+      auto symbol = table.Symbols().Find(name);
+      if (!symbol.has_value()) continue;
+      auto found = table.Resolve(*symbol, kVariable, from, parents);
+      if (found.has_value()) {
+        table_found += table.At(*found).scope_index <= from;
+      }
+    }
+  });
+  EXPECT_EQ(table.Size(), kScopes * kNamesPerScope);
+  EXPECT_EQ(set_found, lookups.size());
+  EXPECT_EQ(table_found, lookups.size());
+  std::cout << "[Symbol Table Benchmark] identifiers: " << table.Size()
+            << ", add: std::set: " << set_add_us
+            << "us, hashed: " << table_add_us
+            << "us, scope chain lookup: std::set: " << set_lookup_us
+            << "us, hashed: " << table_lookup_us << "us" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_symbol_table.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_SYMBOL_TABLE_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
@@ -0,0 +1,175 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_tail_calls.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_TAIL_CALLS_H
+#define HEADER_GUARD_CAOCO_UT0_TAIL_CALLS_H
+// Includes:
+#include "cand_driver.h"
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "ir_optimizer.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_TAIL_CALLS true
+
+#if CAOCO_TEST_TAIL_CALLS
+#define CAOCO_TEST_TAIL_CALLS_Generation 1
+#define CAOCO_TEST_TAIL_CALLS_Evaluation 1
+#define CAOCO_TEST_TAIL_CALLS_DepthLimit 1
+#define CAOCO_TEST_TAIL_CALLS_Benchmark 1
+#endif
+
+// Depth of the benchmark, debug builds interpret too slowly for 10^7.
+#ifdef NDEBUG
+static constexpr int kTailCallBenchmarkDepth = 10000000;
+#else
+static constexpr int kTailCallBenchmarkDepth = 1000000;
+#endif
+
+static const std::string kTailCallTestSource =
+    "def @r: 0; def @e: 0; def @m: 0;"
+    "fn@count(n, acc):{ if(n == 0){ return acc; }; return count(n - 1, acc + 1); };"
+    "fn@even(n):{ if(n == 0){ return true; }; return odd(n - 1); };"
+    "fn@odd(n):{ if(n == 0){ return false; }; return even(n - 1); };"
+    "class @Counter:{ def @n: 0;"
+    "  fn@up(k):{ if(k == 0){ return n; }; n = n + 1; return up(k - 1); }; };"
+    "fn@run(c, k):{ return c.up(k); };"
+    "main: {"
+    "  r = count(100000, 0);"
+    "  e = even(100001);"
+    "  def @c: Counter();"
+    "  m = run(c, 5000) + run(c, 10);"
+    "};";
+
+#if CAOCO_TEST_TAIL_CALLS_Generation
+MINITEST(TestTailCalls, TestCaseGeneration) {
+  auto code = IrTestGenerate(
+      "def @x: 0;"
+      "fn@f(n):{ return n; };"
+      "fn@g(n):{ return f(n); };"
+      "fn@h(n):{ return f(n) + 1; };"
+      "main: { x = g(1); };");
+  ASSERT_FALSE(code.isAborted());
+  EXPECT_TRUE(IrVerifier::Verify(code).Valid());
+  // Only the call returned as is is in tail position.
+  EXPECT_EQ(IrTestCount(code, eIrOp::TAIL_CALL), 1);
+  const auto& lines = code.GetLines();
+  for (auto line = lines.begin(); line != lines.end(); line++) {
+    if (line->op == eIrOp::TAIL_CALL) {
+      EXPECT_TRUE(std::next(line)->op == eIrOp::CALL);
+    }
+  }
+
+  // The optimized program keeps its tail calls.
+  auto optimized = IrTestGenerate(kTailCallTestSource);
+  EXPECT_TRUE(IrPassManager::StandardPipeline().Run(optimized).Valid());
+  EXPECT_EQ(IrTestCount(optimized, eIrOp::TAIL_CALL), 5);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_TAIL_CALLS_Evaluation
+// Self recursion, mutual recursion and member calls deeper than the native
+// stack would allow without tail calls.
+MINITEST(TestTailCalls, TestCaseEvaluation) {
+  auto code = IrTestGenerate(kTailCallTestSource);
+  auto optimized = code;
+  IrPassManager::StandardPipeline().Run(optimized);
+  for (const auto* program : {&code, &optimized}) {
+    Environment env;
+    Evaluator{env}.Evaluate(*program);
+    EXPECT_EQ(env.LookupVariable("r")->GetInt(), 100000);
+    EXPECT_FALSE(env.LookupVariable("e")->GetBool());
+    EXPECT_EQ(env.LookupVariable("m")->GetInt(), 5000 + 5010);
+  }
+
+  // A returned constructor call is evaluated in place, as a return.
+  Environment env;
+  Evaluator{env}.Evaluate(IrTestGenerate(
+      "def @x: 0;"
+      "class @C:{ def @v: 7; fn@get:{ return v; }; };"
+      "fn@make:{ return C(); };"
+      "main: { def @c: make(); x = c.get() + make().get(); };"));
+  EXPECT_EQ(env.LookupVariable("x")->GetInt(), 14);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_TAIL_CALLS_DepthLimit
+// Deep recursion which is not a tail call fails with an error in the driver,
+// before the native stack overflows. Tail calls are not limited.
+MINITEST(TestTailCalls, TestCaseDepthLimit) {
+  auto run = [](const std::string& source, std::string& out) {
+    auto path = std::filesystem::temp_directory_path() / "ut0_depth.cand";
+    std::ofstream(path) << source;
+    std::istringstream in;
+    std::ostringstream out_stream;
+    std::ostringstream err;
+    int exit_code =
+        CandDriver::Main({"run", path.string()}, in, out_stream, err);
+    std::filesystem::remove(path);
+    out = out_stream.str() + err.str();
+    return exit_code;
+  };
+  auto recursion = [](int depth) {
+    return "fn@f(a):{ if(a == 0){ return 0; }; return 1 + f(a - 1); };"
+           "main: { cout(f(" + std::to_string(depth) + ")); };";
+  };
+  std::string out;
+  EXPECT_EQ(run(recursion(100000), out), 1);
+  EXPECT_EQ(out, std::string(kEvaluatorErrorFrameLimit) + "\n");
+  EXPECT_EQ(run(recursion(kEvaluatorDefaultFrameLimit - 1), out), 0);
+  EXPECT_EQ(out, std::to_string(kEvaluatorDefaultFrameLimit - 1) + "\n");
+  EXPECT_EQ(run(kTailCallTestSource, out), 0);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_TAIL_CALLS_Benchmark
+// Deep self recursion runs as a loop, in the stack of one frame.
+MINITEST(TestTailCalls, TestCaseBenchmark) {
+  auto code = IrTestGenerate(
+      "def @r: 0;"
+      "fn@count(n, acc):{ if(n == 0){ return acc; }; return count(n - 1, acc + 1); };"
+      "main: { r = count(" + std::to_string(kTailCallBenchmarkDepth) + ", 0); };");
+  auto start = std::chrono::steady_clock::now();
+  Environment env;
+  Evaluator evaluator{env};
+  evaluator.Evaluate(code);
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+  EXPECT_EQ(env.LookupVariable("r")->GetInt(), kTailCallBenchmarkDepth);
+  std::cout << "[Tail Call Benchmark] recursion depth "
+            << kTailCallBenchmarkDepth << ": " << ms
+            << "ms, " << evaluator.TierTransitions().size()
+            << " tier transitions" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_tail_calls.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_TAIL_CALLS_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
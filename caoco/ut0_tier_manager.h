@@ -0,0 +1,160 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_tier_manager.h
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_UT0_TIER_MANAGER_H
+#define HEADER_GUARD_CAOCO_UT0_TIER_MANAGER_H
+// Includes:
+#include "evaluator.h"
+#include "ir_codegen.h"
+#include "tier_manager.h"
+#include "minitest_flags.h"  // Flags to enable or disable the unit tests
+#include "minitest_pch.h"    // All pre includes for each unit test
+#include "minitest_util.h"   // Utility methods shared among the all unit tests
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+#define CAOCO_TEST_TIER_MANAGER true
+
+#if CAOCO_TEST_TIER_MANAGER
+#define CAOCO_TEST_TIER_MANAGER_Transitions 1
+#define CAOCO_TEST_TIER_MANAGER_Deoptimization CAOCO_JIT_SUPPORTED
+#define CAOCO_TEST_TIER_MANAGER_Benchmark 1
+#endif
+
+#if CAOCO_TEST_TIER_MANAGER_Transitions
+MINITEST(TestTierManager, TestCaseTransitions) {
+  auto code = IrTestGenerate(
+      "def @total: 0; def @calls: 0;\n"
+      "fn@count:{ calls = calls + 1; return calls; };\n"
+      "main: {\n"
+      "  def @i: 0;\n"
+      "  while(i < 100){\n"
+      "    total = total + i * 3;\n"
+      "    i++;\n"
+      "  };\n"
+      "  count(); count(); count();\n"
+      "};\n");
+  Environment env;
+  Evaluator evaluator{env};
+  evaluator.SetTierOptions(TierOptions{true, 2})
+      .SetJitOptions(JitOptions{CAOCO_JIT_SUPPORTED == 1, 10})
+      .Evaluate(code);
+
+  // The loop is promoted at its back edges, the method at its calls.
+  // Neither has enough calls or back edges for the next tier.
+  const auto& transitions = evaluator.TierTransitions();
+  std::vector<TierTransition> loop;
+  std::vector<TierTransition> method;
+  for (const auto& t : transitions) (t.osr ? loop : method).push_back(t);
+  ASSERT_EQ(method.size(), 1);
+  EXPECT_TRUE(method[0].from == eTier::kInterpreter);
+  EXPECT_TRUE(method[0].to == eTier::kBytecode);
+  EXPECT_EQ(method[0].count, 2);
+  EXPECT_EQ(method[0].source_line, 2);
+  ASSERT_EQ(loop.size(), CAOCO_JIT_SUPPORTED ? 2 : 1);
+  EXPECT_TRUE(loop[0].to == eTier::kBytecode);
+  EXPECT_EQ(loop[0].count, 2);
+  EXPECT_EQ(loop[0].source_line, 5);
+  if (loop.size() == 2) {
+    EXPECT_TRUE(loop[1].from == eTier::kBytecode);
+    EXPECT_TRUE(loop[1].to == eTier::kJit);
+    EXPECT_EQ(loop[1].count, 10);
+    EXPECT_EQ(loop[1].unit, loop[0].unit);
+  }
+  EXPECT_TRUE(evaluator.Tiers().Tier(method[0].unit) == eTier::kBytecode);
+
+  // Same results in every tier.
+  Environment plain_env;
+  Evaluator{plain_env}
+      .SetTierOptions(TierOptions{true, 1000})
+      .EnableJit(false)
+      .Evaluate(code);
+  EXPECT_EQ(env.LookupVariable("total")->GetInt(),
+            plain_env.LookupVariable("total")->GetInt());
+  EXPECT_EQ(env.LookupVariable("calls")->GetInt(), 3);
+
+  // Eager bytecode records no transitions, straight line code none either.
+  Environment eager_env;
+  Evaluator eager{eager_env};
+  eager.SetTierOptions(TierOptions{false}).EnableJit(false).Evaluate(code);
+  EXPECT_TRUE(eager.TierTransitions().empty());
+  Environment once_env;
+  Evaluator once{once_env};
+  once.Evaluate(IrTestGenerate("def @a: 1; main: { a = a + 1; };"));
+  EXPECT_TRUE(once.TierTransitions().empty());
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_TIER_MANAGER_Deoptimization
+// A loop which overflows on every iteration leaves the JIT tier.
+MINITEST(TestTierManager, TestCaseDeoptimization) {
+  auto code = IrTestGenerate(
+      "def @x: 1; def @n: 0;"
+      "main: { while(n < 200){ x = x * 3; n++; }; };");
+  Environment env;
+  Evaluator evaluator{env};
+  evaluator.SetTierOptions(TierOptions{true, 2})
+      .SetJitOptions(JitOptions{true, 4})
+      .Evaluate(code);
+  const auto& transitions = evaluator.TierTransitions();
+  ASSERT_EQ(transitions.size(), 3);
+  EXPECT_TRUE(transitions[1].to == eTier::kJit);
+  EXPECT_TRUE(transitions[2].from == eTier::kJit);
+  EXPECT_TRUE(transitions[2].to == eTier::kBytecode);
+  EXPECT_FALSE(transitions[2].osr);
+}
+END_MINITEST;
+#endif
+
+#if CAOCO_TEST_TIER_MANAGER_Benchmark
+// Evaluation of the corpus with every line starting in the bytecode tier,
+// and with tiers.
+MINITEST(TestTierManager, TestCaseBenchmark) {
+  long long eager_us = 0;
+  long long tiered_us = 0;
+  std::size_t transitions = 0;
+  for (const auto& source : kIrSuperinstructionCorpus) {
+    auto code = IrSuperinstructionTestCode(source);
+    lambda xTime = [&](const TierOptions& options) {
+      auto start = std::chrono::steady_clock::now();
+      Environment env;
+      Evaluator evaluator{env};
+      evaluator.SetTierOptions(options).Evaluate(code);
+      if (options.enabled) transitions += evaluator.TierTransitions().size();
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now() - start)
+          .count();
+    };
+    eager_us += xTime(TierOptions{false});
+    tiered_us += xTime(TierOptions{});
+  }
+  EXPECT_TRUE(transitions > 0);
+  std::cout << "[Tier Benchmark] corpus: eager bytecode: " << eager_us
+            << "us, tiered: " << tiered_us << "us, " << transitions
+            << " transitions" << std::endl;
+}
+END_MINITEST;
+#endif
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: unit_tests
+// File: ut0_tier_manager.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_UT0_TIER_MANAGER_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
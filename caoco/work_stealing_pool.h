@@ -0,0 +1,117 @@
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: castd
+// File: work_stealing_pool.h
+//---------------------------------------------------------------------------//
+// Brief: Runs a batch of independent tasks on worker threads.
+//---------------------------------------------------------------------------//
+#ifndef HEADER_GUARD_CAOCO_CASTD_WORK_STEALING_POOL_H
+#define HEADER_GUARD_CAOCO_CASTD_WORK_STEALING_POOL_H
+// Includes:
+#include "import_stl.h"
+#include "phase_timer.h"
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//
+
+//=-------------------------------------------------------------------------=//
+// WorkStealingPool
+//---------------------------------------------------------------------------//
+// Tasks are dealt round robin to a queue per worker. A worker takes the last
+// task of its own queue, and once it is empty steals the first task of the
+// other queues, so workers given short tasks help the ones given long tasks.
+// A batch runs on its own threads, which exit when every queue is empty, and
+// record their phases into the timer of the thread running the batch.
+class WorkStealingPool {
+ public:
+  using Task = std::function<void()>;
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+  std::size_t threads_;
+
+  static std::optional<Task> Pop(Queue& queue, bool steal) {
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) return std::nullopt;
+    Task task;
+    if (steal) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+    return task;
+  }
+
+ public:
+  // 0 threads uses one per hardware thread.
+  explicit WorkStealingPool(std::size_t threads = 0)
+      : threads_(threads != 0
+                     ? threads
+                     : std::max<std::size_t>(
+                           1, std::thread::hardware_concurrency())) {}
+
+  std::size_t Threads() const { return threads_; }
+
+  // Runs every task and returns once all have finished. The first exception
+  // thrown by a task is rethrown here, after the others finished.
+  void Run(std::vector<Task> tasks) const {
+    auto workers = std::min(threads_, tasks.size());
+    if (workers <= 1) {
+      for (auto& task : tasks) task();
+      return;
+    }
+    std::vector<Queue> queues(workers);
+    for (std::size_t i = 0; i < tasks.size(); i++) {
+      queues[i % workers].tasks.push_back(std::move(tasks[i]));
+    }
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto timer = PhaseTimer::Active();
+    lambda xWork = [&](std::size_t self) {
+      PhaseTimer::Adopt adopt(timer);
+      for (;;) {
+        auto task = Pop(queues[self], false);
+        for (std::size_t i = 1; !task && i < workers; i++) {
+          task = Pop(queues[(self + i) % workers], true);
+        }
+        if (!task) return;
+        try {
+          (*task)();
+        } catch (...) {
+          std::lock_guard lock(error_mutex);
+          if (!error) error = std::current_exception();
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < workers; i++) threads.emplace_back(xWork, i);
+    xWork(0);
+    for (auto& thread : threads) thread.join();
+    if (error) std::rethrow_exception(error);
+  }
+};
+
+//=-------------------------------------------------------------------------=//
+//---------------------------------------------------------------------------//
+// All Rights Reserved | Copyright 2024 NTONE INC.
+// Author: Anton Yashchenko
+// Email: ntondev@gmail.com
+// Website: https://www.bigteeny.com
+//---------------------------------------------------------------------------//
+// Project: caoco
+// Directory: castd
+// File: work_stealing_pool.h
+//---------------------------------------------------------------------------//
+#endif HEADER_GUARD_CAOCO_CASTD_WORK_STEALING_POOL_H
+//---------------------------------------------------------------------------//
+//=-------------------------------------------------------------------------=//